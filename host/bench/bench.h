@@ -0,0 +1,44 @@
+/*
+ * bench.h
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct BenchOptions {
+	uint32_t	num_blocks;		// blocks (or iterations) to measure
+	uint8_t		csv;			// print csv instead of a table
+	const char	*out_file;		// -o: where to save what was measured (isr: the traces)
+} BenchOptions;
+
+int bench_audio(const BenchOptions *opt);
+int bench_resample(const BenchOptions *opt);
+int bench_latency(const BenchOptions *opt);
+int bench_exp2(const BenchOptions *opt);
+int bench_graph(const BenchOptions *opt);
+int bench_isr(const BenchOptions *opt);
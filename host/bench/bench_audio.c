@@ -0,0 +1,202 @@
+/*
+ * bench_audio.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Audio callback benchmark: runs process_audio_block_codec() in the full engine
+// under several scripted loads and reports the per-stage timing from audio_profile.h
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "globals.h"
+#include "oscillator.h"
+#include "params_update.h"
+#include "ui_modes.h"
+#include "wavetable_editing.h"
+#include "audio_profile.h"
+
+#include "host_engine.h"
+#include "bench.h"
+
+#define DEFAULT_BLOCKS		20000
+#define WARMUP_BLOCKS		500
+#define MAX_SETUP_BLOCKS	(SAMPLERATE * 10 / HOST_BLOCK_FRAMES)
+
+extern enum UI_Modes 	ui_mode;
+extern o_wt_osc			wt_osc;
+extern o_params			params;
+
+typedef struct AudioScenario {
+	const char *name;
+	void (*enter)(void);
+	void (*per_block)(uint32_t block);
+	void (*exit)(void);
+} AudioScenario;
+
+static void run_blocks(uint32_t num_blocks, void (*per_block)(uint32_t));
+
+//
+// Scenarios
+//
+
+// Re-arm the crossfade on all channels every block, so all 6 are always crossfading
+static void xfade_all_per_block(uint32_t block)
+{
+	uint8_t chan;
+
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+		wt_osc.wt_xfade[chan] = 1.0f;
+}
+
+// Sweep the sliders (level) and pan of every channel at audio rate
+static void panlevel_per_block(uint32_t block)
+{
+	uint8_t chan;
+	float ph;
+
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+	{
+		ph = (float)block * 0.05f + chan;
+		params.pan[chan] = 0.5f + 0.5f * sinf(ph * 1.7f);
+		host_engine_set_slider(chan, (uint16_t)(2048.f + 2000.f * sinf(ph)));
+	}
+}
+
+static void panlevel_exit(void)
+{
+	uint8_t chan;
+
+	for (chan = 0; chan < NUM_CHANNELS; chan++) {
+		params.pan[chan] = default_pan(chan);
+		host_engine_set_slider(chan, 4095);
+	}
+}
+
+static void wait_for_render(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < MAX_SETUP_BLOCKS && ui_mode == WTRENDERING; i++)
+		run_blocks(1, NULL);
+}
+
+static void wtttone_enter(void)
+{
+	enter_wtediting();
+	wait_for_render();
+	enter_wtttone();
+}
+
+static void wtmonitoring_enter(void)
+{
+	enter_wtediting();
+	wait_for_render();
+	enter_wtmonitoring();
+}
+
+static const AudioScenario scenarios[] = {
+	{"play", 			NULL, 					NULL, 					NULL},
+	{"xfade_6ch", 		NULL, 					xfade_all_per_block, 	NULL},
+	{"panlevel_mod", 	NULL, 					panlevel_per_block, 	panlevel_exit},
+	{"wtttone", 		wtttone_enter, 			NULL, 					exit_wtediting},
+	{"wtmonitoring", 	wtmonitoring_enter, 	NULL, 					exit_wtediting},
+};
+#define NUM_SCENARIOS (sizeof(scenarios)/sizeof(scenarios[0]))
+
+//
+// Runs blocks with a 220Hz sine on the audio input
+//
+static void run_blocks(uint32_t num_blocks, void (*per_block)(uint32_t))
+{
+	static uint32_t in_phase = 0;
+	int32_t src[HOST_BLOCK_WORDS], dst[HOST_BLOCK_WORDS];
+	uint32_t block, i;
+
+	for (block = 0; block < num_blocks; block++)
+	{
+		for (i = 0; i < HOST_BLOCK_FRAMES; i++, in_phase++) {
+			src[i*2] = (int32_t)(0x200000 * sinf(2.f * M_PI * 220.f * (float)in_phase / F_SAMPLERATE));
+			src[i*2+1] = 0;
+		}
+
+		if (per_block) per_block(block);
+
+		host_engine_run_block(src, dst);
+	}
+}
+
+static void print_results(const char *scenario, const BenchOptions *opt)
+{
+	o_audio_profile_summary sum;
+	uint8_t stage;
+
+	if (!opt->csv)
+		printf("\n%s (%u blocks)\n  %-16s %12s %12s %12s\n", scenario, (unsigned)audio_profile.num_blocks,
+				"stage", "ns/sample", "worst ns", "jitter ns");
+
+	for (stage = 0; stage < NUM_AUDIO_PROFILE_STAGES; stage++)
+	{
+		audio_profile_get_summary(stage, HOST_BLOCK_FRAMES, &sum);
+		if (opt->csv)
+			printf("audio,%s,%s,%.3f,%.1f,%.1f\n", scenario, audio_profile_stage_name(stage),
+					sum.ns_per_sample, sum.worst_ns, sum.jitter_ns);
+		else
+			printf("  %-16s %12.3f %12.1f %12.1f\n", audio_profile_stage_name(stage),
+					sum.ns_per_sample, sum.worst_ns, sum.jitter_ns);
+	}
+}
+
+int bench_audio(const BenchOptions *opt)
+{
+	uint32_t num_blocks = opt->num_blocks ? opt->num_blocks : DEFAULT_BLOCKS;
+	const AudioScenario *s;
+	uint32_t i;
+
+	host_engine_init(NULL);
+	audio_profile_init();
+
+	if (!opt->csv)
+		printf("Audio callback: %u frames/block, probe overhead %.1f cycles, %.0f cycles/us\n",
+				(unsigned)HOST_BLOCK_FRAMES, audio_profile.lap_overhead, AUDIO_PROFILE_CYCLES_PER_US());
+
+	for (i = 0; i < NUM_SCENARIOS; i++)
+	{
+		s = &scenarios[i];
+
+		if (s->enter) s->enter();
+		run_blocks(WARMUP_BLOCKS, s->per_block);
+
+		audio_profile_reset();
+		run_blocks(num_blocks, s->per_block);
+		print_results(s->name, opt);
+
+		if (s->exit) s->exit();
+		run_blocks(WARMUP_BLOCKS, NULL);
+	}
+	return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * bench_exp2.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// exp2 benchmark: converts a sweep of 1V/oct ADC values (0 to 4095, in fractional steps,
+// like the calibrated and oversampled CV) to a frequency multiplier with the old table
+// lookup and each tier of math_approx.h. Reports the time per call, and the worst error
+// in cents against the exact curve and against the table.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "math_approx.h"
+#include "math_util.h"
+#include "exp_1voct_10_41V.h"
+#include "audio_profile.h"
+
+#include "bench.h"
+
+#define DEFAULT_SWEEPS		2000
+#define SWEEP_STEP			0.37f
+#define SWEEP_LEN			11068			// 4095 / SWEEP_STEP
+
+// The firmware's interpolate_voct(), before math_approx.h
+static float table_voct(float adc_val)
+{
+	uint16_t i_val = (uint16_t)adc_val;
+	float f_val = adc_val - (float)i_val;
+
+	if (i_val >= 4095) return exp_1voct_10_41V[4095];
+	return _CROSSFADE(exp_1voct_10_41V[i_val], exp_1voct_10_41V[i_val+1], f_val);
+}
+
+static float libm_voct(float adc_val)
+{
+	return exp2f((adc_val + 1.f) * EXP_1VOCT_OCT_PER_STEP);
+}
+
+typedef struct Exp2Scenario {
+	const char 	*name;
+	float 		(*voct)(float adc_val);
+} Exp2Scenario;
+
+static const Exp2Scenario scenarios[] = {
+	{"table",	table_voct},
+	{"libm",	libm_voct},
+	{"pitch",	exp_1voct_pitch},
+	{"led",		exp_1voct_led},
+};
+#define NUM_SCENARIOS (sizeof(scenarios)/sizeof(scenarios[0]))
+
+static float sweep[SWEEP_LEN];
+
+static double cents(double a, double b)
+{
+	return fabs(1200.0 * log2(a / b));
+}
+
+// Worst error over the sweep, ignoring the first step (a straight line, in the table and exp_1voct_pitch())
+// and the last value (the table rounds it to 1370.0)
+static void max_errors(float (*voct)(float), double *vs_exact, double *vs_table)
+{
+	double exact;
+	float adc;
+
+	*vs_exact = *vs_table = 0;
+	for (adc = 1.f; adc < 4095.f; adc += 0.125f)
+	{
+		exact = exp2(((double)adc + 1.0) * (double)EXP_1VOCT_OCT_PER_STEP);
+		*vs_exact = fmax(*vs_exact, cents(voct(adc), exact));
+		*vs_table = fmax(*vs_table, cents(voct(adc), table_voct(adc)));
+	}
+}
+
+int bench_exp2(const BenchOptions *opt)
+{
+	uint32_t num_sweeps = opt->num_blocks ? opt->num_blocks : DEFAULT_SWEEPS;
+	float cycles_per_ns = AUDIO_PROFILE_CYCLES_PER_US() / 1000.f;
+	const Exp2Scenario *s;
+	uint32_t t, dt, worst;
+	double total, total_sq, mean, jitter, err_exact, err_table;
+	volatile float sink;
+	float acc;
+	uint32_t i, j, n;
+
+	for (i=0; i<SWEEP_LEN; i++)
+		sweep[i] = (float)i * SWEEP_STEP;
+
+	if (!opt->csv)
+		printf("\n1V/oct exp2: %u values per sweep, %u sweeps\n  %-8s %12s %12s %12s %14s %14s\n",
+				(unsigned)SWEEP_LEN, (unsigned)num_sweeps, "method", "ns/call", "worst ns", "jitter ns", "cents (exact)", "cents (table)");
+
+	for (i=0; i<NUM_SCENARIOS; i++)
+	{
+		s = &scenarios[i];
+		total = total_sq = 0;
+		worst = 0;
+		acc = 0;
+
+		for (n=0; n<num_sweeps; n++)
+		{
+			t = AUDIO_PROFILE_CYCLES();
+			for (j=0; j<SWEEP_LEN; j++)
+				acc += s->voct(sweep[j]);
+			dt = AUDIO_PROFILE_CYCLES() - t;
+
+			total += dt;
+			total_sq += (double)dt * dt;
+			if (dt > worst) worst = dt;
+		}
+		sink = acc;
+		(void)sink;
+
+		mean = total / num_sweeps;
+		jitter = sqrt(fmax(total_sq / num_sweeps - mean * mean, 0.0));
+		max_errors(s->voct, &err_exact, &err_table);
+
+		if (opt->csv)
+			printf("exp2,%s,voct,%.3f,%.1f,%.1f\n", s->name,
+					mean / SWEEP_LEN / cycles_per_ns, worst / cycles_per_ns, jitter / cycles_per_ns);
+		else
+			printf("  %-8s %12.3f %12.1f %12.1f %14.5f %14.5f\n", s->name,
+					mean / SWEEP_LEN / cycles_per_ns, worst / cycles_per_ns, jitter / cycles_per_ns, err_exact, err_table);
+	}
+	return 0;
+}
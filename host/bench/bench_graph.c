@@ -0,0 +1,186 @@
+/*
+ * bench_graph.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Param graph benchmark: times update_oscillators() (the OSC timer) with the param graph
+// off (every node runs on every tick, as before) and on, for a static patch,
+// with CV moving on the 1V/oct jacks, and with a button held down.
+// Also prints how often each node ran with the graph on.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "globals.h"
+#include "params_update.h"
+#include "params_graph.h"
+#include "analog_conditioning.h"
+#include "hardware_controls.h"
+#include "audio_profile.h"
+
+#include "host_engine.h"
+#include "bench.h"
+
+#define DEFAULT_TICKS		20000
+#define SETTLE_BLOCKS		100
+#define BLOCKS_PER_CV_STEP	8
+
+extern o_analog	analog[NUM_ANALOG_ELEMENTS];
+extern o_button	button[NUM_BUTTONS];
+
+enum GraphScenarios {
+	GS_STATIC,
+	GS_VOCT_CV,
+	GS_BUTTON_HELD,
+
+	NUM_GRAPH_SCENARIOS
+};
+
+static const char *scenario_names[NUM_GRAPH_SCENARIOS] = {"static", "voct_cv", "button_held"};
+
+static void set_voct_jacks(uint8_t plugged)
+{
+	uint8_t chan;
+
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+	{
+		if (plugged)
+			analog[A_VOCT + chan].plug_sense_switch.gpio->IDR &= ~analog[A_VOCT + chan].plug_sense_switch.pin;
+		else
+			analog[A_VOCT + chan].plug_sense_switch.gpio->IDR |= analog[A_VOCT + chan].plug_sense_switch.pin;
+	}
+}
+
+static void set_button(uint8_t but, uint8_t pressed)
+{
+	if (pressed)
+		button[but].hwswitch.gpio->IDR &= ~button[but].hwswitch.pin;
+	else
+		button[but].hwswitch.gpio->IDR |= button[but].hwswitch.pin;
+}
+
+static void run_blocks(uint32_t num_blocks)
+{
+	int32_t src[HOST_BLOCK_WORDS] = {0}, dst[HOST_BLOCK_WORDS];
+	uint32_t i;
+
+	for (i = 0; i < num_blocks; i++)
+		host_engine_run_block(src, dst);
+}
+
+static void setup_scenario(enum GraphScenarios scenario)
+{
+	set_voct_jacks(scenario == GS_VOCT_CV);
+	set_button(butm_A_BUTTON, scenario == GS_BUTTON_HELD);
+	run_blocks(SETTLE_BLOCKS);
+}
+
+// Between ticks, the engine runs a block, so the ADCs, the analog conditioning and the UI timer keep going
+static void step_scenario(enum GraphScenarios scenario, uint32_t tick)
+{
+	uint8_t chan;
+
+	if (scenario == GS_VOCT_CV && (tick % BLOCKS_PER_CV_STEP) == 0)
+	{
+		for (chan = 0; chan < NUM_CHANNELS; chan++)
+			host_engine_set_cv(A_VOCT + chan, 2048.f + (float)(((tick / BLOCKS_PER_CV_STEP) * 7 + chan) % 24) * 34.13f);
+	}
+	run_blocks(1);
+}
+
+static void print_node_runs(const BenchOptions *opt)
+{
+	uint32_t total;
+	uint8_t node;
+
+	if (opt->csv) return;
+
+	printf("    node runs:");
+	for (node = 0; node < NUM_PARAM_NODES; node++)
+	{
+		total = param_graph.node[node].runs + param_graph.node[node].skips;
+		printf(" %s %.0f%%", param_node_name(node), total ? 100.f * param_graph.node[node].runs / total : 0.f);
+	}
+	printf("\n");
+}
+
+int bench_graph(const BenchOptions *opt)
+{
+	uint32_t num_ticks = opt->num_blocks ? opt->num_blocks : DEFAULT_TICKS;
+	float cycles_per_ns = AUDIO_PROFILE_CYCLES_PER_US() / 1000.f;
+	uint32_t t, dt, worst, tick;
+	double total, total_sq, mean, jitter;
+	uint8_t scenario, enabled;
+
+	host_engine_init(NULL);
+
+	if (!opt->csv)
+		printf("\nParam graph: update_oscillators(), %u ticks per test\n  %-12s %-6s %12s %12s %12s\n",
+				(unsigned)num_ticks, "scenario", "graph", "ns/tick", "worst ns", "jitter ns");
+
+	for (scenario = 0; scenario < NUM_GRAPH_SCENARIOS; scenario++)
+	{
+		for (enabled = 0; enabled < 2; enabled++)
+		{
+			set_param_graph(enabled);
+			setup_scenario(scenario);
+			reset_param_graph_stats();
+
+			total = total_sq = 0;
+			worst = 0;
+			for (tick = 0; tick < num_ticks; tick++)
+			{
+				step_scenario(scenario, tick);
+
+				t = AUDIO_PROFILE_CYCLES();
+				update_oscillators();
+				dt = AUDIO_PROFILE_CYCLES() - t;
+
+				total += dt;
+				total_sq += (double)dt * dt;
+				if (dt > worst) worst = dt;
+			}
+
+			mean = total / num_ticks;
+			jitter = sqrt(fmax(total_sq / num_ticks - mean * mean, 0.0));
+
+			if (opt->csv)
+				printf("graph,%s,%s,%.3f,%.1f,%.1f\n", scenario_names[scenario], enabled ? "on" : "off",
+						mean / cycles_per_ns, worst / cycles_per_ns, jitter / cycles_per_ns);
+			else
+				printf("  %-12s %-6s %12.1f %12.1f %12.1f\n", scenario_names[scenario], enabled ? "on" : "off",
+						mean / cycles_per_ns, worst / cycles_per_ns, jitter / cycles_per_ns);
+
+			if (enabled)
+				print_node_runs(opt);
+		}
+	}
+
+	set_voct_jacks(0);
+	set_button(butm_A_BUTTON, 0);
+	set_param_graph(1);
+	return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * bench_isr.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Interrupt handler trace: runs the engine with isr_trace on, and reports each handler's
+// load, lateness and preemptions (see host_isr_report.c), for a static patch and for a
+// sequenced 1V/oct CV.
+// The host runs the handlers one at a time at the host's speed, on the timers' simulated time
+// (see host_isr_time_ns()), so nothing is preempted, and a handler starts late when
+// the ones before it haven't finished. The times per call are the host's, not the target's.
+// -o prefix writes each scenario's trace to prefix_<scenario>.bin, for swn_isr_report.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "globals.h"
+#include "params_update.h"
+#include "analog_conditioning.h"
+#include "isr_trace.h"
+
+#include "host_engine.h"
+#include "host_isr_report.h"
+#include "bench.h"
+
+#define DEFAULT_BLOCKS		5500		// about 2 seconds
+#define SETTLE_BLOCKS		100
+#define BLOCKS_PER_STEP		37
+#define MAX_EVENTS			(1 << 18)
+
+extern o_analog	analog[NUM_ANALOG_ELEMENTS];
+
+typedef struct IsrScenario {
+	const char 	*name;
+	uint8_t		voct_steps;
+} IsrScenario;
+
+static const IsrScenario scenarios[] = {
+	{"static", 		0},
+	{"voct_cv", 	1},
+};
+#define NUM_SCENARIOS (sizeof(scenarios)/sizeof(scenarios[0]))
+
+static o_isr_trace_event 	events[MAX_EVENTS];
+static uint32_t 			num_events;
+static uint32_t 			tail;
+static uint32_t 			lost;
+
+// Copies the new events out of the ring, before it wraps
+static void drain_trace(void)
+{
+	uint32_t head = isr_trace.hdr.head;
+
+	if (head - tail > ISR_TRACE_LEN) {
+		lost += head - tail - ISR_TRACE_LEN;
+		tail = head - ISR_TRACE_LEN;
+	}
+
+	while (tail != head)
+	{
+		if (num_events < MAX_EVENTS)
+			events[num_events++] = isr_trace.event[tail & (ISR_TRACE_LEN - 1)];
+		else
+			lost++;
+		tail++;
+	}
+}
+
+static void run_blocks(uint32_t num_blocks, uint8_t voct_steps)
+{
+	int32_t src[HOST_BLOCK_WORDS] = {0}, dst[HOST_BLOCK_WORDS];
+	uint32_t i;
+	uint8_t chan;
+	float cv;
+
+	for (i = 0; i < num_blocks; i++)
+	{
+		if (voct_steps && !(i % BLOCKS_PER_STEP)) {
+			cv = 2048.f + (float)((i / BLOCKS_PER_STEP * 7) % 24) * 34.13f;
+			for (chan = 0; chan < NUM_CHANNELS; chan++)
+				host_engine_set_cv(A_VOCT + chan, cv);
+		}
+		host_engine_run_block(src, dst);
+		drain_trace();
+	}
+}
+
+// Saves the events in the layout of the isr_trace struct, as gdb would dump it
+static int write_dump(const char *prefix, const char *scenario)
+{
+	o_isr_trace_header hdr = {0};
+	o_isr_trace_event blank = {0};
+	char filename[1024];
+	uint32_t len = 1, i;
+	FILE *f;
+
+	while (len < num_events) len <<= 1;
+
+	hdr.magic = ISR_TRACE_MAGIC;
+	hdr.len = len;
+	hdr.ticks_per_us = ISR_TRACE_TICKS_PER_US();
+	hdr.head = num_events;
+	hdr.mask = isr_trace.hdr.mask;
+
+	snprintf(filename, sizeof(filename), "%s_%s.bin", prefix, scenario);
+	if (!(f = fopen(filename, "wb"))) {
+		fprintf(stderr, "Cannot write %s\n", filename);
+		return 1;
+	}
+	fwrite(&hdr, sizeof(hdr), 1, f);
+	fwrite(events, sizeof(o_isr_trace_event), num_events, f);
+	for (i = num_events; i < len; i++)
+		fwrite(&blank, sizeof(blank), 1, f);
+	fclose(f);
+	return 0;
+}
+
+int bench_isr(const BenchOptions *opt)
+{
+	uint32_t num_blocks = opt->num_blocks ? opt->num_blocks : DEFAULT_BLOCKS;
+	const IsrScenario *s;
+	o_isr_report report;
+	uint32_t i;
+	uint8_t chan;
+	int err = 0;
+
+	host_engine_init(NULL);
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+		analog[A_VOCT + chan].plug_sense_switch.gpio->IDR &= ~analog[A_VOCT + chan].plug_sense_switch.pin;
+
+	isr_trace_init();
+
+	for (i = 0; i < NUM_SCENARIOS; i++)
+	{
+		s = &scenarios[i];
+
+		run_blocks(SETTLE_BLOCKS, s->voct_steps);
+
+		isr_trace_start(0);
+		num_events = 0;
+		tail = 0;
+		lost = 0;
+		run_blocks(num_blocks, s->voct_steps);
+
+		isr_report_analyze(events, num_events, (float)ISR_TRACE_TICKS_PER_US(), &report);
+
+		if (opt->csv)
+			isr_report_print_csv(&report, s->name);
+		else {
+			printf("\nISR trace: %s (%u blocks", s->name, (unsigned)num_blocks);
+			if (lost) printf(", %u events lost", (unsigned)lost);
+			printf(")\n");
+			isr_report_print(&report);
+		}
+
+		if (opt->out_file)
+			err |= write_dump(opt->out_file, s->name);
+	}
+
+	isr_trace_stop();
+	return err;
+}
@@ -0,0 +1,153 @@
+/*
+ * bench_latency.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// 1V/oct latency benchmark: steps the CV on all six 1V/oct jacks, like a sequencer,
+// at times spread over the audio block and timer periods, and reports how long each
+// step takes to reach the audio callback (from pitch_trace.h), with the fast path off and on.
+// Times are in the host's simulated time, so they're what the hardware would see,
+// less the ADC's own conversion and oversampling time.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "globals.h"
+#include "params_update.h"
+#include "analog_conditioning.h"
+#include "pitch_trace.h"
+#include "timekeeper.h"
+
+#include "host_engine.h"
+#include "host_timekeeper.h"
+#include "bench.h"
+
+#define DEFAULT_STEPS		2000
+#define BLOCKS_PER_STEP		37			// about 8 steps per second
+#define SETTLE_BLOCKS		100
+
+extern o_analog	analog[NUM_ANALOG_ELEMENTS];
+
+typedef struct LatencyScenario {
+	const char 	*name;
+	uint8_t		fast_path;
+} LatencyScenario;
+
+static const LatencyScenario scenarios[] = {
+	{"timers", 		0},
+	{"fast_path", 	1},
+};
+#define NUM_SCENARIOS (sizeof(scenarios)/sizeof(scenarios[0]))
+
+// Pull the jacks' sense pins low, so the CV is used
+static void plug_voct_jacks(void)
+{
+	uint8_t chan;
+
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+		analog[A_VOCT + chan].plug_sense_switch.gpio->IDR &= ~analog[A_VOCT + chan].plug_sense_switch.pin;
+}
+
+static void run_blocks(uint32_t num_blocks)
+{
+	int32_t src[HOST_BLOCK_WORDS] = {0}, dst[HOST_BLOCK_WORDS];
+	uint32_t i;
+
+	for (i = 0; i < num_blocks; i++)
+		host_engine_run_block(src, dst);
+}
+
+// Sets a new CV partway through the next block
+static void step_cv(uint32_t step)
+{
+	uint64_t block_ns = (uint64_t)HOST_BLOCK_FRAMES * 1000000000ULL / SAMPLERATE;
+	uint64_t start_ns = host_time_ns();
+	uint8_t chan;
+	float cv;
+
+	// 0.6180.. of a block apart: doesn't line up with the block or the timers
+	host_timekeeper_run_until(start_ns + (block_ns * ((step * 2654435769u) >> 16)) / 65536);
+
+	cv = 2048.f + (float)((step * 7) % 24) * 34.13f;		// up to 2 octaves, in semitones
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+		host_engine_set_cv(A_VOCT + chan, cv);
+}
+
+static void print_results(const char *scenario, const BenchOptions *opt)
+{
+	o_pitch_trace_summary sum;
+	uint8_t stage;
+
+	if (!opt->csv)
+		printf("\n%s (%u steps, %u through the fast path)\n  %-22s %10s %10s %10s %10s\n", scenario,
+				(unsigned)(pitch_trace.stage[PTS_TOTAL].num / NUM_CHANNELS), (unsigned)(pitch_trace.fast_updates / NUM_CHANNELS),
+				"stage", "mean us", "best us", "worst us", "jitter us");
+
+	for (stage = 0; stage < NUM_PITCH_TRACE_STAGES; stage++)
+	{
+		pitch_trace_get_summary(stage, &sum);
+		if (opt->csv)
+			printf("latency,%s,%s,%.1f,%.1f,%.1f\n", scenario, pitch_trace_stage_name(stage),
+					sum.mean_us * 1000.f, sum.worst_us * 1000.f, sum.jitter_us * 1000.f);
+		else
+			printf("  %-22s %10.1f %10.1f %10.1f %10.1f\n", pitch_trace_stage_name(stage),
+					sum.mean_us, sum.best_us, sum.worst_us, sum.jitter_us);
+	}
+}
+
+int bench_latency(const BenchOptions *opt)
+{
+	uint32_t num_steps = opt->num_blocks ? opt->num_blocks : DEFAULT_STEPS;
+	const LatencyScenario *s;
+	uint32_t i, step;
+
+	host_engine_init(NULL);
+	plug_voct_jacks();
+	pitch_trace_init();
+
+	if (!opt->csv)
+		printf("\n1V/oct latency: %u frames/block, conditioning at %u Hz, oscillator updates at %u Hz\n",
+				(unsigned)HOST_BLOCK_FRAMES, (unsigned)host_timer_rate_hz(ANALOG_CONDITIONING_TIM_number), (unsigned)host_timer_rate_hz(OSC_TIM_number));
+
+	for (i = 0; i < NUM_SCENARIOS; i++)
+	{
+		s = &scenarios[i];
+
+		set_voct_fast_path(s->fast_path);
+		run_blocks(SETTLE_BLOCKS);
+
+		pitch_trace_reset();
+		for (step = 0; step < num_steps; step++)
+		{
+			step_cv(step);
+			run_blocks(BLOCKS_PER_STEP);
+		}
+		print_results(s->name, opt);
+	}
+
+	set_voct_fast_path(1);
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * bench_main.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// swn_bench: benchmarks for the host build
+//
+// Usage: swn_bench [suite] [-n blocks] [-c] [-o prefix]
+//   suite 	audio (default), resample, latency, exp2, graph, isr
+//   -n		number of blocks (resample: waveforms, latency: CV steps, exp2: sweeps, graph: OSC timer ticks) to measure per scenario
+//   -c		print csv (suite,scenario,stage,ns_per_sample,worst_ns,jitter_ns)
+//			(latency: the mean latency in ns instead of ns_per_sample,
+//			isr: the handler, and its mean ns per call, worst ns from start to end, worst ns late)
+//   -o		isr: save each scenario's trace to prefix_<scenario>.bin, for swn_isr_report
+//
+// Build with `make host`. Results are in ns on the host machine, except latency,
+// which is in the simulated time of the host timers.
+// On the target, build with `make AUDIO_PROFILE=1` and read audio_profile with a debugger,
+// or `make PITCH_TRACE=1` and read pitch_trace,
+// or `make ISR_TRACE=1` and dump isr_trace for swn_isr_report.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+typedef struct BenchSuite {
+	const char 	*name;
+	int 		(*run)(const BenchOptions *opt);
+} BenchSuite;
+
+static const BenchSuite suites[] = {
+	{"audio", 	bench_audio},
+	{"resample", bench_resample},
+	{"latency", bench_latency},
+	{"exp2", 	bench_exp2},
+	{"graph", 	bench_graph},
+	{"isr", 	bench_isr},
+};
+#define NUM_SUITES (sizeof(suites)/sizeof(suites[0]))
+
+static void usage(void)
+{
+	uint32_t i;
+
+	fprintf(stderr, "Usage: swn_bench [suite] [-n blocks] [-c] [-o prefix]\nSuites:");
+	for (i=0; i<NUM_SUITES; i++)
+		fprintf(stderr, " %s", suites[i].name);
+	fprintf(stderr, " all\n");
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions opt = {.num_blocks = 0, .csv = 0, .out_file = NULL};
+	const char *suite = "audio";
+	uint32_t i;
+	int err = 0, found = 0;
+
+	for (i=1; i<(uint32_t)argc; i++)
+	{
+		if (!strcmp(argv[i], "-n") && i+1<(uint32_t)argc) 	opt.num_blocks = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-c")) 					opt.csv = 1;
+		else if (!strcmp(argv[i], "-o") && i+1<(uint32_t)argc) 	opt.out_file = argv[++i];
+		else if (argv[i][0] != '-') 						suite = argv[i];
+		else { usage(); return 1; }
+	}
+
+	if (opt.csv)
+		printf("suite,scenario,stage,ns_per_sample,worst_ns,jitter_ns\n");
+
+	for (i=0; i<NUM_SUITES; i++)
+	{
+		if (!strcmp(suite, "all") || !strcmp(suite, suites[i].name)) {
+			err |= suites[i].run(&opt);
+			found = 1;
+		}
+	}
+
+	if (!found) { usage(); return 1; }
+	return err;
+}
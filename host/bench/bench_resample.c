@@ -0,0 +1,151 @@
+/*
+ * bench_resample.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Resampler benchmark: renders waveform-sized blocks from a recording-sized buffer, the way
+// render_waveform() does, with each resampler mode at several stretch ratios.
+// Reports the time per output sample and per waveform, and how much of a tone that's above
+// the output Nyquist gets through (aliasing), for rates above 1.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wavetable_editing.h"
+#include "resample.h"
+#include "audio_profile.h"
+
+#include "bench.h"
+
+#define DEFAULT_CELLS		2000
+#define CELL_SAMPLES		(WT_TABLELEN + SPHERE_REC_MAX_OVERLAP_SIZE)
+#define IN_SIZE				NUM_SAMPLES_IN_RECBUF_SMOOTHED
+
+static const float rates[] = {0.5f, 0.75f, 1.0f, 1.37f, 2.0f, 3.5f, 4.0f, 8.0f};
+#define NUM_RATES (sizeof(rates)/sizeof(rates[0]))
+
+static const char *mode_names[NUM_RESAMPLE_MODES] = {"hermite", "sinc"};
+
+static int16_t in_buf[IN_SIZE];
+
+static void fill_tone(float cycles_per_sample, float amp)
+{
+	uint32_t i;
+
+	for (i=0; i<IN_SIZE; i++)
+		in_buf[i] = (int16_t)(amp * sinf(2.f * M_PI * cycles_per_sample * (float)i));
+}
+
+// A mix of tones and some noise, like a recording
+static void fill_program(void)
+{
+	uint32_t i;
+
+	srand(1);
+	for (i=0; i<IN_SIZE; i++)
+		in_buf[i] = (int16_t)(12000.f * sinf(0.0051f * i) + 6000.f * sinf(0.071f * i) + 3000.f * sinf(0.93f * i) + (rand() % 2000) - 1000);
+}
+
+// Level of a tone at 0.7x the output sample rate (aliasing down to 0.3x), in dB relative to the input
+static float alias_db(enum ResampleModes mode, float rate)
+{
+	int16_t out[CELL_SAMPLES];
+	o_resampler r;
+	double sum = 0;
+	uint32_t i;
+
+	fill_tone(0.7f / rate, 16384.f);
+	resampler_init(&r, mode, rate, in_buf, IN_SIZE, 1000.f);
+	resampler_process(&r, out, CELL_SAMPLES);
+
+	for (i=0; i<CELL_SAMPLES; i++)
+		sum += (double)out[i] * out[i];
+
+	return 10.f * log10f((float)(sum / CELL_SAMPLES) / (16384.f * 16384.f / 2.f) + 1e-12f);
+}
+
+int bench_resample(const BenchOptions *opt)
+{
+	uint32_t num_cells = opt->num_blocks ? opt->num_blocks : DEFAULT_CELLS;
+	int16_t out[CELL_SAMPLES];
+	o_resampler r;
+	float cycles_per_ns = AUDIO_PROFILE_CYCLES_PER_US() / 1000.f;
+	uint32_t t, dt, worst;
+	double total, total_sq, mean, jitter;
+	float start, aliasing;
+	char scenario[16];
+	uint32_t i, cell;
+	uint8_t mode;
+
+	if (!opt->csv)
+		printf("\nResampler: %u samples per waveform, %u waveforms per test\n  %-8s %-8s %12s %12s %12s %12s\n",
+				(unsigned)CELL_SAMPLES, (unsigned)num_cells, "rate", "mode", "ns/sample", "worst ns", "jitter ns", "alias dB");
+
+	for (i=0; i<NUM_RATES; i++)
+	{
+		for (mode=0; mode<NUM_RESAMPLE_MODES; mode++)
+		{
+			aliasing = (rates[i] > 1.0f) ? alias_db(mode, rates[i]) : 0.f;
+
+			fill_program();
+			total = total_sq = 0;
+			worst = 0;
+			start = 0;
+
+			for (cell=0; cell<num_cells; cell++)
+			{
+				t = AUDIO_PROFILE_CYCLES();
+				resampler_init(&r, mode, rates[i], in_buf, IN_SIZE, start);
+				resampler_process(&r, out, CELL_SAMPLES);
+				dt = AUDIO_PROFILE_CYCLES() - t;
+
+				total += dt;
+				total_sq += (double)dt * dt;
+				if (dt > worst) worst = dt;
+
+				// step through the recording like the sphere's waveforms do
+				start += NUM_SAMPLES_IN_SPHERE + 0.37f;
+				if (start >= NUM_SAMPLES_IN_RECBUF) start -= NUM_SAMPLES_IN_RECBUF;
+			}
+
+			mean = total / num_cells;
+			jitter = sqrt(fmax(total_sq / num_cells - mean * mean, 0.0));
+
+			snprintf(scenario, sizeof(scenario), "x%.2f", rates[i]);
+			if (opt->csv)
+				printf("resample,%s,%s,%.3f,%.1f,%.1f\n", scenario, mode_names[mode],
+						mean / CELL_SAMPLES / cycles_per_ns, worst / cycles_per_ns, jitter / cycles_per_ns);
+			else if (rates[i] > 1.0f)
+				printf("  %-8s %-8s %12.3f %12.1f %12.1f %12.1f\n", scenario, mode_names[mode],
+						mean / CELL_SAMPLES / cycles_per_ns, worst / cycles_per_ns, jitter / cycles_per_ns, aliasing);
+			else
+				printf("  %-8s %-8s %12.3f %12.1f %12.1f %12s\n", scenario, mode_names[mode],
+						mean / CELL_SAMPLES / cycles_per_ns, worst / cycles_per_ns, jitter / cycles_per_ns, "-");
+		}
+	}
+	return 0;
+}
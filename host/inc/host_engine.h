@@ -0,0 +1,48 @@
+/*
+ * host_engine.h
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "sphere.h"
+#include "drivers/codec_sai.h"
+
+#define HOST_BLOCK_FRAMES		MONO_BUFSZ			// frames per audio callback
+#define HOST_BLOCK_WORDS		STEREO_BUFSZ		// interleaved words per audio callback
+
+void host_engine_init(const char *flash_image);
+void host_engine_run_block(int32_t *src, int32_t *dst);
+void host_engine_main_loop(void);
+uint64_t host_engine_num_blocks(void);
+
+void host_engine_set_slider(uint8_t chan, uint16_t val);
+void host_engine_set_knob_adc(uint8_t adc1_chan, uint16_t val);
+void host_engine_set_cv(uint8_t hires_chan, float val);
+
+void host_write_factory_spheres(void);
+const o_waveform *host_factory_sphere(uint8_t wt_num);
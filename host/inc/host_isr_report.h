@@ -0,0 +1,64 @@
+/*
+ * host_isr_report.h
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stm32f7xx.h>
+#include "isr_trace.h"
+
+#define ISR_REPORT_TIMELINE_COLUMNS		100
+
+// Times are in trace ticks: cycles on the target, ns on the host
+typedef struct o_isr_report_stats {
+	uint32_t	calls;
+	uint64_t	self;				// time spent in the handler, less the handlers that preempted it
+	uint32_t	self_worst;
+	uint32_t	response_worst;		// start to end, including the handlers that preempted it
+	uint64_t	response_worst_at;	// when that call started, from the first event
+	uint32_t	preempted;			// calls that were preempted at least once
+	uint32_t	preempted_by[NUM_ISR_TRACE_IDS];	// times each handler preempted this one
+
+	// Handlers that run at a fixed rate (isr_trace_is_periodic()):
+	float		period;
+	float		late_mean;			// how long after it was due each call started
+	uint32_t	late_worst;
+} o_isr_report_stats;
+
+typedef struct o_isr_report {
+	o_isr_report_stats	isr[NUM_ISR_TRACE_IDS];
+	float		ticks_per_us;
+	uint64_t	span;				// first event to last event
+	uint32_t	num_events;
+	uint32_t	skipped;			// events that didn't fit: the end of a call whose start was overwritten, etc.
+} o_isr_report;
+
+void isr_report_analyze(const o_isr_trace_event *events, uint32_t num_events, float ticks_per_us, o_isr_report *report);
+void isr_report_print(const o_isr_report *report);
+void isr_report_print_csv(const o_isr_report *report, const char *scenario);
+void isr_report_print_timeline(const o_isr_trace_event *events, uint32_t num_events, const o_isr_report *report, uint64_t start, uint64_t width);
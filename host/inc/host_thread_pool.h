@@ -0,0 +1,65 @@
+/*
+ * host_thread_pool.h
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+// Runs batches of independent tasks on worker threads (pthreads), for the host tools
+
+#include <stdint.h>
+#include <pthread.h>
+
+// task is 0..num_tasks-1. worker is the thread running it (0..num_threads-1), for per-thread scratch data
+typedef void (*HostTaskFunc)(void *arg, uint32_t task, uint32_t worker);
+
+typedef struct HostThreadPool {
+	pthread_t		*threads;
+	uint32_t		num_threads;
+
+	pthread_mutex_t	lock;
+	pthread_cond_t	start;			// a batch is ready, or the pool is quitting
+	pthread_cond_t	done;			// the last task of the batch finished
+
+	HostTaskFunc	func;
+	void			*arg;
+	uint32_t		num_tasks;
+	uint32_t		next_task;
+	uint32_t		tasks_done;
+	uint32_t		num_started;	// workers number themselves in the order they start
+	uint8_t			quit;
+} HostThreadPool;
+
+uint32_t host_num_cpus(void);
+
+// num_threads = 0 uses one per CPU
+uint8_t host_thread_pool_init(HostThreadPool *pool, uint32_t num_threads);
+
+// Runs func(arg, task, worker) for every task, and returns when they're all done.
+// Tasks run in any order, several at once
+void host_thread_pool_run(HostThreadPool *pool, uint32_t num_tasks, HostTaskFunc func, void *arg);
+
+void host_thread_pool_free(HostThreadPool *pool);
@@ -0,0 +1,52 @@
+/*
+ * host_wav.h
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef struct HostWav {
+	FILE		*f;
+	uint32_t	samplerate;
+	uint16_t	num_channels;
+	uint16_t	bits_per_sample;
+	uint32_t	num_frames;		// total frames (read) or frames written so far (write)
+	uint32_t	cur_frame;
+	uint8_t		writing;
+} HostWav;
+
+// Reading: 16- or 24-bit PCM. Samples are returned as signed 24-bit values.
+uint8_t host_wav_open_read(HostWav *w, const char *filename);
+uint32_t host_wav_read_s24(HostWav *w, int32_t *dst, uint16_t dst_chans, uint32_t num_frames);
+
+// Writing: 16- or 24-bit PCM from signed 24-bit values
+uint8_t host_wav_open_write(HostWav *w, const char *filename, uint32_t samplerate, uint16_t num_channels, uint16_t bits_per_sample);
+uint32_t host_wav_write_s24(HostWav *w, const int32_t *src, uint32_t num_frames);
+
+void host_wav_close(HostWav *w);
@@ -0,0 +1,134 @@
+/*
+ * stm32f7xx.h (host build)
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Wraps the device header for the host build.
+ * The firmware sources touch registers directly (GPIOx->BSRR, TIMx->SR, DWT->CYCCNT...),
+ * so the peripheral and core base addresses are moved into plain RAM arrays.
+ * Reads return whatever was last written (zero at startup).
+ * Cortex-M intrinsics that have no meaning on the host are replaced with C equivalents.
+ */
+
+#pragma once
+
+#include_next <stm32f7xx.h>
+
+#include <stdint.h>
+
+#define HOST_PERIPH_SIZE		0x10080000UL
+#define HOST_CORE_PERIPH_SIZE	0x00043000UL
+
+extern uint8_t host_periph_ram[HOST_PERIPH_SIZE];
+extern uint8_t host_core_periph_ram[HOST_CORE_PERIPH_SIZE];
+
+//
+// Peripherals: 0x40000000 - 0x5007FFFF
+//
+#undef PERIPH_BASE
+#define PERIPH_BASE				((uintptr_t)host_periph_ram)
+
+#undef BKPSRAM_BASE
+#define BKPSRAM_BASE			(PERIPH_BASE + 0x00024000UL)
+
+//
+// Cortex-M7 private peripherals: 0xE0000000 - 0xE0042FFF
+//
+#define HOST_CORE_PERIPH(addr)	((uintptr_t)host_core_periph_ram + ((addr) - 0xE0000000UL))
+
+#undef ITM_BASE
+#define ITM_BASE				HOST_CORE_PERIPH(0xE0000000UL)
+#undef DWT_BASE
+#define DWT_BASE				HOST_CORE_PERIPH(0xE0001000UL)
+#undef SCS_BASE
+#define SCS_BASE				HOST_CORE_PERIPH(0xE000E000UL)
+#undef CoreDebug_BASE
+#define CoreDebug_BASE			HOST_CORE_PERIPH(0xE000EDF0UL)
+#undef TPI_BASE
+#define TPI_BASE				HOST_CORE_PERIPH(0xE0040000UL)
+#undef DBGMCU_BASE
+#define DBGMCU_BASE				HOST_CORE_PERIPH(0xE0042000UL)
+
+//
+// Intrinsics
+//
+#undef __SSAT
+#define __SSAT(ARG1, ARG2) __extension__ ({										\
+	int32_t __v = (int32_t)(ARG1);												\
+	const int32_t __max = (int32_t)((1UL << ((ARG2) - 1)) - 1);					\
+	(__v > __max) ? __max : ((__v < -__max - 1) ? (-__max - 1) : __v);			\
+})
+
+#undef __USAT
+#define __USAT(ARG1, ARG2) __extension__ ({										\
+	int32_t __v = (int32_t)(ARG1);												\
+	const int32_t __max = (int32_t)((1UL << (ARG2)) - 1);						\
+	(uint32_t)((__v > __max) ? __max : ((__v < 0) ? 0 : __v));					\
+})
+
+#define __enable_irq()			do {} while (0)
+#define __disable_irq()			do {} while (0)
+#define __get_BASEPRI()			(0)
+#define __set_BASEPRI(x)		do { (void)(x); } while (0)
+#define __set_BASEPRI_MAX(x)	do { (void)(x); } while (0)
+#define __get_PRIMASK()			(0)
+#define __set_PRIMASK(x)		do { (void)(x); } while (0)
+#define __DSB()					do {} while (0)
+#define __ISB()					do {} while (0)
+#define __DMB()					do {} while (0)
+#define __NOP()					do {} while (0)
+#define __WFI()					do {} while (0)
+
+//
+// Cycle counter for audio_profile.h: DWT->CYCCNT doesn't count on the host
+//
+#if defined(__x86_64__) || defined(__i386__)
+	static inline uint32_t host_cycles(void) { uint32_t lo, hi; __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi)); (void)hi; return lo; }
+#else
+	uint32_t host_cycles(void);
+#endif
+float host_cycles_per_us(void);
+uint64_t host_monotonic_ns(void);
+
+#define AUDIO_PROFILE_CYCLES()			host_cycles()
+#define AUDIO_PROFILE_CYCLES_PER_US()	host_cycles_per_us()
+
+//
+// Clock for pitch_trace.h: the simulated time of the host timers, in ns,
+// so latencies come out as they would on the hardware
+//
+uint64_t host_time_ns(void);
+
+#define PITCH_TRACE_TIME()				((uint32_t)host_time_ns())
+#define PITCH_TRACE_TICKS_PER_US()		1000.f
+
+//
+// Clock for isr_trace.h, in ns: the simulated time, plus the time the handlers
+// take to run on the host (see host_timekeeper.c)
+//
+uint32_t host_isr_time_ns(uint8_t busy);
+
+#define ISR_TRACE_TIME(busy)			host_isr_time_ns(busy)
+#define ISR_TRACE_TICKS_PER_US()		1000
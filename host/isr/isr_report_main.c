@@ -0,0 +1,142 @@
+/*
+ * isr_report_main.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// swn_isr_report: load, lateness and preemptions of the interrupt handlers, from an isr_trace dump
+//
+// Usage: swn_isr_report [-s start_us] [-w width_us] [-c] isr_trace.bin
+//   -s  start of the timeline chart, in us from the first event (default: just before the slowest call)
+//   -w  width of the timeline chart, in us (default: 4 times the slowest call, at least 100us)
+//   -c  print csv (isr,dump,handler,mean_ns,worst_response_ns,worst_late_ns) instead of the charts
+//
+// The dump is the isr_trace struct, saved from the target with gdb (see isr_trace.h):
+//		dump binary value isr_trace.bin isr_trace
+// or from the host with `swn_bench isr -o isr_trace.bin`.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isr_trace.h"
+#include "host_isr_report.h"
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: swn_isr_report [-s start_us] [-w width_us] [-c] isr_trace.bin\n");
+}
+
+// Reads the dump into events[], oldest first. Returns the number of events, or 0 on error
+static uint32_t read_dump(const char *filename, o_isr_trace_header *hdr, o_isr_trace_event **events)
+{
+	o_isr_trace_event *ring;
+	uint32_t num, oldest, i;
+	FILE *f;
+
+	if (!(f = fopen(filename, "rb"))) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return 0;
+	}
+
+	if (fread(hdr, sizeof(o_isr_trace_header), 1, f) != 1 || hdr->magic != ISR_TRACE_MAGIC
+		|| !hdr->len || (hdr->len & (hdr->len - 1)) || !hdr->ticks_per_us) {
+		fprintf(stderr, "%s is not an isr_trace dump\n", filename);
+		fclose(f);
+		return 0;
+	}
+
+	ring = malloc(hdr->len * sizeof(o_isr_trace_event));
+	*events = malloc(hdr->len * sizeof(o_isr_trace_event));
+	if (!ring || !*events || fread(ring, sizeof(o_isr_trace_event), hdr->len, f) != hdr->len) {
+		fprintf(stderr, "Cannot read the events from %s\n", filename);
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+
+	// Once the ring has wrapped, the oldest event is the one the next would overwrite
+	num = (hdr->head < hdr->len) ? hdr->head : hdr->len;
+	oldest = (hdr->head < hdr->len) ? 0 : (hdr->head & (hdr->len - 1));
+	for (i = 0; i < num; i++)
+		(*events)[i] = ring[(oldest + i) & (hdr->len - 1)];
+
+	free(ring);
+	return num;
+}
+
+int main(int argc, char **argv)
+{
+	o_isr_trace_header 	hdr;
+	o_isr_trace_event 	*events = NULL;
+	o_isr_report 		report;
+	float 				start_us = -1.f, width_us = 0.f;
+	uint64_t 			start, width, slowest = 0, slowest_at = 0;
+	uint32_t 			num_events;
+	uint8_t 			csv = 0, id;
+	int 				i;
+
+	for (i=1; i<argc && argv[i][0]=='-'; i++)
+	{
+		if (!strcmp(argv[i], "-s") && i+1<argc) 		start_us = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-w") && i+1<argc) 	width_us = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-c")) 				csv = 1;
+		else { usage(); return 1; }
+	}
+	if (i != argc-1) { usage(); return 1; }
+
+	if (!(num_events = read_dump(argv[i], &hdr, &events)))
+		return 1;
+
+	isr_report_analyze(events, num_events, (float)hdr.ticks_per_us, &report);
+
+	if (csv) {
+		printf("suite,scenario,stage,ns_per_sample,worst_ns,jitter_ns\n");
+		isr_report_print_csv(&report, "dump");
+		return 0;
+	}
+
+	printf("%s: %u events of %u, %u ticks/us, recording %s\n", argv[i], (unsigned)num_events, (unsigned)hdr.len,
+			(unsigned)hdr.ticks_per_us, hdr.running ? "was on" : "had stopped");
+	isr_report_print(&report);
+
+	for (id = 0; id < NUM_ISR_TRACE_IDS; id++) {
+		if (report.isr[id].response_worst > slowest) {
+			slowest = report.isr[id].response_worst;
+			slowest_at = report.isr[id].response_worst_at;
+		}
+	}
+
+	width = (width_us > 0.f) ? (uint64_t)(width_us * hdr.ticks_per_us) : slowest * 4;
+	if (width < 100 * (uint64_t)hdr.ticks_per_us) width = 100 * (uint64_t)hdr.ticks_per_us;
+
+	if (start_us >= 0.f)
+		start = (uint64_t)(start_us * hdr.ticks_per_us);
+	else
+		start = (slowest_at > width / 4) ? slowest_at - width / 4 : 0;
+
+	isr_report_print_timeline(events, num_events, &report, start, width);
+	return 0;
+}
@@ -0,0 +1,394 @@
+/*
+ * sphere_render_main.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// swn_sphere_render: renders spheres from wav files offline, with the firmware's wavetable editor
+//
+// Usage: swn_sphere_render [-c settings.txt] [-d out_dir] [-j threads] [-f flash.bin -w flash_out.bin -n first_sphere -b bits] in.wav [in2.wav ...]
+//   -c  editor settings (see below), applied to every input file
+//   -j  number of threads to render on (default: one per CPU)
+//   -d  where to put the .h files (default: current directory)
+//   -f  SPI flash image to start from, when saving to a flash image
+//   -w  save the spheres into this flash image, instead of writing .h files
+//   -n  sphere slot to save the first file into (default: the first user sphere). Each file goes in the next slot
+//   -b  bits per sample to pack the saved spheres with: 16 is lossless (default), 8-15 drop the low bits, 0 saves them unpacked
+//
+// Each wav is loaded into recbuf the way the audio input records it (left channel, from the start
+// of the buffer), and the editor settings are worked out the same way as the WTEDITING mode.
+// Then the 27 waveforms are rendered with render_waveform(), the same position/stretch/spread and
+// fx chain the firmware uses. The waveforms of RENDER_BATCH_SPHERES files at a time are shared out
+// between the threads. The .h files have the same layout as calc/wavecalc makes for inc/spheres/.
+//
+// Settings file, one per line (# starts a comment):
+//   position 256 				start of the first waveform in recbuf, in samples
+//   stretch 1.5 				stretch_ratio
+//   spread 4096 				spread_amount, in samples
+//   <fx> 0.3 					sets the fx level (0..1) of all 27 waveforms
+//   <fx> x y z 0.3 			sets the fx level of one waveform (x,y,z are 0..2)
+// where <fx> is: fold, decimate, metalize, lpf, normalize, smoothing, tilt, formant, harmonics
+// (tilt, formant and harmonics do nothing at 0.5, their default)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "globals.h"
+#include "audio_util.h"
+#include "math_util.h"
+#include "wavetable_editing.h"
+#include "wavetable_recording.h"
+#include "wavetable_effects.h"
+#include "waveshaper.h"
+#include "params_wt_browse.h"
+#include "sphere_flash_io.h"
+#include "flash_directory.h"
+#include "drivers/flashram_queue.h"
+#include "host_engine.h"
+#include "host_flashram.h"
+#include "host_thread_pool.h"
+#include "host_wav.h"
+
+#define RENDER_BATCH_SPHERES	16		// each needs its own copy of recbuf
+
+extern o_spherebuf 		spherebuf;
+extern o_recbuf 		recbuf;
+
+// A sphere to render: a copy of everything render_waveform() needs from recbuf and spherebuf
+typedef struct RenderJob {
+	const char 		*filename;
+	int16_t 		*rec;
+	float 			stretch_ratio;
+	uint32_t 		start_pos 	[NUM_WAVEFORMS_IN_SPHERE];
+	float 			fx 			[NUM_WAVEFORMS_IN_SPHERE][NUM_FX];		// by SPHERE_CELL()
+	o_waveform 		data		[WT_DIM_SIZE][WT_DIM_SIZE][WT_DIM_SIZE];
+} RenderJob;
+
+typedef struct RenderBatch {
+	RenderJob 		*jobs;
+	o_waveshaper 	*ws;			// one per thread
+} RenderBatch;
+
+static const char *fx_names[NUM_FX] = {
+	[FX_WAVEFOLDING] 	= "fold",
+	[FX_DECIMATING] 	= "decimate",
+	[FX_METALIZE] 		= "metalize",
+	[FX_LPF] 			= "lpf",
+	[FX_NORMALIZE] 		= "normalize",
+	[FX_SMOOTHING] 		= "smoothing",
+	[FX_TILT] 			= "tilt",
+	[FX_FORMANT] 		= "formant",
+	[FX_HARMONICS] 		= "harmonics",
+};
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: swn_sphere_render [-c settings.txt] [-d out_dir] [-j threads] [-f flash.bin -w flash_out.bin -n first_sphere -b bits] in.wav [in2.wav ...]\n");
+}
+
+static void set_fx(uint8_t fx, int x, int y, int z, float val)
+{
+	uint8_t i, j, k;
+
+	val = _CLAMP_F(val, 0.f, 1.f);
+	for (i=0; i<WT_DIM_SIZE; i++) {
+		for (j=0; j<WT_DIM_SIZE; j++) {
+			for (k=0; k<WT_DIM_SIZE; k++) {
+				if ((x<0 || x==i) && (y<0 || y==j) && (z<0 || z==k))
+					spherebuf.fx[fx][i][j][k] = val;
+			}
+		}
+	}
+}
+
+// Applies the settings file on top of init_wt_edit_settings(), with the same limits as the encoders
+static uint8_t apply_settings(const char *filename)
+{
+	FILE 	*f;
+	char 	line[256], key[32];
+	float 	v[4];
+	int 	n, lineno = 0;
+	uint8_t fx;
+
+	if (!(f = fopen(filename, "r")))
+		return 0;
+
+	while (fgets(line, sizeof(line), f))
+	{
+		lineno++;
+		line[strcspn(line, "#\r\n")] = 0;
+
+		n = sscanf(line, "%31s %f %f %f %f", key, &v[0], &v[1], &v[2], &v[3]);
+		if (n <= 0)
+			continue;
+
+		if (!strcmp(key, "position") && n == 2)
+			spherebuf.position = _WRAP_I32((int32_t)v[0], 0, NUM_SAMPLES_IN_RECBUF);
+		else if (!strcmp(key, "stretch") && n == 2)
+			spherebuf.stretch_ratio = _CLAMP_F(v[0], F_SCALING_WTBUF_STRETCH, MAX_STRETCH);
+		else if (!strcmp(key, "spread") && n == 2)
+			spherebuf.spread_amount = _CLAMP_I32((int32_t)v[0], MIN_WTBUF_SPREAD, MAX_WTBUF_SPREAD);
+		else {
+			for (fx=0; fx<NUM_FX; fx++) {
+				if (!strcmp(key, fx_names[fx]))
+					break;
+			}
+			if (fx < NUM_FX && n == 2)
+				set_fx(fx, -1, -1, -1, v[0]);
+			else if (fx < NUM_FX && n == 5 && v[0]>=0 && v[0]<WT_DIM_SIZE && v[1]>=0 && v[1]<WT_DIM_SIZE && v[2]>=0 && v[2]<WT_DIM_SIZE)
+				set_fx(fx, v[0], v[1], v[2], v[3]);
+			else {
+				fprintf(stderr, "%s:%d: cannot parse: %s\n", filename, lineno, line);
+				fclose(f);
+				return 0;
+			}
+		}
+	}
+	fclose(f);
+	return 1;
+}
+
+// Fills recbuf like record_audio_buffer() does when recording the whole buffer.
+// Anything past the end of the file is silence
+static uint8_t load_recbuf(const char *filename)
+{
+	HostWav 	wav;
+	int32_t 	frame[2];
+	uint32_t 	i;
+
+	if (!host_wav_open_read(&wav, filename))
+		return 0;
+	if (wav.samplerate != SAMPLERATE)
+		fprintf(stderr, "Warning: %s is %uHz, recording runs at %uHz\n", filename, (unsigned)wav.samplerate, (unsigned)SAMPLERATE);
+
+	for (i=0; i<NUM_SAMPLES_IN_RECBUF_SMOOTHED; i++) {
+		if (host_wav_read_s24(&wav, frame, 2, 1))
+			recbuf.data[i] = _CLAMP_I32(-convert_s24_to_s32(frame[0])/256, INT16_MIN, INT16_MAX);
+		else
+			recbuf.data[i] = 0;
+	}
+	recbuf.start_pos = 0;
+	recbuf.end_pos = NUM_SAMPLES_IN_RECBUF_SMOOTHED;
+	recbuf.wh = NUM_SAMPLES_IN_RECBUF_SMOOTHED;
+
+	host_wav_close(&wav);
+	return 1;
+}
+
+// C identifier from the file name, without the directory or extension
+static void get_sphere_name(const char *filename, char *name, uint32_t maxlen)
+{
+	const char 	*base = strrchr(filename, '/');
+	uint32_t 	i;
+
+	base = base ? base+1 : filename;
+	for (i=0; base[i] && base[i]!='.' && i<(maxlen-1); i++)
+		name[i] = isalnum((unsigned char)base[i]) ? base[i] : '_';
+	name[i] = 0;
+
+	if (!i || isdigit((unsigned char)name[0])) {
+		memmove(name+1, name, (i<(maxlen-1)) ? i+1 : i);
+		name[0] = '_';
+		name[maxlen-1] = 0;
+	}
+}
+
+// Same layout as the spheres in inc/spheres/: [z][y][x], which is the order they're stored in flash
+static uint8_t write_sphere_header(const char *filename, const char *name, o_waveform data[WT_DIM_SIZE][WT_DIM_SIZE][WT_DIM_SIZE])
+{
+	FILE 	*f;
+	uint8_t x, y, z;
+	uint32_t i;
+
+	if (!(f = fopen(filename, "w")))
+		return 0;
+
+	fprintf(f, "const o_waveform %s[WT_DIM_SIZE][WT_DIM_SIZE][WT_DIM_SIZE] =\n{\n", name);
+	for (z=0; z<WT_DIM_SIZE; z++) {
+		fprintf(f, "\n\t// ##################\n\t//     LAYER %d\n\t// ##################\n\t{\n", z+1);
+		for (y=0; y<WT_DIM_SIZE; y++) {
+			fprintf(f, "\t\t// ROW %d\n\t\t{\n", y+1);
+			for (x=0; x<WT_DIM_SIZE; x++) {
+				fprintf(f, "\t\t\t{{\"%s %d%d%d\"} , {", name, x, y, z);
+				for (i=0; i<WT_TABLELEN; i++)
+					fprintf(f, (i<WT_TABLELEN-1) ? "%d, " : "%d", data[x][y][z].wave[i]);
+				fprintf(f, (x<WT_DIM_SIZE-1) ? "}},\n" : "}}\n");
+			}
+			fprintf(f, (y<WT_DIM_SIZE-1) ? "\t\t},\n" : "\t\t}\n");
+		}
+		fprintf(f, (z<WT_DIM_SIZE-1) ? "\t},\n" : "\t}\n");
+	}
+	fprintf(f, "};\n");
+
+	fclose(f);
+	return 1;
+}
+
+// Copies what's needed to render the sphere of the wav in recbuf, with the settings in spherebuf
+static void setup_job(RenderJob *job, const char *filename)
+{
+	uint8_t x, y, z;
+
+	update_start_positions();
+
+	job->filename 		= filename;
+	job->stretch_ratio 	= spherebuf.stretch_ratio;
+	memcpy(job->rec, recbuf.data, NUM_SAMPLES_IN_RECBUF_SMOOTHED * sizeof(int16_t));
+	memcpy(job->start_pos, spherebuf.start_pos, sizeof(job->start_pos));
+	memcpy(job->data, spherebuf.data, sizeof(job->data));
+
+	for (z=0; z<WT_DIM_SIZE; z++)
+		for (y=0; y<WT_DIM_SIZE; y++)
+			for (x=0; x<WT_DIM_SIZE; x++)
+				get_cell_fx(x, y, z, job->fx[SPHERE_CELL(x, y, z)]);
+}
+
+// One waveform of one sphere in the batch
+static void render_cell_task(void *arg, uint32_t task, uint32_t worker)
+{
+	RenderBatch 	*batch 	= arg;
+	RenderJob 		*job 	= &batch->jobs[task / NUM_WAVEFORMS_IN_SPHERE];
+	uint8_t 		cell 	= task % NUM_WAVEFORMS_IN_SPHERE;
+	uint8_t 		x 		= cell % WT_DIM_SIZE;
+	uint8_t 		y 		= (cell / WT_DIM_SIZE) % WT_DIM_SIZE;
+	uint8_t 		z 		= cell / (WT_DIM_SIZE * WT_DIM_SIZE);
+	o_wt_render_ctx ctx 	= {job->rec, NUM_SAMPLES_IN_RECBUF_SMOOTHED, job->stretch_ratio, &batch->ws[worker]};
+
+	render_waveform(&ctx, job->start_pos[get_browse_index(x, y, z)], job->fx[cell], job->data[x][y][z].wave, NULL);
+}
+
+int main(int argc, char **argv)
+{
+	const char 		*settings_file = NULL, *out_dir = ".", *flash_file = NULL, *flash_out_file = NULL;
+	int 			sphere_num = NUM_FACTORY_SPHERES;
+	char 			name[WT_NAME_MONITOR_CHARSIZE - 4], out_file[1024];
+	int 			i, num_rendered = 0, num_threads = 0, save_bits = SPHERE_SAVE_LOSSLESS;
+	HostThreadPool 	pool;
+	RenderBatch 	batch;
+	uint32_t 		j, num_jobs;
+
+	for (i=1; i<argc && argv[i][0]=='-'; i++)
+	{
+		if (!strcmp(argv[i], "-c") && i+1<argc) 		settings_file = argv[++i];
+		else if (!strcmp(argv[i], "-d") && i+1<argc) 	out_dir = argv[++i];
+		else if (!strcmp(argv[i], "-j") && i+1<argc) 	num_threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-f") && i+1<argc) 	flash_file = argv[++i];
+		else if (!strcmp(argv[i], "-w") && i+1<argc) 	flash_out_file = argv[++i];
+		else if (!strcmp(argv[i], "-n") && i+1<argc) 	sphere_num = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-b") && i+1<argc) 	save_bits = atoi(argv[++i]);
+		else { usage(); return 1; }
+	}
+	if (i >= argc || num_threads < 0 || save_bits < 0) { usage(); return 1; }
+
+	if (flash_out_file && (sphere_num < NUM_FACTORY_SPHERES || (sphere_num + (argc-i)) > MAX_TOTAL_SPHERES)) {
+		fprintf(stderr, "Spheres must fit in the user slots %d to %d\n", NUM_FACTORY_SPHERES, MAX_TOTAL_SPHERES-1);
+		return 1;
+	}
+
+	host_engine_init(flash_file);
+	set_sphere_save_bits(save_bits);
+
+	if (!host_thread_pool_init(&pool, num_threads)) {
+		fprintf(stderr, "Cannot start the render threads\n");
+		return 1;
+	}
+
+	batch.jobs 	= calloc(RENDER_BATCH_SPHERES, sizeof(RenderJob));
+	batch.ws 	= calloc(pool.num_threads, sizeof(o_waveshaper));
+	if (!batch.jobs || !batch.ws) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (j=0; j<RENDER_BATCH_SPHERES; j++) {
+		if (!(batch.jobs[j].rec = malloc(NUM_SAMPLES_IN_RECBUF_SMOOTHED * sizeof(int16_t)))) {
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+	}
+	for (j=0; j<pool.num_threads; j++)
+		init_waveshaper(&batch.ws[j]);
+
+	while (i<argc)
+	{
+		// Load the next batch of files (serially: this uses recbuf and spherebuf)
+		for (num_jobs=0; i<argc && num_jobs<RENDER_BATCH_SPHERES; i++)
+		{
+			if (!load_recbuf(argv[i])) {
+				fprintf(stderr, "Cannot read %s (16 or 24-bit PCM wav required)\n", argv[i]);
+				continue;
+			}
+
+			spherebuf.data_source = SPHERESRC_RECBUFF;
+			init_wt_edit_settings();
+			if (settings_file && !apply_settings(settings_file)) {
+				fprintf(stderr, "Cannot use settings file %s\n", settings_file);
+				return 1;
+			}
+
+			setup_job(&batch.jobs[num_jobs++], argv[i]);
+		}
+
+		host_thread_pool_run(&pool, num_jobs * NUM_WAVEFORMS_IN_SPHERE, render_cell_task, &batch);
+
+		for (j=0; j<num_jobs; j++)
+		{
+			get_sphere_name(batch.jobs[j].filename, name, sizeof(name));
+			if (flash_out_file) {
+				save_unformatted_sphere_to_flash(sphere_num, SPHERE_TYPE_USER, batch.jobs[j].data);
+				printf("%s -> sphere %d (%u bytes per waveform)\n", batch.jobs[j].filename, sphere_num,
+						(unsigned)get_extflash_wave_bytes(sphere_num));
+				sphere_num++;
+			}
+			else {
+				snprintf(out_file, sizeof(out_file), "%s/%s.h", out_dir, name);
+				if (!write_sphere_header(out_file, name, batch.jobs[j].data)) {
+					fprintf(stderr, "Cannot write %s\n", out_file);
+					return 1;
+				}
+				printf("%s -> %s\n", batch.jobs[j].filename, out_file);
+			}
+			num_rendered++;
+		}
+	}
+
+	host_thread_pool_free(&pool);
+	for (j=0; j<RENDER_BATCH_SPHERES; j++)
+		free(batch.jobs[j].rec);
+	free(batch.jobs);
+	free(batch.ws);
+
+	flash_queue_wait_all();
+	update_flash_directory();
+	if (flash_out_file && !host_flashram_save(flash_out_file)) {
+		fprintf(stderr, "Cannot write %s\n", flash_out_file);
+		return 1;
+	}
+
+	printf("Rendered %d sphere%s on %u thread%s\n", num_rendered, (num_rendered==1) ? "" : "s",
+			(unsigned)pool.num_threads, (pool.num_threads==1) ? "" : "s");
+	return num_rendered ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+/*
+ * arm_bitreversal.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// C version of arm_bitreversal_32 (stm32/core/src/arm_bitreversal2.s is Thumb-2 assembly)
+// Same algorithm as the CMSIS-DSP reference: the table holds pairs of byte offsets to swap
+
+#include <stdint.h>
+
+void arm_bitreversal_32(uint32_t *pSrc, const uint16_t bitRevLen, const uint16_t *pBitRevTable)
+{
+	uint32_t a, b, i, tmp;
+
+	for (i = 0; i < bitRevLen; i += 2)
+	{
+		a = pBitRevTable[i    ] >> 2;
+		b = pBitRevTable[i + 1] >> 2;
+
+		//real
+		tmp = pSrc[a];
+		pSrc[a] = pSrc[b];
+		pSrc[b] = tmp;
+
+		//complex
+		tmp = pSrc[a+1];
+		pSrc[a+1] = pSrc[b+1];
+		pSrc[b+1] = tmp;
+	}
+}
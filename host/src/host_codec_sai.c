@@ -0,0 +1,90 @@
+/*
+ * host_codec_sai.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Host replacement for drivers/codec_sai.c
+//
+// There is no DMA on the host: the caller hands each half-transfer worth of
+// samples (STEREO_BUFSZ interleaved words, 24-bit in 32-bit) to
+// host_codec_process_block(), which calls the audio callback just like
+// the SAI RX DMA IRQ does.
+
+#include <string.h>
+
+#include "host_codec.h"
+#include "isr_trace.h"
+
+static audio_callback_func_type audio_callback;
+static uint8_t audio_running = 0;
+
+void set_audio_callback(audio_callback_func_type callback)
+{
+	audio_callback = callback;
+}
+
+enum Codec_Errors init_SAI_clock(uint32_t sample_rate)
+{
+	return CODEC_NO_ERR;
+}
+
+enum Codec_Errors init_audio_DMA(uint32_t sample_rate)
+{
+	return CODEC_NO_ERR;
+}
+
+void reboot_codec(uint32_t sample_rate)
+{
+	stop_audio();
+	start_audio();
+}
+
+void start_audio(void)
+{
+	audio_running = 1;
+}
+
+void stop_audio(void)
+{
+	audio_running = 0;
+}
+
+uint8_t host_codec_is_running(void)
+{
+	return audio_running;
+}
+
+// src and dst are STEREO_BUFSZ words each. dst is zeroed if audio is stopped.
+void host_codec_process_block(int32_t *src, int32_t *dst)
+{
+	if (audio_running && audio_callback) {
+		ISR_TRACE_ENTER(ISR_TRACE_SAI_RX_DMA);
+		audio_callback(src, dst);
+		ISR_TRACE_EXIT(ISR_TRACE_SAI_RX_DMA);
+	}
+	else
+		memset(dst, 0, STEREO_BUFSZ * sizeof(int32_t));
+}
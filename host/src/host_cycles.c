@@ -0,0 +1,76 @@
+/*
+ * host_cycles.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Host cycle counter: the TSC on x86 (inline, in host/inc/stm32f7xx.h),
+// otherwise the monotonic clock in ns.
+// host_cycles_per_us() calibrates the counter against the monotonic clock once.
+
+#include <time.h>
+
+#include <stm32f7xx.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#define HAS_TSC 1
+	static uint64_t rdtsc64(void) { uint32_t lo, hi; __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi)); return ((uint64_t)hi << 32) | lo; }
+#else
+	#define HAS_TSC 0
+#endif
+
+uint64_t host_monotonic_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#if !HAS_TSC
+uint32_t host_cycles(void)
+{
+	return (uint32_t)host_monotonic_ns();
+}
+#endif
+
+float host_cycles_per_us(void)
+{
+	static float cycles_per_us = 0.f;
+#if HAS_TSC
+	uint64_t t0, t1, c0, c1;
+
+	if (cycles_per_us == 0.f)
+	{
+		t0 = host_monotonic_ns();
+		c0 = rdtsc64();
+		do { t1 = host_monotonic_ns(); } while (t1 - t0 < 20000000ULL);
+		c1 = rdtsc64();
+		cycles_per_us = (float)(c1 - c0) * 1000.f / (float)(t1 - t0);
+	}
+#else
+	cycles_per_us = 1000.f;
+#endif
+	return cycles_per_us;
+}
@@ -0,0 +1,246 @@
+/*
+ * host_engine.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Runs the firmware the way main.c does, minus the hardware.
+//
+// host_engine_init() follows the init sequence in main(), skipping the clock, codec,
+// ADC and LED driver setup and all the splash-screen delays.
+// host_engine_run_block() advances simulated time by one audio block: timer callbacks
+// that are due run first (in time order), then one pass of the main loop, then the
+// audio callback.
+
+#include <string.h>
+
+#include "globals.h"
+#include "audio_util.h"
+#include "gpio_pins.h"
+#include "oscillator.h"
+#include "envout_pwm.h"
+#include "params_update.h"
+#include "flash_params.h"
+#include "led_cont.h"
+#include "led_colors.h"
+#include "adc_interface.h"
+#include "timekeeper.h"
+#include "drivers/mono_led_driver.h"
+#include "sphere_flash_io.h"
+#include "flash_directory.h"
+#include "preset_log.h"
+#include "sphere_log.h"
+#include "system_settings.h"
+#include "preset_manager.h"
+#include "preset_manager_UI.h"
+#include "preset_manager_selbus.h"
+#include "compressor.h"
+#include "ui_modes.h"
+#include "quantz_scales.h"
+#include "calibrate_voct.h"
+#include "params_lfo.h"
+#include "sphere.h"
+#include "wavetable_recording.h"
+#include "wavetable_editing.h"
+#include "wavetable_saveload.h"
+#include "analog_conditioning.h"
+#include "UI_conditioning.h"
+#include "drivers/flashram_spidma.h"
+#include "drivers/flashram_queue.h"
+#include "sel_bus.h"
+#include "waveshaper.h"
+#include "pitch_trace.h"
+
+#include "host_engine.h"
+#include "host_codec.h"
+#include "host_flashram.h"
+#include "host_timekeeper.h"
+
+extern enum 	UI_Modes ui_mode;
+
+extern float				hires_adc_raw	[ NUM_HIRES_ADCS ];
+extern ads8634Sample		hires_adc_sample[ NUM_HIRES_ADCS ];
+extern DMABUFFER uint16_t	builtin_adc1_raw[ NUM_BUILTIN_ADC1 ];
+extern DMABUFFER uint16_t	builtin_adc3_raw[ NUM_BUILTIN_ADC3 ];
+
+static uint64_t num_blocks;
+
+// All GPIO inputs idle high: buttons, switches and encoders are active low
+static void init_host_gpio_inputs(void)
+{
+	GPIO_TypeDef *gpios[] = {GPIOA, GPIOB, GPIOC, GPIOD, GPIOE, GPIOF, GPIOG, GPIOH, GPIOI, GPIOJ, GPIOK};
+	uint8_t i;
+
+	for (i=0; i<sizeof(gpios)/sizeof(gpios[0]); i++)
+		gpios[i]->IDR = 0xFFFF;
+}
+
+// Sliders all the way up, knobs and CV jacks at their resting values
+static void init_host_adcs(void)
+{
+	uint8_t i;
+
+	for (i=0; i<NUM_HIRES_ADCS; i++)		hires_adc_raw[i] = 0.f;
+	for (i=0; i<NUM_BUILTIN_ADC1; i++)		builtin_adc1_raw[i] = 2048;
+	for (i=0; i<NUM_BUILTIN_ADC3; i++)		builtin_adc3_raw[i] = 0;
+	for (i=SLD_ADC_1; i<=SLD_ADC_6; i++)	builtin_adc3_raw[i] = 4095;
+}
+
+void host_engine_set_slider(uint8_t chan, uint16_t val)
+{
+	if (chan <= SLD_ADC_6) builtin_adc3_raw[SLD_ADC_1 + chan] = val;
+}
+
+void host_engine_set_knob_adc(uint8_t adc1_chan, uint16_t val)
+{
+	if (adc1_chan < NUM_BUILTIN_ADC1) builtin_adc1_raw[adc1_chan] = val;
+}
+
+// As if the ADC IRQ had just resolved a new value
+void host_engine_set_cv(uint8_t hires_chan, float val)
+{
+	if (hires_chan >= NUM_HIRES_ADCS) return;
+
+	hires_adc_raw[hires_chan] = val;
+	PITCH_TRACE_ADC_SAMPLE(&hires_adc_sample[hires_chan]);
+	hires_adc_sample[hires_chan].count++;
+}
+
+void host_engine_init(const char *flash_image)
+{
+	uint32_t valid_fw_version;
+	uint8_t i;
+
+	set_gpio_map();
+	init_gpio_pins();
+	init_host_gpio_inputs();
+	init_host_adcs();
+
+	init_timekeeper();
+
+	// Initialize starting values
+	init_color_palette();
+	init_led_cont();
+	init_led_cont_ongoing_display();
+	clear_lfo_locks();
+	use_internal_lfo_base();
+	init_lfos();
+	init_encoders();
+	init_lfo_to_vc_mode();
+
+	//External FLASH
+	sFLASH_init();
+	init_flash_queue();
+	if (flash_image)
+		host_flashram_load(flash_image);
+
+	//Initialize param values (do not start updating them yet)
+	init_wt_osc();
+	init_waveshaper(&waveshaper);
+	init_params();
+	init_pitch_params();
+	init_quantz_scales();
+
+	for (i=0; i<NUM_CHANNELS; i++)
+		cache_uncache_keys_params_and_lfos(i, CACHE);
+
+	init_envout_pwm();
+	start_monoled_updates();
+
+	init_sphere_flash();
+	init_flash_directory();
+	init_sphere_log();
+	read_all_spheretypes();
+	init_preset_log();
+	host_write_factory_spheres();
+
+	valid_fw_version = load_flash_params();
+	if (!valid_fw_version)
+	{
+		factory_reset_all_calibrations();
+		factory_reset();
+	}
+
+	update_number_of_user_spheres_filled();
+
+	setup_analog_conditioning();
+	start_analog_conditioning();
+	set_default_cv_jack_calibration_offsets();
+
+	start_UI_conditioning_updates();
+
+	init_preset_manager();
+
+	start_osc_updates();
+	start_osc_interp_updates();
+	force_all_wt_interp_update();
+
+	start_envout_pwm();
+
+	init_compressor(COMPRESS_SIGNED_24BIT, 0.90);
+
+	ui_mode = PLAY;
+
+	set_audio_callback(&process_audio_block_codec);
+	start_audio();
+
+	start_led_display();
+
+	num_blocks = 0;
+}
+
+void host_engine_main_loop(void)
+{
+	read_freq();
+
+	read_switches();
+	update_osc_param_lock();
+	read_selbus_buttons();
+	check_ui_mode_requests();
+
+	read_load_save_encoder();
+	check_sel_bus_event();
+
+	if (ui_mode == VOCT_CALIBRATE) process_voct_calibrate_mode();
+
+	update_sphere_log();
+	update_preset_log();
+	update_flash_directory();
+}
+
+void host_engine_run_block(int32_t *src, int32_t *dst)
+{
+	num_blocks++;
+	host_timekeeper_run_until(num_blocks * HOST_BLOCK_FRAMES * 1000000000ULL / SAMPLERATE);
+
+	host_engine_main_loop();
+
+	host_codec_process_block(src, dst);
+}
+
+uint64_t host_engine_num_blocks(void)
+{
+	return num_blocks;
+}
@@ -0,0 +1,81 @@
+/*
+ * host_factory_spheres.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// The firmware is built with SKIP_FACTORY_SPHERES_IN_HEXFILE, so it expects the
+// factory spheres to already be in the SPI flash. The host build links them in
+// and writes them to the fake flash chip (same order as spheres_internal.h)
+
+#include "globals.h"
+#include "sphere.h"
+#include "sphere_flash_io.h"
+#include "host_engine.h"
+
+#include "spheres/hp_909hits_01.h"
+#include "spheres/hp_Distorted_FM.h"
+#include "spheres/hp_Morphing_Cello.h"
+#include "spheres/hp_TalkativeFM.h"
+#include "spheres/computed_formants.h"
+#include "spheres/hp_wavetable_formants_applespeech_1.h"
+#include "spheres/wavetable_SWN_D.h"
+#include "spheres/wavetable_SWN_wf_rm_hs.h"
+#include "spheres/wavetable_Sine_Seq_JQ.h"
+#include "spheres/wavetable_pailo_sine_square.h"
+#include "spheres/wavetable_pailo_smoothrough.h"
+#include "spheres/wavetable_ring_mod_JQ.h"
+
+static const void *host_factory_spheres[NUM_FACTORY_SPHERES] = {
+	(void *)wavetable_SWN_D,
+	(void *)wavetable_pailo_sine_square,
+	(void *)computed_formants,
+	(void *)hp_wavetable_formants_applespeech_1,
+	(void *)hp_Morphing_Cello,
+	(void *)hp_TalkativeFM,
+	(void *)hp_Distorted_FM,
+	(void *)hp_909hits_01,
+	(void *)wavetable_SWN_wf_rm_hs,
+	(void *)wavetable_pailo_smoothrough,
+	(void *)wavetable_ring_mod_JQ,
+	(void *)wavetable_Sine_Seq_JQ,
+};
+
+// Writes any factory sphere that's not already present
+void host_write_factory_spheres(void)
+{
+	uint32_t wt_num;
+
+	for (wt_num=0; wt_num<NUM_FACTORY_SPHERES; wt_num++) {
+		if (get_spheretype(wt_num) != SPHERE_TYPE_FACTORY)
+			save_sphere_to_flash(wt_num, SPHERE_TYPE_FACTORY, (int16_t *)host_factory_spheres[wt_num]);
+	}
+}
+
+const o_waveform *host_factory_sphere(uint8_t wt_num)
+{
+	if (wt_num >= NUM_FACTORY_SPHERES) return 0;
+	return (const o_waveform *)host_factory_spheres[wt_num];
+}
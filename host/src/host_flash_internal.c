@@ -0,0 +1,132 @@
+/*
+ * host_flash_internal.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Host replacement for flash.c
+// The STM32's internal flash (0x08000000 - 0x080FFFFF) is modeled as a RAM array.
+
+#include <string.h>
+
+#include "flash.h"
+
+#define INTFLASH_BASE	0x08000000
+#define INTFLASH_SIZE	0x00100000
+
+static const uint32_t FLASH_SECTOR_ADDRESSES[NUM_FLASH_SECTORS+1] = {
+	0x08000000,
+	0x08008000,
+	0x08010000,
+	0x08018000,
+	0x08020000,
+	0x08040000,
+	0x08080000,
+	0x080C0000,
+	0x08100000,
+};
+
+static uint8_t intflash[INTFLASH_SIZE];
+static uint8_t intflash_initialized = 0;
+
+static uint8_t *intflash_ptr(uint32_t address)
+{
+	if (!intflash_initialized)
+	{
+		memset(intflash, 0xFF, INTFLASH_SIZE);
+		intflash_initialized = 1;
+	}
+	return &intflash[(address - INTFLASH_BASE) & (INTFLASH_SIZE-1)];
+}
+
+void flash_erase_sector(uint32_t address)
+{
+	flash_open_erase_sector(address);
+}
+
+void flash_open_erase_sector(uint32_t address)
+{
+	uint8_t i;
+
+	for (i = 0; i < NUM_FLASH_SECTORS; i++) {
+		if (address == FLASH_SECTOR_ADDRESSES[i]) {
+			memset(intflash_ptr(address), 0xFF, FLASH_SECTOR_ADDRESSES[i+1] - FLASH_SECTOR_ADDRESSES[i]);
+			break;
+		}
+	}
+}
+
+void flash_begin_open_program(void) {}
+void flash_end_open_program(void) {}
+
+uint8_t flash_open_program_byte(uint8_t byte, uint32_t address)
+{
+	*intflash_ptr(address) &= byte;
+	return 0;
+}
+
+uint8_t flash_open_program_word(uint32_t word, uint32_t address)
+{
+	uint8_t i;
+
+	for (i = 0; i < 4; i++)
+		flash_open_program_byte((word >> (i*8)) & 0xFF, address + i);
+	return 0;
+}
+
+uint8_t flash_open_program_block_bytes(uint8_t* arr, uint32_t address, uint32_t size)
+{
+	while (size--)
+		flash_open_program_byte(*arr++, address++);
+	return 0;
+}
+
+uint8_t flash_open_program_block_words(uint32_t* arr, uint32_t address, uint32_t size)
+{
+	while (size--) {
+		flash_open_program_word(*arr++, address);
+		address += 4;
+	}
+	return 0;
+}
+
+void flash_read_array(uint8_t* arr, uint32_t address, uint32_t size)
+{
+	while (size--)
+		*arr++ = *intflash_ptr(address++);
+}
+
+uint32_t flash_read_word(uint32_t address)
+{
+	uint32_t word;
+
+	flash_read_array((uint8_t *)&word, address, 4);
+	return word;
+}
+
+uint8_t flash_read_byte(uint32_t address)
+{
+	return *intflash_ptr(address);
+}
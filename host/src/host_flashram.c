@@ -0,0 +1,252 @@
+/*
+ * host_flashram.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Host replacement for drivers/flashram_spidma.c
+//
+// RAM-backed model of the S25FL127 SPI flash chip.
+// Erasing sets bytes to 0xFF and programming can only clear bits, like the real chip.
+// All transfers complete immediately, so get_flash_state() is always sFLASH_NOTBUSY
+// by the time a read/write/erase call returns.
+// Sector erases can be given a duration (in sFLASH_is_chip_ready() polls) to test
+// code that runs during an erase. Reading while an erase is running, or reading the
+// sector being erased while it's suspended, is counted as a conflict.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "drivers/flash_S25FL127.h"
+#include "drivers/flashram_spidma.h"
+#include "host_flashram.h"
+
+enum sFlashErrors sflash_error=0;
+volatile enum sFlashStates sflash_state=0;
+
+static uint8_t flashram[sFLASH_SIZE];
+
+static uint32_t erase_polls = 0;
+static uint32_t erase_polls_left = 0;
+static uint8_t 	erase_suspended = 0;
+static uint32_t erase_addr, erase_size;
+static uint32_t conflicts = 0;
+
+uint8_t *host_flashram_mem(void) { return flashram; }
+
+void host_flashram_set_erase_polls(uint32_t polls) { erase_polls = polls; }
+uint32_t host_flashram_conflicts(void) { return conflicts; }
+
+static void check_read_conflict(uint32_t read_addr, uint32_t num_bytes)
+{
+	if (!erase_polls_left)
+		return;
+	if (!erase_suspended || (read_addr < erase_addr + erase_size && read_addr + num_bytes > erase_addr))
+		conflicts++;
+}
+
+//Public:
+enum sFlashStates get_flash_state(void) { return sflash_state; }
+
+void sFLASH_init(void)
+{
+	memset(flashram, 0xFF, sFLASH_SIZE);
+	sflash_error = sFLASH_NO_ERROR;
+	sflash_state = sFLASH_NOTBUSY;
+	erase_polls_left = 0;
+	erase_suspended = 0;
+	conflicts = 0;
+}
+
+uint8_t sFLASH_is_chip_ready(void)
+{
+	if (erase_polls_left && !erase_suspended) {
+		erase_polls_left--;
+		return 0;
+	}
+	return 1;
+}
+
+//
+// READING
+//
+
+void sFLASH_read_buffer(uint8_t* rxBuffer, uint32_t read_addr, uint16_t num_bytes)
+{
+	sFLASH_read_buffer_DMA(rxBuffer, read_addr, num_bytes);
+}
+
+void sFLASH_read_buffer_DMA(uint8_t* rxBuffer, uint32_t read_addr, uint16_t num_bytes)
+{
+	uint32_t i;
+
+	check_read_conflict(read_addr, num_bytes);
+
+	for (i=0; i<num_bytes; i++)
+		rxBuffer[i] = flashram[(read_addr + i) & (sFLASH_SIZE-1)];
+
+	sflash_state = sFLASH_NOTBUSY;
+}
+
+void sFLASH_read_segments_DMA(const sFlashSegment *segs, uint8_t num_segs, uint32_t read_addr)
+{
+	uint8_t i;
+
+	for (i=0; i<num_segs; i++) {
+		sFLASH_read_buffer_DMA(segs[i].buf, read_addr, segs[i].num_bytes);
+		read_addr += segs[i].num_bytes;
+	}
+}
+
+//
+// WRITING
+//
+
+void sFLASH_write_buffer(uint8_t* txBuffer, uint32_t write_addr, uint16_t num_bytes)
+{
+	uint32_t i;
+
+	if (write_addr + num_bytes > sFLASH_SIZE)
+	{
+		sflash_error |= sFLASH_PROG_ERROR;
+		return;
+	}
+
+	if (erase_polls_left)
+		conflicts++;
+
+	for (i=0; i<num_bytes; i++)
+		flashram[write_addr + i] &= txBuffer[i];
+
+	sflash_state = sFLASH_NOTBUSY;
+}
+
+void sFLASH_write_page_DMA(uint8_t* txBuffer, uint32_t write_addr, uint16_t num_bytes)
+{
+	if (num_bytes > sFLASH_SPI_PAGESIZE) {
+		num_bytes = sFLASH_SPI_PAGESIZE;
+		sflash_error |= sFLASH_SPI_PAGE_OF_WARN;
+	}
+	sFLASH_write_buffer(txBuffer, write_addr, num_bytes);
+}
+
+//
+// ERASING
+//
+
+void sFLASH_erase_sector(uint32_t SectorAddr)
+{
+	sFLASH_erase_sector_background(SectorAddr);
+	while (!sFLASH_is_chip_ready()) {;}
+}
+
+void sFLASH_erase_sector_background(uint32_t SectorAddr)
+{
+	uint32_t aligned_addr = sFLASH_align2sector(SectorAddr);
+	uint32_t size = (aligned_addr < sFLASH_SPI_FIRST_64K_ADDR) ? sFLASH_SPI_4K_SECTOR_SIZE : sFLASH_SPI_64K_SECTOR_SIZE;
+
+	if (erase_polls_left)
+		conflicts++;
+
+	memset(&flashram[aligned_addr], 0xFF, size);
+	sflash_state = sFLASH_NOTBUSY;
+
+	erase_addr = aligned_addr;
+	erase_size = size;
+	erase_polls_left = erase_polls;
+	erase_suspended = 0;
+}
+
+void sFLASH_erase_suspend(void)
+{
+	if (erase_polls_left)
+		erase_suspended = 1;
+}
+
+void sFLASH_erase_resume(void)
+{
+	erase_suspended = 0;
+}
+
+void sFLASH_erase_chip(void)
+{
+	memset(flashram, 0xFF, sFLASH_SIZE);
+	sflash_state = sFLASH_NOTBUSY;
+}
+
+//
+// TESTS
+//
+uint32_t sFLASH_test_sector(uint32_t test_start)
+{
+	uint8_t test_bytes[sFLASH_SPI_PAGESIZE];
+	uint32_t i;
+	uint32_t bad_bytes=0;
+
+	test_start = sFLASH_align2sector(test_start);
+
+	for (i=0; i<sFLASH_SPI_PAGESIZE; i++)
+		test_bytes[i] = (5+i) & 0xFF;
+
+	sFLASH_erase_sector(test_start);
+	sFLASH_write_buffer(test_bytes, test_start, sFLASH_SPI_PAGESIZE);
+
+	memset(test_bytes, 0, sFLASH_SPI_PAGESIZE);
+	sFLASH_read_buffer(test_bytes, test_start, sFLASH_SPI_PAGESIZE);
+
+	for (i=0; i<sFLASH_SPI_PAGESIZE; i++)
+	{
+		if (test_bytes[i] != ((5+i) & 0xFF))
+			bad_bytes++;
+	}
+	return bad_bytes;
+}
+
+//
+// Flash image files: a raw 16MB dump of the chip
+//
+
+// Returns 1 if the whole image was read
+uint8_t host_flashram_load(const char *filename)
+{
+	FILE *f = fopen(filename, "rb");
+	size_t n;
+
+	if (!f) return 0;
+	n = fread(flashram, 1, sFLASH_SIZE, f);
+	fclose(f);
+	return (n == sFLASH_SIZE);
+}
+
+uint8_t host_flashram_save(const char *filename)
+{
+	FILE *f = fopen(filename, "wb");
+	size_t n;
+
+	if (!f) return 0;
+	n = fwrite(flashram, 1, sFLASH_SIZE, f);
+	fclose(f);
+	return (n == sFLASH_SIZE);
+}
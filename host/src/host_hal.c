@@ -0,0 +1,86 @@
+/*
+ * host_hal.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// HAL functions called by the firmware sources, reduced to no-ops for the host build.
+// HAL_GetTick() follows the simulated time of host_timekeeper.c
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "globals.h"
+#include "hal_handlers.h"
+#include "host_timekeeper.h"
+
+uint32_t HAL_GetTick(void)
+{
+	return (uint32_t)(host_time_ns() / (1000000ULL / TICKS_PER_MS));
+}
+
+// HAL_Delay() takes ticks (TICKS_PER_MS per ms), since the firmware sets SysTick to 8kHz
+void HAL_Delay(uint32_t Delay)
+{
+	host_timekeeper_advance((uint64_t)Delay * (1000000ULL / TICKS_PER_MS));
+}
+
+void _Error_Handler(const char* file, uint32_t line)
+{
+	fprintf(stderr, "_Error_Handler: %s:%u\n", file, (unsigned)line);
+	abort();
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority) {}
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn) {}
+
+void HAL_GPIO_Init(GPIO_TypeDef  *GPIOx, GPIO_InitTypeDef *GPIO_Init) {}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma) 			{ return HAL_OK; }
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma) 			{ return HAL_OK; }
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma) {}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c) 			{ return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c) 			{ return HAL_OK; }
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c) 					{ return HAL_I2C_ERROR_NONE; }
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout) { return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size) { return HAL_OK; }
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c) {}
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c) {}
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef* hadc) 			{ return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef* hadc) 			{ return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef* hadc, uint32_t* pData, uint32_t Length) { return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef* hadc, ADC_ChannelConfTypeDef* sConfig) { return HAL_OK; }
+
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim) 		{ return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel) { return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef* sConfig, uint32_t Channel) { return HAL_OK; }
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi) 			{ return HAL_OK; }
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart) 			{ return HAL_OK; }
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size) { return HAL_OK; }
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart) {}
@@ -0,0 +1,389 @@
+/*
+ * host_isr_report.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Turns a list of isr_trace events (oldest first) into the load, lateness and
+// preemptions of each handler, for swn_isr_report and the isr bench.
+//
+// The calls are matched up by replaying the events on a stack of the handlers that
+// are running: a start pushes, an end pops, and the handler on top is the one using the CPU.
+// Each event carries the depth it was recorded at, so if the stack doesn't match
+// (the start of a wrapped buffer, or a handler that was masked out partway) it starts over.
+//
+// How late a periodic handler started can't be read from the trace directly, since the
+// time it was due isn't recorded. Its calls are fitted to a fixed-rate schedule (least squares),
+// one call per period, and the call that was earliest relative to the schedule is taken as on time.
+// So the lateness is relative to the best case seen, which is close to 0 on a long enough trace.
+// A call that was lost (on the target, a timer IRQ late by more than its period) makes
+// the calls after it look a period late.
+
+#include <math.h>
+#include <string.h>
+
+#include "host_isr_report.h"
+
+typedef struct IsrFrame {
+	uint8_t		id;
+	uint8_t		preempted;
+	uint64_t	start;
+	uint64_t	resume;				// when it last got the CPU back
+	uint64_t	self;
+} IsrFrame;
+
+typedef struct IsrStack {
+	IsrFrame	frame[NUM_ISR_TRACE_IDS];
+	uint8_t		depth;
+} IsrStack;
+
+// Replays one event. Returns 0 if it didn't fit on the stack
+static uint8_t replay_event(IsrStack *st, const o_isr_trace_event *e, uint64_t t, o_isr_report *report)
+{
+	IsrFrame *f;
+	o_isr_report_stats *s;
+
+	if (e->id >= NUM_ISR_TRACE_IDS)
+		return 0;
+
+	if (!e->exit)
+	{
+		if (e->depth != st->depth) {
+			st->depth = 0;
+			if (e->depth) return 0;
+		}
+		if (st->depth >= NUM_ISR_TRACE_IDS)
+			return 0;
+
+		if (st->depth)
+		{
+			f = &st->frame[st->depth - 1];
+			f->self += t - f->resume;
+			if (report) {
+				if (!f->preempted) report->isr[f->id].preempted++;
+				report->isr[f->id].preempted_by[e->id]++;
+			}
+			f->preempted = 1;
+		}
+
+		f = &st->frame[st->depth++];
+		f->id = e->id;
+		f->preempted = 0;
+		f->start = t;
+		f->resume = t;
+		f->self = 0;
+		return 1;
+	}
+
+	if (!st->depth || e->depth != st->depth - 1 || st->frame[st->depth - 1].id != e->id) {
+		st->depth = 0;
+		return 0;
+	}
+
+	f = &st->frame[--st->depth];
+	f->self += t - f->resume;
+	if (st->depth)
+		st->frame[st->depth - 1].resume = t;
+
+	if (report)
+	{
+		s = &report->isr[f->id];
+		s->calls++;
+		s->self += f->self;
+		if (f->self > s->self_worst)
+			s->self_worst = f->self;
+		if (t - f->start > s->response_worst) {
+			s->response_worst = t - f->start;
+			s->response_worst_at = f->start;
+		}
+	}
+	return 1;
+}
+
+// Fits the start times of each periodic handler to t = a + period * k, k counting its calls
+static void find_lateness(const o_isr_trace_event *events, uint32_t num_events, o_isr_report *report)
+{
+	double sum_k[NUM_ISR_TRACE_IDS] = {0}, sum_kk[NUM_ISR_TRACE_IDS] = {0}, sum_r[NUM_ISR_TRACE_IDS] = {0}, sum_kr[NUM_ISR_TRACE_IDS] = {0};
+	double a[NUM_ISR_TRACE_IDS] = {0}, period[NUM_ISR_TRACE_IDS] = {0};
+	double r_min[NUM_ISR_TRACE_IDS], r_max[NUM_ISR_TRACE_IDS];
+	uint64_t first[NUM_ISR_TRACE_IDS] = {0}, t;
+	uint32_t num[NUM_ISR_TRACE_IDS] = {0};
+	uint32_t i;
+	uint8_t id, pass;
+	double k, r, n, det;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		memset(num, 0, sizeof(num));
+		t = 0;
+		for (i = 0; i < num_events; i++)
+		{
+			if (i) t += (uint32_t)(events[i].time - events[i-1].time);
+
+			id = events[i].id;
+			if (events[i].exit || id >= NUM_ISR_TRACE_IDS || !isr_trace_is_periodic(id))
+				continue;
+
+			if (!num[id]) first[id] = t;
+			k = (double)num[id]++;
+			r = (double)(t - first[id]);
+
+			if (pass == 0) {
+				sum_k[id] += k;
+				sum_kk[id] += k * k;
+				sum_r[id] += r;
+				sum_kr[id] += k * r;
+			} else {
+				r -= a[id] + period[id] * k;
+				if (r < r_min[id]) r_min[id] = r;
+				if (r > r_max[id]) r_max[id] = r;
+			}
+		}
+
+		for (id = 0; id < NUM_ISR_TRACE_IDS; id++)
+		{
+			if (num[id] < 3) continue;
+
+			n = (double)num[id];
+			det = n * sum_kk[id] - sum_k[id] * sum_k[id];
+			if (pass == 0) {
+				period[id] = (n * sum_kr[id] - sum_k[id] * sum_r[id]) / det;
+				a[id] = (sum_r[id] - period[id] * sum_k[id]) / n;
+				r_min[id] = 1e30;
+				r_max[id] = -1e30;
+			}
+			else {
+				// The residuals average 0, so the mean lateness is how early the earliest call was
+				report->isr[id].period = (float)period[id];
+				report->isr[id].late_mean = (float)(0.0 - r_min[id]);
+				report->isr[id].late_worst = (uint32_t)(r_max[id] - r_min[id]);
+			}
+		}
+	}
+}
+
+void isr_report_analyze(const o_isr_trace_event *events, uint32_t num_events, float ticks_per_us, o_isr_report *report)
+{
+	IsrStack st;
+	uint64_t t = 0, first = 0, last = 0;
+	uint32_t i;
+	uint8_t started = 0;
+
+	memset(report, 0, sizeof(o_isr_report));
+	report->ticks_per_us = ticks_per_us;
+	st.depth = 0;
+
+	for (i = 0; i < num_events; i++)
+	{
+		if (i) t += (uint32_t)(events[i].time - events[i-1].time);
+
+		if (!replay_event(&st, &events[i], t, report)) {
+			report->skipped++;
+			continue;
+		}
+		if (!started) { first = t; started = 1; }
+		last = t;
+		report->num_events++;
+	}
+
+	report->span = last - first;
+	find_lateness(events, num_events, report);
+}
+
+static float to_us(const o_isr_report *report, double ticks)
+{
+	return (float)(ticks / report->ticks_per_us);
+}
+
+static float load_percent(const o_isr_report *report, uint8_t id)
+{
+	return report->span ? (float)(100.0 * (double)report->isr[id].self / (double)report->span) : 0.f;
+}
+
+static const char *report_name(uint8_t id)
+{
+	static char buf[16];
+	const char *name = isr_trace_name(id);
+
+	if (name[0]) return name;
+	snprintf(buf, sizeof(buf), "id %u", (unsigned)id);
+	return buf;
+}
+
+void isr_report_print(const o_isr_report *report)
+{
+	const o_isr_report_stats *s;
+	uint8_t id, col, num_preempting = 0;
+	uint8_t preempting[NUM_ISR_TRACE_IDS];
+	float load, max_load = 0.f, total_load = 0.f, rate;
+	uint32_t j, bar;
+
+	printf("\n%.1f ms of trace, %u events (%u skipped)\n", to_us(report, report->span) / 1000.f,
+			(unsigned)report->num_events, (unsigned)report->skipped);
+	printf("  %-18s %8s %9s %7s %9s %9s %9s %9s %9s %10s\n", "handler", "calls", "rate Hz", "load %",
+			"mean us", "worst us", "resp us", "late us", "worst us", "preempted");
+
+	for (id = 0; id < NUM_ISR_TRACE_IDS; id++)
+	{
+		s = &report->isr[id];
+		if (!s->calls) continue;
+
+		load = load_percent(report, id);
+		total_load += load;
+		if (load > max_load) max_load = load;
+
+		rate = s->period ? 1e6f / to_us(report, s->period) : (report->span ? (float)s->calls * 1e6f / to_us(report, report->span) : 0.f);
+		printf("  %-18s %8u %9.1f %7.2f %9.2f %9.2f %9.2f", report_name(id), (unsigned)s->calls, rate, load,
+				to_us(report, (double)s->self / s->calls), to_us(report, s->self_worst), to_us(report, s->response_worst));
+		if (s->period)
+			printf(" %9.2f %9.2f", to_us(report, s->late_mean), to_us(report, s->late_worst));
+		else
+			printf(" %9s %9s", "-", "-");
+		printf(" %9.1f%%\n", 100.f * (float)s->preempted / (float)s->calls);
+	}
+	printf("  %-18s %8s %9s %7.2f\n", "total", "", "", total_load);
+
+	// Load chart, scaled to the busiest handler
+	printf("\n  Load\n");
+	for (id = 0; id < NUM_ISR_TRACE_IDS; id++)
+	{
+		if (!report->isr[id].calls) continue;
+
+		load = load_percent(report, id);
+		bar = (max_load > 0.f) ? (uint32_t)(load / max_load * 50.f + 0.5f) : 0;
+		printf("  %-18s |", report_name(id));
+		for (j = 0; j < 50; j++)
+			putchar(j < bar ? '#' : ' ');
+		printf("| %6.2f%%\n", load);
+	}
+
+	// Preemption chart: how many times each handler (row) was preempted by each other (column)
+	for (id = 0; id < NUM_ISR_TRACE_IDS; id++)
+	{
+		for (j = 0; j < NUM_ISR_TRACE_IDS; j++)
+			if (report->isr[j].preempted_by[id]) break;
+		if (j < NUM_ISR_TRACE_IDS)
+			preempting[num_preempting++] = id;
+	}
+
+	if (!num_preempting) {
+		printf("\n  No preemptions\n");
+		return;
+	}
+
+	printf("\n  Preempted by\n  %-18s", "");
+	for (col = 0; col < num_preempting; col++)
+		printf(" %9.9s", report_name(preempting[col]));
+	printf("\n");
+
+	for (id = 0; id < NUM_ISR_TRACE_IDS; id++)
+	{
+		s = &report->isr[id];
+		if (!s->preempted) continue;
+
+		printf("  %-18s", report_name(id));
+		for (col = 0; col < num_preempting; col++) {
+			if (s->preempted_by[preempting[col]])
+				printf(" %9u", (unsigned)s->preempted_by[preempting[col]]);
+			else
+				printf(" %9s", ".");
+		}
+		printf("\n");
+	}
+}
+
+// isr,<scenario>,<handler>,<mean time per call>,<worst start to end>,<worst lateness>, in ns
+void isr_report_print_csv(const o_isr_report *report, const char *scenario)
+{
+	const o_isr_report_stats *s;
+	uint8_t id;
+
+	for (id = 0; id < NUM_ISR_TRACE_IDS; id++)
+	{
+		s = &report->isr[id];
+		if (!s->calls) continue;
+
+		printf("isr,%s,%s,%.1f,%.1f,%.1f\n", scenario, report_name(id),
+				to_us(report, (double)s->self / s->calls) * 1000.f, to_us(report, s->response_worst) * 1000.f,
+				to_us(report, s->late_worst) * 1000.f);
+	}
+}
+
+static void mark(char *row, uint64_t from, uint64_t to, uint64_t start, uint64_t width, char c)
+{
+	uint64_t b0, b1, b;
+
+	if (to <= start || from >= start + width) return;
+	if (from < start) from = start;
+	if (to > start + width) to = start + width;
+
+	b0 = (from - start) * ISR_REPORT_TIMELINE_COLUMNS / width;
+	b1 = (to - start) * ISR_REPORT_TIMELINE_COLUMNS / width;
+	if (b1 == b0) b1 = b0 + 1;
+	if (b1 > ISR_REPORT_TIMELINE_COLUMNS) b1 = ISR_REPORT_TIMELINE_COLUMNS;
+
+	for (b = b0; b < b1; b++)
+		if (row[b] != '#') row[b] = c;
+}
+
+// Chart of which handler had the CPU (#) and which were preempted (-),
+// from start to start + width (ticks from the first event)
+void isr_report_print_timeline(const o_isr_trace_event *events, uint32_t num_events, const o_isr_report *report, uint64_t start, uint64_t width)
+{
+	char row[NUM_ISR_TRACE_IDS][ISR_REPORT_TIMELINE_COLUMNS + 1];
+	char from[32], to[32];
+	IsrStack st;
+	uint64_t t = 0, prev_t = 0;
+	uint32_t i;
+	uint8_t id, d;
+
+	if (!width) return;
+
+	memset(row, ' ', sizeof(row));
+	st.depth = 0;
+
+	for (i = 0; i < num_events && t < start + width; i++)
+	{
+		if (i) t += (uint32_t)(events[i].time - events[i-1].time);
+
+		for (d = 0; d < st.depth; d++)
+			mark(row[st.frame[d].id], prev_t, t, start, width, (d == st.depth - 1) ? '#' : '-');
+
+		replay_event(&st, &events[i], t, 0);
+		prev_t = t;
+	}
+
+	snprintf(from, sizeof(from), "%.1f us", to_us(report, start));
+	snprintf(to, sizeof(to), "%.1f us", to_us(report, start + width));
+	printf("\n  %-18s  %-*s%s\n", "Timeline", ISR_REPORT_TIMELINE_COLUMNS - (int)strlen(to), from, to);
+
+	for (id = 0; id < NUM_ISR_TRACE_IDS; id++)
+	{
+		row[id][ISR_REPORT_TIMELINE_COLUMNS] = 0;
+		if (strspn(row[id], " ") == ISR_REPORT_TIMELINE_COLUMNS) continue;
+
+		printf("  %-18s |%s|\n", report_name(id), row[id]);
+	}
+}
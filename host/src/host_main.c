@@ -0,0 +1,111 @@
+/*
+ * host_main.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// swn_host: runs the SWN audio engine offline
+//
+// Usage: swn_host [-i in.wav] [-o out.wav] [-s seconds] [-f flash.bin] [-w flash_out.bin]
+//   -i  audio input jack (left channel of the file is used, like the hardware)
+//   -o  stereo 24-bit output (default: swn_out.wav)
+//   -s  length to render, in seconds (default: 5, or the length of the input file)
+//   -f  SPI flash image to start from (16MB raw dump)
+//   -w  save the SPI flash image when done
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.h"
+#include "flash_directory.h"
+#include "drivers/flashram_queue.h"
+#include "host_engine.h"
+#include "host_flashram.h"
+#include "host_wav.h"
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: swn_host [-i in.wav] [-o out.wav] [-s seconds] [-f flash.bin] [-w flash_out.bin]\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *in_file = NULL, *out_file = "swn_out.wav", *flash_file = NULL, *flash_out_file = NULL;
+	float seconds = 0.f;
+	HostWav in_wav, out_wav;
+	int32_t src[HOST_BLOCK_WORDS], dst[HOST_BLOCK_WORDS];
+	uint64_t num_frames, frame;
+	int i;
+
+	for (i=1; i<argc; i++)
+	{
+		if (!strcmp(argv[i], "-i") && i+1<argc) 		in_file = argv[++i];
+		else if (!strcmp(argv[i], "-o") && i+1<argc) 	out_file = argv[++i];
+		else if (!strcmp(argv[i], "-s") && i+1<argc) 	seconds = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-f") && i+1<argc) 	flash_file = argv[++i];
+		else if (!strcmp(argv[i], "-w") && i+1<argc) 	flash_out_file = argv[++i];
+		else { usage(); return 1; }
+	}
+
+	if (in_file && !host_wav_open_read(&in_wav, in_file)) {
+		fprintf(stderr, "Cannot read %s (16 or 24-bit PCM wav required)\n", in_file);
+		return 1;
+	}
+	if (in_file && in_wav.samplerate != SAMPLERATE)
+		fprintf(stderr, "Warning: %s is %uHz, engine runs at %uHz\n", in_file, (unsigned)in_wav.samplerate, (unsigned)SAMPLERATE);
+
+	if (seconds <= 0.f)
+		seconds = in_file ? ((float)in_wav.num_frames / SAMPLERATE) : 5.f;
+	num_frames = (uint64_t)(seconds * SAMPLERATE);
+
+	if (!host_wav_open_write(&out_wav, out_file, SAMPLERATE, 2, 24)) {
+		fprintf(stderr, "Cannot write %s\n", out_file);
+		return 1;
+	}
+
+	host_engine_init(flash_file);
+
+	for (frame=0; frame<num_frames; frame+=HOST_BLOCK_FRAMES)
+	{
+		memset(src, 0, sizeof(src));
+		if (in_file)
+			host_wav_read_s24(&in_wav, src, 2, HOST_BLOCK_FRAMES);
+
+		host_engine_run_block(src, dst);
+		host_wav_write_s24(&out_wav, dst, HOST_BLOCK_FRAMES);
+	}
+
+	host_wav_close(&out_wav);
+	if (in_file) host_wav_close(&in_wav);
+
+	flash_queue_wait_all();
+	update_flash_directory();
+	if (flash_out_file && !host_flashram_save(flash_out_file))
+		fprintf(stderr, "Cannot write %s\n", flash_out_file);
+
+	printf("Rendered %.2fs to %s\n", (double)frame / SAMPLERATE, out_file);
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * host_thread_pool.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "host_thread_pool.h"
+
+uint32_t host_num_cpus(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? (uint32_t)n : 1;
+}
+
+static void *worker_main(void *p)
+{
+	HostThreadPool 	*pool = p;
+	uint32_t 		worker, task;
+
+	pthread_mutex_lock(&pool->lock);
+	worker = pool->num_started++;
+
+	while (1)
+	{
+		while (!pool->quit && pool->next_task >= pool->num_tasks)
+			pthread_cond_wait(&pool->start, &pool->lock);
+		if (pool->quit)
+			break;
+
+		task = pool->next_task++;
+		pthread_mutex_unlock(&pool->lock);
+
+		pool->func(pool->arg, task, worker);
+
+		pthread_mutex_lock(&pool->lock);
+		if (++pool->tasks_done == pool->num_tasks)
+			pthread_cond_signal(&pool->done);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+uint8_t host_thread_pool_init(HostThreadPool *pool, uint32_t num_threads)
+{
+	uint32_t i;
+
+	pool->num_threads 	= num_threads ? num_threads : host_num_cpus();
+	pool->num_tasks 	= 0;
+	pool->next_task 	= 0;
+	pool->tasks_done 	= 0;
+	pool->num_started 	= 0;
+	pool->quit 			= 0;
+
+	if (!(pool->threads = calloc(pool->num_threads, sizeof(pthread_t))))
+		return 0;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	for (i=0; i<pool->num_threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, worker_main, pool)) {
+			pool->num_threads = i;
+			host_thread_pool_free(pool);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void host_thread_pool_run(HostThreadPool *pool, uint32_t num_tasks, HostTaskFunc func, void *arg)
+{
+	if (!num_tasks)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->func 			= func;
+	pool->arg 			= arg;
+	pool->num_tasks 	= num_tasks;
+	pool->tasks_done 	= 0;
+	pool->next_task 	= 0;
+	pthread_cond_broadcast(&pool->start);
+
+	while (pool->tasks_done < pool->num_tasks)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void host_thread_pool_free(HostThreadPool *pool)
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i=0; i<pool->num_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	pool->threads = NULL;
+}
@@ -0,0 +1,172 @@
+/*
+ * host_timekeeper.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Host replacement for timekeeper.c
+//
+// The hardware timers are simulated: each started timer has a rate and a next
+// deadline in simulated time. host_timekeeper_run_until() calls every callback
+// that is due, in deadline order, so the relative rates match the hardware.
+// Nothing preempts anything else on the host, so callbacks run to completion.
+
+#include "timekeeper.h"
+#include "host_timekeeper.h"
+#include "isr_trace.h"
+
+#define NUM_TIMERS 14
+typedef void (*voidfunc_type)(void);
+
+voidfunc_type tim_callbacks			[NUM_TIMERS+1];
+voidfunc_type cached_tim_callbacks	[NUM_TIMERS+1];
+
+static uint64_t	tim_period_ns		[NUM_TIMERS+1];
+static uint64_t	tim_deadline_ns		[NUM_TIMERS+1];
+static uint64_t	now_ns;
+
+static uint64_t	isr_clock_ns;
+static uint64_t	isr_clock_real_ns;
+
+// Rates as configured in timekeeper.c:init_timekeeper()
+static const uint32_t TIMER_RATE_HZ[NUM_TIMERS+1] = {
+	[MONO_LED_TIM_number]					= 3000,
+	[OSC_TIM_number]						= 1800,
+	[ANALOG_CONDITIONING_TIM_number]		= 3000,
+	[PWM_OUTS_TIM_number]					= 7200,
+	[LED_UPDATE_TIM_number]					= 60,
+	[UI_CONDITIONING_UPDATE_TIM_number]		= 1000,
+	[WT_INTERP_TIM_number]					= 1800,
+};
+
+uint32_t host_timer_rate_hz(uint8_t tim_number)
+{
+	if (tim_number > NUM_TIMERS) return 0;
+	return TIMER_RATE_HZ[tim_number];
+}
+
+void init_timekeeper(void)
+{
+	host_timekeeper_reset();
+}
+
+void host_timekeeper_reset(void)
+{
+	uint8_t i;
+
+	for (i=0; i<=NUM_TIMERS; i++)
+	{
+		tim_callbacks[i] = NULL;
+		cached_tim_callbacks[i] = NULL;
+		tim_period_ns[i] = 0;
+		tim_deadline_ns[i] = 0;
+	}
+	now_ns = 0;
+	isr_clock_ns = 0;
+}
+
+void start_timer_IRQ(uint8_t tim_number, void *callbackfunc)
+{
+	if (tim_number > NUM_TIMERS || !TIMER_RATE_HZ[tim_number]) return;
+
+	tim_period_ns[tim_number] = 1000000000ULL / TIMER_RATE_HZ[tim_number];
+	tim_deadline_ns[tim_number] = now_ns + tim_period_ns[tim_number];
+	tim_callbacks[tim_number] = callbackfunc;
+}
+
+void pause_timer_IRQ(uint8_t tim_number)
+{
+	cached_tim_callbacks[tim_number] = tim_callbacks[tim_number];
+	tim_callbacks[tim_number] = NULL;
+}
+
+void resume_timer_IRQ(uint8_t tim_number)
+{
+	if (cached_tim_callbacks[tim_number] != NULL)
+		tim_callbacks[tim_number] = cached_tim_callbacks[tim_number];
+}
+
+void host_timekeeper_run_until(uint64_t t_ns)
+{
+	uint8_t i, next;
+
+	while (1)
+	{
+		next = 0;
+		for (i=1; i<=NUM_TIMERS; i++)
+		{
+			if (!tim_period_ns[i]) continue;
+			if (!next || tim_deadline_ns[i] < tim_deadline_ns[next])
+				next = i;
+		}
+		if (!next || tim_deadline_ns[next] > t_ns)
+			break;
+
+		now_ns = tim_deadline_ns[next];
+		tim_deadline_ns[next] += tim_period_ns[next];
+
+		// A paused timer keeps counting, its interrupt is just ignored
+		ISR_TRACE_ENTER(next);
+		if (tim_callbacks[next] != NULL) tim_callbacks[next]();
+		ISR_TRACE_EXIT(next);
+	}
+
+	if (t_ns > now_ns) now_ns = t_ns;
+}
+
+// Moves the clock forward without running timers (used by HAL_Delay)
+void host_timekeeper_advance(uint64_t dt_ns)
+{
+	uint8_t i;
+
+	now_ns += dt_ns;
+	for (i=1; i<=NUM_TIMERS; i++)
+	{
+		while (tim_period_ns[i] && tim_deadline_ns[i] <= now_ns)
+			tim_deadline_ns[i] += tim_period_ns[i];
+	}
+}
+
+uint64_t host_time_ns(void)
+{
+	return now_ns;
+}
+
+// Clock for isr_trace.h. The handlers take no simulated time, so this models
+// a core that runs them one at a time: while a handler runs (busy), the clock
+// moves with the host's own time, and a handler that's due while the core is
+// still busy starts late. Otherwise it catches up with the simulated time.
+uint32_t host_isr_time_ns(uint8_t busy)
+{
+	uint64_t real_ns = host_monotonic_ns();
+
+	if (busy)
+		isr_clock_ns += real_ns - isr_clock_real_ns;
+	else if (isr_clock_ns < now_ns)
+		isr_clock_ns = now_ns;
+
+	isr_clock_real_ns = real_ns;
+	return (uint32_t)isr_clock_ns;
+}
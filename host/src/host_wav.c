@@ -0,0 +1,192 @@
+/*
+ * host_wav.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+// Minimal RIFF/WAVE PCM reader and writer for the host tools
+
+#include <string.h>
+
+#include "host_wav.h"
+
+static uint32_t rd_u32(const uint8_t *p) { return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32_t)p[3]<<24); }
+static uint16_t rd_u16(const uint8_t *p) { return p[0] | (p[1]<<8); }
+
+static void wr_u32(uint8_t *p, uint32_t v) { p[0]=v; p[1]=v>>8; p[2]=v>>16; p[3]=v>>24; }
+static void wr_u16(uint8_t *p, uint16_t v) { p[0]=v; p[1]=v>>8; }
+
+uint8_t host_wav_open_read(HostWav *w, const char *filename)
+{
+	uint8_t hdr[12], chunk[8], fmt[16];
+	uint32_t chunk_size;
+	uint8_t found_fmt = 0;
+
+	memset(w, 0, sizeof(HostWav));
+
+	w->f = fopen(filename, "rb");
+	if (!w->f) return 0;
+
+	if (fread(hdr, 1, 12, w->f) != 12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr+8, "WAVE", 4))
+		goto fail;
+
+	while (fread(chunk, 1, 8, w->f) == 8)
+	{
+		chunk_size = rd_u32(chunk+4);
+
+		if (!memcmp(chunk, "fmt ", 4))
+		{
+			if (chunk_size < 16 || fread(fmt, 1, 16, w->f) != 16) goto fail;
+			if (rd_u16(fmt) != 1 && rd_u16(fmt) != 0xFFFE) goto fail; //PCM or WAVE_FORMAT_EXTENSIBLE
+			w->num_channels 	= rd_u16(fmt+2);
+			w->samplerate 		= rd_u32(fmt+4);
+			w->bits_per_sample 	= rd_u16(fmt+14);
+			if (w->bits_per_sample != 16 && w->bits_per_sample != 24) goto fail;
+			if (!w->num_channels) goto fail;
+			fseek(w->f, chunk_size - 16 + (chunk_size & 1), SEEK_CUR);
+			found_fmt = 1;
+		}
+		else if (!memcmp(chunk, "data", 4))
+		{
+			if (!found_fmt) goto fail;
+			w->num_frames = chunk_size / (w->num_channels * (w->bits_per_sample/8));
+			w->cur_frame = 0;
+			return 1;
+		}
+		else
+			fseek(w->f, chunk_size + (chunk_size & 1), SEEK_CUR);
+	}
+
+fail:
+	fclose(w->f);
+	w->f = NULL;
+	return 0;
+}
+
+// Reads up to num_frames into dst (dst_chans interleaved). Extra file channels are dropped,
+// missing ones are copied from the last file channel. Returns number of frames read.
+uint32_t host_wav_read_s24(HostWav *w, int32_t *dst, uint16_t dst_chans, uint32_t num_frames)
+{
+	uint8_t buf[8*3];
+	uint32_t frame_bytes = w->num_channels * (w->bits_per_sample/8);
+	uint32_t i, c, src_c;
+	int32_t s;
+
+	if (!w->f || w->writing || frame_bytes > sizeof(buf)) return 0;
+
+	for (i=0; i<num_frames && w->cur_frame < w->num_frames; i++, w->cur_frame++)
+	{
+		if (fread(buf, 1, frame_bytes, w->f) != frame_bytes) break;
+
+		for (c=0; c<dst_chans; c++)
+		{
+			src_c = (c < w->num_channels) ? c : (w->num_channels-1);
+			if (w->bits_per_sample == 16)
+				s = ((int16_t)rd_u16(&buf[src_c*2])) * 256;
+			else
+				s = ((int32_t)((buf[src_c*3] << 8) | (buf[src_c*3+1] << 16) | ((uint32_t)buf[src_c*3+2] << 24))) >> 8;
+			*dst++ = s;
+		}
+	}
+	return i;
+}
+
+static void write_header(HostWav *w)
+{
+	uint8_t h[44];
+	uint32_t data_bytes = w->num_frames * w->num_channels * (w->bits_per_sample/8);
+
+	memcpy(h, "RIFF", 4);
+	wr_u32(h+4, 36 + data_bytes);
+	memcpy(h+8, "WAVEfmt ", 8);
+	wr_u32(h+16, 16);
+	wr_u16(h+20, 1);
+	wr_u16(h+22, w->num_channels);
+	wr_u32(h+24, w->samplerate);
+	wr_u32(h+28, w->samplerate * w->num_channels * (w->bits_per_sample/8));
+	wr_u16(h+32, w->num_channels * (w->bits_per_sample/8));
+	wr_u16(h+34, w->bits_per_sample);
+	memcpy(h+36, "data", 4);
+	wr_u32(h+40, data_bytes);
+
+	fseek(w->f, 0, SEEK_SET);
+	fwrite(h, 1, 44, w->f);
+	fseek(w->f, 0, SEEK_END);
+}
+
+uint8_t host_wav_open_write(HostWav *w, const char *filename, uint32_t samplerate, uint16_t num_channels, uint16_t bits_per_sample)
+{
+	memset(w, 0, sizeof(HostWav));
+
+	if (bits_per_sample != 16 && bits_per_sample != 24) return 0;
+
+	w->f = fopen(filename, "wb");
+	if (!w->f) return 0;
+
+	w->samplerate = samplerate;
+	w->num_channels = num_channels;
+	w->bits_per_sample = bits_per_sample;
+	w->writing = 1;
+	write_header(w);
+	return 1;
+}
+
+// Writes num_frames of interleaved signed 24-bit samples
+uint32_t host_wav_write_s24(HostWav *w, const int32_t *src, uint32_t num_frames)
+{
+	uint8_t b[3];
+	uint32_t i, c;
+	int32_t s;
+
+	if (!w->f || !w->writing) return 0;
+
+	for (i=0; i<num_frames; i++)
+	{
+		for (c=0; c<w->num_channels; c++)
+		{
+			s = *src++;
+			if (s > 0x7FFFFF) s = 0x7FFFFF;
+			else if (s < -0x800000) s = -0x800000;
+
+			if (w->bits_per_sample == 16) {
+				wr_u16(b, (uint16_t)(s >> 8));
+				fwrite(b, 1, 2, w->f);
+			} else {
+				b[0] = s; b[1] = s >> 8; b[2] = s >> 16;
+				fwrite(b, 1, 3, w->f);
+			}
+		}
+	}
+	w->num_frames += num_frames;
+	return num_frames;
+}
+
+void host_wav_close(HostWav *w)
+{
+	if (!w->f) return;
+	if (w->writing) write_header(w);
+	fclose(w->f);
+	w->f = NULL;
+}
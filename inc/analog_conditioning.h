@@ -89,6 +89,7 @@ typedef struct o_analog {
 } o_analog;
 
 uint8_t analog_jack_plugged(enum AnalogElements jacknum);
+uint8_t analog_latest_hires_val(uint8_t i, float *val);
 
 void setup_iir_filters(void);
 void setup_fir_filters(void);
@@ -0,0 +1,113 @@
+/*
+ * audio_profile.h
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+
+//
+// Per-stage timing of the audio callback.
+//
+// Compile with -DAUDIO_PROFILE (make AUDIO_PROFILE=1) to enable the probes in
+// process_audio_block_codec(). Otherwise the macros are empty.
+// On the target, the DWT cycle counter is used. The stats in audio_profile
+// can be read with a debugger while running.
+// The host build supplies its own cycle counter (see host/inc/stm32f7xx.h).
+//
+
+enum AudioProfileStages {
+	APS_HEAD_ADVANCE,
+	APS_INTERP,
+	APS_XFADE,
+	APS_PAN,
+	APS_COMPRESS,
+	APS_BLOCK,
+
+	NUM_AUDIO_PROFILE_STAGES
+};
+
+typedef struct o_audio_profile_stage {
+	uint32_t	block_cycles;		// accumulator for the current block
+	uint32_t	block_laps;
+	uint32_t	worst;				// per-block cycles
+	uint32_t	best;
+	uint64_t	total;
+	uint64_t	total_sq;
+	uint64_t	laps;
+} o_audio_profile_stage;
+
+typedef struct o_audio_profile {
+	o_audio_profile_stage	stage[NUM_AUDIO_PROFILE_STAGES];
+	uint32_t				num_blocks;
+	uint32_t				block_start;
+	float					lap_overhead;	// cycles added by each probe
+} o_audio_profile;
+
+typedef struct o_audio_profile_summary {
+	float		ns_per_sample;		// average, per output frame
+	float		worst_ns;			// per block
+	float		jitter_ns;			// standard deviation of the per-block time
+} o_audio_profile_summary;
+
+extern o_audio_profile audio_profile;
+
+#ifndef AUDIO_PROFILE_CYCLES
+	#define AUDIO_PROFILE_CYCLES()			(DWT->CYCCNT)
+	#define AUDIO_PROFILE_CYCLES_PER_US()	((float)SystemCoreClock / 1000000.f)
+#endif
+
+void audio_profile_init(void);
+void audio_profile_reset(void);
+void audio_profile_block_end(void);
+void audio_profile_get_summary(enum AudioProfileStages stage, uint32_t samples_per_block, o_audio_profile_summary *summary);
+const char *audio_profile_stage_name(enum AudioProfileStages stage);
+
+static inline uint32_t audio_profile_block_start(void)
+{
+	audio_profile.block_start = AUDIO_PROFILE_CYCLES();
+	return audio_profile.block_start;
+}
+
+// Adds the time since *t to the stage, and restarts *t
+static inline void audio_profile_lap(enum AudioProfileStages stage, uint32_t *t)
+{
+	uint32_t now = AUDIO_PROFILE_CYCLES();
+	audio_profile.stage[stage].block_cycles += now - *t;
+	audio_profile.stage[stage].block_laps++;
+	*t = now;
+}
+
+#ifdef AUDIO_PROFILE
+	#define AUDIO_PROFILE_BLOCK_START(t)	uint32_t t = audio_profile_block_start()
+	#define AUDIO_PROFILE_LAP(stage, t)		audio_profile_lap((stage), &(t))
+	#define AUDIO_PROFILE_BLOCK_END()		audio_profile_block_end()
+#else
+	#define AUDIO_PROFILE_BLOCK_START(t)
+	#define AUDIO_PROFILE_LAP(stage, t)
+	#define AUDIO_PROFILE_BLOCK_END()
+#endif
@@ -246,8 +246,15 @@ enum ADS863xErrors {
 	
 };
 
+// Counts the values resolved for an ADC channel, so a reader can tell when there's a new one
+typedef struct ads8634Sample {
+	volatile uint32_t	count;
+	volatile uint32_t	time;		// only set with PITCH_TRACE
+} ads8634Sample;
+
 //Public functions:
 //void ads8634_init_with_DMA(uint16_t *adc_buffer, uint8_t adc_buffer_size, uint16_t *tx_buffer, uint16_t tx_buffer_size, enum RangeSel *v_ranges, uint8_t chipnum);
 void ads8634_init_with_SPIIRQ(float *adc_buffer, uint8_t adc_buffer_chans, uint8_t chipnum, uint8_t *oversample_amts, enum RangeSel *v_ranges);
 void ads8634_set_vrange(uint8_t chipnum, enum RangeSel *v_ranges, uint8_t number_adcs);
+void ads8634_count_samples(uint8_t chipnum, ads8634Sample *samples);
 
@@ -50,6 +50,9 @@
 #define sFLASH_CMD_BE			0x60  // Bulk Erase instruction 
 #define sFLASH_CMD_BE_alt		0xC7  // Bulk Erase instruction 
 
+#define sFLASH_CMD_ERSP			0x75  // Erase Suspend
+#define sFLASH_CMD_ERRS			0x7A  // Erase Resume
+
 
 #define sFLASH_DUMMY_BYTE		0xA5
 
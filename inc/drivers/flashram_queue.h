@@ -0,0 +1,157 @@
+/*
+ * flashram_queue.h - Prioritized request queue for the external FLASH RAM
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * All reads, writes and erases of the external flash go through this queue
+ * (except at startup and in the hardware tests, before anything is queued).
+ *
+ * Requests are started highest priority first, then oldest first. A request never
+ * overtakes an earlier one that it conflicts with (a read and a write/erase of the same
+ * addresses, or two writes/erases), so writes and erases happen in the order they were queued.
+ *
+ * Queued reads of nearby addresses are read as one burst with a single read command.
+ * Writes are done one page at a time, and a sector erase is suspended whenever a
+ * FLASHQ_PRIO_AUDIO read is waiting, so audio reads are never stuck behind a preset save.
+ *
+ * flash_queue_service() runs the queue. It's called from the WT_INTERP timer, and by the
+ * blocking functions so they also work with the WT_INTERP timer paused. It masks the timer
+ * interrupts while it runs, so it can be called from the main loop or from a timer.
+ * Completion callbacks run from flash_queue_service(), and must not block.
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "drivers/flashram_spidma.h"
+
+#define FLASHQ_SIZE				24
+#define FLASHQ_NONE				0xFF
+
+#define FLASHQ_MAX_BURST		8		// requests per burst
+#define FLASHQ_MAX_GAP			32		// bytes skipped between requests in a burst (a waveform's name is 30)
+#define FLASHQ_ERASE_MIN_POLLS	4		// service calls an erase runs after resuming, before it can be suspended again
+
+enum FlashQueuePriorities {
+	FLASHQ_PRIO_AUDIO,			// waveforms the oscillators are waiting for
+	FLASHQ_PRIO_NORMAL,			// presets, sphere saving and loading
+	FLASHQ_PRIO_BACKGROUND,		// prefetching
+
+	NUM_FLASHQ_PRIOS
+};
+
+enum FlashQueueOps {
+	FLASHQ_READ,
+	FLASHQ_WRITE,
+	FLASHQ_ERASE_SECTOR
+};
+
+enum FlashQueueReqStates {
+	FLASHQ_FREE,
+	FLASHQ_QUEUED,
+	FLASHQ_ACTIVE,
+};
+
+typedef void (*FlashQueueCallback)(uint32_t ctx);
+
+typedef struct o_flashq_req{
+	enum FlashQueueOps 			op;
+	enum FlashQueuePriorities 	prio;
+	volatile enum FlashQueueReqStates state;
+	uint8_t 					*buf;
+	const sFlashSegment 		*segs;			// scattered reads: buffers for consecutive pieces (buf is unused)
+	uint8_t 					num_segs;
+	uint32_t 					addr;
+	uint32_t 					num_bytes;
+	uint32_t 					done_bytes;		// writes: bytes already programmed
+	uint32_t 					seq;
+	FlashQueueCallback 			callback;
+	uint32_t 					ctx;
+} o_flashq_req;
+
+typedef struct o_flashq_stats{
+	uint32_t 	reads;
+	uint32_t 	bursts;
+	uint32_t 	writes;
+	uint32_t 	erases;
+	uint32_t 	erase_suspends;
+} o_flashq_stats;
+
+enum FlashQueueEngineStates {
+	FLASHQ_IDLE,
+	FLASHQ_READING,
+	FLASHQ_WRITING,
+	FLASHQ_ERASING,
+	FLASHQ_ERASE_SUSPENDING,
+	FLASHQ_ERASE_SUSPENDED
+};
+
+typedef struct o_flash_queue{
+	o_flashq_req 		req 		[FLASHQ_SIZE];
+	uint32_t 			next_seq;
+
+	enum FlashQueueEngineStates engine;
+	uint8_t 			modifying;					// write or erase in progress, or FLASHQ_NONE
+	uint16_t 			page_bytes;					// size of the page being written
+	uint8_t 			erase_polls;
+
+	uint8_t 			burst 		[FLASHQ_MAX_BURST];
+	uint8_t 			burst_len;
+	sFlashSegment 		segs 		[FLASHQ_MAX_BURST * 2];
+	uint8_t 			gap 		[FLASHQ_MAX_GAP];
+
+	o_flashq_stats 		stats;
+} o_flash_queue;
+
+void 		init_flash_queue(void);
+
+// Queue a request. Returns the request number, or FLASHQ_NONE if the queue is full.
+// buf must stay valid (not on the stack) until the request is done.
+// callback can be NULL
+uint8_t 	flash_queue_read(uint8_t *buf, uint32_t addr, uint32_t num_bytes, enum FlashQueuePriorities prio, FlashQueueCallback callback, uint32_t ctx);
+uint8_t 	flash_queue_write(uint8_t *buf, uint32_t addr, uint32_t num_bytes, enum FlashQueuePriorities prio, FlashQueueCallback callback, uint32_t ctx);
+uint8_t 	flash_queue_erase_sector(uint32_t addr, enum FlashQueuePriorities prio, FlashQueueCallback callback, uint32_t ctx);
+
+// Reads consecutive addresses into the list of buffers in *segs, with one read command.
+// *segs and the buffers must stay valid until the request is done
+uint8_t 	flash_queue_read_segments(const sFlashSegment *segs, uint8_t num_segs, uint32_t addr, enum FlashQueuePriorities prio, FlashQueueCallback callback, uint32_t ctx);
+
+// Moves a queued request up (e.g. a prefetch that's now needed)
+void 		flash_queue_raise_prio(uint8_t req, enum FlashQueuePriorities prio);
+
+uint8_t 	flash_queue_num_pending(enum FlashQueuePriorities prio);
+uint8_t 	flash_queue_num_free(void);
+uint8_t 	flash_queue_is_idle(void);
+
+void 		flash_queue_service(void);
+
+// Blocking versions, for code that needs the result before continuing.
+// These call flash_queue_service() until the request is done
+void 		flash_queue_wait(uint8_t req);
+void 		flash_queue_wait_all(void);
+void 		flash_queue_read_wait(uint8_t *buf, uint32_t addr, uint32_t num_bytes);
+void 		flash_queue_read_segments_wait(const sFlashSegment *segs, uint8_t num_segs, uint32_t addr);
+void 		flash_queue_write_wait(uint8_t *buf, uint32_t addr, uint32_t num_bytes);
+void 		flash_queue_erase_sector_wait(uint32_t addr);
@@ -85,6 +85,12 @@ enum sFlashStates {
 	sFLASH_ERROR 
 };
 
+// One piece of a read that continues from where the previous piece left off
+typedef struct sFlashSegment{
+	uint8_t 		*buf;
+	uint16_t		num_bytes;
+} sFlashSegment;
+
 //Initialize
 void sFLASH_init(void);
 
@@ -96,11 +102,15 @@ enum sFlashStates get_flash_state(void);
 void sFLASH_erase_sector(uint32_t SectorAddr);
 void sFLASH_erase_sector_background(uint32_t SectorAddr);
 void sFLASH_erase_chip(void);
+void sFLASH_erase_suspend(void);
+void sFLASH_erase_resume(void);
 
 //Reading and writing
 void sFLASH_write_buffer(uint8_t* txBuffer, uint32_t write_addr, uint16_t num_bytes);
 void sFLASH_read_buffer(uint8_t* rxBuffer, uint32_t read_addr, uint16_t num_bytes);
 void sFLASH_read_buffer_DMA(uint8_t* rxBuffer, uint32_t read_addr, uint16_t num_bytes);
+void sFLASH_read_segments_DMA(const sFlashSegment *segs, uint8_t num_segs, uint32_t read_addr);
+void sFLASH_write_page_DMA(uint8_t* txBuffer, uint32_t write_addr, uint16_t num_bytes);
 
 
 //Testing routines
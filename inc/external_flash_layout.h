@@ -3,10 +3,12 @@
 #include <stm32f7xx.h>
 #include "flash_S25FL127.h"
 
+#define 	FLASH_DIRECTORY_SECTOR 	13
 #define 	STARTUP_PRESET_SETTING_SECTOR 14
 #define 	WT_SECTOR_START 		16
 #define		PRESET_SECTOR_START		217
-#define		PRESETS_PER_SECTOR		2
+#define		PRESETS_PER_SECTOR		2				/* in the layout before the preset log */
+#define		PRESET_NUM_SECTORS		(sFLASH_SPI_NUM_SECTORS - PRESET_SECTOR_START)								/* 54 */
 
 #define		MAX_WT_IN_FLASH  		(PRESET_SECTOR_START - WT_SECTOR_START - 1)									/* 200 */
 #define		MAX_PRESETS  			((sFLASH_SPI_NUM_SECTORS - PRESET_SECTOR_START) * PRESETS_PER_SECTOR)		/* 108 */
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include "sphere_flash_io.h"
+
+// A copy of every sphere's type and where every sphere and preset is in its log, kept in its
+// own sector, so they're known at boot with one read instead of reading each sphere and preset.
+// If flash was changed since the directory was written, they're scanned instead.
+// Each sphere's and preset's crc is in its log record's header, and is checked after boot by
+// update_sphere_log() and update_preset_log().
+
+void init_flash_directory(void);
+
+// Whether the spheres or presets are in the directory (read at boot, or scanned since)
+uint8_t flash_directory_has_spheres(void);
+uint8_t flash_directory_has_presets(void);
+
+enum SphereTypes flash_directory_spheretype(uint8_t wt_num, uint16_t *pack_bytes);
+char flash_directory_preset(uint32_t preset_num, uint32_t *addr);
+uint32_t flash_directory_sphere_addr(uint8_t wt_num);
+uint8_t flash_directory_sphere_log_sector(uint8_t sector);
+uint32_t flash_directory_sphere_log_seq(void);
+uint8_t flash_directory_preset_log_sector(uint8_t sector);
+uint32_t flash_directory_preset_log_seq(void);
+
+// After a scan sets every sphere or preset
+void flash_directory_spheres_scanned(void);
+void flash_directory_presets_scanned(void);
+
+// Call before changing a sphere or preset in flash, from the main loop
+void flash_directory_changing(void);
+
+// Call after it's changed, or when scanning (these can be called from flash queue callbacks)
+void flash_directory_set_sphere(uint8_t wt_num, enum SphereTypes type, uint16_t pack_bytes);
+void flash_directory_set_sphere_addr(uint8_t wt_num, uint32_t addr);
+void flash_directory_set_sphere_log_sector(uint8_t sector, uint8_t state);
+void flash_directory_set_sphere_log_seq(uint32_t seq);
+void flash_directory_set_preset(uint32_t preset_num, char version, uint32_t addr);
+void flash_directory_set_preset_log_sector(uint8_t sector, uint8_t state);
+void flash_directory_set_preset_log_seq(uint32_t seq);
+
+// Call from the main loop: writes the directory if it changed and the flash is idle
+void update_flash_directory(void);
@@ -1,8 +1,11 @@
 extern "C" {
 #include "drivers/flash_S25FL127.h"
 #include "drivers/flashram_spidma.h"
+#include "drivers/flashram_queue.h"
 }
 
+// Reads, writes and erases go through the flash queue, and wait until they're done
+
 template<int sector, class Data>
 struct FlashStorage {
 	using data_t = Data;
@@ -14,25 +17,28 @@ struct FlashStorage {
 	static_assert(aligned_data_size_ < size_);
 	static constexpr int cell_nr_ = size_ / aligned_data_size_;
 
+	static uint32_t CellAddr(int cell)
+	{
+		return sFLASH_get_sector_addr(sector) + cell * aligned_data_size_;
+	}
+
 	bool Read(data_t *data, int cell)
 	{
 		if (cell >= cell_nr_) return false;
-		uint32_t addr = sFLASH_get_sector_addr(sector) + cell * aligned_data_size_;
-		sFLASH_read_buffer(reinterpret_cast<uint8_t *>(data), addr, data_size_);
+		flash_queue_read_wait(reinterpret_cast<uint8_t *>(data), CellAddr(cell), data_size_);
 		return true;
 	}
 
 	bool Write(data_t *data, int cell)
 	{
 		if (cell >= cell_nr_) return false;
-		uint32_t addr = sFLASH_get_sector_addr(sector) + cell * aligned_data_size_;
-		sFLASH_write_buffer(reinterpret_cast<uint8_t *>(data), addr, data_size_);
+		flash_queue_write_wait(reinterpret_cast<uint8_t *>(data), CellAddr(cell), data_size_);
 		return true;
 	}
 
 	void Erase()
 	{
-		sFLASH_erase_sector(sFLASH_get_sector_addr(sector));
+		flash_queue_erase_sector_wait(sFLASH_get_sector_addr(sector));
 	}
 	// Verify all bits are 1's
 	bool IsWriteable(int cell)
@@ -0,0 +1,117 @@
+/*
+ * isr_trace.h - Entry and exit times of the interrupt handlers
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+
+//
+// Records a timestamp when each traced interrupt handler starts and ends,
+// in a ring buffer that always holds the latest ISR_TRACE_LEN events.
+//
+// Compile with -DISR_TRACE (make ISR_TRACE=1) to enable. Otherwise the macros are empty.
+// Stop the target and dump the buffer with gdb:
+//		dump binary value isr_trace.bin isr_trace
+// then run host/build/swn_isr_report isr_trace.bin for the load, latency and
+// preemptions of each handler (see README.md).
+// isr_trace_start(1) fills the buffer once and stops, to catch what follows an event.
+// isr_trace.mask selects which handlers are recorded (bit n = id n).
+//
+// On the target, the DWT cycle counter is used. The host build uses a clock that
+// runs the handlers one after the other on its timers' simulated time (see host_timekeeper.c), in ns.
+//
+// The ADS8634 SPI IRQs are not traced: they run once per ADC word (240ns each),
+// and would fill the buffer in a few ms.
+//
+
+#ifndef ISR_TRACE_LEN
+	#define ISR_TRACE_LEN	512					// must be a power of 2. 8 bytes per event, in SRAM1
+#endif
+
+#define ISR_TRACE_MAGIC		0x31525349			// "ISR1"
+
+// 1 to 14 are the timer IRQs, by timer number (see timekeeper.h)
+enum IsrTraceIds {
+	ISR_TRACE_SAI_RX_DMA = 15,
+	ISR_TRACE_FLASH_SPI_DMA_RX,
+	ISR_TRACE_FLASH_SPI_DMA_TX,
+	ISR_TRACE_FLASH_SPI,
+	ISR_TRACE_LED_I2C_DMA_TX,
+	ISR_TRACE_LED_I2C_EV,
+	ISR_TRACE_LED_I2C_ER,
+	ISR_TRACE_MIDI_UART,
+
+	NUM_ISR_TRACE_IDS
+};
+
+typedef struct o_isr_trace_event {
+	uint32_t	time;
+	uint8_t		id;
+	uint8_t		exit;				// 0: handler started, 1: handler ended
+	uint16_t	depth;				// number of traced handlers it preempted
+} o_isr_trace_event;
+
+// Fixed size, so swn_isr_report can read a dump from a build with any ISR_TRACE_LEN
+typedef struct o_isr_trace_header {
+	uint32_t	magic;
+	uint32_t	len;				// ISR_TRACE_LEN
+	uint32_t	ticks_per_us;
+	uint32_t	head;				// events written since isr_trace_start(). The next one goes in event[head % len]
+	uint32_t	mask;
+	uint8_t		running;
+	uint8_t		oneshot;
+	uint8_t		depth;
+	uint8_t		unused;
+} o_isr_trace_header;
+
+typedef struct o_isr_trace {
+	o_isr_trace_header	hdr;
+	o_isr_trace_event	event[ISR_TRACE_LEN];
+} o_isr_trace;
+
+extern o_isr_trace isr_trace;
+
+#ifndef ISR_TRACE_TIME
+	#define ISR_TRACE_TIME(busy)			(DWT->CYCCNT)
+	#define ISR_TRACE_TICKS_PER_US()		(SystemCoreClock / 1000000)
+#endif
+
+void isr_trace_init(void);
+void isr_trace_start(uint8_t oneshot);
+void isr_trace_stop(void);
+void isr_trace_event(uint8_t id, uint8_t exit);
+const char *isr_trace_name(uint8_t id);
+uint8_t isr_trace_is_periodic(uint8_t id);
+
+#ifdef ISR_TRACE
+	#define ISR_TRACE_ENTER(id)			isr_trace_event((id), 0)
+	#define ISR_TRACE_EXIT(id)			isr_trace_event((id), 1)
+#else
+	#define ISR_TRACE_ENTER(id)
+	#define ISR_TRACE_EXIT(id)
+#endif
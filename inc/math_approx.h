@@ -0,0 +1,119 @@
+/*
+ * math_approx.h - Polynomial approximations of exp2 and log2
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * exp2 is split into 2^n * 2^f, with f in [-0.5, 0.5): 2^f is a minimax polynomial
+ * (relative error), and 2^n is added to the float's exponent. Two tiers:
+ *
+ *   exp2_pitch()	degree 5, within 7.5e-8 (0.0001 cents; rounding x to a float adds more)
+ *   exp2_led()		degree 2, within 0.17% (3 cents), for brightness curves
+ *
+ * exp_1voct_pitch() and exp_1voct_led() are the curve of the exp_1voct_10_41V[] table
+ * they replace (0V to 10.41V on a 12-bit ADC), for any ADC value, not just the integers.
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+
+#define EXP_1VOCT_OCT_PER_STEP		0.0025438819638759f		// octaves per ADC step: 10.41V / 4095 steps
+#define EXP_1VOCT_MAX_STEP			4095.f
+
+typedef union { float f; uint32_t u; } float_bits;
+
+// Splits x into n + f, n an integer and f in [-0.5, 0.5)
+static inline float exp2_split(float x, int32_t *n)
+{
+	float xr;
+
+	if (x > 127.f) x = 127.f;
+	if (x < -126.f) x = -126.f;
+
+	xr = x + 0.5f;
+	*n = (int32_t)xr;
+	if (xr < (float)*n) (*n)--;
+
+	return x - (float)*n;
+}
+
+static inline float exp2_scale(float p, int32_t n)
+{
+	float_bits v = { .f = p };
+	v.u += (uint32_t)n << 23;
+	return v.f;
+}
+
+static inline float exp2_pitch(float x)
+{
+	int32_t n;
+	float f = exp2_split(x, &n);
+	float p = 1.000000072f + f * (0.6931469671f + f * (0.2402211972f + f * (0.05550713273f + f * (0.009675541331f + f * 0.001327647217f))));
+	return exp2_scale(p, n);
+}
+
+static inline float exp2_led(float x)
+{
+	int32_t n;
+	float f = exp2_split(x, &n);
+	float p = 1.000443142f + f * (0.703448006f + f * 0.2384289355f);
+	return exp2_scale(p, n);
+}
+
+// log2(x), within 2e-6 octaves, for x > 0
+static inline float log2_approx(float x)
+{
+	float_bits v = { .f = x };
+	int32_t e = (int32_t)((v.u >> 23) & 0xFF) - 127;
+	float s, s2;
+
+	// mantissa in [sqrt(0.5), sqrt(2))
+	v.u = (v.u & 0x007FFFFF) | 0x3F800000;
+	if (v.f > 1.41421356f) { v.f *= 0.5f; e++; }
+
+	// 2/ln(2) * atanh(s), s = (m-1)/(m+1)
+	s = (v.f - 1.f) / (v.f + 1.f);
+	s2 = s * s;
+	return (float)e + s * (2.88539008f + s2 * (0.96179669f + s2 * 0.57707802f));
+}
+
+// Frequency multiplier for an ADC value on a 1V/oct jack (0 = 1.0, 4095 = 10.41 octaves up).
+// Like the table, the first step goes straight from 1.0 to 2^(2 steps),
+// so 0V is exactly 1.0 and every other value matches the table's curve
+static inline float exp_1voct_pitch(float adc_val)
+{
+	if (adc_val <= 0.f)
+		return 1.f;
+	if (adc_val < 1.f)
+		return 1.f + adc_val * (exp2_pitch(2.f * EXP_1VOCT_OCT_PER_STEP) - 1.f);
+	if (adc_val > EXP_1VOCT_MAX_STEP)
+		adc_val = EXP_1VOCT_MAX_STEP;
+	return exp2_pitch((adc_val + 1.f) * EXP_1VOCT_OCT_PER_STEP);
+}
+
+static inline float exp_1voct_led(float adc_val)
+{
+	return exp2_led((adc_val + 1.f) * EXP_1VOCT_OCT_PER_STEP);
+}
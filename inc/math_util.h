@@ -80,6 +80,8 @@ float _N_OVER_12TH_ROOT_TWO(float n);
 
 float _AVERAGE_EXCL_MINMAX_F(float *lpf_values, uint32_t num_elements);
 
+uint32_t _CRC32(uint32_t crc, const uint8_t *data, uint32_t len);
+
 static inline float _CROSSFADE(float a, float b, float xfade)
 {
 	return (a*(1.0-xfade)) + (b*xfade);
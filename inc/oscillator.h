@@ -63,13 +63,21 @@ typedef struct o_wt_osc{
 	// WT READING HEAD
 	float 						wt_head_pos 			[NUM_CHANNELS]		;
 	float						wt_head_pos_inc			[NUM_CHANNELS]		;
-	uint16_t 					rh0						[NUM_CHANNELS]		;
-	uint16_t 					rh1						[NUM_CHANNELS]		;
-	float 						rhd						[NUM_CHANNELS]		; 
-	float 						rhd_inv					[NUM_CHANNELS]		;
 	
 } o_wt_osc;
 
 
+// Partial blends kept between calls to interp_wt(), so only the stages whose m_frac moved are recomputed.
+// They're blends of the int16 corner waveforms, so they're stored rounded to int16 (within 0.5 LSB)
+typedef struct o_wt_interp_cache{
+
+	int16_t 					edge 					[NUM_CHANNELS][4][WT_TABLELEN];	// corners blended along x (m_frac[0])
+	int16_t 					face 					[NUM_CHANNELS][2][WT_TABLELEN];	// edges blended along y (m_frac[1])
+	float 						frac 					[2][NUM_CHANNELS]	;			// m_frac[0] and [1] that edge and face were made with
+	uint8_t 					valid 					[NUM_CHANNELS]		;			// cleared when the corner waveforms change
+
+} o_wt_interp_cache;
+
+
 void	init_wt_osc(void);
 void 	process_audio_block_codec(int32_t *src, int32_t *dst);
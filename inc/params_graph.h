@@ -0,0 +1,123 @@
+/*
+ * params_graph.h - Change-driven updates of the oscillator parameters
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "globals.h"
+#include "hardware_controls.h"
+
+//
+// update_oscillators() runs the nodes below in order on every OSC timer tick, but each node
+// only runs if it's dirty. A node is flagged dirty when:
+//   - its inputs changed since it last ran (buttons, rotary and switch presses, jacks, CV, params),
+//   - a node it depends on ran (see PARAM_NODE_DEPENDENTS in params_graph.c),
+//   - or something outside the graph called flag_param_update() or flag_all_param_updates().
+// Some nodes have to poll while they're active (held buttons, Keys mode, the quantizer's
+// note-change lockout, update_wt()'s round robin), and outside of PLAY mode every node
+// runs on every tick, like before.
+//
+// param_graph.node[] counts how many times each node ran or was skipped (per channel,
+// for the per-channel nodes), and can be read with a debugger.
+//
+
+enum ParamNodes {
+	PN_NAV_RESET,		// check_reset_navigation()
+	PN_WT,				// update_wt()
+	PN_KEYMODES,		// read_all_keymodes()
+	PN_TRANSPOSE,		// combine_transpose_spread(), compute_transpositions()
+	PN_TRANSPOSE_CV,	// update_transpose_cv()
+	PN_EXT_TRIGS,		// read_ext_trigs()
+
+	//Per channel:
+	PN_NOTEON,			// read_noteon()
+	PN_LFO_BUTTONS,		// read_lfomode(), read_lfoto_vca_vco()
+	PN_PITCH,			// update_pitch()
+	PN_NOISE,			// update_noise()
+
+	NUM_PARAM_NODES
+};
+#define PN_FIRST_CHANNEL_NODE	PN_NOTEON
+
+typedef struct o_param_node_stats {
+	uint32_t	runs;
+	uint32_t	skips;
+} o_param_node_stats;
+
+// Everything the button and key mode nodes read
+typedef struct o_param_control_inputs {
+	uint32_t	plugged;						// one bit per analog jack
+	uint8_t		button[NUM_BUTTONS];
+	uint8_t		rotary[NUM_ROTARIES];
+	uint8_t		hw_switch[NUM_SWITCHES];
+	uint8_t		key_sw[NUM_CHANNELS];
+	uint8_t		lfo_audio_mode[NUM_CHANNELS];
+	uint8_t		ui_mode;
+} o_param_control_inputs;
+
+typedef struct o_param_transpose_inputs {
+	int32_t		transpose_enc[NUM_CHANNELS];
+	int32_t		spread_enc[NUM_CHANNELS];
+	uint8_t		osc_param_lock[NUM_CHANNELS];
+	uint8_t		spread_cv;
+} o_param_transpose_inputs;
+
+// What update_pitch() reads, other than the nodes it depends on
+typedef struct o_param_pitch_inputs {
+	float		cv;								// pitch_cv_input()
+	float		tuning;
+	int8_t		oct;
+	uint8_t		indiv_scale;
+	uint8_t		key_sw;
+	uint8_t		flags;							// note_on, new_key, voct switch, lock, jack polarity, jack plugged
+} o_param_pitch_inputs;
+
+typedef struct o_param_graph {
+	uint8_t						dirty[NUM_PARAM_NODES];		// channel mask (bit 0 for nodes that aren't per channel)
+	o_param_node_stats			node[NUM_PARAM_NODES];
+	uint32_t					ticks;
+
+	o_param_control_inputs		controls;
+	uint8_t						trig_levels;
+	o_param_transpose_inputs	transpose;
+	float						transpose_cv;
+	uint8_t						transpose_cv_polarity;
+	o_param_pitch_inputs		pitch[NUM_CHANNELS];
+
+	uint8_t						enabled;					// 0: run every node on every tick
+} o_param_graph;
+
+extern o_param_graph param_graph;
+
+void 		init_param_graph(void);
+void 		update_param_graph(void);
+void 		set_param_graph(uint8_t enabled);
+void 		flag_param_update(enum ParamNodes node, uint8_t chan_mask);
+void 		flag_all_param_updates(void);
+void 		reset_param_graph_stats(void);
+const char *param_node_name(enum ParamNodes node);
@@ -231,6 +231,7 @@ void 		check_reset_navigation(void);
 void 		cache_uncache_pitch_params(enum CacheUncache cache_uncache);
 
 void 		read_noteon(uint8_t i);
+uint8_t 	read_ext_trig_levels(void);
 void 		read_ext_trigs(void);
 void 		read_level_and_pan(uint8_t chan);
 float		default_pan(uint8_t chan);
@@ -249,6 +250,9 @@ void 		cache_uncache_keys_params_and_lfos(uint8_t chan, enum CacheUncache cache_
 
 void 		update_lfomode(uint8_t i);
 void 		update_pitch(uint8_t chan);
+void 		update_pitch_fast(uint8_t chan);
+float 		pitch_cv_input(uint8_t chan);
+void 		set_voct_fast_path(uint8_t enabled);
 void 		update_wt_head_pos_inc(uint8_t chan);
 void 		update_noise(uint8_t chan);
 
@@ -321,6 +325,7 @@ void 		cache_uncache_nav_params(enum CacheUncache cache_uncache);
 
 void 		update_wt_nav(uint8_t wt_dim, float wt_pos_increment);
 void 		update_wt_nav_cv(uint8_t wt_dim);
+float 		get_wt_browse_pos(uint8_t chan);
 void 		calc_wt_pos(uint8_t chan);
 void 		set_wtpos_to_int(uint8_t chan);
 
@@ -30,6 +30,13 @@ public:
     }
     return Storage::Write(data, cell_++);
   }
+
+  // Address of the cell last read or written
+  bool CurrentAddr(uint32_t *addr) {
+    if (!cell_) return false;
+    *addr = Storage::CellAddr(cell_ - 1);
+    return true;
+  }
 };
 
 template <class Storage>
@@ -0,0 +1,116 @@
+/*
+ * pitch_trace.h - Latency of 1V/oct CV, from the ADC to the audio callback
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "globals.h"
+#include "drivers/ads8634_driver.h"
+
+//
+// Timestamps a 1V/oct sample at each stage it passes through:
+// the ADC IRQ, process_analog_conditioning(), update_pitch() (or the fast path
+// in the audio callback), and the first audio block that uses the new pitch.
+//
+// Compile with -DPITCH_TRACE (make PITCH_TRACE=1) to enable. Otherwise the macros are empty.
+// The stats in pitch_trace can be read with a debugger while running.
+// On the target, the DWT cycle counter is used. The host build uses the
+// simulated time of its timers (see host/inc/stm32f7xx.h), in ns.
+//
+
+enum PitchTraceStages {
+	PTS_ADC_TO_COND,		// ADC IRQ -> analog conditioning
+	PTS_COND_TO_PITCH,		// analog conditioning -> update_pitch()
+	PTS_PITCH_TO_AUDIO,		// new wt_head_pos_inc -> audio block
+	PTS_TOTAL,				// ADC IRQ -> audio block
+
+	NUM_PITCH_TRACE_STAGES
+};
+
+typedef struct o_pitch_trace_stage {
+	uint32_t	worst;
+	uint32_t	best;
+	uint64_t	total;
+	uint64_t	total_sq;
+	uint32_t	num;
+} o_pitch_trace_stage;
+
+// Where each channel's latest sample has got to
+typedef struct o_pitch_trace_chan {
+	uint32_t	cond_count;			// sample count seen by the last conditioning
+	uint32_t	cond_src;			// ...when that sample was read
+	uint32_t	cond_time;			// ...when it was conditioned
+	uint32_t	pitch_count;		// sample count that last updated wt_head_pos_inc
+	uint32_t	pitch_src;
+	uint32_t	pitch_time;
+	uint8_t		pending;			// wt_head_pos_inc changed, and no audio block has used it yet
+} o_pitch_trace_chan;
+
+typedef struct o_pitch_trace {
+	o_pitch_trace_stage	stage[NUM_PITCH_TRACE_STAGES];
+	o_pitch_trace_chan	chan[NUM_CHANNELS];
+	uint32_t			fast_updates;	// pitch updates made by the fast path
+} o_pitch_trace;
+
+typedef struct o_pitch_trace_summary {
+	float		mean_us;
+	float		best_us;
+	float		worst_us;
+	float		jitter_us;			// standard deviation
+	uint32_t	num;
+} o_pitch_trace_summary;
+
+extern o_pitch_trace pitch_trace;
+
+#ifndef PITCH_TRACE_TIME
+	#define PITCH_TRACE_TIME()				(DWT->CYCCNT)
+	#define PITCH_TRACE_TICKS_PER_US()		((float)SystemCoreClock / 1000000.f)
+#endif
+
+void pitch_trace_init(void);
+void pitch_trace_reset(void);
+void pitch_trace_conditioned(uint8_t chan, ads8634Sample *s);
+void pitch_trace_pitch_updated(uint8_t chan);
+void pitch_trace_fast_updated(uint8_t chan, ads8634Sample *s);
+void pitch_trace_audio_block(void);
+void pitch_trace_get_summary(enum PitchTraceStages stage, o_pitch_trace_summary *summary);
+const char *pitch_trace_stage_name(enum PitchTraceStages stage);
+
+#ifdef PITCH_TRACE
+	#define PITCH_TRACE_ADC_SAMPLE(s)			do { (s)->time = PITCH_TRACE_TIME(); } while (0)
+	#define PITCH_TRACE_CONDITIONED(chan, s)	pitch_trace_conditioned((chan), (s))
+	#define PITCH_TRACE_PITCH_UPDATED(chan)		pitch_trace_pitch_updated(chan)
+	#define PITCH_TRACE_FAST_UPDATED(chan, s)	pitch_trace_fast_updated((chan), (s))
+	#define PITCH_TRACE_AUDIO_BLOCK()			pitch_trace_audio_block()
+#else
+	#define PITCH_TRACE_ADC_SAMPLE(s)
+	#define PITCH_TRACE_CONDITIONED(chan, s)
+	#define PITCH_TRACE_PITCH_UPDATED(chan)
+	#define PITCH_TRACE_FAST_UPDATED(chan, s)
+	#define PITCH_TRACE_AUDIO_BLOCK()
+#endif
@@ -0,0 +1,108 @@
+/*
+ * preset_log.h - Presets saved as an append-only log in the preset sectors
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Saving a preset writes it into the next free slot, and zeroes the signature of the copy
+ * it replaces, so nothing is erased when saving. Each slot is a header (with a sequence
+ * number, in case the power went off before the old copy was zeroed) and the preset.
+ * The preset's signature is written last, so a preset that wasn't finished isn't found.
+ *
+ * The header also has a crc of the preset. After boot, update_preset_log() checks each preset
+ * against it in the background, and zeroes the signature of one that doesn't match, so it's
+ * never loaded. A preset that's moved is checked before it's rewritten.
+ *
+ * update_preset_log() erases sectors that have no presets left, in the background.
+ * When free slots run low, it first moves the presets out of the emptiest sector.
+ *
+ * Sectors in the layout from before the log (two presets at the start and the middle)
+ * are used as they are: their presets stay where they are until they're saved again,
+ * and slots in the space around them are used for new presets.
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "external_flash_layout.h"
+#include "params_update.h"
+#include "params_lfo.h"
+
+#define PRESET_LOG_HEADER_SIZE		12
+#define PRESET_LOG_RECORD_SIZE		(PRESET_LOG_HEADER_SIZE + 4 + sizeof(o_params) + sizeof(o_lfos))
+#define PRESET_LOG_SLOT_SIZE		(((PRESET_LOG_RECORD_SIZE + sFLASH_SPI_PAGESIZE - 1) >> sFLASH_PAGESIZE_BITS) << sFLASH_PAGESIZE_BITS)
+#define PRESET_LOG_SECTOR_SIZE		0x10000
+#define PRESET_LOG_SLOTS_PER_SECTOR	(PRESET_LOG_SECTOR_SIZE / PRESET_LOG_SLOT_SIZE)
+
+#define PRESET_LOG_LEGACY			0x80		// sector state: in the old layout (low bits: slots used)
+#define PRESET_LOG_RESERVE_SLOTS	2			// only used for moving presets (a sector has 2 presets on average)
+#define PRESET_LOG_COMPACT_SLOTS	(PRESET_LOG_SLOTS_PER_SECTOR * 2)
+#define PRESET_LOG_NONE				0xFF
+
+typedef struct o_preset_log_header {
+	char 		sig[2];					// 'P', 'L'
+	uint8_t 	preset_num;
+	uint8_t 	reserved;
+	uint32_t 	seq;
+	uint32_t 	crc;					// of the preset after its signature
+} o_preset_log_header;
+
+enum PresetLogGCStates {
+	PLOG_GC_IDLE,
+	PLOG_GC_READING,
+	PLOG_GC_READ_DONE,
+	PLOG_GC_VERIFYING,
+	PLOG_GC_VERIFY_DONE,
+};
+
+typedef struct o_preset_log {
+	uint32_t 	addr 		[MAX_PRESETS];				// preset's signature, or 0 if it's empty
+	char 		version 	[MAX_PRESETS];
+	uint8_t 	sector 		[PRESET_NUM_SECTORS];		// slots used, and PRESET_LOG_LEGACY
+	uint8_t 	live 		[PRESET_NUM_SECTORS];		// presets in the sector
+	uint16_t 	free_slots;
+	uint8_t 	head;
+	uint32_t 	next_seq;
+
+	volatile uint8_t 	erasing;
+	volatile enum PresetLogGCStates gc_state;
+	uint8_t 	gc_preset;
+	uint32_t 	gc_from;
+	uint8_t 	verify_next;			// next preset to check the crc of
+} o_preset_log;
+
+void 		init_preset_log(void);
+
+uint32_t 	preset_log_addr(uint32_t preset_num);
+char 		preset_log_version(uint32_t preset_num);
+
+// Queues saving a preset. rec is PRESET_LOG_HEADER_SIZE bytes of space followed by the preset
+// (signature, params, lfos), and must stay valid until it's written. Returns the preset's address
+uint32_t 	preset_log_store(uint32_t preset_num, uint8_t *rec);
+
+// Queues zeroing the preset's signature. Returns the request, or FLASHQ_NONE if it was empty
+uint8_t 	preset_log_clear(uint32_t preset_num);
+
+// Call from the main loop
+void 		update_preset_log(void);
@@ -87,6 +87,10 @@ void update_preset_version(char version, o_params *t_params, o_lfos *t_lfos);
 
 void recalc_active_params(void);
 
+uint8_t is_preset_signature(const char *sig);
 uint8_t check_preset_filled(uint32_t preset_num, char *version);
+
+// The preset log calls this when it drops a preset that failed its crc check
+void forget_preset(uint32_t preset_num);
 uint32_t get_preset_addr(uint32_t preset_num);
 uint32_t get_preset_size(void);
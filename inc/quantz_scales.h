@@ -43,8 +43,18 @@ enum scaleMap{
 	NUM_QTZ_SCALES	//4
 };
 
-void init_quantz_scales(void);
-//Todo: use previous note/oct to apply hysterisis correction (ie make sure we've moved far enough into another note/oct before changing)
-//float quantize_to_scale(uint8_t scale_num, float unqtz_freq, uint8_t *qtz_note, uint8_t *qtz_oct, uint8_t prev_qtz_note, uint8_t prev_qtz_oct);
-float quantize_to_scale(uint8_t scale_num, float unqtz_freq, uint8_t *qtz_note, int8_t *qtz_oct);
+#define QTZ_BINS_PER_OCT	32					// a bin is smaller than a semitone, so it rarely has more than one threshold
+#define QTZ_HYSTERESIS		(10.f / 1200.f)		// octaves (10 cents)
+
+// Thresholds of a scale, in octaves (log2 of the frequency)
+typedef struct o_qtz_table {
+	float		low;								// log2 of the bottom of the first note's range, in octave 0
+	float		thresh		[MAX_NUM_QTZ_STEPS];	// top of each note's range, in octaves above low (the last one is 1)
+	float		freq		[MAX_NUM_QTZ_STEPS];	// the notes in octave 0
+	uint8_t		bin_note	[QTZ_BINS_PER_OCT];		// lowest note with a range in each 1/QTZ_BINS_PER_OCT of the octave
+	uint8_t		num_notes;
+} o_qtz_table;
 
+void init_quantz_scales(void);
+uint8_t quantz_set_scale(uint8_t scale_num, const float *notes, uint8_t num_notes);
+float quantize_to_scale(uint8_t scale_num, float unqtz_freq, uint8_t *qtz_note, int8_t *qtz_oct, uint8_t prev_qtz_note, int8_t prev_qtz_oct);
@@ -24,11 +24,52 @@
  * See http://creativecommons.org/licenses/MIT/ for more information.
  *
  * -----------------------------------------------------------------------------
+ *
+ * A resampler keeps its read position in an o_resampler, so several can run at once
+ * (e.g. from the main loop and from a timer) and a long read can be split into blocks.
+ *
+ * RESAMPLE_HERMITE: 4-point Hermite interpolation.
+ * RESAMPLE_SINC: Kaiser-windowed sinc, looked up from a polyphase table. When reading faster
+ * than 1:1 (rate > 1), the cutoff is lowered to the output Nyquist so the result doesn't alias.
+ *
+ * Whole number rates (within RESAMPLE_INTEGER_TOLERANCE over the block) take a fast path:
+ * Hermite just picks every n'th sample, and sinc computes its taps once for the whole block.
  */
 
 #pragma once
 
 #include <stm32f7xx.h>
 
-float resample_hermitian(float resample_rate, float start_inpos, uint32_t in_buf_size, int16_t* in, uint32_t out_samples, int16_t *out, uint16_t init_pos);
+#define RESAMPLE_SINC_ZERO_CROSSINGS	8		// each side of the kernel, at the input Nyquist
+#define RESAMPLE_SINC_PHASES			32		// table points between zero crossings
+#define RESAMPLE_SINC_TABLE_LEN			(RESAMPLE_SINC_ZERO_CROSSINGS * RESAMPLE_SINC_PHASES + 2)
+#define RESAMPLE_MAX_DECIMATION			8		// sinc kernel stops widening above this rate
+#define RESAMPLE_SINC_MAX_TAPS			(2 * RESAMPLE_SINC_ZERO_CROSSINGS * RESAMPLE_MAX_DECIMATION)
+
+#define RESAMPLE_INTEGER_TOLERANCE		0.01f	// samples of drift allowed over a block on the whole number path
+
+enum ResampleModes {
+	RESAMPLE_HERMITE,
+	RESAMPLE_SINC,
+
+	NUM_RESAMPLE_MODES
+};
+
+typedef struct o_resampler {
+	enum ResampleModes 	mode;
+	float 				rate;			// input samples read per output sample
+	const int16_t 		*in;
+	uint32_t 			in_size;		// reads wrap around to in[0] here
+
+	uint32_t 			pos;			// the input sample at or before the next output
+	float 				frac;			// and how far past it
+
+	float 				cutoff;			// sinc: fraction of the input Nyquist
+	uint16_t 			half_taps;		// sinc: taps on each side of the output point
+} o_resampler;
+
+void 	resampler_init(o_resampler *r, enum ResampleModes mode, float rate, const int16_t *in, uint32_t in_size, float start_pos);
+void 	resampler_set_rate(o_resampler *r, float rate);
 
+// Writes out_samples to out[], and returns the input position of the next output sample
+float 	resampler_process(o_resampler *r, int16_t *out, uint32_t out_samples);
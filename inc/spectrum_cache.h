@@ -0,0 +1,70 @@
+/*
+ * spectrum_cache.h
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Spectra of the waveforms being edited, as they come out of resampling recbuf
+ * (before any FX). A waveform that only uses the spectral FX (LPF, tilt, formant,
+ * harmonics) is re-rendered from its cached spectrum when an FX level changes,
+ * without resampling it or running a forward FFT.
+ *
+ * There's only RAM for a few spectra, so slots are reused least-recently-used first.
+ * Each slot is keyed by the cell and by everything that goes into resampling it,
+ * except recbuf itself: call flush_spectrum_cache() whenever recbuf changes.
+ *
+ * Only one render at a time may use the cache: a slot from spectrum_cache_new() is filled
+ * in after it's returned, and another render could find it half filled, or take it over.
+ * The WT_INTERP tick doesn't render while finish_sphere_render() runs in the main loop.
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "globals.h"
+#include "sphere.h"
+
+#define SPECTRUM_CACHE_SIZE		4
+
+typedef struct o_spectrum_cache_slot{
+	float 		spectrum[WT_TABLELEN];		// do_rfft_512_f32() layout
+	float 		sum, min, max;				// of the waveform
+	float 		start_sample;				// where the waveform starts in recbuf
+	float 		stretch_ratio;
+	float 		smoothing;
+	uint8_t 	cell;						// SPHERE_CELL()
+	uint8_t 	valid;
+	uint32_t 	last_used;
+} o_spectrum_cache_slot;
+
+typedef struct o_spectrum_cache{
+	o_spectrum_cache_slot 	slot[SPECTRUM_CACHE_SIZE];
+	uint32_t 				use_ctr;
+
+	uint32_t 				hits;
+	uint32_t 				misses;
+} o_spectrum_cache;
+
+o_spectrum_cache_slot* 	spectrum_cache_find(uint8_t cell, float start_sample, float smoothing);
+o_spectrum_cache_slot* 	spectrum_cache_new(uint8_t cell, float start_sample, float smoothing);
+void 					flush_spectrum_cache(void);
@@ -0,0 +1,76 @@
+/*
+ * sphere_cache.h
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Waveforms loaded from the spheres in external flash, shared by all channels.
+ * Each slot is keyed by (sphere, x, y, z) and counts how many channel corners use it.
+ * Slots with no users keep their data and are reused least-recently-used first,
+ * so channels sitting in the same cell (or returning to one) don't read flash again.
+ * Slots can also be filled ahead of time by sphere_prefetch.c
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "globals.h"
+#include "sphere.h"
+
+// Each channel holds at most 8 corners, and releases them before loading new ones,
+// so there's always a free slot for a load. The extra slots hold prefetched cells.
+// Loads go through the flash queue, so several can be waiting at once
+#define SPHERE_CACHE_PREFETCH_SLOTS	16
+#define SPHERE_CACHE_SIZE		(NUM_CHANNELS * 8 + SPHERE_CACHE_PREFETCH_SLOTS)
+#define SPHERE_CACHE_NONE		0xFF
+
+typedef struct o_sphere_cache_slot{
+	int16_t 	wave[WT_TABLELEN];
+	uint8_t 	wt_num;
+	uint8_t 	x, y, z;
+	uint8_t 	valid;
+	uint8_t 	refs;
+	volatile uint8_t loading;		// flash read queued or in progress
+	uint8_t 	req;				// flash queue request, while loading
+	uint32_t 	last_used;
+} o_sphere_cache_slot;
+
+typedef struct o_sphere_cache{
+	o_sphere_cache_slot 	slot[SPHERE_CACHE_SIZE];
+	uint8_t 				chan_slot[NUM_CHANNELS][8];	// slot used by each channel's corners
+	uint32_t 				use_ctr;
+
+	uint32_t 				hits;
+	uint32_t 				misses;
+	uint32_t 				prefetches;
+} o_sphere_cache;
+
+void 		init_sphere_cache(void);
+uint8_t 	sphere_cache_acquire(uint8_t chan, uint8_t corner, uint8_t wt_num, uint8_t x, uint8_t y, uint8_t z);
+uint8_t 	sphere_cache_load(uint8_t chan, uint8_t corner, uint8_t wt_num, uint8_t x, uint8_t y, uint8_t z);
+uint8_t 	sphere_cache_prefetch(uint8_t wt_num, uint8_t x, uint8_t y, uint8_t z);
+void 		sphere_cache_release_chan(uint8_t chan);
+uint8_t 	sphere_cache_chan_loading(uint8_t chan);
+int16_t* 	sphere_cache_corner(uint8_t chan, uint8_t corner);
+void 		flush_sphere_cache(void);
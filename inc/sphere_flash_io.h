@@ -40,18 +40,37 @@ enum SphereTypes {
 	NUM_SPHERE_TYPES
 };
 
+// Third char of the signature
+#define SPHERE_VERSION_UNPACKED		'1'		// 27 o_waveform's (name and wave)
+#define SPHERE_VERSION_PACKED		'2'		// the header, then 27 waveforms packed into equal size slots
+
+#define PACKED_SPHERE_HEADER_SIZE	8		// signature, slot size (uint16), 2 unused
+
+#define SPHERE_SAVE_LOSSLESS		16
+#define SPHERE_SAVE_UNPACKED		0
+
 void init_sphere_flash(void);
+void set_sphere_save_bits(uint8_t bits);
 void write_factory_spheres_to_extflash(void);
 void restore_factory_spheres_to_extflash(void);
 
 void load_extflash_wavetable(uint8_t wt_num, o_waveform *waveform, uint8_t x, uint8_t y, uint8_t z);
-void load_extflash_wave_raw(uint8_t wt_num, int16_t *waveform, uint8_t x, uint8_t y, uint8_t z);
+void load_sphere_bulk(uint8_t wt_num, int16_t * const waves[NUM_WAVEFORMS_IN_SPHERE]);
+uint32_t get_extflash_wave_addr(uint8_t wt_num, uint8_t x, uint8_t y, uint8_t z);
+uint8_t get_extflash_wave_packed(uint8_t wt_num);
+uint16_t get_extflash_wave_bytes(uint8_t wt_num);
+uint8_t *get_extflash_wave_buf(uint8_t wt_num, int16_t *wave);
+void unpack_extflash_wave(uint8_t wt_num, int16_t *wave);
 uint32_t get_wt_addr(uint16_t wt_num);
 
 void save_sphere_to_flash(uint8_t wt_num, enum SphereTypes sphere_type, int16_t *sphere_data);
 void save_unformatted_sphere_to_flash(uint8_t wt_num, enum SphereTypes sphere_type, o_waveform sphere_data[WT_DIM_SIZE][WT_DIM_SIZE][WT_DIM_SIZE]);
 
 enum SphereTypes read_spheretype(uint32_t wt_num);
+uint8_t is_sphere_signature(const char *data);
+
+// The sphere log calls this when it empties a sphere that failed its crc check
+void forget_sphere(uint8_t wt_num);
 
 void empty_all_user_spheres(void);
 enum SphereTypes clear_user_sphere(uint8_t wt_num);
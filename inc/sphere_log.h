@@ -0,0 +1,110 @@
+/*
+ * sphere_log.h - Spheres saved as an append-only log in the sphere sectors
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * A sphere takes as many 4kB units of a sector as it needs, so several share each 64kB sector:
+ * an unpacked sphere is 7 units, and a packed one 3 to 7 (5 for a rendered sphere packed lossless).
+ *
+ * Saving a sphere writes it into free units, and zeroes the signature of the copy it
+ * replaces, so nothing is erased when saving unless there's no room left. Each record is
+ * a header (with the sphere number and a sequence number, in case the power went off before
+ * the old copy was zeroed) and the sphere. The sphere's signature is written last, so a
+ * sphere that wasn't finished isn't found.
+ *
+ * The header also has the sphere's size and a crc of it. After boot, update_sphere_log() checks
+ * each sphere against it in the background, and empties one that doesn't match.
+ *
+ * There are more sectors than spheres, so there's always a sector with no spheres left
+ * to erase when the free units run out. Nothing has to be moved to make room.
+ *
+ * Sectors in the layout from before the log (sphere n at the start of sector n) are used
+ * as they are: their spheres stay where they are until they're saved again.
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "external_flash_layout.h"
+#include "sphere.h"
+
+#define SPHERE_LOG_HEADER_SIZE		16
+#define SPHERE_LOG_UNIT_SIZE		0x1000
+#define SPHERE_LOG_SECTOR_SIZE		0x10000
+#define SPHERE_LOG_UNITS_PER_SECTOR	(SPHERE_LOG_SECTOR_SIZE / SPHERE_LOG_UNIT_SIZE)
+#define SPHERE_LOG_NUM_SECTORS		MAX_WT_IN_FLASH
+#define SPHERE_LOG_VERIFY_CHUNK		1024
+
+#define SPHERE_LOG_LEGACY			0x80		// sector state: in the old layout (low bits: units used)
+#define SPHERE_LOG_NONE				0xFF
+
+#if SPHERE_LOG_NUM_SECTORS <= MAX_TOTAL_SPHERES
+	#error "The sphere log needs more sectors than spheres, so there's always one to erase"
+#endif
+
+typedef struct o_sphere_log_header {
+	char 		sig[2];					// 'S', 'L'
+	uint8_t 	wt_num;
+	uint8_t 	num_units;				// the record's size, header included
+	uint32_t 	seq;
+	uint32_t 	num_bytes;				// the sphere's size, signature included
+	uint32_t 	crc;					// of the sphere after its signature. Written just before the signature
+} o_sphere_log_header;
+
+typedef struct o_sphere_log {
+	uint32_t 	addr 		[MAX_TOTAL_SPHERES];		// sphere's signature, or 0 if it's not in flash
+	uint8_t 	sector 		[SPHERE_LOG_NUM_SECTORS];	// units used, and SPHERE_LOG_LEGACY
+	uint8_t 	live 		[SPHERE_LOG_NUM_SECTORS];	// spheres in the sector
+	uint8_t 	head;
+	uint32_t 	next_seq;
+
+	uint8_t 	verify_next;			// next sphere to check the crc of
+	uint8_t 	verify_wt;
+	uint32_t 	verify_addr;
+	uint32_t 	verify_pos;
+	uint32_t 	verify_bytes;
+	uint32_t 	verify_crc;
+	uint32_t 	verify_expect;
+	volatile uint8_t 	verify_reading;
+} o_sphere_log;
+
+// Call after init_flash_directory()
+void 		init_sphere_log(void);
+
+uint32_t 	sphere_log_addr(uint8_t wt_num);
+
+// Writes a record header into free units for a sphere of num_bytes, and returns the address the sphere goes at.
+// Write the sphere there after its first sig_bytes (the signature, or a packed sphere's header), then call
+// sphere_log_commit() with the crc of the sphere after its 4-byte signature. It writes the crc, then sig,
+// then zeroes the old copy. Returns 0 if there's no room.
+// These wait for the flash, and can erase a sector: call with WT_INTERP paused, after flash_directory_changing()
+uint32_t 	sphere_log_start(uint8_t wt_num, uint32_t num_bytes);
+void 		sphere_log_commit(uint8_t wt_num, uint32_t addr, uint32_t crc, uint8_t *sig, uint8_t sig_bytes);
+
+// Zeroes the sphere's signature, so it's empty
+void 		sphere_log_clear(uint8_t wt_num);
+
+// Call from the main loop: checks the spheres' crcs, a chunk at a time
+void 		update_sphere_log(void);
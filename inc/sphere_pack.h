@@ -0,0 +1,60 @@
+/*
+ * sphere_pack.h - Compression of waveforms stored in external flash
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * A packed waveform is the difference from a fixed predictor (previous sample, or the
+ * line through the previous two), Rice coded with a separate parameter for each block
+ * of PACK_BLOCK_SIZE samples. Blocks that would be bigger that way are stored as they are.
+ * Packing with shift > 0 drops the low bits first (e.g. 4 for 12-bit), which is
+ * near-lossless; shift = 0 is lossless.
+ *
+ * A waveform is unpacked in place: it's read into the end of the waveform buffer, and the
+ * samples overwrite it from the start, only after the bytes they overwrite have been read.
+ * pack_waveform() stores more blocks as they are where it has to, to keep it that way.
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "sphere.h"
+
+#define PACK_BLOCK_SIZE			32
+#define PACK_NUM_BLOCKS			(WT_TABLELEN / PACK_BLOCK_SIZE)
+#define PACK_HEADER_BYTES		(1 + PACK_NUM_BLOCKS/2)		// predictor and shift, then a 4-bit Rice parameter per block
+#define PACK_MAX_ORDER			2
+#define PACK_MAX_SHIFT			8
+#define PACK_RAW_BLOCK			15		// Rice parameter of a block that's not coded
+#define PACK_RICE_ESCAPE		16		// a quotient this long is followed by the raw value instead
+#define PACK_ESCAPE_BITS		18		// enough for any residual of 16-bit samples
+#define PACK_MAX_BYTES			(WT_TABLELEN * BYTEDEPTH)	// packing is only worth it if it's smaller than this
+
+// Packs wave[] into out[], which must hold PACK_MAX_BYTES.
+// Returns the number of bytes, or 0 if it doesn't fit in PACK_MAX_BYTES or can't be unpacked in place
+uint16_t 	pack_waveform(const int16_t *wave, uint8_t shift, uint8_t *out);
+
+// Unpacks in_bytes of in[] into wave[]. in[] can be the last in_bytes of wave[] itself.
+// Never reads past in[in_bytes-1]
+void 		unpack_waveform(int16_t *wave, const uint8_t *in, uint16_t in_bytes);
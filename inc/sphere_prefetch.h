@@ -0,0 +1,57 @@
+/*
+ * sphere_prefetch.h
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Predicts which sphere cell each channel will move into next, and loads its corners
+ * into the sphere cache while the flash chip is idle.
+ * When browsing, the next cell comes from the browse order. Otherwise it's the
+ * neighboring cells in the direction that wt_pos is moving (from nav encoders, CV or LFOs).
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "globals.h"
+#include "sphere.h"
+
+#define PREFETCH_VEL_LPF			0.1f		// smoothing of the per-tick position changes
+#define PREFETCH_MIN_NAV_VEL		0.0005f		// cells per WT_INTERP tick (about 1 cell/sec)
+#define PREFETCH_MIN_BROWSE_VEL		0.002f		// browse steps per WT_INTERP tick
+
+typedef struct o_sphere_prefetch{
+	float 		last_pos 		[NUM_WT_DIMENSIONS][NUM_CHANNELS];
+	float 		vel 			[NUM_WT_DIMENSIONS][NUM_CHANNELS];
+	float 		last_browse 	[NUM_CHANNELS];
+	float 		browse_vel 		[NUM_CHANNELS];
+
+	// Prediction that has been fully loaded, so we don't look it up again every tick
+	uint32_t 	done_key 		[NUM_CHANNELS];
+
+	uint8_t 	next_chan;
+} o_sphere_prefetch;
+
+void init_sphere_prefetch(void);
+void update_sphere_prefetch(uint8_t allow_load);
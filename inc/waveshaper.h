@@ -0,0 +1,84 @@
+/*
+ * waveshaper.h
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Memoryless waveshaping through a transfer curve table.
+ *
+ * A shaper is a curve function and a parameter that stays the same for the whole waveform
+ * (e.g. the wavefold amount). waveshaper_set_curve() starts a new table when either changes.
+ * Table points are worked out the first time a sample lands next to them, so each point is
+ * evaluated at most once per curve and parameter, however many waveforms are shaped with it.
+ * After that, shaping a sample is a table lookup and a linear interpolation.
+ *
+ * The firmware has one shaper, waveshaper, for both of its sphere renders: on the WT_INTERP tick,
+ * and in the main loop (finish_sphere_render()). They can't share it at the same time, since the
+ * table fills in as it's used, so the tick doesn't render while finish_sphere_render() runs.
+ * Anything rendering on another thread (the host's sphere renderer) needs its own o_waveshaper.
+ */
+
+#pragma once
+
+#include <stm32f7xx.h>
+#include "globals.h"
+
+#define WAVESHAPER_LUT_BITS 		12
+#define WAVESHAPER_LUT_SIZE 		(1 << WAVESHAPER_LUT_BITS)		// intervals across -1..1
+
+// x and the result are -1..1
+typedef float (*WaveshaperCurve)(float x, float param);
+
+typedef struct o_waveshaper{
+	int16_t 		lut 	[WAVESHAPER_LUT_SIZE + 1];
+	uint32_t 		filled 	[(WAVESHAPER_LUT_SIZE + 32) / 32];		// one bit per lut[] point
+	WaveshaperCurve curve;
+	float 			param;
+
+	uint32_t 		evals;			// curve evaluations, for benchmarking
+} o_waveshaper;
+
+#define WAVESHAPER_FILLED(ws, i) 	(((ws)->filled[(i) >> 5] >> ((i) & 31)) & 1)
+
+extern SRAM1DATA o_waveshaper waveshaper;
+
+void init_waveshaper(o_waveshaper *ws);
+void waveshaper_set_curve(o_waveshaper *ws, WaveshaperCurve curve, float param);
+void waveshaper_fill(o_waveshaper *ws, uint32_t i);
+
+// x is -1..1
+static inline float waveshape(o_waveshaper *ws, float x)
+{
+	float 		pos;
+	uint32_t 	i;
+
+	pos = (x + 1.0f) * (float)(WAVESHAPER_LUT_SIZE / 2);
+	if (pos < 0.0f) pos = 0.0f;
+	i = (uint32_t)pos;
+	if (i >= WAVESHAPER_LUT_SIZE) i = WAVESHAPER_LUT_SIZE - 1;
+
+	if (!WAVESHAPER_FILLED(ws, i) || !WAVESHAPER_FILLED(ws, i+1))
+		waveshaper_fill(ws, i);
+
+	return ((float)ws->lut[i] + (float)(ws->lut[i+1] - ws->lut[i]) * (pos - (float)i)) / (float)INT16_MAX;
+}
@@ -54,6 +54,10 @@
 #define DEFAULT_WTBUF_SPREAD			(WT_TABLELEN * 8)
 #define MAX_WTBUF_SPREAD				(WT_TABLELEN * NUM_SPHERES_IN_RECBUF)
 
+#define ALL_SPHERE_CELLS_DIRTY			((1UL << NUM_WAVEFORMS_IN_SPHERE) - 1)
+#define SPHERE_CELL(x, y, z)			((x) + ((y) * WT_DIM_SIZE) + ((z) * WT_DIM_SIZE * WT_DIM_SIZE))
+#define SPHERE_RENDER_CELLS_PER_TICK	1
+
 #define F_TABLE_DISTORTMAX 4.0
 #define F_TABLE_DECIMATEMAX 3.0
 #define F_TABLE_FOLDMAX 20.0
@@ -74,8 +78,17 @@ typedef struct o_spherebuf{
 	o_waveform 				data		[WT_DIM_SIZE][WT_DIM_SIZE][WT_DIM_SIZE];
 	
 	uint32_t 				start_pos	[NUM_WAVEFORMS_IN_SPHERE];
+	volatile uint32_t 		dirty;					// waveforms that need rendering, one bit per SPHERE_CELL()
 } o_spherebuf;
 
+// What render_waveform() reads from, besides the waveform's start and fx levels
+typedef struct o_wt_render_ctx{
+	const int16_t 			*rec;					// the recording (recbuf.data)
+	uint32_t 				rec_size;
+	float 					stretch_ratio;
+	o_waveshaper 			*ws;					// filled in by the wavefolder: one per thread
+} o_wt_render_ctx;
+
 
 
 
@@ -83,6 +96,7 @@ void init_sphere_editor(void);
 void set_params_for_editing(void);
 
 void enter_wtrendering(void);
+void enter_wtrendering_cell(uint8_t dim1, uint8_t dim2, uint8_t dim3);
 void enter_wtediting(void);
 void stage_enter_wtediting(void);
 void enter_wtmonitoring(void);
@@ -90,9 +104,13 @@ void enter_wtttone(void);
 void exit_wtediting(void);
 
 void copy_current_sphere_to_recbuf(uint8_t sphere_index);
-void render_full_sphere(void);
+void update_sphere_render(void);
+void finish_sphere_render(void);
 float render_recbuf_to_spherebuf(uint8_t dim1, uint8_t dim2, uint8_t dim3, float start_sample);
-float put_waveform_in_sphere(uint8_t dim1, uint8_t dim2, uint8_t dim3, float start_sample);
+void render_waveform(const o_wt_render_ctx *ctx, float start_sample, const float *fx, int16_t *wave, o_spectrum_cache_slot *save_spectrum);
+void get_cell_fx(uint8_t dim1, uint8_t dim2, uint8_t dim3, float *fx);
+void update_start_positions(void);
+float get_next_waveform_start(float start_sample);
 
 void update_sphere_stretch_position(int16_t encoder_in);
 void init_wt_edit_settings(void);
@@ -29,6 +29,9 @@
 
 #pragma once
 
+#include "waveshaper.h"
+#include "spectrum_cache.h"
+
 enum FX_LIST {
   FX_WAVEFOLDING,
   FX_DECIMATING,
@@ -36,9 +39,16 @@ enum FX_LIST {
   FX_LPF,
   FX_NORMALIZE,
   FX_SMOOTHING,
+
+  // Spectral FX: hold the LPF button (D) with A, B or C to change these
+  FX_TILT,
+  FX_FORMANT,
+  FX_HARMONICS,
   NUM_FX
 };
 
+#define NUM_FX_BUTTONS 6
+
 enum UNUSED_FX_LIST {
 	FX_DISTORTION,
   	FX_SLEW_LIMIT
@@ -47,15 +57,14 @@ enum UNUSED_FX_LIST {
 void update_wt_fx_params(uint8_t dim1, uint8_t dim2, uint8_t dim3, int16_t increment);
 
 //FX in use:
-void chebyshev_wavefold(uint8_t dim1, uint8_t dim2, uint8_t dim3);
-void decimate_waveform(uint8_t dim1, uint8_t dim2, uint8_t dim3);
-void metalizer(uint8_t dim1,uint8_t dim2,uint8_t dim3);
-void lowpass_fft(uint8_t dim1,uint8_t dim2,uint8_t dim3);
+void apply_wt_fx(o_waveshaper *ws, int16_t *wave, const float *fx, o_spectrum_cache_slot *save_spectrum);
+void apply_wt_fx_from_spectrum(int16_t *wave, const float *fx, const o_spectrum_cache_slot *cached);
+uint8_t wt_fx_cacheable(const float *fx);
 void normalize_waveform(uint8_t dim1,uint8_t dim2,uint8_t dim3);
 void overlap_smooth_wave(int16_t *in, int16_t *out, uint32_t in_size, uint32_t out_size);
 
-void distort_waveform(uint8_t dim1, uint8_t dim2, uint8_t dim3);
-void linear_wavefold(uint8_t dim1, uint8_t dim2, uint8_t dim3);
+void distort_waveform(o_waveshaper *ws, uint8_t dim1, uint8_t dim2, uint8_t dim3);
+void linear_wavefold(o_waveshaper *ws, uint8_t dim1, uint8_t dim2, uint8_t dim3);
 void slew_limit(uint8_t dim1,uint8_t dim2,uint8_t dim3);
 void lowpass_biquad(uint8_t dim1,uint8_t dim2,uint8_t dim3, int16_t *inbuf, int16_t bufsize);
 void lowpass_fft_q15(uint8_t dim1,uint8_t dim2,uint8_t dim3);
@@ -0,0 +1,104 @@
+/*
+ * wavetable_mipmap.h
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Band-limited copies of each channel's current wavetable, one per octave.
+ * Level 0 is wt_osc.mc itself (256 harmonics). Level n keeps 256>>n harmonics,
+ * so it plays without aliasing up to wt_head_pos_inc = 2^n.
+ * Levels are stored with 4x oversampling (min 16 samples) so linear interpolation stays clean.
+ *
+ * Levels 1-8 are built as a set, a few ticks after the wavetable changes. Each channel keeps playing
+ * its last complete set until the next one is done, then crossfades to it. So a channel whose
+ * wavetable is always moving (CV or LFO on the wt position) still plays band-limited levels.
+ */
+
+#pragma once
+#include <stm32f7xx.h>
+#include "globals.h"
+#include "sphere.h"
+
+#define WT_MIP_LEVELS		9		// level 0 (wt_osc.mc) plus 8 band-limited levels
+#define WT_MIP_BUFLEN		1040	// sum of the lengths of levels 1-8
+
+// One set playing per channel, one being built, and one being crossfaded from.
+// A crossfade (1ms) is done long before the next set can be built (9 WT_INTERP ticks)
+#define WT_MIP_SETS			(NUM_CHANNELS + 2)
+
+typedef struct o_wt_mipmap{
+
+	// Sets of levels 1-8, each packed one level after the other
+	float 			table 			[WT_MIP_SETS][WT_MIP_BUFLEN];
+
+	// Set each channel plays, and the set it's crossfading from while xfade > 0
+	uint8_t 		set 			[NUM_CHANNELS];
+	uint8_t 		prev_set 		[NUM_CHANNELS];
+	float 			xfade 			[NUM_CHANNELS];
+
+	// Highest level that can be read. 0 until the channel's first set is built
+	uint8_t 		top_level 		[NUM_CHANNELS];
+
+	// Set when a channel's wavetable changes, cleared when a build of it starts
+	uint8_t 		pending 		[NUM_CHANNELS];
+
+	// Build in progress: one FFT/IFFT per WT_INTERP tick
+	uint8_t 		build_chan;
+	uint8_t 		build_set;
+	uint8_t 		build_level;
+	uint8_t 		last_chan;
+	float 			spectrum 		[WT_TABLELEN*2];
+	float 			cbuf 			[WT_TABLELEN*2];
+
+} o_wt_mipmap;
+
+extern const uint16_t WT_MIP_LEN[WT_MIP_LEVELS];
+extern const uint16_t WT_MIP_OFFSET[WT_MIP_LEVELS];
+
+void 			init_wt_mipmap(void);
+void 			invalidate_wt_mipmap(uint8_t chan);
+void 			update_wt_mipmaps(void);
+const float* 	get_wt_mipmap_table(uint8_t chan, uint8_t level);
+const float* 	get_wt_mipmap_prev_table(uint8_t chan, uint8_t level);
+
+// Finds the two levels to blend for a read head increment.
+// 0.5 < inc <= 1 blends level 0 to 1, 1 < inc <= 2 blends 1 to 2, etc, so the blend is continuous
+// and both levels are always alias-free at that pitch. Returns the lower level, blend is the amount of the next level.
+static inline uint8_t get_wt_mipmap_level(float inc, float *blend)
+{
+	uint8_t level = 0;
+	float 	lim = 0.5f;
+
+	while ((inc > (lim * 2.f)) && (level < (WT_MIP_LEVELS-1))) {
+		lim *= 2.f;
+		level++;
+	}
+
+	if ((level == (WT_MIP_LEVELS-1)) || (inc <= lim))
+		*blend = 0.f;
+	else
+		*blend = (inc - lim) / lim;
+
+	return level;
+}
@@ -198,6 +198,7 @@ void builtin_adc_setup(void)
 // extern these into any file that needs to read the adcs
 
 float				hires_adc_raw	[ NUM_HIRES_ADCS ];
+ads8634Sample		hires_adc_sample[ NUM_HIRES_ADCS ];	// counts new values in hires_adc_raw[]
 DMABUFFER uint16_t	builtin_adc1_raw[ NUM_BUILTIN_ADC1 ];
 DMABUFFER uint16_t	builtin_adc3_raw[ NUM_BUILTIN_ADC3 ];
 
@@ -293,6 +294,7 @@ void hires_adc_init_all(float *adc_dest)
 			}
 		}
 		ads8634_init_with_SPIIRQ(&(adc_dest[base_adc_num]), NUM_HIRES_ADC_PER_CHIP[chipnum], chipnum, os_amts, v_ranges);
+		ads8634_count_samples(chipnum, &(hires_adc_sample[base_adc_num]));
 
 		base_adc_num +=  NUM_HIRES_ADC_PER_CHIP[chipnum];
 	}
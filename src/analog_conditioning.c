@@ -58,10 +58,12 @@
 #include "timekeeper.h"
 #include "math_util.h"
 #include "ui_modes.h"
+#include "pitch_trace.h"
 #include "gpio_pins.h"
 #include "drivers/ads8634_driver.h"
 
 extern float				hires_adc_raw	[ NUM_HIRES_ADCS ];
+extern ads8634Sample		hires_adc_sample[ NUM_HIRES_ADCS ];
 extern DMABUFFER uint16_t	builtin_adc1_raw[ NUM_BUILTIN_ADC1 ];
 extern DMABUFFER uint16_t	builtin_adc3_raw[ NUM_BUILTIN_ADC3 ];
 
@@ -367,6 +369,18 @@ static inline uint16_t apply_bracket(uint8_t filter_id, uint16_t current_value,
 }
 
 
+static inline float apply_jack_offset(uint8_t i, float raw_val);
+static inline float apply_jack_offset(uint8_t i, float raw_val)
+{
+	// Plugged jacks with sense pins:
+	if (analog[i].plug_sense_switch.pressed == PRESSED)
+		return _CLAMP_F(raw_val - system_calibrations->cv_jack_plugged_offset[i], 0, 4095);
+
+	// Unplugged jacks with sense pins and jacks with no sense pin
+	else
+		return _CLAMP_F(raw_val - system_calibrations->cv_jack_unplugged_offset[i], 0, 4095);
+}
+
 void process_analog_conditioning(void)
 {
 	uint8_t i; //analog element ID
@@ -410,13 +424,8 @@ void process_analog_conditioning(void)
 			// else if (analog[i].plug_sense_switch.pressed == RELEASED)
 			// 	analog[i].raw_val = _CLAMP_F(analog[i].raw_val - system_calibrations->cv_jack_unplugged_offset[i], 0 ,4095);
 			
-			// Plugged jacks with sense pins:
-			else if (analog[i].plug_sense_switch.pressed == PRESSED)
-				analog[i].raw_val = _CLAMP_F(analog[i].raw_val - system_calibrations->cv_jack_plugged_offset[i], 0, 4095);
-
-			// Unplugged jacks with sense pins and jacks with no sense pin
-			else 
-				analog[i].raw_val = _CLAMP_F(analog[i].raw_val - system_calibrations->cv_jack_unplugged_offset[i], 0, 4095);
+			else
+				analog[i].raw_val = apply_jack_offset(i, analog[i].raw_val);
 		}
 
 		// Apply LPFs
@@ -430,10 +439,32 @@ void process_analog_conditioning(void)
 		//
 		if (analog[i].bracket_size)		analog[i].bracketed_val = apply_bracket(i, analog[i].bracketed_val, analog[i].lpf_val);
 		else							analog[i].bracketed_val = analog[i].raw_val;
+
+		if (i < NUM_CHANNELS) PITCH_TRACE_CONDITIONED(i, &hires_adc_sample[i]);
 	}
 
 }
 
+// Conditions the latest value of a hires adc the way process_analog_conditioning() does,
+// without waiting for it to run. Uses the plug sense state it last read.
+// Returns 0 if the element is filtered or auto-zeroed, in which case lpf_val has to be used.
+uint8_t analog_latest_hires_val(uint8_t i, float *val)
+{
+	if (i >= NUM_HIRES_ADCS || analog[i].fir_lpf_size || analog[i].iir_lpf_size)
+		return 0;
+
+	*val = hires_adc_raw[i];
+
+	if ((ui_mode != SELECT_PARAMS) && (ui_mode != RGB_COLOR_ADJUST))
+	{
+		if ((AUTO_ZERO_WHEN_UNPLUGGED) && (analog[i].plug_sense_switch.pressed == RELEASED))
+			return 0;
+
+		*val = apply_jack_offset(i, *val);
+	}
+	return 1;
+}
+
 uint8_t analog_jack_plugged(enum AnalogElements jacknum) {
 	return analog[jacknum].plug_sense_switch.pressed;
 }
@@ -0,0 +1,141 @@
+/*
+ * audio_profile.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "audio_profile.h"
+
+o_audio_profile audio_profile;
+
+static const char *STAGE_NAMES[NUM_AUDIO_PROFILE_STAGES] = {
+	"head advance",
+	"interpolation",
+	"crossfade",
+	"pan/level",
+	"compress",
+	"whole block",
+};
+
+const char *audio_profile_stage_name(enum AudioProfileStages stage)
+{
+	return (stage < NUM_AUDIO_PROFILE_STAGES) ? STAGE_NAMES[stage] : "";
+}
+
+void audio_profile_init(void)
+{
+	uint32_t t, start;
+	uint8_t i;
+
+	//Start the cycle counter
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	audio_profile_reset();
+
+	//Measure the cost of a probe, so it can be subtracted from the stage times
+	start = AUDIO_PROFILE_CYCLES();
+	t = start;
+	for (i = 0; i < 64; i++)
+		audio_profile_lap(APS_BLOCK, &t);
+	audio_profile.lap_overhead = (float)(t - start) / 64.f;
+
+	audio_profile.stage[APS_BLOCK].block_cycles = 0;
+	audio_profile.stage[APS_BLOCK].block_laps = 0;
+}
+
+void audio_profile_reset(void)
+{
+	float lap_overhead = audio_profile.lap_overhead;
+	uint8_t i;
+
+	memset(&audio_profile, 0, sizeof(audio_profile));
+	for (i = 0; i < NUM_AUDIO_PROFILE_STAGES; i++)
+		audio_profile.stage[i].best = 0xFFFFFFFF;
+
+	audio_profile.lap_overhead = lap_overhead;
+}
+
+// Folds the current block's accumulators into the stats
+void audio_profile_block_end(void)
+{
+	o_audio_profile_stage *s;
+	uint32_t block_time = AUDIO_PROFILE_CYCLES() - audio_profile.block_start;
+	uint8_t i;
+
+	audio_profile.stage[APS_BLOCK].block_cycles = block_time;
+	audio_profile.stage[APS_BLOCK].block_laps = 0;
+	for (i = 0; i < APS_BLOCK; i++)
+		audio_profile.stage[APS_BLOCK].block_laps += audio_profile.stage[i].block_laps;
+
+	for (i = 0; i < NUM_AUDIO_PROFILE_STAGES; i++)
+	{
+		s = &audio_profile.stage[i];
+
+		if (s->block_cycles > s->worst) s->worst = s->block_cycles;
+		if (s->block_cycles < s->best) s->best = s->block_cycles;
+		s->total += s->block_cycles;
+		s->total_sq += (uint64_t)s->block_cycles * s->block_cycles;
+		s->laps += s->block_laps;
+
+		s->block_cycles = 0;
+		s->block_laps = 0;
+	}
+	audio_profile.num_blocks++;
+}
+
+// Converts the stats to ns, with the probe overhead removed
+void audio_profile_get_summary(enum AudioProfileStages stage, uint32_t samples_per_block, o_audio_profile_summary *summary)
+{
+	o_audio_profile_stage *s = &audio_profile.stage[stage];
+	float ns_per_cycle = 1000.f / AUDIO_PROFILE_CYCLES_PER_US();
+	double n = (double)audio_profile.num_blocks;
+	double mean, var;
+	float overhead_per_block;
+
+	if (!audio_profile.num_blocks || stage >= NUM_AUDIO_PROFILE_STAGES) {
+		memset(summary, 0, sizeof(o_audio_profile_summary));
+		return;
+	}
+
+	overhead_per_block = audio_profile.lap_overhead * (float)((double)s->laps / n);
+
+	//double: the sums are too large for float precision
+	mean = (double)s->total / n;
+	var = (double)s->total_sq / n - mean * mean;
+	if (var < 0.0) var = 0.0;
+
+	summary->ns_per_sample = ((float)mean - overhead_per_block) * ns_per_cycle / (float)samples_per_block;
+	summary->worst_ns = ((float)s->worst - overhead_per_block) * ns_per_cycle;
+	summary->jitter_ns = (float)sqrt(var) * ns_per_cycle;
+
+	if (summary->ns_per_sample < 0.f) summary->ns_per_sample = 0.f;
+	if (summary->worst_ns < 0.f) summary->worst_ns = 0.f;
+}
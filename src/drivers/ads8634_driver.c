@@ -42,6 +42,7 @@
 #include "drivers/ads8634_driver.h"
 #include "timekeeper.h"
 #include "hal_handlers.h"
+#include "pitch_trace.h"
 
 //delays about 32ns for every value of x
 #define delay_32ns(x) do {  register unsigned int i;  for (i = 0; i < x; ++i)   __asm__ __volatile__ ("nop\n\t":::"memory"); } while (0)
@@ -59,6 +60,9 @@ uint16_t			reg_init_buffer[ REG_INIT_BUFFER_SIZE ];
 float 				*g_adc_buffer_addr[ NUMBER_OF_ADS8634_CHIPS ];
 uint8_t				g_adc_buffer_numchans[ NUMBER_OF_ADS8634_CHIPS ];
 
+// Pointer to location where each channel's sample count is kept (optional)
+ads8634Sample		*g_adc_sample_addr[ NUMBER_OF_ADS8634_CHIPS ];
+
 
 uint8_t				g_oversample_amt[ NUMBER_OF_ADS8634_CHIPS ][ MAX_ADCS_PER_CHIP ];
 uint16_t			g_oversample_buff[ NUMBER_OF_ADS8634_CHIPS ][ MAX_ADCS_PER_CHIP ][ MAX_OVERSAMPLE_BUFF_SIZE ];
@@ -539,6 +543,12 @@ void ads8634_set_vrange(uint8_t chipnum, enum RangeSel *v_ranges, uint8_t number
 	__HAL_SPI_ENABLE_IT(&spi_ads8634[chipnum], SPI_IT_RXNE);
 }
 
+// samples[channel_number] is counted up each time a new value is put into adc_buffer[channel_number]
+void ads8634_count_samples(uint8_t chipnum, ads8634Sample *samples)
+{
+	g_adc_sample_addr[chipnum] = samples;
+}
+
 //*************************//
 // Oversampling
 //*************************//
@@ -608,6 +618,11 @@ void ADS8634_A_SPI_IRQHANDLER(void)
 			{
 				g_os_i[0][chan] = 0;
 				g_adc_buffer_addr[0][chan] = resolve_oversampling(0, chan);
+				if (g_adc_sample_addr[0])
+				{
+					PITCH_TRACE_ADC_SAMPLE(&g_adc_sample_addr[0][chan]);
+					g_adc_sample_addr[0][chan].count++;
+				}
 			}
 		}
 
@@ -645,6 +660,11 @@ void ADS8634_B_SPI_IRQHANDLER(void)
 			{
 				g_os_i[1][chan] = 0;
 				g_adc_buffer_addr[1][chan] = resolve_oversampling(1, chan);
+				if (g_adc_sample_addr[1])
+				{
+					PITCH_TRACE_ADC_SAMPLE(&g_adc_sample_addr[1][chan]);
+					g_adc_sample_addr[1][chan].count++;
+				}
 			}
 		}
 		chip[1].SPIx->DR = 0x00;
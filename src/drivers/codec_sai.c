@@ -31,6 +31,7 @@
 #include "hal_handlers.h"
 #include "drivers/codec_i2c.h"
 #include "gpio_pins.h"
+#include "isr_trace.h"
 
 
 //Link to the process_audio_block_codec() of the main app or the bootloader
@@ -334,6 +335,8 @@ void CODEC_SAI_RX_DMA_IRQHandler(void)
 	//Read the interrupt status register (ISR)
 	uint32_t tmpisr = CODEC_SAI_RX_DMA->CODEC_SAI_RX_DMA_ISR;
 
+	ISR_TRACE_ENTER(ISR_TRACE_SAI_RX_DMA);
+
 	if ((tmpisr & CODEC_SAI_RX_DMA_FLAG_FE) && __HAL_DMA_GET_IT_SOURCE(&hdma_sai2a_rx, DMA_IT_FE))
 		codec_dma_it_err=CODEC_DMA_IT_FE; 
 		
@@ -368,6 +371,8 @@ void CODEC_SAI_RX_DMA_IRQHandler(void)
 
 		CODEC_SAI_RX_DMA->CODEC_SAI_RX_DMA_IFCR = CODEC_SAI_RX_DMA_FLAG_HT;
 	}
+
+	ISR_TRACE_EXIT(ISR_TRACE_SAI_RX_DMA);
 }
 
 
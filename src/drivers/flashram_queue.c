@@ -0,0 +1,522 @@
+/*
+ * flashram_queue.c - Prioritized request queue for the external FLASH RAM
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include "drivers/flashram_queue.h"
+#include "drivers/flash_S25FL127.h"
+
+o_flash_queue flash_queue;
+
+// The queue is used from the main loop and from the timer interrupts.
+// Masking interrupts at preempt priority 1 and lower (with NVIC_PRIORITYGROUP_2) keeps the timers out
+// while the queue is changed, but lets the SPI DMA interrupts (priority 0) run, which the driver waits on.
+#define FLASHQ_BASEPRI 		(1 << 6)
+
+static inline uint32_t flashq_lock(void)
+{
+	uint32_t basepri = __get_BASEPRI();
+	__set_BASEPRI_MAX(FLASHQ_BASEPRI);
+	return basepri;
+}
+
+static inline void flashq_unlock(uint32_t basepri)
+{
+	__set_BASEPRI(basepri);
+}
+
+
+void init_flash_queue(void)
+{
+	uint8_t i;
+
+	for (i=0; i<FLASHQ_SIZE; i++)
+		flash_queue.req[i].state = FLASHQ_FREE;
+
+	flash_queue.next_seq = 0;
+	flash_queue.engine = FLASHQ_IDLE;
+	flash_queue.modifying = FLASHQ_NONE;
+	flash_queue.burst_len = 0;
+
+	flash_queue.stats.reads = 0;
+	flash_queue.stats.bursts = 0;
+	flash_queue.stats.writes = 0;
+	flash_queue.stats.erases = 0;
+	flash_queue.stats.erase_suspends = 0;
+}
+
+//
+// Queueing
+//
+
+static uint8_t submit(enum FlashQueueOps op, uint8_t *buf, const sFlashSegment *segs, uint8_t num_segs, uint32_t addr, uint32_t num_bytes, enum FlashQueuePriorities prio, FlashQueueCallback callback, uint32_t ctx)
+{
+	uint8_t 		i;
+	o_flashq_req 	*r;
+	uint32_t 		basepri = flashq_lock();
+
+	for (i=0; i<FLASHQ_SIZE; i++) {
+		if (flash_queue.req[i].state == FLASHQ_FREE)
+			break;
+	}
+
+	if (i < FLASHQ_SIZE) {
+		r = &flash_queue.req[i];
+		r->op 			= op;
+		r->prio 		= prio;
+		r->buf 			= buf;
+		r->segs 		= segs;
+		r->num_segs 	= num_segs;
+		r->addr 		= addr;
+		r->num_bytes 	= num_bytes;
+		r->done_bytes 	= 0;
+		r->seq 			= flash_queue.next_seq++;
+		r->callback 	= callback;
+		r->ctx 			= ctx;
+		r->state 		= FLASHQ_QUEUED;
+	}
+	else
+		i = FLASHQ_NONE;
+
+	flashq_unlock(basepri);
+	return i;
+}
+
+uint8_t flash_queue_read(uint8_t *buf, uint32_t addr, uint32_t num_bytes, enum FlashQueuePriorities prio, FlashQueueCallback callback, uint32_t ctx)
+{
+	return submit(FLASHQ_READ, buf, 0, 0, addr, num_bytes, prio, callback, ctx);
+}
+
+uint8_t flash_queue_write(uint8_t *buf, uint32_t addr, uint32_t num_bytes, enum FlashQueuePriorities prio, FlashQueueCallback callback, uint32_t ctx)
+{
+	return submit(FLASHQ_WRITE, buf, 0, 0, addr, num_bytes, prio, callback, ctx);
+}
+
+uint8_t flash_queue_erase_sector(uint32_t addr, enum FlashQueuePriorities prio, FlashQueueCallback callback, uint32_t ctx)
+{
+	addr = sFLASH_align2sector(addr);
+	return submit(FLASHQ_ERASE_SECTOR, 0, 0, 0, addr, sFLASH_get_sector_size(sFLASH_get_sector_num(addr)), prio, callback, ctx);
+}
+
+// num_bytes is the whole range read, so it's checked for conflicts like a plain read
+uint8_t flash_queue_read_segments(const sFlashSegment *segs, uint8_t num_segs, uint32_t addr, enum FlashQueuePriorities prio, FlashQueueCallback callback, uint32_t ctx)
+{
+	uint8_t 	i;
+	uint32_t 	num_bytes = 0;
+
+	for (i=0; i<num_segs; i++)
+		num_bytes += segs[i].num_bytes;
+
+	return submit(FLASHQ_READ, 0, segs, num_segs, addr, num_bytes, prio, callback, ctx);
+}
+
+void flash_queue_raise_prio(uint8_t req, enum FlashQueuePriorities prio)
+{
+	uint32_t basepri = flashq_lock();
+
+	if (req < FLASHQ_SIZE && flash_queue.req[req].state != FLASHQ_FREE && prio < flash_queue.req[req].prio)
+		flash_queue.req[req].prio = prio;
+
+	flashq_unlock(basepri);
+}
+
+uint8_t flash_queue_num_pending(enum FlashQueuePriorities prio)
+{
+	uint8_t i, n=0;
+
+	for (i=0; i<FLASHQ_SIZE; i++) {
+		if (flash_queue.req[i].state != FLASHQ_FREE && flash_queue.req[i].prio == prio)
+			n++;
+	}
+	return n;
+}
+
+uint8_t flash_queue_num_free(void)
+{
+	uint8_t i, n=0;
+
+	for (i=0; i<FLASHQ_SIZE; i++) {
+		if (flash_queue.req[i].state == FLASHQ_FREE)
+			n++;
+	}
+	return n;
+}
+
+uint8_t flash_queue_is_idle(void)
+{
+	uint8_t i;
+
+	if (flash_queue.engine != FLASHQ_IDLE)
+		return 0;
+
+	for (i=0; i<FLASHQ_SIZE; i++) {
+		if (flash_queue.req[i].state != FLASHQ_FREE)
+			return 0;
+	}
+	return 1;
+}
+
+//
+// Scheduling
+//
+
+// Reads can pass each other, and can pass writes/erases of other addresses.
+// Writes and erases never pass each other
+static uint8_t reqs_conflict(o_flashq_req *a, o_flashq_req *b)
+{
+	if (a->op == FLASHQ_READ && b->op == FLASHQ_READ)
+		return 0;
+
+	if (a->op != FLASHQ_READ && b->op != FLASHQ_READ)
+		return 1;
+
+	return (a->addr < (b->addr + b->num_bytes)) && (b->addr < (a->addr + a->num_bytes));
+}
+
+// A request is blocked if an earlier request that it conflicts with isn't done
+static uint8_t is_blocked(uint8_t i)
+{
+	uint8_t 		j;
+	o_flashq_req 	*r = &flash_queue.req[i];
+
+	for (j=0; j<FLASHQ_SIZE; j++) {
+		if (j == i || flash_queue.req[j].state == FLASHQ_FREE)
+			continue;
+		if (flash_queue.req[j].seq < r->seq && reqs_conflict(&flash_queue.req[j], r))
+			return 1;
+	}
+	return 0;
+}
+
+// Finds the highest priority, oldest request that can start.
+// A write that's part way done can continue (it's FLASHQ_ACTIVE between pages)
+static uint8_t pick_next(uint8_t reads_only, enum FlashQueuePriorities max_prio)
+{
+	uint8_t 		i, best = FLASHQ_NONE;
+	o_flashq_req 	*r;
+
+	for (i=0; i<FLASHQ_SIZE; i++) {
+		r = &flash_queue.req[i];
+
+		if (r->prio > max_prio)
+			continue;
+		if (reads_only && r->op != FLASHQ_READ)
+			continue;
+		if (r->state != FLASHQ_QUEUED && !(r->state == FLASHQ_ACTIVE && i == flash_queue.modifying))
+			continue;
+
+		if (best != FLASHQ_NONE) {
+			if (r->prio > flash_queue.req[best].prio)
+				continue;
+			if (r->prio == flash_queue.req[best].prio && r->seq > flash_queue.req[best].seq)
+				continue;
+		}
+		if (r->state == FLASHQ_QUEUED && is_blocked(i))
+			continue;
+
+		best = i;
+	}
+	return best;
+}
+
+static uint8_t add_segments(uint8_t *buf, uint32_t num_bytes, uint8_t *num_segs)
+{
+	uint8_t 	n = *num_segs;
+	uint32_t 	sz;
+
+	while (num_bytes) {
+		if (n >= (FLASHQ_MAX_BURST * 2))
+			return 0;
+
+		sz = (num_bytes > 0xFFFF) ? 0xFFFF : num_bytes;
+		flash_queue.segs[n].buf = buf;
+		flash_queue.segs[n].num_bytes = sz;
+		buf += sz;
+		num_bytes -= sz;
+		n++;
+	}
+	*num_segs = n;
+	return 1;
+}
+
+// Starts reading request i, along with any queued reads that follow it in flash
+// (skipping at most FLASHQ_MAX_GAP bytes between them).
+// Scattered reads already have their own segment list, so they're read alone
+static void start_read_burst(uint8_t i, enum FlashQueuePriorities max_prio)
+{
+	uint8_t 		j, next, num_segs = 0;
+	uint32_t 		end, gap;
+	o_flashq_req 	*r = &flash_queue.req[i];
+
+	r->state = FLASHQ_ACTIVE;
+	flash_queue.burst[0] = i;
+	flash_queue.burst_len = 1;
+
+	if (r->segs) {
+		flash_queue.stats.bursts++;
+		flash_queue.stats.reads++;
+		flash_queue.engine = FLASHQ_READING;
+		sFLASH_read_segments_DMA(r->segs, r->num_segs, r->addr);
+		return;
+	}
+
+	add_segments(r->buf, r->num_bytes, &num_segs);
+	end = r->addr + r->num_bytes;
+
+	while (flash_queue.burst_len < FLASHQ_MAX_BURST)
+	{
+		next = FLASHQ_NONE;
+		for (j=0; j<FLASHQ_SIZE; j++) {
+			r = &flash_queue.req[j];
+			if (r->state != FLASHQ_QUEUED || r->op != FLASHQ_READ || r->segs || r->prio > max_prio)
+				continue;
+			if (r->addr < end || (r->addr - end) > FLASHQ_MAX_GAP)
+				continue;
+			if (next != FLASHQ_NONE && r->addr >= flash_queue.req[next].addr)
+				continue;
+			if (is_blocked(j))
+				continue;
+			next = j;
+		}
+		if (next == FLASHQ_NONE)
+			break;
+
+		r = &flash_queue.req[next];
+		gap = r->addr - end;
+		if (((gap ? 1 : 0) + 1 + (r->num_bytes / 0xFFFF) + num_segs) > (FLASHQ_MAX_BURST * 2))
+			break;
+
+		if (gap)
+			add_segments(flash_queue.gap, gap, &num_segs);
+		add_segments(r->buf, r->num_bytes, &num_segs);
+
+		r->state = FLASHQ_ACTIVE;
+		flash_queue.burst[flash_queue.burst_len++] = next;
+		end = r->addr + r->num_bytes;
+	}
+
+	flash_queue.stats.bursts++;
+	flash_queue.stats.reads += flash_queue.burst_len;
+
+	flash_queue.engine = FLASHQ_READING;
+	sFLASH_read_segments_DMA(flash_queue.segs, num_segs, flash_queue.req[flash_queue.burst[0]].addr);
+}
+
+static void start_write_page(uint8_t i)
+{
+	o_flashq_req 	*r = &flash_queue.req[i];
+	uint32_t 		addr = r->addr + r->done_bytes;
+	uint32_t 		sz = r->num_bytes - r->done_bytes;
+
+	// Pages can't cross a page boundary
+	if (sz > (sFLASH_SPI_PAGESIZE - (addr % sFLASH_SPI_PAGESIZE)))
+		sz = sFLASH_SPI_PAGESIZE - (addr % sFLASH_SPI_PAGESIZE);
+
+	r->state = FLASHQ_ACTIVE;
+	flash_queue.modifying = i;
+	flash_queue.page_bytes = sz;
+	flash_queue.stats.writes++;
+
+	flash_queue.engine = FLASHQ_WRITING;
+	sFLASH_write_page_DMA(r->buf + r->done_bytes, addr, sz);
+}
+
+static void start_erase(uint8_t i)
+{
+	flash_queue.req[i].state = FLASHQ_ACTIVE;
+	flash_queue.modifying = i;
+	flash_queue.erase_polls = FLASHQ_ERASE_MIN_POLLS;
+	flash_queue.stats.erases++;
+
+	flash_queue.engine = FLASHQ_ERASING;
+	sFLASH_erase_sector_background(flash_queue.req[i].addr);
+}
+
+static void start_next(void)
+{
+	uint8_t i = pick_next(0, NUM_FLASHQ_PRIOS);
+
+	if (i == FLASHQ_NONE)
+		return;
+
+	switch (flash_queue.req[i].op) {
+		case FLASHQ_READ: 			start_read_burst(i, NUM_FLASHQ_PRIOS); break;
+		case FLASHQ_WRITE: 			start_write_page(i); break;
+		case FLASHQ_ERASE_SECTOR: 	start_erase(i); break;
+	}
+}
+
+// Frees the request first, so the callback can queue another one
+static void complete_req(uint8_t i)
+{
+	FlashQueueCallback 	callback = flash_queue.req[i].callback;
+	uint32_t 			ctx = flash_queue.req[i].ctx;
+
+	flash_queue.req[i].state = FLASHQ_FREE;
+	if (callback)
+		callback(ctx);
+}
+
+void flash_queue_service(void)
+{
+	uint8_t 	i;
+	uint32_t 	basepri = flashq_lock();
+
+	switch (flash_queue.engine)
+	{
+		case FLASHQ_READING:
+			if (get_flash_state() != sFLASH_NOTBUSY)
+				break;
+
+			flash_queue.engine = (flash_queue.modifying != FLASHQ_NONE && flash_queue.req[flash_queue.modifying].op == FLASHQ_ERASE_SECTOR)
+									? FLASHQ_ERASE_SUSPENDED : FLASHQ_IDLE;
+			for (i=0; i<flash_queue.burst_len; i++)
+				complete_req(flash_queue.burst[i]);
+			flash_queue.burst_len = 0;
+			break;
+
+		case FLASHQ_WRITING:
+			if (get_flash_state() != sFLASH_NOTBUSY || !sFLASH_is_chip_ready())
+				break;
+
+			i = flash_queue.modifying;
+			flash_queue.req[i].done_bytes += flash_queue.page_bytes;
+			flash_queue.engine = FLASHQ_IDLE;
+			if (flash_queue.req[i].done_bytes >= flash_queue.req[i].num_bytes) {
+				flash_queue.modifying = FLASHQ_NONE;
+				complete_req(i);
+			}
+			break;
+
+		case FLASHQ_ERASING:
+			if (get_flash_state() != sFLASH_NOTBUSY)
+				break;
+
+			// Let audio reads in, unless the erase was just resumed
+			if (flash_queue.erase_polls)
+				flash_queue.erase_polls--;
+			else if (pick_next(1, FLASHQ_PRIO_AUDIO) != FLASHQ_NONE) {
+				sFLASH_erase_suspend();
+				flash_queue.stats.erase_suspends++;
+				flash_queue.engine = FLASHQ_ERASE_SUSPENDING;
+				break;
+			}
+
+			if (!sFLASH_is_chip_ready())
+				break;
+
+			i = flash_queue.modifying;
+			flash_queue.modifying = FLASHQ_NONE;
+			flash_queue.engine = FLASHQ_IDLE;
+			complete_req(i);
+			break;
+
+		case FLASHQ_ERASE_SUSPENDING:
+			// The chip is ready once the erase has stopped
+			if (sFLASH_is_chip_ready())
+				flash_queue.engine = FLASHQ_ERASE_SUSPENDED;
+			break;
+
+		case FLASHQ_IDLE:
+		case FLASHQ_ERASE_SUSPENDED:
+			break;
+	}
+
+	if (flash_queue.engine == FLASHQ_IDLE)
+		start_next();
+
+	// While suspended, only audio reads are done (never of the sector being erased: those are blocked)
+	else if (flash_queue.engine == FLASHQ_ERASE_SUSPENDED) {
+		i = pick_next(1, FLASHQ_PRIO_AUDIO);
+		if (i != FLASHQ_NONE)
+			start_read_burst(i, FLASHQ_PRIO_AUDIO);
+		else {
+			sFLASH_erase_resume();
+			flash_queue.erase_polls = FLASHQ_ERASE_MIN_POLLS;
+			flash_queue.engine = FLASHQ_ERASING;
+		}
+	}
+
+	flashq_unlock(basepri);
+}
+
+//
+// Blocking
+//
+
+void flash_queue_wait(uint8_t req)
+{
+	uint32_t seq;
+
+	if (req >= FLASHQ_SIZE)
+		return;
+
+	seq = flash_queue.req[req].seq;
+	while (flash_queue.req[req].state != FLASHQ_FREE && flash_queue.req[req].seq == seq)
+		flash_queue_service();
+}
+
+void flash_queue_wait_all(void)
+{
+	while (!flash_queue_is_idle())
+		flash_queue_service();
+}
+
+void flash_queue_read_wait(uint8_t *buf, uint32_t addr, uint32_t num_bytes)
+{
+	uint8_t req;
+
+	while ((req = flash_queue_read(buf, addr, num_bytes, FLASHQ_PRIO_NORMAL, 0, 0)) == FLASHQ_NONE)
+		flash_queue_service();
+	flash_queue_wait(req);
+}
+
+void flash_queue_read_segments_wait(const sFlashSegment *segs, uint8_t num_segs, uint32_t addr)
+{
+	uint8_t req;
+
+	while ((req = flash_queue_read_segments(segs, num_segs, addr, FLASHQ_PRIO_NORMAL, 0, 0)) == FLASHQ_NONE)
+		flash_queue_service();
+	flash_queue_wait(req);
+}
+
+void flash_queue_write_wait(uint8_t *buf, uint32_t addr, uint32_t num_bytes)
+{
+	uint8_t req;
+
+	while ((req = flash_queue_write(buf, addr, num_bytes, FLASHQ_PRIO_NORMAL, 0, 0)) == FLASHQ_NONE)
+		flash_queue_service();
+	flash_queue_wait(req);
+}
+
+void flash_queue_erase_sector_wait(uint32_t addr)
+{
+	uint8_t req;
+
+	while ((req = flash_queue_erase_sector(addr, FLASHQ_PRIO_NORMAL, 0, 0)) == FLASHQ_NONE)
+		flash_queue_service();
+	flash_queue_wait(req);
+}
@@ -34,6 +34,7 @@
 #include "globals.h"
 #include "hal_handlers.h"
 #include "gpio_pins.h"
+#include "isr_trace.h"
 
 
 FlashRamChip s_flash_chip;
@@ -53,7 +54,6 @@ void sFLASH_write_enable(void);
 void sFLASH_WaitForWriteEnd(void);
 void sFLASH_SPI_GPIO_init(uint32_t nss_mode);
 void sFLASH_SPIDMA_init(void);
-void sFLASH_write_page_DMA(uint8_t* txBuffer, uint32_t write_addr, uint16_t num_bytes);
 void sFLASH_write_page(uint8_t* txBuffer, uint32_t write_addr, uint16_t num_bytes);
 
 static inline void select_chip(void);
@@ -67,6 +67,13 @@ enum sFlashStates get_flash_state(void) { return sflash_state; }
 
 static uint8_t g_cmd[4];
 
+// Segmented read in progress: the DMA complete callback starts the next segment
+// while the chip is still selected, so the chip keeps streaming from the next address
+static sFlashSegment 		single_seg;
+static const sFlashSegment 	*read_segs;
+static uint8_t 				read_num_segs;
+static volatile uint8_t 	read_seg_i;
+
 //
 // READING
 //
@@ -80,6 +87,21 @@ void sFLASH_read_buffer(uint8_t* rxBuffer, uint32_t read_addr, uint16_t num_byte
 
 void sFLASH_read_buffer_DMA(uint8_t* rxBuffer, uint32_t read_addr, uint16_t num_bytes)
 {
+	single_seg.buf = rxBuffer;
+	single_seg.num_bytes = num_bytes;
+	sFLASH_read_segments_DMA(&single_seg, 1, read_addr);
+}
+
+// Reads consecutive addresses into a list of buffers with one read command.
+// *segs must stay valid until get_flash_state() returns sFLASH_NOTBUSY
+void sFLASH_read_segments_DMA(const sFlashSegment *segs, uint8_t num_segs, uint32_t read_addr)
+{
+	if (!num_segs) return;
+
+	read_segs = segs;
+	read_num_segs = num_segs;
+	read_seg_i = 0;
+
 	g_cmd[0] = sFLASH_CMD_READ;
 	g_cmd[1] = read_addr >> 16;
 	g_cmd[2] = read_addr >> 8;
@@ -93,10 +115,25 @@ void sFLASH_read_buffer_DMA(uint8_t* rxBuffer, uint32_t read_addr, uint16_t num_
 	while (sflash_state != sFLASH_NOTBUSY)  { ; }
 
 	sflash_state = sFLASH_READING;
-	if (HAL_SPI_Receive_DMA(&flashram_spi, rxBuffer, num_bytes) != HAL_OK)
+	if (HAL_SPI_Receive_DMA(&flashram_spi, segs[0].buf, segs[0].num_bytes) != HAL_OK)
 		sflash_error |= sFLASH_SPI_DMA_RX_ERROR;
 }
 
+// Called from the DMA complete callbacks when a read segment is done.
+// Returns 1 if another segment was started
+static uint8_t read_next_segment(void)
+{
+	if (sflash_state != sFLASH_READING || (read_seg_i + 1) >= read_num_segs)
+		return 0;
+
+	read_seg_i++;
+	if (HAL_SPI_Receive_DMA(&flashram_spi, read_segs[read_seg_i].buf, read_segs[read_seg_i].num_bytes) != HAL_OK) {
+		sflash_error |= sFLASH_SPI_DMA_RX_ERROR;
+		return 0;
+	}
+	return 1;
+}
+
 //
 // WRITING
 //
@@ -263,6 +300,34 @@ void sFLASH_erase_sector_background(uint32_t SectorAddr)
 	deselect_chip();
 }
 
+// Suspends a sector erase so the chip can be read (but not the sector being erased).
+// The chip is ready for reads when sFLASH_is_chip_ready() returns true (max 45us)
+void sFLASH_erase_suspend(void)
+{
+	g_cmd[0] = sFLASH_CMD_ERSP;
+
+	sflash_state = sFLASH_WRITECMD;
+	select_chip();
+	if (HAL_SPI_Transmit_DMA(&flashram_spi, g_cmd, 1) != HAL_OK)
+		sflash_error |= sFLASH_SPI_DMA_TX_ERROR;
+
+	while (sflash_state != sFLASH_NOTBUSY)  { ; }
+	deselect_chip();
+}
+
+void sFLASH_erase_resume(void)
+{
+	g_cmd[0] = sFLASH_CMD_ERRS;
+
+	sflash_state = sFLASH_ERASING;
+	select_chip();
+	if (HAL_SPI_Transmit_DMA(&flashram_spi, g_cmd, 1) != HAL_OK)
+		sflash_error |= sFLASH_SPI_DMA_TX_ERROR;
+
+	while (sflash_state != sFLASH_NOTBUSY)  { ; }
+	deselect_chip();
+}
+
 void sFLASH_erase_chip(void)
 {
 	sFLASH_write_enable();
@@ -526,6 +591,8 @@ void sFLASH_SPI_GPIO_init(uint32_t nss_mode)
 
 void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
 {
+	if (read_next_segment())
+		return;
 	if (sflash_state == sFLASH_READING || sflash_state == sFLASH_WRITING)
 		deselect_chip();
 	sflash_state = sFLASH_NOTBUSY;
@@ -538,6 +605,8 @@ void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
 }
 void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
 {
+	if (read_next_segment())
+		return;
 	if (sflash_state == sFLASH_READING)
 		deselect_chip();
 	sflash_state = sFLASH_NOTBUSY;
@@ -549,15 +618,21 @@ void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
 }
 void SPIx_DMA_RX_IRQHandler(void)
 {
+	ISR_TRACE_ENTER(ISR_TRACE_FLASH_SPI_DMA_RX);
 	HAL_DMA_IRQHandler(flashram_spi.hdmarx);
+	ISR_TRACE_EXIT(ISR_TRACE_FLASH_SPI_DMA_RX);
 }
 void SPIx_DMA_TX_IRQHandler(void)
 {
+	ISR_TRACE_ENTER(ISR_TRACE_FLASH_SPI_DMA_TX);
 	HAL_DMA_IRQHandler(flashram_spi.hdmatx);
+	ISR_TRACE_EXIT(ISR_TRACE_FLASH_SPI_DMA_TX);
 }
 void SPIx_IRQHandler(void)
 {
+	ISR_TRACE_ENTER(ISR_TRACE_FLASH_SPI);
 	HAL_SPI_IRQHandler(&flashram_spi);
+	ISR_TRACE_EXIT(ISR_TRACE_FLASH_SPI);
 }
 
 
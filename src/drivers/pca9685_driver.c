@@ -31,6 +31,7 @@
 #include "drivers/pca9685_driver.h"
 #include "hal_handlers.h"
 #include "i2c_util.h"
+#include "isr_trace.h"
 
 I2C_HandleTypeDef pwmleddriver_i2c;
 DMA_HandleTypeDef pwmleddriver_dmatx;
@@ -359,13 +360,19 @@ void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
 
 void LEDDRIVER_I2C_DMA_TX_IRQHandler()
 {
+	ISR_TRACE_ENTER(ISR_TRACE_LED_I2C_DMA_TX);
 	HAL_DMA_IRQHandler(pwmleddriver_i2c.hdmatx);
+	ISR_TRACE_EXIT(ISR_TRACE_LED_I2C_DMA_TX);
 }
 void I2C1_EV_IRQHandler(void)
 {
+	ISR_TRACE_ENTER(ISR_TRACE_LED_I2C_EV);
 	HAL_I2C_EV_IRQHandler(&pwmleddriver_i2c);
+	ISR_TRACE_EXIT(ISR_TRACE_LED_I2C_EV);
 }
 void I2C1_ER_IRQHandler(void)
 {
+	ISR_TRACE_ENTER(ISR_TRACE_LED_I2C_ER);
 	HAL_I2C_ER_IRQHandler(&pwmleddriver_i2c);
+	ISR_TRACE_EXIT(ISR_TRACE_LED_I2C_ER);
 }
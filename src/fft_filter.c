@@ -71,6 +71,76 @@ void do_cfft_lpf_512_f32(int16_t *inbuf,  int16_t *outbuf, float *cinbuf, float
 }
 
 
+//Real FFT of 512 samples. inbuf is used as scratch space, so its contents are lost.
+//spectrum has 512 elements: spectrum[0] is DC, spectrum[1] is Nyquist (both are real),
+//then the real and imaginary parts of bins 1..255
+void do_rfft_512_f32(float *inbuf, float *spectrum)
+{
+	arm_rfft_fast_instance_f32 rfft;
+
+	arm_rfft_fast_init_f32(&rfft, 512);
+	arm_rfft_fast_f32(&rfft, inbuf, spectrum, 0);
+}
+
+//Inverse of do_rfft_512_f32(). spectrum is used as scratch space
+void do_irfft_512_f32(float *spectrum, float *outbuf)
+{
+	arm_rfft_fast_instance_f32 rfft;
+
+	arm_rfft_fast_init_f32(&rfft, 512);
+	arm_rfft_fast_f32(&rfft, spectrum, outbuf, 1);
+}
+
+//inbuf has 512 floats, spectrum has 1024 elements (interleaved complex)
+void do_cfft_512_f32(float *inbuf, float *spectrum)
+{
+	const uint16_t bufsize = 512;
+	uint16_t i;
+
+	for (i=0; i<bufsize; i++) {
+		spectrum[i*2] = inbuf[i];
+		spectrum[i*2+1] = 0.0;
+	}
+	arm_cfft_f32(&arm_cfft_sR_f32_len512, spectrum, 0, 1);
+}
+
+//Makes a real table of outlen samples from a spectrum made by do_cfft_512_f32(), keeping only bins 0..num_harmonics
+//outlen is a power of 2 from 16 to 512, and num_harmonics must be less than outlen/2
+//cbuf has outlen*2 elements
+void do_icfft_bandlimit_f32(float *spectrum, uint16_t num_harmonics, float *outbuf, uint16_t outlen, float *cbuf)
+{
+	const arm_cfft_instance_f32 *cfft;
+	uint16_t i;
+
+	switch (outlen) {
+		case 16:	cfft = &arm_cfft_sR_f32_len16; break;
+		case 32:	cfft = &arm_cfft_sR_f32_len32; break;
+		case 64:	cfft = &arm_cfft_sR_f32_len64; break;
+		case 128:	cfft = &arm_cfft_sR_f32_len128; break;
+		case 256:	cfft = &arm_cfft_sR_f32_len256; break;
+		default:	cfft = &arm_cfft_sR_f32_len512; outlen = 512; break;
+	}
+
+	for (i=0; i<outlen*2; i++)
+		cbuf[i] = 0.0;
+
+	//positive bins stay put, negative bins move from the end of the 512 spectrum to the end of the shorter one
+	for (i=0; i<=num_harmonics; i++) {
+		cbuf[i*2] = spectrum[i*2];
+		cbuf[i*2+1] = spectrum[i*2+1];
+	}
+	for (i=1; i<=num_harmonics; i++) {
+		cbuf[(outlen-i)*2] = spectrum[(512-i)*2];
+		cbuf[(outlen-i)*2+1] = spectrum[(512-i)*2+1];
+	}
+
+	//Inverse CFFT scales by 1/outlen, but the forward CFFT was 512 points
+	arm_cfft_f32(cfft, cbuf, 1, 1);
+
+	for (i=0; i<outlen; i++)
+		outbuf[i] = cbuf[i*2] * (float)outlen / 512.0f;
+}
+
 void do_fft_shift_16(int16_t *inbuf, int16_t *outbuf, float *tmpbuf, int16_t shift)
 {
 	// const uint16_t bufsize = 16;
@@ -0,0 +1,218 @@
+#include "flash_storage.hh"
+#include "persistent_storage.hh"
+#include <stdint.h>
+#include <stddef.h>
+extern "C" {
+#include "globals.h"
+#include "external_flash_layout.h"
+#include "flash_directory.h"
+#include "math_util.h"
+}
+
+static const uint16_t DIRECTORY_CHECK_WORD = 0xD1ED;
+static const uint32_t DIRECTORY_CURRENT = 0xFFFFFFFF;
+
+struct FlashDirectory {
+	uint16_t check_word;
+	uint8_t num_spheres;
+	uint8_t num_presets;
+	uint16_t sphere_pack_bytes[MAX_TOTAL_SPHERES];
+	uint8_t sphere_type[MAX_TOTAL_SPHERES];
+	uint32_t sphere_addr[MAX_TOTAL_SPHERES];	// 0 if the sphere isn't in flash
+	uint8_t sphere_log_sector[MAX_WT_IN_FLASH];
+	uint32_t sphere_log_seq;
+	char preset_version[MAX_PRESETS];		// 0 if the preset is empty
+	uint32_t preset_addr[MAX_PRESETS];
+	uint8_t preset_log_sector[PRESET_NUM_SECTORS];
+	uint32_t preset_log_seq;
+	uint32_t crc;
+
+	// Left erased when the directory is written, and cleared (without erasing) before
+	// the first sphere or preset is changed after that. Not part of the crc
+	uint32_t current;
+
+	uint32_t calc_crc()
+	{
+		return _CRC32(0, reinterpret_cast<const uint8_t *>(this), offsetof(FlashDirectory, crc));
+	}
+
+	bool validate()
+	{
+		if (check_word != DIRECTORY_CHECK_WORD)
+			return false;
+		if (num_spheres != MAX_TOTAL_SPHERES || num_presets != MAX_PRESETS)
+			return false;
+		return crc == calc_crc();
+	}
+};
+
+static SRAM1DATA FlashDirectory directory;
+static WearLevel<FlashStorage<FLASH_DIRECTORY_SECTOR, FlashDirectory>> directory_storage;
+
+static uint8_t has_spheres;
+static uint8_t has_presets;
+static volatile uint8_t changed;
+static uint8_t marked_not_current;
+static uint32_t not_current = 0;
+
+extern "C" void init_flash_directory(void)
+{
+	has_spheres = 0;
+	has_presets = 0;
+	changed = 0;
+	marked_not_current = 0;
+
+	if (directory_storage.Read(&directory) && directory.current == DIRECTORY_CURRENT) {
+		has_spheres = 1;
+		has_presets = 1;
+		return;
+	}
+
+	//Stale or missing: the spheres and presets will be scanned
+	directory.check_word = DIRECTORY_CHECK_WORD;
+	directory.num_spheres = MAX_TOTAL_SPHERES;
+	directory.num_presets = MAX_PRESETS;
+	marked_not_current = 1;
+}
+
+extern "C" uint8_t flash_directory_has_spheres(void) { return has_spheres; }
+extern "C" uint8_t flash_directory_has_presets(void) { return has_presets; }
+
+extern "C" enum SphereTypes flash_directory_spheretype(uint8_t wt_num, uint16_t *pack_bytes)
+{
+	if (wt_num >= MAX_TOTAL_SPHERES || directory.sphere_type[wt_num] >= NUM_SPHERE_TYPES) {
+		*pack_bytes = 0;
+		return SPHERE_TYPE_EMPTY;
+	}
+	*pack_bytes = directory.sphere_pack_bytes[wt_num];
+	return static_cast<enum SphereTypes>(directory.sphere_type[wt_num]);
+}
+
+extern "C" char flash_directory_preset(uint32_t preset_num, uint32_t *addr)
+{
+	if (preset_num >= MAX_PRESETS || !directory.preset_version[preset_num]) {
+		*addr = 0;
+		return 0;
+	}
+	*addr = directory.preset_addr[preset_num];
+	return directory.preset_version[preset_num];
+}
+
+extern "C" uint32_t flash_directory_sphere_addr(uint8_t wt_num)
+{
+	if (wt_num >= MAX_TOTAL_SPHERES) return 0;
+	return directory.sphere_addr[wt_num];
+}
+
+extern "C" uint8_t flash_directory_sphere_log_sector(uint8_t sector)
+{
+	if (sector >= MAX_WT_IN_FLASH) return 0;
+	return directory.sphere_log_sector[sector];
+}
+
+extern "C" uint32_t flash_directory_sphere_log_seq(void)
+{
+	return directory.sphere_log_seq;
+}
+
+extern "C" uint8_t flash_directory_preset_log_sector(uint8_t sector)
+{
+	if (sector >= PRESET_NUM_SECTORS) return 0;
+	return directory.preset_log_sector[sector];
+}
+
+extern "C" uint32_t flash_directory_preset_log_seq(void)
+{
+	return directory.preset_log_seq;
+}
+
+extern "C" void flash_directory_spheres_scanned(void)
+{
+	has_spheres = 1;
+	changed = 1;
+}
+
+extern "C" void flash_directory_presets_scanned(void)
+{
+	has_presets = 1;
+	changed = 1;
+}
+
+// Queues the write that marks the directory in flash as not current, so if the
+// power goes off before it's rewritten, the next boot scans instead of using it.
+// It's queued before the change it's for, and the queue keeps them in order
+extern "C" void flash_directory_changing(void)
+{
+	uint32_t addr;
+
+	if (marked_not_current)
+		return;
+
+	if (directory_storage.CurrentAddr(&addr)) {
+		addr += offsetof(FlashDirectory, current);
+		while (flash_queue_write(reinterpret_cast<uint8_t *>(&not_current), addr, sizeof(not_current), FLASHQ_PRIO_NORMAL, 0, 0) == FLASHQ_NONE)
+			flash_queue_service();
+	}
+	marked_not_current = 1;
+}
+
+extern "C" void flash_directory_set_sphere(uint8_t wt_num, enum SphereTypes type, uint16_t pack_bytes)
+{
+	if (wt_num >= MAX_TOTAL_SPHERES) return;
+	directory.sphere_type[wt_num] = type;
+	directory.sphere_pack_bytes[wt_num] = pack_bytes;
+	changed = 1;
+}
+
+extern "C" void flash_directory_set_sphere_addr(uint8_t wt_num, uint32_t addr)
+{
+	if (wt_num >= MAX_TOTAL_SPHERES) return;
+	directory.sphere_addr[wt_num] = addr;
+	changed = 1;
+}
+
+extern "C" void flash_directory_set_sphere_log_sector(uint8_t sector, uint8_t state)
+{
+	if (sector >= MAX_WT_IN_FLASH) return;
+	directory.sphere_log_sector[sector] = state;
+	changed = 1;
+}
+
+extern "C" void flash_directory_set_sphere_log_seq(uint32_t seq)
+{
+	directory.sphere_log_seq = seq;
+	changed = 1;
+}
+
+extern "C" void flash_directory_set_preset(uint32_t preset_num, char version, uint32_t addr)
+{
+	if (preset_num >= MAX_PRESETS) return;
+	directory.preset_version[preset_num] = version;
+	directory.preset_addr[preset_num] = addr;
+	changed = 1;
+}
+
+extern "C" void flash_directory_set_preset_log_sector(uint8_t sector, uint8_t state)
+{
+	if (sector >= PRESET_NUM_SECTORS) return;
+	directory.preset_log_sector[sector] = state;
+	changed = 1;
+}
+
+extern "C" void flash_directory_set_preset_log_seq(uint32_t seq)
+{
+	directory.preset_log_seq = seq;
+	changed = 1;
+}
+
+extern "C" void update_flash_directory(void)
+{
+	if (!changed || !has_spheres || !has_presets || !flash_queue_is_idle())
+		return;
+
+	changed = 0;
+	directory.crc = directory.calc_crc();
+	directory.current = DIRECTORY_CURRENT;
+	if (directory_storage.Write(&directory))
+		marked_not_current = 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * isr_trace.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include <string.h>
+
+#include "isr_trace.h"
+#include "timekeeper.h"
+#include "globals.h"
+
+typedef struct IsrTraceSource {
+	const char	*name;
+	uint8_t		periodic;			// runs at a fixed rate, so swn_isr_report can tell how late it started
+} IsrTraceSource;
+
+static const IsrTraceSource SOURCES[NUM_ISR_TRACE_IDS] = {
+	[MONO_LED_TIM_number]					= {"TIM4 mono LEDs", 	1},
+	[OSC_TIM_number]						= {"TIM6 osc", 			1},
+	[ANALOG_CONDITIONING_TIM_number]		= {"TIM8 analog", 		1},
+	[PWM_OUTS_TIM_number]					= {"TIM9 PWM outs", 	1},
+	[LED_UPDATE_TIM_number]					= {"TIM10 LEDs", 		1},
+	[UI_CONDITIONING_UPDATE_TIM_number]		= {"TIM11 UI", 			1},
+	[WT_INTERP_TIM_number]					= {"TIM12 WT interp", 	1},
+	[LFO_TIM_number]						= {"TIM14 LFO", 		1},
+	[ISR_TRACE_SAI_RX_DMA]					= {"SAI RX DMA", 		1},
+	[ISR_TRACE_FLASH_SPI_DMA_RX]			= {"flash SPI DMA RX", 	0},
+	[ISR_TRACE_FLASH_SPI_DMA_TX]			= {"flash SPI DMA TX", 	0},
+	[ISR_TRACE_FLASH_SPI]					= {"flash SPI", 		0},
+	[ISR_TRACE_LED_I2C_DMA_TX]				= {"LED I2C DMA TX", 	0},
+	[ISR_TRACE_LED_I2C_EV]					= {"LED I2C EV", 		0},
+	[ISR_TRACE_LED_I2C_ER]					= {"LED I2C ER", 		0},
+	[ISR_TRACE_MIDI_UART]					= {"MIDI UART", 		0},
+};
+
+const char *isr_trace_name(uint8_t id)
+{
+	return (id < NUM_ISR_TRACE_IDS && SOURCES[id].name) ? SOURCES[id].name : "";
+}
+
+uint8_t isr_trace_is_periodic(uint8_t id)
+{
+	return (id < NUM_ISR_TRACE_IDS) ? SOURCES[id].periodic : 0;
+}
+
+#ifdef ISR_TRACE
+
+SRAM1DATA o_isr_trace isr_trace;
+
+void isr_trace_init(void)
+{
+	//Start the cycle counter
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	//SRAM1 is not cleared at startup
+	memset(&isr_trace, 0, sizeof(isr_trace));
+	isr_trace.hdr.magic = ISR_TRACE_MAGIC;
+	isr_trace.hdr.len = ISR_TRACE_LEN;
+	isr_trace.hdr.ticks_per_us = ISR_TRACE_TICKS_PER_US();
+	isr_trace.hdr.mask = 0xFFFFFFFF;
+	isr_trace_start(0);
+}
+
+// Empties the buffer and starts recording. If oneshot is set, it stops when the buffer is full
+void isr_trace_start(uint8_t oneshot)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	isr_trace.hdr.head = 0;
+	isr_trace.hdr.oneshot = oneshot;
+	isr_trace.hdr.running = 1;
+	__set_PRIMASK(primask);
+}
+
+void isr_trace_stop(void)
+{
+	isr_trace.hdr.running = 0;
+}
+
+// Called at the start and end of each traced handler.
+// Interrupts are masked while the event is written, so a handler that preempts this one can't take the same slot
+void isr_trace_event(uint8_t id, uint8_t exit)
+{
+	o_isr_trace_event *e;
+	uint32_t primask, now;
+
+	if (!(isr_trace.hdr.mask & (1UL << id))) return;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (exit && isr_trace.hdr.depth) isr_trace.hdr.depth--;
+
+	// Time is read even when not recording, so the host clock knows when a handler was running
+	now = ISR_TRACE_TIME(exit || isr_trace.hdr.depth);
+
+	if (isr_trace.hdr.running)
+	{
+		e = &isr_trace.event[isr_trace.hdr.head & (ISR_TRACE_LEN - 1)];
+		e->time = now;
+		e->id = id;
+		e->exit = exit;
+		e->depth = isr_trace.hdr.depth;
+
+		isr_trace.hdr.head++;
+		if (isr_trace.hdr.oneshot && isr_trace.hdr.head >= ISR_TRACE_LEN)
+			isr_trace.hdr.running = 0;
+	}
+
+	if (!exit) isr_trace.hdr.depth++;
+
+	__set_PRIMASK(primask);
+}
+
+#endif
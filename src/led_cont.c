@@ -41,6 +41,7 @@
 #include "preset_manager.h"
 #include "preset_manager_UI.h"
 #include "math_util.h"
+#include "math_approx.h"
 #include "drivers/mono_led_driver.h"
 #include "system_settings.h"
 #include "ui_modes.h"
@@ -96,8 +97,6 @@ extern const enum colorCodes qtz_scale_colors[NUM_QTZ_SCALES];
 extern const enum colorCodes fx_colors[NUM_FX];
 
 // TABLES
-extern const float 	exp_1voct_10_41V[4096];
-
 const uint16_t CH_COLOR_MAP[6][3] = {
 	{ 1		, 600	, 954	},
 	{ 1		, 12	, 954	},
@@ -404,7 +403,7 @@ void update_button_leds(void){
 			// mute
 			if (i < NUM_CHANNELS){
 				brightness = spherebuf.fx[i][(uint8_t)(calc_params.wt_pos[0][0])][(uint8_t)(calc_params.wt_pos[1][0])][(uint8_t)(calc_params.wt_pos[2][0])];
-				brightness = exp_1voct_10_41V[_SCALE_F2U16(brightness, 0.0, 1.0, 2700, 4095)] / 1370.0;
+				brightness = exp_1voct_led(_SCALE_F2U16(brightness, 0.0, 1.0, 2700, 4095)) / 1370.0;
 
 				set_rgb_color_brightness(&led_cont.button[i], fx_colors[i], brightness);
 			}
@@ -516,7 +515,7 @@ void update_mono_leds(void){
 				if (calc_params.adjusting_pan_state[i] == pan_CACHED_LEVEL && cached_param_flash_state())
 					level = level < 3000 ? 4095 : 0;
 
-				exp = exp_1voct_10_41V[level] * system_settings.global_brightness;
+				exp = exp_1voct_led(level) * system_settings.global_brightness;
 				if ((level > 50) && (exp > (slider_pwm*43))){
 					mono_led_on(i);
 				}
@@ -754,9 +753,9 @@ void display_wtpos_inring(void)
 		scaled_wt_pos[2] = _SCALE_F2U16(calc_params.wt_pos[2][i], 0, 2, 2048, 4095);
 
 		j = rotate_origin(i, NUM_CHANNELS);
-		led_cont.inring[j].c_red 		= 3 * exp_1voct_10_41V[scaled_wt_pos[0]];
-		led_cont.inring[j].c_green 		= 	  exp_1voct_10_41V[scaled_wt_pos[1]];
-		led_cont.inring[j].c_blue 		= 3 * exp_1voct_10_41V[scaled_wt_pos[2]];
+		led_cont.inring[j].c_red 		= 3 * exp_1voct_led(scaled_wt_pos[0]);
+		led_cont.inring[j].c_green 		= 	  exp_1voct_led(scaled_wt_pos[1]);
+		led_cont.inring[j].c_blue 		= 3 * exp_1voct_led(scaled_wt_pos[2]);
 		led_cont.inring[j].brightness 	= F_MAX_BRIGHTNESS;
 	}
 }
@@ -785,8 +784,8 @@ void get_wt_color(uint8_t wt_num, o_rgb_led *rgb)
 
 	if (wt_num < NUM_FACTORY_SPHERES) {
 		scaled_wt_num = _SCALE_U2U(wt_num, 0, NUM_FACTORY_SPHERES, 1024, 4095);
-		fade = exp_1voct_10_41V[scaled_wt_num] / 1370.0;
-		inv_fade = exp_1voct_10_41V[4095-scaled_wt_num] / 1370.0;
+		fade = exp_1voct_led(scaled_wt_num) / 1370.0;
+		inv_fade = exp_1voct_led(4095-scaled_wt_num) / 1370.0;
 
 		rgb->c_red 		= (2048.0 * inv_fade) + 150.0;
 		rgb->c_green  	= 0;
@@ -795,7 +794,7 @@ void get_wt_color(uint8_t wt_num, o_rgb_led *rgb)
 	else if (wt_num < MAX_TOTAL_SPHERES) {
 		scaled_wt_num = _SCALE_U2U((wt_num-NUM_FACTORY_SPHERES) % 18, 0, 17, 1024, 4095);
 		//fade = exp_1voct_10_41V[scaled_wt_num] / 1370.0;
-		inv_fade = exp_1voct_10_41V[4095-scaled_wt_num+1024] / 1370.0;
+		inv_fade = exp_1voct_led(4095-scaled_wt_num+1024) / 1370.0;
 		fade = 1.0-inv_fade;
 
 		if (wt_num < (NUM_FACTORY_SPHERES + 18*1)){
@@ -857,9 +856,9 @@ void display_wt_pos(void)
 		}
 
 		j = rotate_origin(i, NUM_LED_OUTRING);
-		led_cont.outring[j].c_red 		= 3 * exp_1voct_10_41V[scaled_wt_pos[0]];
-		led_cont.outring[j].c_green 	= 	  exp_1voct_10_41V[scaled_wt_pos[1]];
-		led_cont.outring[j].c_blue 		= 3 * exp_1voct_10_41V[scaled_wt_pos[2]];
+		led_cont.outring[j].c_red 		= 3 * exp_1voct_led(scaled_wt_pos[0]);
+		led_cont.outring[j].c_green 	= 	  exp_1voct_led(scaled_wt_pos[1]);
+		led_cont.outring[j].c_blue 		= 3 * exp_1voct_led(scaled_wt_pos[2]);
 		led_cont.outring[j].brightness 	= F_MAX_BRIGHTNESS;
 	}
 
@@ -956,7 +955,7 @@ void display_transpose(void)
 			set_rgb_color(&led_cont.inring[j], ledc_OFF);
 		} else {
 			num_wraps = (uint32_t)((float)(t_transpose - transpose_pos[i] - MIN_TRANSPOSE_WRAP) / (float)(MAX_TRANSPOSE_WRAP - MIN_TRANSPOSE_WRAP) * 4096.0);
-			set_rgb_color_by_array(&led_cont.inring[j], CH_COLOR_MAP[i], ((exp_1voct_10_41V[num_wraps] / 500.0) + 0.017) / F_MAX_BRIGHTNESS);
+			set_rgb_color_by_array(&led_cont.inring[j], CH_COLOR_MAP[i], ((exp_1voct_led(num_wraps) / 500.0) + 0.017) / F_MAX_BRIGHTNESS);
 		}
 
 		overlap[transpose_pos[i]][ overlap_num[transpose_pos[i]] ] = i;
@@ -1032,7 +1031,7 @@ void display_finetune (void)
 			saw = ((float)(tm % period)/(float)period) * 8191.0;
 			triangle = (saw>4095) ? (8191-saw) : saw;
 
-			led_cont.outring[detune_pos_i].brightness = (exp_1voct_10_41V[triangle] / 1367.0) + 0.03;
+			led_cont.outring[detune_pos_i].brightness = (exp_1voct_led(triangle) / 1367.0) + 0.03;
 		}
 	}
 }
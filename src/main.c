@@ -52,6 +52,9 @@
 #include "hardware_tests.h"
 #include "hal_handlers.h"
 #include "sphere_flash_io.h"
+#include "flash_directory.h"
+#include "preset_log.h"
+#include "sphere_log.h"
 #include "system_settings.h"
 #include "preset_manager.h"
 #include "preset_manager_UI.h"
@@ -69,7 +72,12 @@
 #include "analog_conditioning.h"
 #include "UI_conditioning.h"
 #include "drivers/flashram_spidma.h"
+#include "drivers/flashram_queue.h"
 #include "sel_bus.h"
+#include "waveshaper.h"
+#include "audio_profile.h"
+#include "pitch_trace.h"
+#include "isr_trace.h"
 
 
 
@@ -123,6 +131,10 @@ int main(void)
 
 	init_timekeeper();
 
+#ifdef ISR_TRACE
+	isr_trace_init();
+#endif
+
 	init_pwm_leds();
 
 	HAL_Delay(80);
@@ -141,10 +153,12 @@ int main(void)
 
 	//External FLASH
 	sFLASH_init();
+	init_flash_queue();
 
 
 	//Initialize param values (do not start updating them yet)
 	init_wt_osc();
+	init_waveshaper(&waveshaper);
 	init_params();
 	init_pitch_params();
 	init_quantz_scales();
@@ -165,10 +179,16 @@ int main(void)
 	init_sphere_flash();
 
 #ifdef ERASE_ALL_WAVETABLES
-	for (uint8_t ww=0; ww<12; ww++)
+	for (uint8_t ww=0; ww<MAX_WT_IN_FLASH; ww++)
 		sFLASH_erase_sector( sFLASH_get_sector_addr(WT_SECTOR_START+ww) );
+	sFLASH_erase_sector( sFLASH_get_sector_addr(FLASH_DIRECTORY_SECTOR) );
 #endif
 
+	init_flash_directory();
+	init_sphere_log();
+	read_all_spheretypes();
+	init_preset_log();
+
 #ifdef CLEAR_USER_SPHERES_FROM_FLASH
 	empty_all_user_spheres();
 #endif
@@ -197,7 +217,6 @@ int main(void)
 
 	restore_factory_spheres_to_extflash();
 
-	read_all_spheretypes();
 	update_number_of_user_spheres_filled();
 
 	// Init ADC
@@ -244,6 +263,14 @@ int main(void)
 
 	init_compressor(COMPRESS_SIGNED_24BIT, 0.90);
 
+#ifdef AUDIO_PROFILE
+	audio_profile_init();
+#endif
+
+#ifdef PITCH_TRACE
+	pitch_trace_init();
+#endif
+
 	ui_mode = PLAY;
 
 	//Start Codec
@@ -275,6 +302,10 @@ int main(void)
 
 		if (ui_mode == VOCT_CALIBRATE) process_voct_calibrate_mode();
 
+		update_sphere_log();
+		update_preset_log();
+		update_flash_directory();
+
 	} //end main loop
 
 	return(0);
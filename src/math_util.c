@@ -256,3 +256,17 @@ float _AVERAGE_EXCL_MINMAX_F(float *lpf_values, uint32_t num_elements)
 
 	return ((float)sum)/((float)num_elements);
 }
+
+// CRC-32 (as in zlib). Start with crc = 0, and pass the result back in to continue with more data
+uint32_t _CRC32(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+	uint8_t i;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *data++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	}
+	return ~crc;
+}
@@ -46,6 +46,13 @@
 #include "math_util.h"
 #include "gpio_pins.h"
 #include "wavetable_play_export.h"
+#include "wavetable_mipmap.h"
+#include "sphere_cache.h"
+#include "sphere_prefetch.h"
+#include "drivers/flashram_queue.h"
+#include "audio_profile.h"
+#include "pitch_trace.h"
+#include "params_graph.h"
 
 extern enum UI_Modes 	ui_mode;
 extern o_rotary 		rotary[NUM_ROTARIES];
@@ -55,34 +62,145 @@ extern o_systemSettings	system_settings;
 extern o_led_cont 		led_cont;
 
 extern o_recbuf 		recbuf;
+extern SRAM1DATA o_wt_mipmap wt_mipmap;
 o_wt_osc				wt_osc;
 uint8_t 				audio_in_gate;
 
 //Private:
 void update_sphere_wt(void);
 
+//
+// Block kernel
+//
+// Each stage runs over the whole block for one channel. The per-sample values are
+// kept in local arrays, and the loops have a fixed length, no branches and no stores
+// to wt_osc, so the compiler can unroll them (and vectorize them on the host).
+// The only per-block decisions are the mipmap levels and whether the channel is crossfading.
+//
+
+// Fills pos[] with the read head position for each sample
+static inline void osc_advance_head(uint8_t chan, float *pos)
+{
+	float 		p = wt_osc.wt_head_pos[chan];
+	float 		inc = wt_osc.wt_head_pos_inc[chan];
+	uint16_t 	i;
+
+	// Accumulate (rather than pos + inc*i) so the phase matches the per-sample version exactly
+	for (i = 0; i < MONO_BUFSZ; i++)
+	{
+		p += inc;
+		p -= (float)WT_TABLELEN * (float)(int32_t)(p * (1.f / (float)WT_TABLELEN));
+		pos[i] = p;
+	}
+
+	wt_osc.wt_head_pos[chan] = p;
+}
+
+// len is a power of 2, and pos[] is scaled from WT_TABLELEN to len
+static inline void osc_interp(const float *wt, uint16_t len, const float *pos, float *out)
+{
+	float 		scale = (float)len / (float)WT_TABLELEN;
+	float 		p, a, b;
+	uint16_t 	i, rh0;
+
+	for (i = 0; i < MONO_BUFSZ; i++)
+	{
+		p = pos[i] * scale;
+		rh0 = (uint16_t)p;
+		a = wt[rh0];
+		b = wt[(rh0 + 1) & (len-1)];
+		out[i] = a + (b - a) * (p - (float)rh0);
+	}
+}
+
+static inline void osc_blend(float *smpl, const float *other, float amt)
+{
+	uint16_t 	i;
+
+	for (i = 0; i < MONO_BUFSZ; i++)
+		smpl[i] += (other[i] - smpl[i]) * amt;
+}
+
+// Mixes in the previous buffer with a linear ramp, clamped at 0 so it's branch-free
+static inline void osc_xfade(float *smpl, const float *prev, float xfade)
+{
+	float 		x;
+	uint16_t 	i;
+
+	for (i = 0; i < MONO_BUFSZ; i++)
+	{
+		x = xfade - (float)XFADE_INC * (float)(i + 1);
+		x = (x > 0.f) ? x : 0.f;
+		smpl[i] += (prev[i] - smpl[i]) * x;
+	}
+}
+
+// Crossfades one level read from what the channel played before: the previous mc buffer for level 0,
+// and the previous band-limited set for the others. Each has its own crossfade, since they change at different times
+static inline void osc_xfade_level(uint8_t chan, uint8_t level, const float *pos, float *smpl, float *prev)
+{
+	float 		xfade = level ? wt_mipmap.xfade[chan] : wt_osc.wt_xfade[chan];
+
+	if (xfade > 0.f)
+	{
+		osc_interp(get_wt_mipmap_prev_table(chan, level), WT_MIP_LEN[level], pos, prev);
+		osc_xfade(smpl, prev, xfade);
+	}
+}
+
+static inline float osc_xfade_step(float xfade)
+{
+	xfade -= (float)XFADE_INC * (float)MONO_BUFSZ;
+	return (xfade > 0.f) ? xfade : 0.f;
+}
+
+static inline void osc_level_pan(const float *smpl, float level, float level_inc, float pan, float pan_inc, float *out_evens, float *out_odds)
+{
+	float 		s, p;
+	uint16_t 	i;
+
+	for (i = 0; i < MONO_BUFSZ; i++)
+	{
+		s = smpl[i] * (level + level_inc * (float)i);
+		p = pan + pan_inc * (float)i;
+		out_evens[i] += s * p;
+		out_odds[i]  += s - s * p;
+	}
+}
+
 void process_audio_block_codec(int32_t *src, int32_t *dst)
 {
 	int16_t 		i_sample;
 	uint8_t 		chan;
-	float 			smpl;
-	float			xfade0, xfade1;
 	int32_t			audio_in_sample, outL, outR;
 	float			output_buffer_evens[MONO_BUFSZ] = {0.f};
 	float			output_buffer_odds[MONO_BUFSZ] = {0.f};
 
+	float			pos[MONO_BUFSZ];
+	float			smpl[MONO_BUFSZ];
+	float			smpl_mip[MONO_BUFSZ];
+	float			smpl_prev[MONO_BUFSZ];
+
 	float 			oscout_status, audiomon_status;
 
 	static float 	prev_level[NUM_CHANNELS] = {0.f};
-	float 			interpolated_level, level_inc;
+	float 			level_start, level_inc;
 
 	static float 	prev_pan[NUM_CHANNELS] = {0.f};
-	float 			interpolated_pan, pan_inc;
+	float 			pan_start, pan_inc;
+
+	uint8_t 		mip_level, mip_next;
+	float 			mip_blend;
 
 	float 			audio_in_sum;
 	static uint8_t	audio_gate_ctr=0;
 
 	// DEBUG0_ON;
+	AUDIO_PROFILE_BLOCK_START(prof_t);
+
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+		update_pitch_fast(chan);
+	PITCH_TRACE_AUDIO_BLOCK();
 
 	//Todo: use a separate callback for WTTTONE mode, and another one for WTRECORDING/WTMONITORING/WTREC_WAIT
 	oscout_status = 	((ui_mode != WTRECORDING) && (ui_mode != WTMONITORING) && (ui_mode != WTREC_WAIT));
@@ -94,67 +212,72 @@ void process_audio_block_codec(int32_t *src, int32_t *dst)
 	{
 		read_level_and_pan(chan);
 		level_inc = (calc_params.level[chan] - prev_level[chan]) / MONO_BUFSZ;
-		interpolated_level = prev_level[chan];
+		level_start = prev_level[chan];
 		prev_level[chan] = calc_params.level[chan];
 		
 		pan_inc = (params.pan[chan] - prev_pan[chan]) / MONO_BUFSZ;
-		interpolated_pan = prev_pan[chan];
+		pan_start = prev_pan[chan];
 		prev_pan[chan] = params.pan[chan];
+		AUDIO_PROFILE_LAP(APS_PAN, prof_t);
+
+		osc_advance_head(chan, pos);
+		AUDIO_PROFILE_LAP(APS_HEAD_ADVANCE, prof_t);
 
-		for (i_sample = 0; i_sample < MONO_BUFSZ; i_sample++)
+		// Band-limited level for this pitch, blended with the next one up.
+		// Levels that aren't built yet fall back to the highest one that is.
+		mip_level = get_wt_mipmap_level(wt_osc.wt_head_pos_inc[chan], &mip_blend);
+		mip_next = mip_level + 1;
+		if (mip_level > wt_mipmap.top_level[chan])	mip_level = wt_mipmap.top_level[chan];
+		if (mip_next > wt_mipmap.top_level[chan])	mip_next = wt_mipmap.top_level[chan];
+
+		if (mip_blend <= 0.f)
+			mip_next = mip_level;
+
+		osc_interp(get_wt_mipmap_table(chan, mip_level), WT_MIP_LEN[mip_level], pos, smpl);
+		if (mip_next != mip_level)
+			osc_interp(get_wt_mipmap_table(chan, mip_next), WT_MIP_LEN[mip_next], pos, smpl_mip);
+		AUDIO_PROFILE_LAP(APS_INTERP, prof_t);
+
+		// Each level crossfades from the same level of the previous wavetable, so the fade is band-limited too
+		osc_xfade_level(chan, mip_level, pos, smpl, smpl_prev);
+		if (mip_next != mip_level)
 		{
-			wt_osc.wt_head_pos[chan] += wt_osc.wt_head_pos_inc[chan];
-			while (wt_osc.wt_head_pos[chan] >= (float)WT_TABLELEN)
-				wt_osc.wt_head_pos[chan] -= (float)(WT_TABLELEN);
-
-			wt_osc.rh0[chan] 	= (uint16_t)(wt_osc.wt_head_pos[chan]);
-			wt_osc.rh1[chan] 	= (wt_osc.rh0[chan] + 1) & (WT_TABLELEN-1);
-			wt_osc.rhd[chan] 	= wt_osc.wt_head_pos[chan] - (float)(wt_osc.rh0[chan]);
-			wt_osc.rhd_inv[chan] = 1.0 - wt_osc.rhd[chan];
-
-			xfade0 = (wt_osc.mc[wt_osc.buffer_sel[chan]][chan][wt_osc.rh0[chan]] * wt_osc.rhd_inv[chan]) + (wt_osc.mc[wt_osc.buffer_sel[chan]][chan][wt_osc.rh1[chan]] * wt_osc.rhd[chan]);
-
-			if (wt_osc.wt_xfade[chan] > 0)
-			{
-				wt_osc.wt_xfade[chan] -= XFADE_INC;
-				xfade1 = wt_osc.mc[1-wt_osc.buffer_sel[chan]][chan][wt_osc.rh0[chan]] * wt_osc.rhd_inv[chan] + wt_osc.mc[1-wt_osc.buffer_sel[chan]][chan][wt_osc.rh1[chan]] * wt_osc.rhd[chan];
-
-				smpl = ((xfade0 * (1.0 - wt_osc.wt_xfade[chan])) + (xfade1 * wt_osc.wt_xfade[chan])) * interpolated_level;
-			} else {
-				smpl = xfade0  * interpolated_level;
-			}
-			interpolated_level += level_inc;
-
-			output_buffer_evens[i_sample] += smpl * interpolated_pan;
-			output_buffer_odds[i_sample] += smpl * (1.f - interpolated_pan);
-			interpolated_pan += pan_inc;
-
-			if (chan==5)
-			{
-				outL=0;
-				outR=0;
-
-				audio_in_sample = convert_s24_to_s32(*src++);
-				UNUSED(*src++);  // ignore right channel input (not connected in hardware)
-
-				if (oscout_status) {
-					outL = (int32_t)(output_buffer_evens[i_sample] * system_settings.master_gain);
-					outR = (int32_t)(output_buffer_odds[i_sample] * system_settings.master_gain);
-				}
-				if (audiomon_status) {
-					outL += audio_in_sample;
-					outR += audio_in_sample;
-				}
-
-				*dst++ = compress(outL);
-				*dst++ = compress(outR);
-
-				if (audio_in_sample<0)
-					audio_in_sum += audio_in_sample;
-			}
+			osc_xfade_level(chan, mip_next, pos, smpl_mip, smpl_prev);
+			osc_blend(smpl, smpl_mip, mip_blend);
 		}
+		wt_osc.wt_xfade[chan] = osc_xfade_step(wt_osc.wt_xfade[chan]);
+		wt_mipmap.xfade[chan] = osc_xfade_step(wt_mipmap.xfade[chan]);
+		AUDIO_PROFILE_LAP(APS_XFADE, prof_t);
+
+		osc_level_pan(smpl, level_start, level_inc, pan_start, pan_inc, output_buffer_evens, output_buffer_odds);
+		AUDIO_PROFILE_LAP(APS_PAN, prof_t);
 	}
 
+	for (i_sample = 0; i_sample < MONO_BUFSZ; i_sample++)
+	{
+		outL=0;
+		outR=0;
+
+		audio_in_sample = convert_s24_to_s32(*src++);
+		UNUSED(*src++);  // ignore right channel input (not connected in hardware)
+
+		if (oscout_status) {
+			outL = (int32_t)(output_buffer_evens[i_sample] * system_settings.master_gain);
+			outR = (int32_t)(output_buffer_odds[i_sample] * system_settings.master_gain);
+		}
+		if (audiomon_status) {
+			outL += audio_in_sample;
+			outR += audio_in_sample;
+		}
+
+		*dst++ = compress(outL);
+		*dst++ = compress(outR);
+
+		if (audio_in_sample<0)
+			audio_in_sum += audio_in_sample;
+	}
+	AUDIO_PROFILE_LAP(APS_COMPRESS, prof_t);
+
 	//Requires: Min 4V trigger, min 0.25V/ms rise time (@5V = 20ms, @8V = 32ms), 20ms off time between pulses
 	if (audio_in_sum < AUDIO_GATE_THRESHOLD)
 	{
@@ -167,50 +290,27 @@ void process_audio_block_codec(int32_t *src, int32_t *dst)
 	else
 		audio_in_gate = 0;
 
+	AUDIO_PROFILE_BLOCK_END();
 	// DEBUG0_OFF;
 }
 
 
+// Only the params whose inputs changed are updated: see params_graph.h
 void update_oscillators(void){
-	int8_t chan;
-
-	check_reset_navigation();
-	update_wt();
-	read_all_keymodes();
-
-	combine_transpose_spread();
-	compute_transpositions();
-	update_transpose_cv();
-
-	read_ext_trigs();
-
-	for (chan = 0; chan < NUM_CHANNELS; chan++){
-
-		if ((ui_mode != SELECT_PARAMS) && (ui_mode != RGB_COLOR_ADJUST)) {
-
-			read_noteon(chan);
-
-			if(ui_mode == PLAY)
-			{
-				read_lfomode(chan);
-				read_lfoto_vca_vco (chan);
-			}
-		}
-		update_pitch (chan);
-
-		if (ui_mode == PLAY)
-			update_noise(chan);
-	}
-
+	update_param_graph();
 }
 
 void start_osc_updates(void){
+	init_param_graph();
 	start_timer_IRQ(OSC_TIM_number, &update_oscillators);
 }
 
 void update_sphere_wt(void){
-	render_full_sphere();
+	flash_queue_service();
+	update_sphere_render();
 	update_wt_interp();
+	flash_queue_service();
+	update_wt_mipmaps();
 }
 
 void start_osc_interp_updates(void){
@@ -226,4 +326,7 @@ void init_wt_osc(void) {
 		wt_osc.buffer_sel[i] 					= 0;
 		wt_osc.wt_interp_request[i]				= WT_INTERP_REQ_FORCE;
 	}
+	init_wt_mipmap();
+	init_sphere_cache();
+	init_sphere_prefetch();
 }
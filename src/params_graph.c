@@ -0,0 +1,327 @@
+/*
+ * params_graph.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include <string.h>
+
+#include "params_graph.h"
+#include "params_update.h"
+#include "params_lfo.h"
+#include "analog_conditioning.h"
+#include "ui_modes.h"
+
+extern o_params			params;
+extern o_calc_params	calc_params;
+extern o_lfos			lfos;
+extern enum UI_Modes	ui_mode;
+extern o_analog			analog[NUM_ANALOG_ELEMENTS];
+extern o_rotary			rotary[NUM_ROTARIES];
+extern o_button			button[NUM_BUTTONS];
+extern o_switch			hwSwitch[NUM_SWITCHES];
+
+SRAM1DATA o_param_graph param_graph;
+
+#define ALL_CHANNELS	((1 << NUM_CHANNELS) - 1)
+
+// Nodes that read the buttons, rotary presses, switches and key modes
+#define CONTROL_NODES	((1 << PN_NAV_RESET) | (1 << PN_KEYMODES) | (1 << PN_EXT_TRIGS) | (1 << PN_NOTEON) | (1 << PN_LFO_BUTTONS))
+
+typedef struct ParamNode {
+	const char	*name;
+	void		(*update)(uint8_t chan);
+	uint8_t		(*inputs_changed)(uint8_t chan);	// compares the node's inputs with the last tick's, and saves them
+	uint8_t		(*must_poll)(uint8_t chan);			// node has to run on every tick, for now
+	uint16_t	dependents;							// nodes that read what this node writes
+} ParamNode;
+
+//
+// Nodes
+//
+
+static void run_nav_reset(uint8_t chan)			{ check_reset_navigation(); }
+static void run_wt(uint8_t chan)				{ update_wt(); }
+static void run_keymodes(uint8_t chan)			{ read_all_keymodes(); }
+static void run_transpose_cv(uint8_t chan)		{ update_transpose_cv(); }
+static void run_ext_trigs(uint8_t chan)			{ read_ext_trigs(); }
+
+static void run_transpose(uint8_t chan)
+{
+	combine_transpose_spread();
+	compute_transpositions();
+}
+
+static void run_noteon(uint8_t chan)
+{
+	if ((ui_mode != SELECT_PARAMS) && (ui_mode != RGB_COLOR_ADJUST))
+		read_noteon(chan);
+}
+
+static void run_lfo_buttons(uint8_t chan)
+{
+	if (ui_mode == PLAY)
+	{
+		read_lfomode(chan);
+		read_lfoto_vca_vco(chan);
+	}
+}
+
+// A note change the quantizer locked out is taken on the tick after the lockout ends
+static void run_pitch(uint8_t chan)
+{
+	uint8_t lockout = params.qtz_note_changed[chan];
+
+	update_pitch(chan);
+
+	if (lockout)
+		flag_param_update(PN_PITCH, 1 << chan);
+}
+
+static void run_noise(uint8_t chan)
+{
+	if (ui_mode == PLAY)
+		update_noise(chan);
+}
+
+//
+// Inputs
+//
+
+static uint8_t transpose_inputs_changed(uint8_t chan)
+{
+	o_param_transpose_inputs in;
+
+	memset(&in, 0, sizeof(in));
+	memcpy(in.transpose_enc, params.transpose_enc, sizeof(in.transpose_enc));
+	memcpy(in.spread_enc, params.spread_enc, sizeof(in.spread_enc));
+	memcpy(in.osc_param_lock, params.osc_param_lock, sizeof(in.osc_param_lock));
+	in.spread_cv = params.spread_cv;
+
+	if (!memcmp(&in, &param_graph.transpose, sizeof(in)))
+		return 0;
+
+	param_graph.transpose = in;
+	return 1;
+}
+
+static uint8_t transpose_cv_changed(uint8_t chan)
+{
+	float cv = analog_jack_plugged(TRANSPOSE_CV) ? analog[TRANSPOSE_CV].lpf_val : 0.f;
+	uint8_t polarity = analog[TRANSPOSE_CV].polarity;
+
+	if (cv == param_graph.transpose_cv && polarity == param_graph.transpose_cv_polarity)
+		return 0;
+
+	param_graph.transpose_cv = cv;
+	param_graph.transpose_cv_polarity = polarity;
+	return 1;
+}
+
+static uint8_t ext_trigs_changed(uint8_t chan)
+{
+	uint8_t levels = read_ext_trig_levels();
+
+	if (levels == param_graph.trig_levels)
+		return 0;
+
+	param_graph.trig_levels = levels;
+	return 1;
+}
+
+static uint8_t pitch_inputs_changed(uint8_t chan)
+{
+	o_param_pitch_inputs in;
+
+	in.cv			= pitch_cv_input(chan);
+	in.tuning		= calc_params.tuning[chan];
+	in.oct			= params.oct[chan];
+	in.indiv_scale	= params.indiv_scale[chan];
+	in.key_sw		= params.key_sw[chan];
+	in.flags		= (params.note_on[chan] ? 1 : 0)
+					| (params.new_key[chan] ? 2 : 0)
+					| ((params.voct_switch_state[chan] == SW_VOCT) ? 4 : 0)
+					| (params.osc_param_lock[chan] ? 8 : 0)
+					| ((analog[A_VOCT + chan].polarity == AP_BIPOLAR) ? 16 : 0)
+					| (analog_jack_plugged(A_VOCT + chan) ? 32 : 0);
+
+	if (!memcmp(&in, &param_graph.pitch[chan], sizeof(in)))
+		return 0;
+
+	param_graph.pitch[chan] = in;
+	return 1;
+}
+
+// Reads the buttons, rotary presses, switches, jacks and key modes.
+// Returns 1 if any of them changed, or if a button or rotary is being held
+// (press times and key combos change while they're held)
+static uint8_t control_inputs_changed(void)
+{
+	o_param_control_inputs in;
+	uint8_t i, held = 0;
+
+	memset(&in, 0, sizeof(in));
+
+	for (i = 0; i < NUM_BUTTONS; i++) {
+		in.button[i] = button[i].hwswitch.pressed;
+		held |= in.button[i];
+	}
+	for (i = 0; i < NUM_ROTARIES; i++) {
+		in.rotary[i] = rotary[i].hwswitch.pressed;
+		held |= in.rotary[i];
+	}
+	for (i = 0; i < NUM_SWITCHES; i++)
+		in.hw_switch[i] = hwSwitch[i].pressed;
+
+	for (i = 0; i < NUM_ANALOG_ELEMENTS; i++)
+		if (analog[i].plug_sense_switch.pressed != RELEASED)
+			in.plugged |= (1 << i);
+
+	for (i = 0; i < NUM_CHANNELS; i++) {
+		in.key_sw[i] = params.key_sw[i];
+		in.lfo_audio_mode[i] = lfos.audio_mode[i];
+	}
+	in.ui_mode = ui_mode;
+
+	if (!memcmp(&in, &param_graph.controls, sizeof(in)))
+		return held;
+
+	param_graph.controls = in;
+	return 1;
+}
+
+static uint8_t always_poll(uint8_t chan)
+{
+	return 1;
+}
+
+// read_noteon() drives note_on and the LFO phase on every tick in the key modes other than Mute
+static uint8_t noteon_must_poll(uint8_t chan)
+{
+	return (params.key_sw[chan] != ksw_MUTE);
+}
+
+// Counting down the note-change lockout, or a new key is waiting to take the 1V/oct value
+static uint8_t pitch_must_poll(uint8_t chan)
+{
+	return (params.qtz_note_changed[chan] || params.new_key[chan]);
+}
+
+static const ParamNode PARAM_NODES[NUM_PARAM_NODES] = {
+	[PN_NAV_RESET]		= {"nav_reset",		run_nav_reset,		NULL,						NULL,				(1 << PN_WT)},
+	[PN_WT]				= {"wt",			run_wt,				NULL,						always_poll,		0},
+	[PN_KEYMODES]		= {"keymodes",		run_keymodes,		NULL,						NULL,				(1 << PN_NOTEON) | (1 << PN_LFO_BUTTONS) | (1 << PN_EXT_TRIGS)},
+	[PN_TRANSPOSE]		= {"transpose",		run_transpose,		transpose_inputs_changed,	NULL,				(1 << PN_PITCH)},
+	[PN_TRANSPOSE_CV]	= {"transpose_cv",	run_transpose_cv,	transpose_cv_changed,		NULL,				(1 << PN_PITCH)},
+	[PN_EXT_TRIGS]		= {"ext_trigs",		run_ext_trigs,		ext_trigs_changed,			NULL,				0},
+	[PN_NOTEON]			= {"noteon",		run_noteon,			NULL,						noteon_must_poll,	0},
+	[PN_LFO_BUTTONS]	= {"lfo_buttons",	run_lfo_buttons,	NULL,						NULL,				0},
+	[PN_PITCH]			= {"pitch",			run_pitch,			pitch_inputs_changed,		pitch_must_poll,	(1 << PN_NOISE)},
+	[PN_NOISE]			= {"noise",			run_noise,			NULL,						NULL,				0},
+};
+
+//
+// Graph
+//
+
+void init_param_graph(void)
+{
+	memset(&param_graph, 0, sizeof(param_graph));
+	param_graph.enabled = 1;
+	flag_all_param_updates();
+}
+
+void set_param_graph(uint8_t enabled)
+{
+	param_graph.enabled = enabled ? 1 : 0;
+	flag_all_param_updates();
+}
+
+const char *param_node_name(enum ParamNodes node)
+{
+	return (node < NUM_PARAM_NODES) ? PARAM_NODES[node].name : "";
+}
+
+void reset_param_graph_stats(void)
+{
+	memset(param_graph.node, 0, sizeof(param_graph.node));
+	param_graph.ticks = 0;
+}
+
+// Called from the main loop and from ISRs that can't preempt the OSC timer
+void flag_param_update(enum ParamNodes node, uint8_t chan_mask)
+{
+	param_graph.dirty[node] |= chan_mask;
+}
+
+void flag_all_param_updates(void)
+{
+	memset(param_graph.dirty, ALL_CHANNELS, sizeof(param_graph.dirty));
+}
+
+static void flag_nodes(uint16_t nodes, uint8_t chan_mask)
+{
+	uint8_t node;
+
+	for (node = 0; nodes; node++, nodes >>= 1)
+		if (nodes & 1)
+			param_graph.dirty[node] |= chan_mask;
+}
+
+static void run_node(enum ParamNodes node, uint8_t chan, uint8_t poll_all)
+{
+	const ParamNode *n = &PARAM_NODES[node];
+	uint8_t chan_mask = (node >= PN_FIRST_CHANNEL_NODE) ? (1 << chan) : ALL_CHANNELS;
+	uint8_t changed = n->inputs_changed ? n->inputs_changed(chan) : 0;
+
+	if (poll_all || changed || (param_graph.dirty[node] & chan_mask) || (n->must_poll && n->must_poll(chan)))
+	{
+		param_graph.dirty[node] &= ~chan_mask;
+		n->update(chan);
+		flag_nodes(n->dependents, chan_mask);
+		param_graph.node[node].runs++;
+	}
+	else
+		param_graph.node[node].skips++;
+}
+
+// Called by the OSC timer
+void update_param_graph(void)
+{
+	uint8_t poll_all = !param_graph.enabled || (ui_mode != PLAY);
+	uint8_t node, chan;
+
+	param_graph.ticks++;
+
+	if (control_inputs_changed())
+		flag_nodes(CONTROL_NODES, ALL_CHANNELS);
+
+	for (node = 0; node < PN_FIRST_CHANNEL_NODE; node++)
+		run_node(node, 0, poll_all);
+
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+		for (node = PN_FIRST_CHANNEL_NODE; node < NUM_PARAM_NODES; node++)
+			run_node(node, chan, poll_all);
+}
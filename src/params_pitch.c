@@ -30,15 +30,11 @@
 #include "analog_conditioning.h"
 #include "calibrate_voct.h"
 #include "math_util.h"
+#include "math_approx.h"
 #include <math.h>
 
-extern const float 	exp_1voct_10_41V[4096];
 extern o_analog analog[NUM_ANALOG_ELEMENTS];
 
-//Private:
-float interpolate_voct(float adc_val);
-
-
 float calc_expo_pitch(uint8_t chan, float adc_val)
 {
 
@@ -51,27 +47,11 @@ float calc_expo_pitch(uint8_t chan, float adc_val)
 	if (analog[A_VOCT + chan].polarity == AP_BIPOLAR)
 	{
 		if (adc_val >= 2048.0)
-			return interpolate_voct(adc_val - 2048.0);
+			return exp_1voct_pitch(adc_val - 2048.0);
 		else
-			return 1.0/interpolate_voct(2048.0 - adc_val);
+			return 1.0/exp_1voct_pitch(2048.0 - adc_val);
 	} else
 	{
-		return interpolate_voct(adc_val);
+		return exp_1voct_pitch(adc_val);
 	}
 }
-
-float interpolate_voct(float adc_val)
-{
-	uint16_t i_val;
-	float f_val;
-
-	i_val = (uint16_t)adc_val;
-	f_val = adc_val - (float)i_val;
-	
-	// if (i_val >= 4095) return 1024.0;
-	// return powf(2.0, adc_val / 409.5);
-
-	if (i_val >= 4095) return exp_1voct_10_41V[4095];
-
-	return _CROSSFADE(exp_1voct_10_41V[i_val], exp_1voct_10_41V[i_val+1], f_val);
-}
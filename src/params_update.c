@@ -31,7 +31,6 @@
 #include "params_changes.h"
 #include "led_cont.h"
 #include "gpio_pins.h"
-#include "exp_1voct_10_41V.h"
 #include "flash_params.h"
 #include "math.h"
 #include "sphere_flash_io.h"
@@ -64,7 +63,12 @@
 #include "wavetable_saveload_UI.h"
 #include "drivers/flashram_spidma.h"
 #include "wavetable_play_export.h"
+#include "wavetable_mipmap.h"
+#include "sphere_cache.h"
+#include "sphere_prefetch.h"
 #include "preset_manager_selbus.h"
+#include "pitch_trace.h"
+#include "params_graph.h"
 
 extern o_wt_osc wt_osc;
 extern enum UI_Modes ui_mode;
@@ -75,6 +79,7 @@ extern SystemCalibrations *system_calibrations;
 extern enum UI_Modes ui_mode;
 extern	o_systemSettings	system_settings;
 extern	o_analog	analog[NUM_ANALOG_ELEMENTS];
+extern	ads8634Sample	hires_adc_sample[NUM_HIRES_ADCS];
 extern	o_macro_states macro_states;
 extern	o_rotary	rotary[NUM_ROTARIES];
 extern	o_button	button[NUM_BUTTONS];
@@ -89,6 +94,8 @@ extern const uint8_t ALL_CHANNEL_MASK;
 extern	SRAM1DATA o_spherebuf spherebuf;
 extern const int16_t TTONE[WT_TABLELEN];
 
+SRAM1DATA o_wt_interp_cache wt_interp_cache;
+
 const int8_t		CHORD_LIST[NUM_CHORDS][NUM_CHANNELS] =
 {
 	// DEFAULT
@@ -181,13 +188,10 @@ const float DISP_PATTERN[NUM_DISPPAT][6][3] =	{
 	}
 };
 
-extern const float exp_1voct_10_41V[4096];
-
 o_params			params;
 o_calc_params		calc_params;
 
 uint32_t num_spheres_filled;
-o_waveform	waveform[NUM_CHANNELS][2][2][2];
 
 
 //Todo: replace with init_param_object(&params), plus a few other differences
@@ -351,6 +355,7 @@ void init_calc_params(void)
 	calc_params.already_handled_button[butm_LFOMODE_BUTTON] = 0;
 	calc_params.button_safe_release[0] = 0;
 	calc_params.button_safe_release[1] = 0;
+	flag_all_param_updates();
 }
 
 void set_pitch_params_to_ttone(void) {
@@ -503,25 +508,38 @@ void cache_uncache_pitch_params(enum CacheUncache cache_uncache)
 				break;
 		}
 	}
+	flag_all_param_updates();
 }
 
 static uint8_t new_key_armed[NUM_CHANNELS] = {0};
 
+// Gate levels of the jacks read_ext_trigs() uses: bit n for channel n, bit 6 for the Chord CV jack
+uint8_t read_ext_trig_levels(void)
+{
+	uint8_t levels;
+
+	levels  = ((params.key_sw[0]==ksw_KEYS_EXT_TRIG) ? audio_in_gate : (analog[WTSEL_CV].raw_val > 2048)) << 0;
+	levels |= (analog[DISP_CV].raw_val > 2048) << 1;
+	levels |= (analog[DEPTH_CV].raw_val > 2048) << 2;
+	levels |= (analog[DISPPAT_CV].raw_val > 2048) << 3;
+	levels |= (analog[LATITUDE_CV].raw_val > 2048) << 4;
+	levels |= (analog[WTSEL_SPREAD_CV].raw_val > 2048) << 5;
+	levels |= (analog[CHORD_CV].raw_val > 2048) << 6;
+
+	return levels;
+}
+
 void read_ext_trigs(void)
 {
 	uint8_t chan;
 	uint8_t chans_in_cvgate_mode=0;
 
 	static uint8_t last_trig_level[NUM_CHANNELS+1]={0};
-	uint8_t trig_level[NUM_CHANNELS+1]={0};
+	uint8_t trig_level[NUM_CHANNELS+1];
+	uint8_t trig_levels = read_ext_trig_levels();
 
-	trig_level[0] = (params.key_sw[0]==ksw_KEYS_EXT_TRIG) ? audio_in_gate : (analog[WTSEL_CV].raw_val > 2048);
-	trig_level[1] = analog[DISP_CV].raw_val > 2048;
-	trig_level[2] = analog[DEPTH_CV].raw_val > 2048;
-	trig_level[3] = analog[DISPPAT_CV].raw_val > 2048;
-	trig_level[4] = analog[LATITUDE_CV].raw_val > 2048;
-	trig_level[5] = analog[WTSEL_SPREAD_CV].raw_val > 2048;
-	trig_level[6] = analog[CHORD_CV].raw_val > 2048;
+	for (chan=0; chan<NUM_CHANNELS+1; chan++)
+		trig_level[chan] = (trig_levels >> chan) & 1;
 
 	for (chan=0; chan<NUM_CHANNELS; chan++)
 	{
@@ -1136,55 +1154,124 @@ void update_transpose_cv(void)
 	params.transpose_cv = calc_expo_pitch(TRANSPOSE_CV, analog[TRANSPOSE_CV].lpf_val);
 }
 
+// The fast path for 1V/oct: with it on, a new value from the ADC updates wt_head_pos_inc at the
+// start of the next audio block (see update_pitch_fast()), and update_pitch() uses the latest
+// value too, instead of the one from the last process_analog_conditioning()
+static uint8_t VOCT_FAST_PATH = 1;
+static uint32_t voct_fast_count[NUM_CHANNELS];
+
+void set_voct_fast_path(uint8_t enabled)
+{
+	VOCT_FAST_PATH = (enabled) ? 1 : 0;
+	flag_all_param_updates();
+}
+
+// Whether the channel's pitch follows the 1V/oct jack right now (otherwise it's held by the key)
+static inline uint8_t pitch_tracks_voct(uint8_t chan)
+{
+	return ( params.key_sw[chan]==ksw_MUTE || params.key_sw[chan]==ksw_KEYS_EXT_TRIG_SUSTAIN || params.key_sw[chan]==ksw_KEYS_EXT_TRIG || params.new_key[chan] || ((params.key_sw[chan] == ksw_NOTE) && !params.note_on[chan]) );
+}
+
+// Pitch multiplier from the 1V/oct and transpose jacks
+static inline float calc_voct(uint8_t chan, float ch_freq_adc)
+{
+	float voct;
+
+	if ((params.voct_switch_state[chan] == SW_VOCT) || (params.key_sw[chan] != ksw_MUTE))
+		voct = calc_expo_pitch(A_VOCT+chan, ch_freq_adc);
+	else
+		voct = 1.0;
+
+	if (!params.osc_param_lock[chan])
+		voct *= params.transpose_cv;
+
+	return voct;
+}
+
+// Unquantized frequency of the channel, with voct as its 1V/oct multiplier
+static inline float calc_ch_freq(uint8_t chan, float voct)
+{
+	float ch_freq;
+	int16_t oct_clamped;
+
+	ch_freq = F_BASE_FREQ  * calc_params.transposition[chan] * voct;
+	oct_clamped = _CLAMP_I16(params.oct[chan], MIN_OCT , MAX_OCT);
+	if (oct_clamped < 0)
+		ch_freq /= (float)(1 << (-oct_clamped));
+	else
+		ch_freq *= (1 << oct_clamped);
+
+	return ch_freq;
+}
+
+// The 1V/oct CV that update_pitch() uses. Returns 1 if it's the latest ADC value (the fast path)
+static inline uint8_t read_pitch_cv(uint8_t chan, float *ch_freq_adc)
+{
+	if (params.indiv_scale[chan] != sclm_NONE)
+		*ch_freq_adc = analog[A_VOCT + chan].bracketed_val;
+	else if (VOCT_FAST_PATH && analog_latest_hires_val(A_VOCT + chan, ch_freq_adc))
+		return 1;
+	else
+		*ch_freq_adc = analog[A_VOCT + chan].lpf_val;
+	return 0;
+}
+
+// The CV that update_pitch() would read for the channel, or 0 if the CV won't change the pitch
+// (jack unplugged, set to VCA, or the pitch is held by the key)
+float pitch_cv_input(uint8_t chan)
+{
+	float ch_freq_adc;
+
+	if (!pitch_tracks_voct(chan) || analog[A_VOCT + chan].plug_sense_switch.pressed == RELEASED)
+		return 0.f;
+	if ((params.voct_switch_state[chan] != SW_VOCT) && (params.key_sw[chan] == ksw_MUTE))
+		return 0.f;
+
+	read_pitch_cv(chan, &ch_freq_adc);
+	return ch_freq_adc;
+}
+
+// update_pitch_fast() runs in the audio IRQ, which can preempt this between reading the ADC
+// and setting the pitch. So the pitch is worked out first, and only set if the fast path
+// hasn't set it from a newer ADC sample in the meantime
 void update_pitch(uint8_t chan)
 {
-	float ch_freq, ch_freq_adc, qtz_ch_freq;
+	float voct, ch_freq, ch_freq_adc, qtz_ch_freq, qtz_freq, pitch;
+	uint32_t count = 0, primask;
 	uint8_t note;
 	int8_t oct;
-	int16_t oct_clamped;
+	uint8_t tracked = 0, latest = 0, stale;
 
-	if ( params.key_sw[chan]==ksw_MUTE || params.key_sw[chan]==ksw_KEYS_EXT_TRIG_SUSTAIN || params.key_sw[chan]==ksw_KEYS_EXT_TRIG || params.new_key[chan] || ((params.key_sw[chan] == ksw_NOTE) && !params.note_on[chan]) )
+	if (pitch_tracks_voct(chan))
 	{
 		// Calculate pitch multiplier from individual jack 1V/oct CV
-		if ((params.voct_switch_state[chan] == SW_VOCT) || (params.key_sw[chan] != ksw_MUTE))
-		{
-			if (params.indiv_scale[chan] != sclm_NONE)
-				ch_freq_adc = analog[A_VOCT + chan].bracketed_val;
-			else
-				ch_freq_adc = analog[A_VOCT + chan].lpf_val;
-
-			calc_params.voct[chan] = calc_expo_pitch(A_VOCT+chan, ch_freq_adc);
-		} else
-			calc_params.voct[chan] = 1.0;
+		count = hires_adc_sample[A_VOCT + chan].count;
+		latest = read_pitch_cv(chan, &ch_freq_adc);
 
-		if (!params.osc_param_lock[chan])
-			calc_params.voct[chan] *= params.transpose_cv;
+		voct = calc_voct(chan, ch_freq_adc);
 
 		if (params.new_key[chan]) params.new_key[chan] = 0;
+		tracked = 1;
 	}
-
-	ch_freq = F_BASE_FREQ  * calc_params.transposition[chan] * calc_params.voct[chan];
-	oct_clamped = _CLAMP_I16(params.oct[chan], MIN_OCT , MAX_OCT);
-	if (oct_clamped < 0)
-		ch_freq /= (float)(1 << (-oct_clamped));
 	else
-		ch_freq *= (1 << oct_clamped);
+		voct = calc_params.voct[chan];
+
+	ch_freq = calc_ch_freq(chan, voct);
+	qtz_freq = calc_params.qtz_freq[chan];
 
 	if (params.indiv_scale[chan]==sclm_NONE)
 	{
-		calc_params.qtz_freq[chan] = ch_freq;
+		qtz_freq = ch_freq;
 	}
 	else
 	{
-//Todo:
-//		qtz_ch_freq = quantize_to_scale(params.indiv_scale[chan], ch_freq, &note, &oct, prev_qtz_note[chan], prev_qtz_oct[chan]);
-		qtz_ch_freq = quantize_to_scale(params.indiv_scale[chan], ch_freq, &note, &oct);
+		qtz_ch_freq = quantize_to_scale(params.indiv_scale[chan], ch_freq, &note, &oct, calc_params.prev_qtz_note[chan], calc_params.prev_qtz_oct[chan]);
 
 		if (qtz_ch_freq!=ch_freq && params.qtz_note_changed[chan]==0 && (calc_params.prev_qtz_note[chan]!=note || calc_params.prev_qtz_oct[chan]!=oct))
 		{
 			calc_params.prev_qtz_note[chan] = note;
 			calc_params.prev_qtz_oct[chan] = oct;
-			calc_params.qtz_freq[chan] = qtz_ch_freq;
+			qtz_freq = qtz_ch_freq;
 			if ((params.key_sw[chan]==ksw_KEYS || params.key_sw[chan]==ksw_NOTE) && !params.note_on[chan])
 				params.qtz_note_changed[chan] = 1;
 		}
@@ -1197,9 +1284,56 @@ void update_pitch(uint8_t chan)
 	}
 
 	// Apply fine-tuning
+	pitch = _CLAMP_F(qtz_freq * calc_params.tuning[chan], F_MIN_FREQ, F_MAX_FREQ);
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	// The fast path used a sample newer than the one read above: its pitch is the current one
+	stale = latest && (int32_t)(voct_fast_count[chan] - count) > 0;
+	if (!stale)
+	{
+		calc_params.voct[chan] = voct;
+		calc_params.qtz_freq[chan] = qtz_freq;
+		calc_params.pitch[chan] = pitch;
+		update_wt_head_pos_inc(chan);
+		if (latest) voct_fast_count[chan] = count;
+	}
+
+	__set_PRIMASK(primask);
+
+	if (stale) return;
+
+	if (latest)			PITCH_TRACE_FAST_UPDATED(chan, &hires_adc_sample[A_VOCT + chan]);
+	else if (tracked)	PITCH_TRACE_PITCH_UPDATED(chan);
+}
+
+// Called at the start of each audio block. If the ADC has a new 1V/oct value, updates the pitch
+// with it, for channels that aren't quantized and are following the jack.
+// The quantizer and the key states are left to update_pitch()
+void update_pitch_fast(uint8_t chan)
+{
+	uint32_t count = hires_adc_sample[A_VOCT + chan].count;
+	float ch_freq_adc;
+
+	if (!VOCT_FAST_PATH || count == voct_fast_count[chan])
+		return;
+
+	if (params.indiv_scale[chan] != sclm_NONE || params.new_key[chan] || !pitch_tracks_voct(chan))
+		return;
+
+	if (!analog_latest_hires_val(A_VOCT + chan, &ch_freq_adc))
+		return;
+
+	voct_fast_count[chan] = count;
+
+	calc_params.voct[chan] = calc_voct(chan, ch_freq_adc);
+	calc_params.qtz_freq[chan] = calc_ch_freq(chan, calc_params.voct[chan]);
 	calc_params.pitch[chan] = _CLAMP_F(calc_params.qtz_freq[chan] * calc_params.tuning[chan], F_MIN_FREQ, F_MAX_FREQ);
 
 	update_wt_head_pos_inc(chan);
+
+	PITCH_TRACE_FAST_UPDATED(chan, &hires_adc_sample[A_VOCT + chan]);
 }
 
 void update_wt_head_pos_inc(uint8_t chan){
@@ -1892,7 +2026,6 @@ void read_browse_encoder(void)
 
 enum WTFlashLoadQueueStates{
 	WT_FLASH_NO_ACTION,
-	WT_FLASH_LOAD_0,
 	WT_FLASH_LOAD_1,
 	WT_FLASH_LOAD_2,
 	WT_FLASH_LOAD_3,
@@ -1938,9 +2071,6 @@ void update_wt_interp(void)
 		{
 			if (ui_mode == PLAY)
 			{
-				if (get_flash_state() != sFLASH_NOTBUSY)
-					continue;
-
 				if (state[chan]==WT_FLASH_NO_ACTION)
 				{
 					loadx[0][chan] = wt_osc.m0[0][chan];
@@ -1949,32 +2079,38 @@ void update_wt_interp(void)
 					loadx[1][chan] = wt_osc.m1[0][chan];
 					loady[1][chan] = wt_osc.m1[1][chan];
 					loadz[1][chan] = wt_osc.m1[2][chan];
-				}
 
-				state[chan]++;
+					sphere_cache_release_chan(chan);
+					state[chan] = WT_FLASH_LOAD_1;
+				}
 
-				if (state[chan] < WT_FLASH_INTERP) {
-					uint8_t s = state[chan]-1;
-					uint8_t sb0 = s&1;
-					uint8_t sb1 = (s&2)>>1;
-					uint8_t sb2 = (s&4)>>2;
-					load_extflash_wavetable(params.wt_bank[chan], &(waveform[chan][sb2][sb1][sb0]), loadx[sb2][chan], loady[sb1][chan], loadz[sb0][chan]);
+				// Take as many corners as we can from the cache (including ones other channels are using),
+				// and queue flash reads for the rest. If the flash queue is full, we continue on the next tick
+				while (state[chan] < WT_FLASH_INTERP) {
+					uint8_t c = state[chan] - WT_FLASH_LOAD_1;
+					uint8_t cx = loadx[c&1][chan];
+					uint8_t cy = loady[(c>>1)&1][chan];
+					uint8_t cz = loadz[(c>>2)&1][chan];
+
+					if (!sphere_cache_acquire(chan, c, params.wt_bank[chan], cx, cy, cz)
+						&& !sphere_cache_load(chan, c, params.wt_bank[chan], cx, cy, cz))
+						break;
+					state[chan]++;
 				}
-				else {
+
+				if ((state[chan] == WT_FLASH_INTERP) && !sphere_cache_chan_loading(chan))
+				{
 					old_x0[chan] = loadx[0][chan];
 					old_y0[chan] = loady[0][chan];
 					old_z0[chan] = loadz[0][chan];
 					old_bank[chan] = params.wt_bank[chan];
 
-					p_waveform[chan][0] = waveform[chan][0][0][0].wave;
-					p_waveform[chan][1] = waveform[chan][1][0][0].wave;
-					p_waveform[chan][2] = waveform[chan][0][1][0].wave;
-					p_waveform[chan][3] = waveform[chan][1][1][0].wave;
-					p_waveform[chan][4] = waveform[chan][0][0][1].wave;
-					p_waveform[chan][5] = waveform[chan][1][0][1].wave;
-					p_waveform[chan][6] = waveform[chan][0][1][1].wave;
-					p_waveform[chan][7] = waveform[chan][1][1][1].wave;
+					// corner c is at x = c&1, y = (c>>1)&1, z = (c>>2)&1
+					for (uint8_t c = 0; c < 8; c++)
+						p_waveform[chan][c] = sphere_cache_corner(chan, c);
+
 					state[chan] = WT_FLASH_NO_ACTION;
+					wt_interp_cache.valid[chan] = 0;
 					interp_wt(chan, p_waveform[chan]);
 				}
 			}
@@ -1991,6 +2127,7 @@ void update_wt_interp(void)
 				old_y0[chan] = y[0];
 				old_z0[chan] = z[0];
 
+				sphere_cache_release_chan(chan);
 				p_waveform[chan][0] =  spherebuf.data[x[0]][y[0]][z[0]].wave;
 				p_waveform[chan][1] =  spherebuf.data[x[1]][y[0]][z[0]].wave;
 				p_waveform[chan][2] =  spherebuf.data[x[0]][y[1]][z[0]].wave;
@@ -2000,45 +2137,92 @@ void update_wt_interp(void)
 				p_waveform[chan][6] =  spherebuf.data[x[0]][y[1]][z[1]].wave;
 				p_waveform[chan][7] =  spherebuf.data[x[1]][y[1]][z[1]].wave;
 				state[chan] = WT_FLASH_NO_ACTION;
+				wt_interp_cache.valid[chan] = 0;
 				interp_wt(chan, p_waveform[chan]);
 			}
 		}
 	}
+
+	// Loads for the current cells come first: only prefetch when no channel is waiting on flash
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+		if (state[chan] != WT_FLASH_NO_ACTION) break;
+
+	update_sphere_prefetch(chan == NUM_CHANNELS);
 }
 
 
+// A blend of int16 samples is always in range, so it only needs rounding
+static inline int16_t round_s16(float x){
+	return (int16_t)((x < 0.f) ? (x - 0.5f) : (x + 0.5f));
+}
+
+// Trilinear blend of the 8 corner waveforms, done in three stages:
+// x blends the corners into 4 edges, y blends the edges into 2 faces, z blends the faces into mc.
+// The edges and faces are cached, so a change to only m_frac[2] costs one blend per sample,
+// and a change to only m_frac[1] costs three.
 void interp_wt(uint8_t chan, int16_t *p_waveform[8]){
 
 	uint16_t  i = 0;
-	// float xfade0, xfade1, yfade0, yfade1;
+	float 	  e0, e1, e2, e3, f0, f1;
+	float 	  *out = wt_osc.mc[1 - wt_osc.buffer_sel[chan]][chan];
+	int16_t   (*edge)[WT_TABLELEN] = wt_interp_cache.edge[chan];
+	int16_t   (*face)[WT_TABLELEN] = wt_interp_cache.face[chan];
+	float 	  fx = wt_osc.m_frac[0][chan], fx_inv = wt_osc.m_frac_inv[0][chan];
+	float 	  fy = wt_osc.m_frac[1][chan], fy_inv = wt_osc.m_frac_inv[1][chan];
+	float 	  fz = wt_osc.m_frac[2][chan], fz_inv = wt_osc.m_frac_inv[2][chan];
 
 	if (ui_mode == WTTTONE) {
 		while (i < WT_TABLELEN){
-			wt_osc.mc[1 - wt_osc.buffer_sel[chan]][chan][i] = (float)(TTONE[i]);
+			out[i] = (float)(TTONE[i]);
 			i++;
 		}
 	}
 	else{
-		while (i < WT_TABLELEN){
-		//100us
-			wt_osc.mc[1 - wt_osc.buffer_sel[chan]][chan][i] =
-				(
-					( (float) ( *(p_waveform[0] + i))  * wt_osc.m_frac_inv[0][chan] + (float) ( *(p_waveform[1] + i))  * wt_osc.m_frac[0][chan] )  * wt_osc.m_frac_inv[1][chan] +
-					( (float) ( *(p_waveform[2] + i))  * wt_osc.m_frac_inv[0][chan] + (float) ( *(p_waveform[3] + i))  * wt_osc.m_frac[0][chan] )  * wt_osc.m_frac	[1][chan]
-				) * wt_osc.m_frac_inv[2][chan]
-				+
-				(
-					( (float) ( *(p_waveform[4] + i))  * wt_osc.m_frac_inv[0][chan] + (float) ( *(p_waveform[5] + i))   * wt_osc.m_frac[0][chan] )   * wt_osc.m_frac_inv[1][chan] +
-					( (float) ( *(p_waveform[6] + i))	* wt_osc.m_frac_inv[0][chan] + (float) ( *(p_waveform[7] + i))   * wt_osc.m_frac[0][chan] )   * wt_osc.m_frac	[1][chan]
-				) * wt_osc.m_frac[2][chan];
-
-			i++;
+		if (!wt_interp_cache.valid[chan] || (wt_interp_cache.frac[0][chan] != fx))
+		{
+			//100us
+			for (i = 0; i < WT_TABLELEN; i++) {
+				e0 = (float)(p_waveform[0][i]) * fx_inv + (float)(p_waveform[1][i]) * fx;
+				e1 = (float)(p_waveform[2][i]) * fx_inv + (float)(p_waveform[3][i]) * fx;
+				e2 = (float)(p_waveform[4][i]) * fx_inv + (float)(p_waveform[5][i]) * fx;
+				e3 = (float)(p_waveform[6][i]) * fx_inv + (float)(p_waveform[7][i]) * fx;
+				f0 = e0 * fy_inv + e1 * fy;
+				f1 = e2 * fy_inv + e3 * fy;
+				edge[0][i] = round_s16(e0);
+				edge[1][i] = round_s16(e1);
+				edge[2][i] = round_s16(e2);
+				edge[3][i] = round_s16(e3);
+				face[0][i] = round_s16(f0);
+				face[1][i] = round_s16(f1);
+				out[i] = f0 * fz_inv + f1 * fz;
+			}
+		}
+		else if (wt_interp_cache.frac[1][chan] != fy)
+		{
+			for (i = 0; i < WT_TABLELEN; i++) {
+				f0 = (float)(edge[0][i]) * fy_inv + (float)(edge[1][i]) * fy;
+				f1 = (float)(edge[2][i]) * fy_inv + (float)(edge[3][i]) * fy;
+				face[0][i] = round_s16(f0);
+				face[1][i] = round_s16(f1);
+				out[i] = f0 * fz_inv + f1 * fz;
+			}
+		}
+		else
+		{
+			for (i = 0; i < WT_TABLELEN; i++)
+				out[i] = (float)(face[0][i]) * fz_inv + (float)(face[1][i]) * fz;
 		}
+
+		wt_interp_cache.frac[0][chan] = fx;
+		wt_interp_cache.frac[1][chan] = fy;
+		wt_interp_cache.valid[chan] = 1;
 	}
 	wt_osc.buffer_sel[chan]		= 1 - wt_osc.buffer_sel[chan];
 	wt_osc.wt_xfade[chan]			= 1.0;
 	wt_osc.wt_interp_request[chan]	= WT_INTERP_REQ_NONE;
 
+	invalidate_wt_mipmap(chan);
+
 }
 
 void req_wt_interp_update (uint8_t chan){
@@ -2312,6 +2496,12 @@ void update_wt_disp(uint8_t clear_lpf){
 }
 
 
+// Browse position (encoder + CV), before wrapping to 0..27
+float get_wt_browse_pos(uint8_t chan){
+	float browse_cv = params.wt_pos_lock[chan] ? 0: params.wt_browse_step_pos_cv;
+	return params.wt_browse_step_pos_enc[chan] + browse_cv;
+}
+
 // Set the wt_pos[dim][chan], properly wrapping it, and requesting an update if needed
 // Given:
 // params.dispersion_enc: float 0..1
@@ -2333,7 +2523,7 @@ void calc_wt_pos(uint8_t chan){
 	float	total_disp, total_browse;
 	uint8_t disp_pattern;
 	float	new_wt_pos = 10;
-	float	disp_cv, disppat_cv, nav_cv, browse_cv;
+	float	disp_cv, disppat_cv, nav_cv;
 	uint8_t snap_to_int=0;
 
 	if (UIMODE_IS_WT_RECORDING_EDITING(ui_mode) && !switch_pressed(FINE_BUTTON))
@@ -2345,8 +2535,7 @@ void calc_wt_pos(uint8_t chan){
 	nav_enc[2]	= params.wt_nav_enc[2][chan];
 
 	// BROWSE
-	browse_cv = params.wt_pos_lock[chan] ? 0: params.wt_browse_step_pos_cv;
-	total_browse = params.wt_browse_step_pos_enc[chan] + browse_cv;
+	total_browse = get_wt_browse_pos(chan);
 	get_browse_nav(total_browse, &browse_nav[0], &browse_nav[1], &browse_nav[2]);
 
 	// DISPERSION
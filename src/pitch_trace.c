@@ -0,0 +1,166 @@
+/*
+ * pitch_trace.c
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "pitch_trace.h"
+
+o_pitch_trace pitch_trace;
+
+static const char *STAGE_NAMES[NUM_PITCH_TRACE_STAGES] = {
+	"adc -> conditioning",
+	"conditioning -> pitch",
+	"pitch -> audio",
+	"adc -> audio",
+};
+
+const char *pitch_trace_stage_name(enum PitchTraceStages stage)
+{
+	return (stage < NUM_PITCH_TRACE_STAGES) ? STAGE_NAMES[stage] : "";
+}
+
+void pitch_trace_init(void)
+{
+	//Start the cycle counter
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	memset(&pitch_trace, 0, sizeof(pitch_trace));
+	pitch_trace_reset();
+}
+
+// Clears the stats. Samples that are on their way keep being traced
+void pitch_trace_reset(void)
+{
+	uint8_t i;
+
+	memset(pitch_trace.stage, 0, sizeof(pitch_trace.stage));
+	for (i = 0; i < NUM_PITCH_TRACE_STAGES; i++)
+		pitch_trace.stage[i].best = 0xFFFFFFFF;
+	pitch_trace.fast_updates = 0;
+}
+
+static void add_latency(enum PitchTraceStages stage, uint32_t ticks)
+{
+	o_pitch_trace_stage *s = &pitch_trace.stage[stage];
+
+	if (ticks > s->worst) s->worst = ticks;
+	if (ticks < s->best) s->best = ticks;
+	s->total += ticks;
+	s->total_sq += (uint64_t)ticks * ticks;
+	s->num++;
+}
+
+// Called by process_analog_conditioning() for each 1V/oct jack
+void pitch_trace_conditioned(uint8_t chan, ads8634Sample *s)
+{
+	o_pitch_trace_chan *c = &pitch_trace.chan[chan];
+	uint32_t now = PITCH_TRACE_TIME();
+	uint32_t count = s->count;
+
+	if (count == c->cond_count) return;
+
+	c->cond_count = count;
+	c->cond_src = s->time;
+	c->cond_time = now;
+	add_latency(PTS_ADC_TO_COND, now - c->cond_src);
+}
+
+// Called by update_pitch() when it set wt_head_pos_inc from the conditioned CV
+void pitch_trace_pitch_updated(uint8_t chan)
+{
+	o_pitch_trace_chan *c = &pitch_trace.chan[chan];
+	uint32_t now = PITCH_TRACE_TIME();
+
+	if (c->cond_count == c->pitch_count) return;
+
+	c->pitch_count = c->cond_count;
+	c->pitch_src = c->cond_src;
+	c->pitch_time = now;
+	c->pending = 1;
+	add_latency(PTS_COND_TO_PITCH, now - c->cond_time);
+}
+
+// Called when wt_head_pos_inc was set straight from the ADC sample, skipping the conditioning stage
+void pitch_trace_fast_updated(uint8_t chan, ads8634Sample *s)
+{
+	o_pitch_trace_chan *c = &pitch_trace.chan[chan];
+	uint32_t count = s->count;
+
+	if (count == c->pitch_count) return;
+
+	c->pitch_count = count;
+	c->pitch_src = s->time;
+	c->pitch_time = PITCH_TRACE_TIME();
+	c->pending = 1;
+	pitch_trace.fast_updates++;
+}
+
+// Called at the start of the audio callback, after the fast path
+void pitch_trace_audio_block(void)
+{
+	o_pitch_trace_chan *c;
+	uint32_t now = PITCH_TRACE_TIME();
+	uint8_t chan;
+
+	for (chan = 0; chan < NUM_CHANNELS; chan++)
+	{
+		c = &pitch_trace.chan[chan];
+		if (!c->pending) continue;
+
+		add_latency(PTS_PITCH_TO_AUDIO, now - c->pitch_time);
+		add_latency(PTS_TOTAL, now - c->pitch_src);
+		c->pending = 0;
+	}
+}
+
+void pitch_trace_get_summary(enum PitchTraceStages stage, o_pitch_trace_summary *summary)
+{
+	o_pitch_trace_stage *s = &pitch_trace.stage[stage];
+	float us_per_tick = 1.f / PITCH_TRACE_TICKS_PER_US();
+	double n, mean, var;
+
+	if (stage >= NUM_PITCH_TRACE_STAGES || !s->num) {
+		memset(summary, 0, sizeof(o_pitch_trace_summary));
+		return;
+	}
+
+	//double: the sums are too large for float precision
+	n = (double)s->num;
+	mean = (double)s->total / n;
+	var = (double)s->total_sq / n - mean * mean;
+	if (var < 0.0) var = 0.0;
+
+	summary->mean_us = (float)mean * us_per_tick;
+	summary->best_us = (float)s->best * us_per_tick;
+	summary->worst_us = (float)s->worst * us_per_tick;
+	summary->jitter_us = (float)sqrt(var) * us_per_tick;
+	summary->num = s->num;
+}
@@ -0,0 +1,592 @@
+/*
+ * preset_log.c - Presets saved as an append-only log in the preset sectors
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "preset_log.h"
+#include "preset_manager.h"
+#include "flash_directory.h"
+#include "drivers/flashram_queue.h"
+#include "math_util.h"
+#include "globals.h"
+
+#define PRESET_SIZE 		(PRESET_LOG_RECORD_SIZE - PRESET_LOG_HEADER_SIZE)
+#define SLOTS 				PRESET_LOG_SLOTS_PER_SECTOR
+
+// Slots that overlap the presets of an old-layout sector
+#define LEGACY_FIRST_SLOT 	((PRESET_SIZE + PRESET_LOG_SLOT_SIZE - 1) / PRESET_LOG_SLOT_SIZE)
+#define LEGACY_MID_FIRST 	((PRESET_LOG_SECTOR_SIZE / 2) / PRESET_LOG_SLOT_SIZE)
+#define LEGACY_MID_LAST 	((PRESET_LOG_SECTOR_SIZE / 2 + PRESET_SIZE - 1) / PRESET_LOG_SLOT_SIZE)
+
+static SRAM1DATA o_preset_log plog;
+static SRAM1DATA uint8_t gc_buf[PRESET_LOG_RECORD_SIZE];
+
+// Signatures waiting to be written last
+static char store_sig[4];
+static char gc_sig[4];
+static uint32_t zero_sig = 0;
+
+static volatile uint8_t erase_done;
+
+
+static uint32_t sector_addr(uint8_t s)
+{
+	return sFLASH_get_sector_addr(PRESET_SECTOR_START + s);
+}
+
+static uint8_t sector_of(uint32_t addr)
+{
+	return (addr - sector_addr(0)) / PRESET_LOG_SECTOR_SIZE;
+}
+
+static uint8_t slots_used(uint8_t s)
+{
+	return plog.sector[s] & ~PRESET_LOG_LEGACY;
+}
+
+static uint8_t slot_usable(uint8_t s, uint8_t slot)
+{
+	if (!(plog.sector[s] & PRESET_LOG_LEGACY))
+		return 1;
+
+	return slot >= LEGACY_FIRST_SLOT && (slot < LEGACY_MID_FIRST || slot > LEGACY_MID_LAST);
+}
+
+static uint8_t sector_free_slots(uint8_t s)
+{
+	uint8_t slot, n = 0;
+
+	if (s == plog.erasing)
+		return 0;
+
+	for (slot = slots_used(s); slot < SLOTS; slot++)
+		if (slot_usable(s, slot)) n++;
+
+	return n;
+}
+
+// Presets in the old layout have no header
+static uint8_t is_legacy_preset(uint32_t addr)
+{
+	return (addr - sector_addr(sector_of(addr))) % PRESET_LOG_SLOT_SIZE != PRESET_LOG_HEADER_SIZE;
+}
+
+// rec is a whole record, header and preset
+static uint32_t record_crc(const uint8_t *rec)
+{
+	return _CRC32(0, rec + PRESET_LOG_HEADER_SIZE + 4, PRESET_SIZE - 4);
+}
+
+static void set_sector(uint8_t s, uint8_t state)
+{
+	plog.sector[s] = state;
+	flash_directory_set_preset_log_sector(s, state);
+}
+
+static void set_preset(uint32_t preset_num, char version, uint32_t addr)
+{
+	if (plog.addr[preset_num])
+		plog.live[sector_of(plog.addr[preset_num])]--;
+	if (addr)
+		plog.live[sector_of(addr)]++;
+
+	plog.addr[preset_num] = addr;
+	plog.version[preset_num] = addr ? version : 0;
+	flash_directory_set_preset(preset_num, plog.version[preset_num], addr);
+}
+
+static uint8_t queue_write(uint8_t *buf, uint32_t addr, uint32_t num_bytes, enum FlashQueuePriorities prio)
+{
+	uint8_t req;
+
+	while ((req = flash_queue_write(buf, addr, num_bytes, prio, 0, 0)) == FLASHQ_NONE)
+		flash_queue_service();
+
+	return req;
+}
+
+// Next free slot. When the head sector is full, it moves to the next erased sector,
+// or else any sector with free slots (around the presets of an old-layout sector).
+// Returns 0 if there's none
+static uint32_t alloc_slot(void)
+{
+	uint8_t s, i, slot;
+	uint8_t start = (plog.head == PRESET_LOG_NONE) ? (PRESET_NUM_SECTORS - 1) : plog.head;
+
+	if (plog.head == PRESET_LOG_NONE || !sector_free_slots(plog.head)) {
+		plog.head = PRESET_LOG_NONE;
+
+		for (i = 1; i <= PRESET_NUM_SECTORS; i++) {
+			s = (start + i) % PRESET_NUM_SECTORS;
+			if (!plog.sector[s] && s != plog.erasing) {
+				plog.head = s;
+				break;
+			}
+		}
+		for (s = 0; s < PRESET_NUM_SECTORS && plog.head == PRESET_LOG_NONE; s++) {
+			if (sector_free_slots(s))
+				plog.head = s;
+		}
+		if (plog.head == PRESET_LOG_NONE)
+			return 0;
+	}
+
+	s = plog.head;
+	slot = slots_used(s);
+	while (!slot_usable(s, slot))
+		slot++;
+
+	set_sector(s, (plog.sector[s] & PRESET_LOG_LEGACY) | (slot + 1));
+	plog.free_slots--;
+
+	return sector_addr(s) + slot * PRESET_LOG_SLOT_SIZE;
+}
+
+// Queues writing the record into a new slot, and zeroing the old copy's signature
+static uint32_t write_record(uint8_t preset_num, uint8_t *rec, char *sig, enum FlashQueuePriorities prio)
+{
+	o_preset_log_header h;
+	uint32_t old_addr = plog.addr[preset_num];
+	uint32_t addr = alloc_slot();
+
+	if (!addr)
+		return 0;
+
+	h.sig[0] = 'P';
+	h.sig[1] = 'L';
+	h.preset_num = preset_num;
+	h.reserved = 0xFF;
+	h.seq = plog.next_seq++;
+	h.crc = record_crc(rec);
+	memcpy(rec, &h, PRESET_LOG_HEADER_SIZE);
+	flash_directory_set_preset_log_seq(plog.next_seq);
+
+	memcpy(sig, rec + PRESET_LOG_HEADER_SIZE, 4);
+	memset(rec + PRESET_LOG_HEADER_SIZE, 0xFF, 4);
+
+	flash_directory_changing();
+	queue_write(rec, addr, PRESET_LOG_RECORD_SIZE, prio);
+	queue_write((uint8_t *)sig, addr + PRESET_LOG_HEADER_SIZE, 4, prio);
+	if (old_addr)
+		queue_write((uint8_t *)&zero_sig, old_addr, 4, prio);
+
+	set_preset(preset_num, sig[2], addr + PRESET_LOG_HEADER_SIZE);
+	return addr + PRESET_LOG_HEADER_SIZE;
+}
+
+
+//
+// Garbage collection: one step at a time, from the main loop
+//
+
+static void sector_erased(uint32_t s)
+{
+	erase_done = 1;
+}
+
+static void start_erase(uint8_t s)
+{
+	plog.free_slots -= sector_free_slots(s);
+	erase_done = 0;
+	plog.erasing = s;
+
+	flash_directory_changing();
+	while (flash_queue_erase_sector(sector_addr(s), FLASHQ_PRIO_BACKGROUND, sector_erased, s) == FLASHQ_NONE)
+		flash_queue_service();
+}
+
+static void finish_erase(void)
+{
+	uint8_t s = plog.erasing;
+
+	plog.erasing = PRESET_LOG_NONE;
+	set_sector(s, 0);
+	plog.free_slots += SLOTS;
+}
+
+// A sector that's been written to, with no presets left
+static uint8_t find_dead_sector(void)
+{
+	uint8_t s;
+
+	for (s = 0; s < PRESET_NUM_SECTORS; s++) {
+		if (s != plog.head && plog.sector[s] && !plog.live[s])
+			return s;
+	}
+	return PRESET_LOG_NONE;
+}
+
+static void relocation_read(uint32_t ctx)
+{
+	plog.gc_state = PLOG_GC_READ_DONE;
+}
+
+// Starts moving a preset out of the full sector with the fewest presets, so it can be erased
+static uint8_t start_relocation(void)
+{
+	uint8_t s, victim = PRESET_LOG_NONE;
+	uint32_t i;
+
+	if (!plog.free_slots)
+		return 0;
+
+	for (s = 0; s < PRESET_NUM_SECTORS; s++) {
+		if (s == plog.head || !plog.live[s] || sector_free_slots(s))
+			continue;
+		if (victim == PRESET_LOG_NONE || plog.live[s] < plog.live[victim])
+			victim = s;
+	}
+	if (victim == PRESET_LOG_NONE)
+		return 0;
+
+	for (i = 0; i < MAX_PRESETS; i++) {
+		if (plog.addr[i] && sector_of(plog.addr[i]) == victim)
+			break;
+	}
+
+	plog.gc_preset = i;
+	plog.gc_from = plog.addr[i];
+	plog.gc_state = PLOG_GC_READING;
+
+	//With its header, so its crc can be checked
+	if (is_legacy_preset(plog.gc_from)) {
+		while (flash_queue_read(gc_buf + PRESET_LOG_HEADER_SIZE, plog.gc_from, PRESET_SIZE, FLASHQ_PRIO_BACKGROUND, relocation_read, 0) == FLASHQ_NONE)
+			flash_queue_service();
+	} else {
+		while (flash_queue_read(gc_buf, plog.gc_from - PRESET_LOG_HEADER_SIZE, PRESET_LOG_RECORD_SIZE, FLASHQ_PRIO_BACKGROUND, relocation_read, 0) == FLASHQ_NONE)
+			flash_queue_service();
+	}
+
+	return 1;
+}
+
+// gc_buf has the whole record
+static uint8_t gc_buf_crc_ok(void)
+{
+	o_preset_log_header h;
+
+	memcpy(&h, gc_buf, PRESET_LOG_HEADER_SIZE);
+	return h.crc == record_crc(gc_buf);
+}
+
+static void drop_preset(uint8_t preset_num)
+{
+	flash_directory_changing();
+	queue_write((uint8_t *)&zero_sig, plog.addr[preset_num], 4, FLASHQ_PRIO_BACKGROUND);
+	set_preset(preset_num, 0, 0);
+	forget_preset(preset_num);
+}
+
+static void finish_relocation(void)
+{
+	uint8_t preset_num = plog.gc_preset;
+
+	plog.gc_state = PLOG_GC_IDLE;
+
+	//Saved or cleared since it was read
+	if (plog.addr[preset_num] != plog.gc_from)
+		return;
+
+	if (!is_preset_signature((char *)gc_buf + PRESET_LOG_HEADER_SIZE)) {
+		drop_preset(preset_num);
+		return;
+	}
+
+	//Don't give a corrupted preset a new crc
+	if (!is_legacy_preset(plog.gc_from) && !gc_buf_crc_ok()) {
+		drop_preset(preset_num);
+		return;
+	}
+
+	write_record(preset_num, gc_buf, gc_sig, FLASHQ_PRIO_BACKGROUND);
+}
+
+static void verify_read(uint32_t ctx)
+{
+	plog.gc_state = PLOG_GC_VERIFY_DONE;
+}
+
+// Starts reading the next preset to check its crc. Presets in the old layout have none
+static uint8_t start_verify(void)
+{
+	uint8_t i;
+
+	while (plog.verify_next < MAX_PRESETS) {
+		i = plog.verify_next++;
+		if (!plog.addr[i] || is_legacy_preset(plog.addr[i]))
+			continue;
+
+		plog.gc_preset = i;
+		plog.gc_from = plog.addr[i];
+		plog.gc_state = PLOG_GC_VERIFYING;
+
+		while (flash_queue_read(gc_buf, plog.gc_from - PRESET_LOG_HEADER_SIZE, PRESET_LOG_RECORD_SIZE, FLASHQ_PRIO_BACKGROUND, verify_read, 0) == FLASHQ_NONE)
+			flash_queue_service();
+		return 1;
+	}
+	return 0;
+}
+
+static void finish_verify(void)
+{
+	uint8_t preset_num = plog.gc_preset;
+
+	plog.gc_state = PLOG_GC_IDLE;
+
+	//Saved or cleared since it was read
+	if (plog.addr[preset_num] != plog.gc_from)
+		return;
+
+	if (!gc_buf_crc_ok())
+		drop_preset(preset_num);
+}
+
+// Returns 1 if there was something to do
+static uint8_t gc_step(uint16_t compact_below)
+{
+	uint8_t s;
+
+	if (plog.erasing != PRESET_LOG_NONE) {
+		if (erase_done)
+			finish_erase();
+		return 1;
+	}
+
+	if (plog.gc_state == PLOG_GC_READING || plog.gc_state == PLOG_GC_VERIFYING)
+		return 1;
+
+	if (plog.gc_state == PLOG_GC_READ_DONE) {
+		finish_relocation();
+		return 1;
+	}
+
+	if (plog.gc_state == PLOG_GC_VERIFY_DONE) {
+		finish_verify();
+		return 1;
+	}
+
+	s = find_dead_sector();
+	if (s != PRESET_LOG_NONE) {
+		start_erase(s);
+		return 1;
+	}
+
+	if (plog.free_slots < compact_below)
+		return start_relocation();
+
+	return 0;
+}
+
+// The crcs are checked when there's nothing else to do, and nothing else is queued
+void update_preset_log(void)
+{
+	if (!gc_step(PRESET_LOG_COMPACT_SLOTS) && flash_queue_is_idle())
+		start_verify();
+}
+
+// update_preset_log() normally keeps slots free. If it hasn't had time to, this does it now
+static void make_room(void)
+{
+	while (plog.free_slots <= PRESET_LOG_RESERVE_SLOTS && gc_step(0xFFFF))
+		flash_queue_wait_all();
+}
+
+
+//
+// Saving and clearing
+//
+
+uint32_t preset_log_store(uint32_t preset_num, uint8_t *rec)
+{
+	if (preset_num >= MAX_PRESETS)
+		return 0;
+
+	if (plog.free_slots <= PRESET_LOG_RESERVE_SLOTS)
+		make_room();
+
+	return write_record(preset_num, rec, store_sig, FLASHQ_PRIO_NORMAL);
+}
+
+uint8_t preset_log_clear(uint32_t preset_num)
+{
+	uint32_t addr;
+
+	if (preset_num >= MAX_PRESETS || !plog.addr[preset_num])
+		return FLASHQ_NONE;
+
+	addr = plog.addr[preset_num];
+	flash_directory_changing();
+	set_preset(preset_num, 0, 0);
+
+	return queue_write((uint8_t *)&zero_sig, addr, 4, FLASHQ_PRIO_NORMAL);
+}
+
+uint32_t preset_log_addr(uint32_t preset_num)
+{
+	if (preset_num >= MAX_PRESETS) return 0;
+	return plog.addr[preset_num];
+}
+
+char preset_log_version(uint32_t preset_num)
+{
+	if (preset_num >= MAX_PRESETS) return 0;
+	return plog.version[preset_num];
+}
+
+
+//
+// Finding the presets at boot
+//
+
+static uint32_t record_seq(uint32_t addr)
+{
+	o_preset_log_header h;
+
+	//Presets in the old layout have no header, and are older than any in the log
+	if (is_legacy_preset(addr))
+		return 0;
+
+	flash_queue_read_wait((uint8_t *)&h, addr - PRESET_LOG_HEADER_SIZE, PRESET_LOG_HEADER_SIZE);
+	return h.seq;
+}
+
+static void scan_found(uint8_t preset_num, uint32_t addr, char version, uint32_t seq)
+{
+	uint32_t old_addr = plog.addr[preset_num];
+
+	//The power went off before the old copy was zeroed
+	if (old_addr) {
+		if (record_seq(old_addr) > seq) {
+			flash_queue_write_wait((uint8_t *)&zero_sig, addr, 4);
+			return;
+		}
+		flash_queue_write_wait((uint8_t *)&zero_sig, old_addr, 4);
+	}
+
+	plog.addr[preset_num] = addr;
+	plog.version[preset_num] = version;
+}
+
+static void scan_sector(uint8_t s)
+{
+	uint32_t base = sector_addr(s);
+	uint8_t rd[PRESET_LOG_HEADER_SIZE + 4];
+	uint8_t mid_sig[4];
+	o_preset_log_header h;
+	uint8_t slot;
+
+	plog.sector[s] = 0;
+
+	flash_queue_read_wait(rd, base, sizeof(rd));
+	if (rd[0] != 'P' || rd[1] != 'L') {
+		flash_queue_read_wait((uint8_t *)mid_sig, base + PRESET_LOG_SECTOR_SIZE / 2, 4);
+
+		if (rd[0] == 0xFF && rd[1] == 0xFF && rd[2] == 0xFF && rd[3] == 0xFF
+			&& mid_sig[0] == 0xFF && mid_sig[1] == 0xFF && mid_sig[2] == 0xFF && mid_sig[3] == 0xFF)
+			return;
+
+		plog.sector[s] = PRESET_LOG_LEGACY;
+		if (is_preset_signature((char *)rd))
+			scan_found(s * PRESETS_PER_SECTOR, base, rd[2], 0);
+		if (is_preset_signature((char *)mid_sig))
+			scan_found(s * PRESETS_PER_SECTOR + 1, base + PRESET_LOG_SECTOR_SIZE / 2, mid_sig[2], 0);
+	}
+
+	for (slot = 0; slot < SLOTS; slot++) {
+		if (!slot_usable(s, slot))
+			continue;
+
+		flash_queue_read_wait(rd, base + slot * PRESET_LOG_SLOT_SIZE, sizeof(rd));
+		if (rd[0] == 0xFF && rd[1] == 0xFF)
+			break;
+
+		memcpy(&h, rd, PRESET_LOG_HEADER_SIZE);
+		if (h.sig[0] != 'P' || h.sig[1] != 'L')
+			continue;
+
+		if (h.seq >= plog.next_seq)
+			plog.next_seq = h.seq + 1;
+
+		if (h.preset_num < MAX_PRESETS && is_preset_signature((char *)rd + PRESET_LOG_HEADER_SIZE))
+			scan_found(h.preset_num, base + slot * PRESET_LOG_SLOT_SIZE + PRESET_LOG_HEADER_SIZE, rd[PRESET_LOG_HEADER_SIZE + 2], h.seq);
+	}
+	plog.sector[s] |= slot;
+}
+
+void init_preset_log(void)
+{
+	uint32_t i;
+	uint8_t s;
+
+	plog.head = PRESET_LOG_NONE;
+	plog.erasing = PRESET_LOG_NONE;
+	plog.gc_state = PLOG_GC_IDLE;
+	plog.verify_next = 0;
+	erase_done = 0;
+
+	for (i = 0; i < MAX_PRESETS; i++) {
+		plog.addr[i] = 0;
+		plog.version[i] = 0;
+	}
+
+	//From the flash directory, or by reading the preset sectors if the directory is stale
+	if (flash_directory_has_presets()) {
+		plog.next_seq = flash_directory_preset_log_seq();
+		for (s = 0; s < PRESET_NUM_SECTORS; s++)
+			plog.sector[s] = flash_directory_preset_log_sector(s);
+		for (i = 0; i < MAX_PRESETS; i++)
+			plog.version[i] = flash_directory_preset(i, &plog.addr[i]);
+	}
+	else {
+		plog.next_seq = 1;
+		for (s = 0; s < PRESET_NUM_SECTORS; s++)
+			scan_sector(s);
+
+		for (s = 0; s < PRESET_NUM_SECTORS; s++)
+			flash_directory_set_preset_log_sector(s, plog.sector[s]);
+		for (i = 0; i < MAX_PRESETS; i++)
+			flash_directory_set_preset(i, plog.version[i], plog.addr[i]);
+		flash_directory_set_preset_log_seq(plog.next_seq);
+		flash_directory_presets_scanned();
+	}
+
+	for (s = 0; s < PRESET_NUM_SECTORS; s++)
+		plog.live[s] = 0;
+	for (i = 0; i < MAX_PRESETS; i++) {
+		if (plog.addr[i])
+			plog.live[sector_of(plog.addr[i])]++;
+	}
+
+	//Keep writing into a sector that's partly used
+	plog.free_slots = 0;
+	for (s = 0; s < PRESET_NUM_SECTORS; s++) {
+		plog.free_slots += sector_free_slots(s);
+		if (plog.head == PRESET_LOG_NONE && !(plog.sector[s] & PRESET_LOG_LEGACY)
+			&& slots_used(s) && slots_used(s) < SLOTS)
+			plog.head = s;
+	}
+}
@@ -26,9 +26,10 @@
  * -----------------------------------------------------------------------------
  */
 
+#include <string.h>
 #include "preset_manager.h"
 #include "UI_conditioning.h"
-#include "drivers/flashram_spidma.h"
+#include "drivers/flashram_queue.h"
 #include "globals.h"
 #include "gpio_pins.h"
 #include "hardware_controls.h"
@@ -40,6 +41,7 @@
 #include "timekeeper.h"
 #include "wavetable_saveload.h"
 #include "startup_preset_storage.h"
+#include "preset_log.h"
 
 extern o_params params;
 extern o_lfos lfos;
@@ -50,40 +52,38 @@ char	preset_signature_v1_0[4] = {'P', 'R', '9', '\0'};
 char	preset_signature_v1_2[4] = {'P', 'R', 'A', '\0'};
 char	preset_signature_vLatest[4] = {'P', 'R', 'B', '\0'};
 
-static uint8_t cached_preset[sizeof(preset_signature_vLatest) + sizeof(o_params) + sizeof(o_lfos)];
+static uint8_t store_buf[PRESET_LOG_RECORD_SIZE];
+static char verify_data[4];
+static uint8_t preset_save_req = FLASHQ_NONE;
 static uint8_t animation_enabled = 1;
 static char read_data[4];
 
-//Todo: pack presets in more tightly:
-//each sector contains 28 presets. next sector is blank for double buffering
-//1) erase inactive buffer
-//2) read each preset in active buffer into cached_preset, and then write it to inactive buffer
-//3) --instead of reading the preset matching preset_num, just write current params/lfos to inactive buffer
-//4) set word 1 of former active sector to DOUBLE_BUFFER_INACTIVE (0x01020304) (byte has never been written since it was erased, so it's ok to write w/o immediately erasing)
-//5) word 1 of new active sector will be erased (0xFFFFFFFF == DOUBLE_BUFFER_ACTIVE)
-// When reading a preset, or checking if preset is filled, always read word 1 to see if it's active or inactive. Skip inactive sectors
+// Saving and clearing are queued, and use store_buf until it's written
+static void wait_for_preset_save(uint8_t num_reqs)
+{
+	flash_queue_wait(preset_save_req);
+	while (flash_queue_num_free() < num_reqs)
+		flash_queue_service();
+}
 
-static inline void wait_for_flash_ready(void)
+static void preset_save_verified(uint32_t preset_num)
 {
-	while (get_flash_state() != sFLASH_NOTBUSY) {}
+	preset_mgr.filled[preset_num] = (verify_data[0] == preset_signature_vLatest[0]
+								  && verify_data[1] == preset_signature_vLatest[1]
+								  && verify_data[2] == preset_signature_vLatest[2]
+								  && verify_data[3] == preset_signature_vLatest[3]);
 }
 
 void init_preset_manager(void)
 {
-	char dummy;
-
 	preset_mgr.hover_num = 0;
 	preset_mgr.mode = PM_INACTIVE;
 	preset_mgr.last_action = PM_INACTIVE;
 	preset_mgr.animation_ctr = 0;
 
 	uint16_t i;
-	for (i = 0; i < MAX_PRESETS; i++) {
-		if (check_preset_filled(i, &dummy))
-			preset_mgr.filled[i] = 1;
-		else
-			preset_mgr.filled[i] = 0;
-	}
+	for (i = 0; i < MAX_PRESETS; i++)
+		preset_mgr.filled[i] = preset_log_version(i) ? 1 : 0;
 
 	init_startup_preset_storage();
 	uint16_t preset_num = get_startup_preset();
@@ -123,43 +123,27 @@ void recall_preset_into_active(uint32_t preset_num)
 	recalc_active_params();
 }
 
+// The save is queued, and written into a free slot of the preset log (nothing is erased).
+// preset_mgr.filled[] is set when it's written and verified
 void store_preset(uint32_t preset_num, o_params *t_params, o_lfos *t_lfos)
 {
-	uint32_t addr = get_preset_addr(preset_num);
-	uint32_t other_preset_addr;
-	uint32_t sz;
-	char dummy;
-
-	pause_timer_IRQ(OSC_TIM_number);
-	pause_timer_IRQ(WT_INTERP_TIM_number);
-	pause_timer_IRQ(PWM_OUTS_TIM_number);
-	wait_for_flash_ready();
-
-	//store other half of sector in a temp variable
-	other_preset_addr = get_preset_addr((preset_num & 1) ? preset_num - 1 : preset_num + 1);
-	sFLASH_read_buffer(cached_preset, other_preset_addr, get_preset_size());
-
-	sFLASH_erase_sector(addr);
-
-	sz = 4;
-	sFLASH_write_buffer((uint8_t *)preset_signature_vLatest, addr, sz);
-	addr += sz;
-
-	sz = sizeof(o_params);
-	sFLASH_write_buffer((uint8_t *)t_params, addr, sz);
-	addr += sz;
+	uint8_t *preset = store_buf + PRESET_LOG_HEADER_SIZE;
+	uint32_t addr;
 
-	sz = sizeof(o_lfos);
-	sFLASH_write_buffer((uint8_t *)t_lfos, addr, sz);
+	wait_for_preset_save(5);
 
-	sFLASH_write_buffer(cached_preset, other_preset_addr, get_preset_size());
+	memcpy(preset, preset_signature_vLatest, 4);
+	memcpy(preset + 4, t_params, sizeof(o_params));
+	memcpy(preset + 4 + sizeof(o_params), t_lfos, sizeof(o_lfos));
 
-	//Verify sector was written (could use a checksum to be more rigorous)
-	preset_mgr.filled[preset_num] = check_preset_filled(preset_num, &dummy);
+	addr = preset_log_store(preset_num, store_buf);
+	if (!addr) {
+		preset_mgr.filled[preset_num] = 0;
+		return;
+	}
 
-	resume_timer_IRQ(OSC_TIM_number);
-	resume_timer_IRQ(WT_INTERP_TIM_number);
-	resume_timer_IRQ(PWM_OUTS_TIM_number);
+	//Verify the signature was written (could use a checksum to be more rigorous)
+	preset_save_req = flash_queue_read((uint8_t *)verify_data, addr, 4, FLASHQ_PRIO_NORMAL, preset_save_verified, preset_num);
 }
 
 void recall_preset(uint32_t preset_num, o_params *t_params, o_lfos *t_lfos)
@@ -173,8 +157,6 @@ void recall_preset(uint32_t preset_num, o_params *t_params, o_lfos *t_lfos)
 	pause_timer_IRQ(WT_INTERP_TIM_number);
 	pause_timer_IRQ(PWM_OUTS_TIM_number);
 
-	while (get_flash_state() != sFLASH_NOTBUSY) {}
-
 	//Manually checking is not necessary, but we want to make sure this sector is readable, and we already have control of FLASH
 	preset_is_filled = check_preset_filled(preset_num, &version);
 	if (preset_num < MAX_PRESETS && preset_mgr.filled[preset_num] && preset_is_filled) {
@@ -182,11 +164,11 @@ void recall_preset(uint32_t preset_num, o_params *t_params, o_lfos *t_lfos)
 		addr += 4;
 
 		sz = sizeof(o_params);
-		sFLASH_read_buffer((uint8_t *)t_params, addr, sz);
+		flash_queue_read_wait((uint8_t *)t_params, addr, sz);
 		addr += sz;
 
 		sz = sizeof(o_lfos);
-		sFLASH_read_buffer((uint8_t *)t_lfos, addr, sz);
+		flash_queue_read_wait((uint8_t *)t_lfos, addr, sz);
 
 		if (version != preset_signature_vLatest[2])
 			update_preset_version(version, t_params, t_lfos);
@@ -220,26 +202,19 @@ void update_preset_version(char version, o_params *t_params, o_lfos *t_lfos)
 	}
 }
 
+// Queued like store_preset(): zeroes the preset's signature
 void clear_preset(uint32_t preset_num)
 {
-	//Write over the preset
-	uint32_t addr = get_preset_addr(preset_num);
-	uint32_t other_preset_addr;
-
-	pause_timer_IRQ(WT_INTERP_TIM_number);
-	wait_for_flash_ready();
-
-	//store other half of sector in a temp variable
-	other_preset_addr = get_preset_addr((preset_num & 1) ? preset_num - 1 : preset_num + 1);
-	sFLASH_read_buffer(cached_preset, other_preset_addr, get_preset_size());
-
-	sFLASH_erase_sector(addr);
-
-	sFLASH_write_buffer(cached_preset, other_preset_addr, get_preset_size());
+	wait_for_preset_save(2);
 
+	preset_save_req = preset_log_clear(preset_num);
 	preset_mgr.filled[preset_num] = 0;
+}
 
-	resume_timer_IRQ(WT_INTERP_TIM_number);
+void forget_preset(uint32_t preset_num)
+{
+	if (preset_num < MAX_PRESETS)
+		preset_mgr.filled[preset_num] = 0;
 }
 
 void recalc_active_params(void)
@@ -253,38 +228,30 @@ void recalc_active_params(void)
 		compute_tuning(i);	
 }
 
-//Writes over preset version in all sectors
-//Much faster than erasing sectors
+//Writes over preset version of all presets
+//Much faster than erasing sectors (they're erased later by update_preset_log())
 void clear_all_presets(void)
 {
 	uint8_t preset_num;
-	uint32_t addr;
-	uint8_t sz;
 
-	pause_timer_IRQ(WT_INTERP_TIM_number);
-	wait_for_flash_ready();
+	wait_for_preset_save(2);
 
 	for (preset_num = 0; preset_num < MAX_PRESETS; preset_num++) {
-		addr = get_preset_addr(preset_num);
-		sz = 4;
-		sFLASH_read_buffer((uint8_t *)read_data, addr, sz);
-		if (   read_data[0] == preset_signature_vLatest[0]
-			&& read_data[1] == preset_signature_vLatest[1]
-			// && read_data[2] == preset_signature_vLatest[2]
-			&& read_data[3] == preset_signature_vLatest[3] )
-		{
-			sz = 4;
-			read_data[0] = 0x00;
-			read_data[1] = 0x00;
-			read_data[2] = 0x00;
-			read_data[3] = 0x00;
-			sFLASH_write_buffer((uint8_t *)read_data, addr, sz);
-		}
-
+		preset_log_clear(preset_num);
 		preset_mgr.filled[preset_num] = 0;
 	}
+	flash_queue_wait_all();
+	preset_save_req = FLASHQ_NONE;
+}
 
-	resume_timer_IRQ(WT_INTERP_TIM_number);
+uint8_t is_preset_signature(const char *sig)
+{
+	return (   sig[0] == preset_signature_vLatest[0]
+			&& sig[1] == preset_signature_vLatest[1]
+			&& (sig[2] == preset_signature_vLatest[2] \
+				|| sig[2] == preset_signature_v1_0[2] \
+				|| sig[2] == preset_signature_v1_2[2])
+			&& sig[3] == preset_signature_vLatest[3] );
 }
 
 uint8_t check_preset_filled(uint32_t preset_num, char *version)
@@ -292,17 +259,13 @@ uint8_t check_preset_filled(uint32_t preset_num, char *version)
 	uint32_t addr = get_preset_addr(preset_num);
 	uint32_t sz;
 
-	sz = 4;
-	wait_for_flash_ready();
+	if (!addr)
+		return 0;
 
-	sFLASH_read_buffer((uint8_t *)read_data, addr, sz);
+	sz = 4;
+	flash_queue_read_wait((uint8_t *)read_data, addr, sz);
 
-	if (   read_data[0] == preset_signature_vLatest[0]
-		&& read_data[1] == preset_signature_vLatest[1]
-		&& (read_data[2] == preset_signature_vLatest[2] \
-			|| read_data[2] == preset_signature_v1_0[2] \
-			|| read_data[2] == preset_signature_v1_2[2])
-		&& read_data[3] == preset_signature_vLatest[3] )
+	if (is_preset_signature(read_data))
 	{
 		*version = read_data[2];
 		return 1;
@@ -316,19 +279,9 @@ uint32_t get_preset_size(void)
 	return (4 + sizeof(o_params) + sizeof(o_lfos));
 }
 
+// Where the preset is in the preset log, or 0 if it's empty
 uint32_t get_preset_addr(uint32_t preset_num)
 {
-	uint32_t preset_sector_offset = 0;
-
-	if (preset_num >= MAX_PRESETS)
-		preset_num = (MAX_PRESETS - 1);
-
-	uint32_t sector_num = PRESET_SECTOR_START + (preset_num >> 1);
-	uint32_t sector_start = sFLASH_get_sector_addr(sector_num);
-
-	//odd numbered presets start in middle of a sector
-	if (preset_num & 1) preset_sector_offset = sFLASH_get_sector_size(sector_num) / 2;
-
-	return sector_start +  preset_sector_offset;
+	return preset_log_addr(preset_num);
 }
 
@@ -30,6 +30,8 @@
 #include "globals.h"
 #include "led_colors.h"
 #include "params_update.h"
+#include "math_approx.h"
+#include "params_graph.h"
 
 //Todo: this could be a struct:
 // struct quantizedScale {
@@ -138,64 +140,103 @@ const float qtz_scales[NUM_QTZ_SCALES][MAX_NUM_QTZ_STEPS] = {
 };
 
 
-float qtz_scale_midpt[NUM_QTZ_SCALES][MAX_NUM_QTZ_STEPS];
+// Each scale's table is built from the main loop or at boot, and swapped in with one
+// pointer write, so the OSC timer never sees one that's half-built
+static SRAM1DATA o_qtz_table qtz_table_buf[NUM_QTZ_SCALES + 1];
+static o_qtz_table *qtz_table[NUM_QTZ_SCALES];
+static o_qtz_table *qtz_spare_table;
 
 void init_quantz_scales(void)
 {
-	uint8_t i,j;
+	uint8_t i;
 
+	qtz_spare_table = &qtz_table_buf[NUM_QTZ_SCALES];
 	for (i=0;i<NUM_QTZ_SCALES;i++)
 	{
-		for (j=0; j<(num_qtz_steps[i]-1); j++)
-		{
-			qtz_scale_midpt[i][j] = (qtz_scales[i][j] + qtz_scales[i][j+1]) / 2.0;
-		}
+		qtz_table[i] = &qtz_table_buf[i];
+		if (i != sclm_NONE)
+			quantz_set_scale(i, qtz_scales[i], num_qtz_steps[i]);
+	}
+}
+
+// Builds the thresholds for a scale and swaps it in. Call from the main loop, not an interrupt.
+// notes[] are the frequencies in the lowest octave, ascending, starting with C0 (16.35Hz).
+// Returns 0 if they're out of order or span an octave or more
+uint8_t quantz_set_scale(uint8_t scale_num, const float *notes, uint8_t num_notes)
+{
+	o_qtz_table *t = qtz_spare_table;
+	float note_pos[MAX_NUM_QTZ_STEPS + 1];
+	uint8_t i, bin;
 
-		//last midpoint is between last note and an octave above the first note
-		qtz_scale_midpt[i][num_qtz_steps[i]-1] = (qtz_scales[i][num_qtz_steps[i]-1] + (qtz_scales[i][0]*2.0)) / 2.0; 
+	if ((scale_num == sclm_NONE) || (scale_num >= NUM_QTZ_SCALES) || !num_notes || (num_notes > MAX_NUM_QTZ_STEPS))
+		return 0;
+
+	for (i=0; i<num_notes; i++)
+	{
+		if ((notes[i] <= 0.f) || (i && notes[i] <= notes[i-1]) || (notes[i] >= notes[0]*2.f))
+			return 0;
+		note_pos[i] = log2_approx(notes[i]);
+		t->freq[i] = notes[i];
 	}
+	note_pos[num_notes] = note_pos[0] + 1.f;
 
-}
+	// Each note's range ends halfway (in pitch) to the next one. The first note's range
+	// starts where the last note's ended, an octave down
+	t->low = (note_pos[num_notes-1] + note_pos[num_notes]) * 0.5f - 1.f;
+	for (i=0; i<num_notes; i++)
+		t->thresh[i] = (note_pos[i] + note_pos[i+1]) * 0.5f - t->low;
+	t->thresh[num_notes-1] = 1.f;
+	t->num_notes = num_notes;
+
+	for (bin=0, i=0; bin<QTZ_BINS_PER_OCT; bin++)
+	{
+		while ((float)bin / QTZ_BINS_PER_OCT >= t->thresh[i]) i++;
+		t->bin_note[bin] = i;
+	}
 
-float quantize_to_scale(uint8_t scale_num, float unqtz_freq, uint8_t *qtz_note, int8_t *qtz_oct){
-//float quantize_to_scale(uint8_t scale_num, float unqtz_freq, uint8_t *qtz_note, uint8_t *qtz_oct, uint8_t prev_qtz_note, uint8_t prev_qtz_oct){
+	qtz_spare_table = qtz_table[scale_num];
+	qtz_table[scale_num] = t;
+	flag_param_update(PN_PITCH, (1 << NUM_CHANNELS) - 1);
+	return 1;
+}
 
-	uint8_t note 			= 0;
-	int8_t oct  			= 0;
-	float 	qtz_freq		= unqtz_freq;
-	float	high_note;
-	float	distance_from_midpt;
+// prev_qtz_note/oct: the note the channel is on now (prev_qtz_note = 0xFF for none).
+// It's kept until the input is QTZ_HYSTERESIS octaves outside of its range
+float quantize_to_scale(uint8_t scale_num, float unqtz_freq, uint8_t *qtz_note, int8_t *qtz_oct, uint8_t prev_qtz_note, int8_t prev_qtz_oct)
+{
+	const o_qtz_table *t;
+	float pos, frac;
+	int32_t oct;
+	uint8_t note;
 
 	if ((scale_num == sclm_NONE) || (scale_num>=NUM_QTZ_SCALES))
 		return unqtz_freq;
 
-	// Find octave
-	high_note = qtz_scale_midpt[scale_num][ num_qtz_steps[scale_num]-1 ];
- 	while( (unqtz_freq >= high_note ) && (oct <= MAX_OCT) ){
- 		oct++;
- 		high_note *= 2;
- 	}
-
-	if (oct < MAX_OCT){
-
-		for (note = 0; note < num_qtz_steps[scale_num]; note++){
-			distance_from_midpt = (qtz_scale_midpt[scale_num][note] * (float)(1<<oct)) - unqtz_freq;
-			if( distance_from_midpt > 0.0 )
-			{
-				if (distance_from_midpt > (0.1	 * (float)(1<<oct)))
-				{
-					//Set the frequency based on note and octave
-					qtz_freq  = qtz_scales[scale_num][note] * (1<<oct);
-					*qtz_note = note;
-					*qtz_oct = oct;
-					break; //found a note, so exit loop
-				} else {
-					break; //Todo: implement better anti-hysteresis
-				}
-			}
+	t = qtz_table[scale_num];
+
+	// Octaves above the start of the first note's range in octave 0
+	pos = (unqtz_freq > 0.f) ? (log2_approx(unqtz_freq) - t->low) : 0.f;
+	if (pos < 0.f) pos = 0.f;
+
+	oct = (int32_t)pos;
+	if (oct >= MAX_OCT)
+		return unqtz_freq;
+
+	frac = pos - (float)oct;
+	note = t->bin_note[(uint32_t)(frac * QTZ_BINS_PER_OCT)];
+	while (frac >= t->thresh[note]) note++;
+
+	if ((prev_qtz_note < t->num_notes) && ((note != prev_qtz_note) || (oct != prev_qtz_oct)))
+	{
+		frac = pos - (float)prev_qtz_oct;
+		if ((frac > (prev_qtz_note ? t->thresh[prev_qtz_note-1] : 0.f) - QTZ_HYSTERESIS) && (frac < t->thresh[prev_qtz_note] + QTZ_HYSTERESIS))
+		{
+			note = prev_qtz_note;
+			oct = prev_qtz_oct;
 		}
 	}
 
-	return qtz_freq;
+	*qtz_note = note;
+	*qtz_oct = oct;
+	return t->freq[note] * (1<<oct);
 }
-
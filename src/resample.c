@@ -1,5 +1,5 @@
 /*
- * resample.c - Resampling of audio buffer using a Hermite interpolation
+ * resample.c - Resampling of audio buffer using Hermite or windowed-sinc interpolation
  *
  * Author: Dan Green (danngreen1@gmail.com)
  *
@@ -26,134 +26,335 @@
  * -----------------------------------------------------------------------------
  */
 
+#include <math.h>
 #include "resample.h"
 #include "math_util.h"
 
-float resample_hermitian(float resample_rate, float start_inpos, uint32_t in_buf_size, int16_t* in, uint32_t out_samples, int16_t *out, uint16_t init_pos)
+// Kaiser-windowed sinc (beta = 7), from 0 to RESAMPLE_SINC_ZERO_CROSSINGS, RESAMPLE_SINC_PHASES points per zero crossing.
+// Ends with two 0's so lookups can interpolate up to the last zero crossing
+static const float sinc_table[RESAMPLE_SINC_TABLE_LEN] = {
+	+1.00000000, +0.99834504, +0.99339042, +0.98516678, +0.97372493, +0.95913549, +0.94148830, +0.92089178,
+	+0.89747208, +0.87137215, +0.84275061, +0.81178061, +0.77864850, +0.74355245, +0.70670093, +0.66831122,
+	+0.62860777, +0.58782054, +0.54618336, +0.50393221, +0.46130352, +0.41853252, +0.37585154, +0.33348840,
+	+0.29166486, +0.25059512, +0.21048437, +0.17152747, +0.13390770, +0.09779563, +0.06334808, +0.03070728,
+	+0.00000000, -0.02866299, -0.05518747, -0.07949614, -0.10152884, -0.12124260, -0.13861164, -0.15362715,
+	-0.16629698, -0.17664517, -0.18471144, -0.19055042, -0.19423095, -0.19583512, -0.19545734, -0.19320326,
+	-0.18918866, -0.18353825, -0.17638447, -0.16786620, -0.15812748, -0.14731622, -0.13558290, -0.12307929,
+	-0.10995715, -0.09636703, -0.08245708, -0.06837189, -0.05425144, -0.04023004, -0.02643548, -0.01298808,
+	-0.00000000, +0.01242545, +0.02419439, +0.03522286, +0.04543714, +0.05477411, +0.06318132, +0.07061715,
+	+0.07705072, +0.08246182, +0.08684064, +0.09018753, +0.09251257, +0.09383512, +0.09418332, +0.09359349,
+	+0.09210944, +0.08978183, +0.08666743, +0.08282832, +0.07833114, +0.07324624, +0.06764693, +0.06160860,
+	+0.05520798, +0.04852231, +0.04162856, +0.03460276, +0.02751924, +0.02044998, +0.01346401, +0.00662686,
+	+0.00000000, -0.00635956, -0.01239968, -0.01807342, -0.02333933, -0.02816160, -0.03251023, -0.03636114,
+	-0.03969611, -0.04250281, -0.04477463, -0.04651060, -0.04771513, -0.04839777, -0.04857293, -0.04825953,
+	-0.04748063, -0.04626308, -0.04463705, -0.04263560, -0.04029426, -0.03765057, -0.03474358, -0.03161344,
+	-0.02830091, -0.02484693, -0.02129223, -0.01767684, -0.01403980, -0.01041874, -0.00684955, -0.00336611,
+	-0.00000000, +0.00321972, +0.00626672, +0.00911756, +0.01175180, +0.01415210, +0.01630428, +0.01819731,
+	+0.01982332, +0.02117755, +0.02225823, +0.02306653, +0.02360638, +0.02388433, +0.02390935, +0.02369266,
+	+0.02324750, +0.02258889, +0.02173342, +0.02069898, +0.01950453, +0.01816984, +0.01671526, +0.01516145,
+	+0.01352917, +0.01183905, +0.01011136, +0.00836583, +0.00662143, +0.00489625, +0.00320729, +0.00157037,
+	+0.00000000, -0.00149073, -0.00289021, -0.00418838, -0.00537673, -0.00644837, -0.00739800, -0.00822189,
+	-0.00891786, -0.00948521, -0.00992466, -0.01023829, -0.01042943, -0.01050258, -0.01046326, -0.01031797,
+	-0.01007398, -0.00973930, -0.00932248, -0.00883252, -0.00827875, -0.00767069, -0.00701795, -0.00633010,
+	-0.00561658, -0.00488659, -0.00414900, -0.00341226, -0.00268435, -0.00197269, -0.00128408, -0.00062470,
+	-0.00000000, +0.00058524, +0.00112700, +0.00162197, +0.00206758, +0.00246199, +0.00280403, +0.00309323,
+	+0.00332976, +0.00351435, +0.00364834, +0.00373355, +0.00377224, +0.00376710, +0.00372115, +0.00363769,
+	+0.00352027, +0.00337259, +0.00319848, +0.00300183, +0.00278653, +0.00255645, +0.00231537, +0.00206693,
+	+0.00181462, +0.00156174, +0.00131136, +0.00106630, +0.00082910, +0.00060205, +0.00038711, +0.00018597,
+	+0.00000000, -0.00016971, -0.00032237, -0.00045748, -0.00057478, -0.00067430, -0.00075627, -0.00082115,
+	-0.00086960, -0.00090243, -0.00092062, -0.00092526, -0.00091752, -0.00089867, -0.00087003, -0.00083293,
+	-0.00078872, -0.00073873, -0.00068427, -0.00062659, -0.00056688, -0.00050625, -0.00044574, -0.00038628,
+	-0.00032870, -0.00027373, -0.00022197, -0.00017395, -0.00013005, -0.00009056, -0.00005568, -0.00002549,
+	+0.00000000, +0.00000000
+};
+
+static inline int16_t clamp_s16(float x)
+{
+	int32_t v = (int32_t)x;
+
+	if (v > INT16_MAX) return INT16_MAX;
+	if (v < INT16_MIN) return INT16_MIN;
+	return v;
+}
+
+// Reads in[i] for i within one buffer length of the ends
+static inline int16_t read_wrapped(const o_resampler *r, int32_t i)
+{
+	if (i < 0) 							i += r->in_size;
+	else if (i >= (int32_t)r->in_size) 	i -= r->in_size;
+	return r->in[i];
+}
+
+// t is the distance from the center in table points, and must be <= RESAMPLE_SINC_ZERO_CROSSINGS * RESAMPLE_SINC_PHASES
+static inline float sinc_lookup(float t)
+{
+	uint32_t i = (uint32_t)t;
+	return sinc_table[i] + (t - (float)i) * (sinc_table[i+1] - sinc_table[i]);
+}
+
+void resampler_init(o_resampler *r, enum ResampleModes mode, float rate, const int16_t *in, uint32_t in_size, float start_pos)
+{
+	uint32_t start = (uint32_t)start_pos;
+
+	r->mode 	= mode;
+	r->in 		= in;
+	r->in_size 	= in_size;
+	r->pos 		= _WRAP_U32(start, 0, in_size);
+	r->frac 	= start_pos - (float)start;
+
+	resampler_set_rate(r, rate);
+}
+
+void resampler_set_rate(o_resampler *r, float rate)
+{
+	float width = _CLAMP_F(rate, 1.0, RESAMPLE_MAX_DECIMATION);
+
+	r->rate 		= rate;
+	r->cutoff 		= 1.0f / width;
+
+	// Taps further out than this would be past the end of sinc_table
+	r->half_taps 	= (uint16_t)((float)RESAMPLE_SINC_ZERO_CROSSINGS * width);
+}
+
+// Moves the read position ahead by num_samples outputs
+static void advance(o_resampler *r, uint32_t num_samples)
+{
+	float adv = r->frac + (float)num_samples * r->rate;
+	uint32_t whole = (uint32_t)adv;
+
+	r->frac = adv - (float)whole;
+	r->pos 	= _WRAP_U32(r->pos + whole, 0, r->in_size);
+}
+
+// True if a block of num_samples reads from first-left to last+right without wrapping
+static uint8_t block_fits(const o_resampler *r, uint32_t num_samples, uint32_t left, uint32_t right)
 {
-	static float fractional_pos = 0;
-	static float xm1, x0, x1, x2;
-	float a,b,c;
-	uint32_t outpos;
-	uint32_t inpos;
+	uint32_t last = r->pos + (uint32_t)(r->frac + (float)(num_samples - 1) * r->rate) + 1;
+
+	return (r->pos >= left) && (last + right < r->in_size);
+}
+
+// Returns the whole number step if the rate is close enough to one for all num_samples outputs
+static uint32_t whole_number_step(const o_resampler *r, uint32_t num_samples)
+{
+	float step = roundf(r->rate);
+
+	if (step < 1.0f || fabsf(r->rate - step) * (float)num_samples >= RESAMPLE_INTEGER_TOLERANCE)
+		return 0;
+	return (uint32_t)step;
+}
+
+//
+// Hermite
+//
 
-	inpos = (uint32_t)start_inpos;
-	fractional_pos = start_inpos - (float)inpos;
+static inline void hermite_block(o_resampler *r, int16_t *out, uint32_t num_samples, const uint8_t wrap)
+{
+	const int16_t *in = r->in;
+	const float rate = r->rate;
+	int32_t pos = r->pos;
+	int32_t coef_pos = -2;
+	float frac = r->frac;
+	float xm1=0, x0=0, x1=0, x2=0;
+	float a=0, b=0, c=0;
+	uint32_t whole;
+	uint32_t i;
 
-	if (resample_rate == 1.0)		//Handle the trivial case of 1:1 resample rate (out<=in)
+	for (i=0; i<num_samples; i++)
 	{
-		for(outpos=0;outpos<out_samples;outpos++)
+		// Only reload the points and coefficients when we've moved to a new input sample
+		if (pos != coef_pos)
 		{
-			out[outpos] = in[inpos];
-			inpos++;
+			if (wrap) {
+				xm1 = read_wrapped(r, pos-1);
+				x0 	= read_wrapped(r, pos);
+				x1 	= read_wrapped(r, pos+1);
+				x2 	= read_wrapped(r, pos+2);
+			} else {
+				xm1 = in[pos-1];
+				x0 	= in[pos];
+				x1 	= in[pos+1];
+				x2 	= in[pos+2];
+			}
+			a = (3 * (x0-x1) - xm1 + x2) / 2;
+			b = 2*x1 + xm1 - (5*x0 + x2) / 2;
+			c = (x1 - xm1) / 2;
+			coef_pos = pos;
+		}
+
+		out[i] = clamp_s16((((a * frac) + b) * frac + c) * frac + x0);
+
+		frac += rate;
+		if (frac >= 1.0f) {
+			whole = (uint32_t)frac;
+			frac -= (float)whole;
+			pos += whole;
+			if (wrap && pos >= (int32_t)r->in_size) pos -= r->in_size;
 		}
 	}
-	else {
 
-		//fill the resampling buffer with three points
-		if (init_pos)
-		{
-			xm1		= in[inpos];
-			inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+	r->pos 	= pos;
+	r->frac = frac;
+}
 
-			x0		= in[inpos];
-			inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+// At a whole number rate, starting on (or within RESAMPLE_INTEGER_TOLERANCE of) an input sample,
+// every output is an input sample
+static uint8_t hermite_whole_numbers(o_resampler *r, int16_t *out, uint32_t num_samples)
+{
+	uint32_t step = whole_number_step(r, num_samples);
+	uint32_t pos;
+	uint32_t i;
 
-			x1		= in[inpos];
-			inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+	if (!step) return 0;
 
-			x2		= in[inpos];
-			inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+	if (r->frac < RESAMPLE_INTEGER_TOLERANCE)
+		pos = r->pos;
+	else if (r->frac > (1.0f - RESAMPLE_INTEGER_TOLERANCE))
+		pos = _WRAP_U32(r->pos + 1, 0, r->in_size);
+	else
+		return 0;
 
-			fractional_pos = 0.0;
+	if (pos + (num_samples-1) * step < r->in_size) {
+		for (i=0; i<num_samples; i++, pos+=step)
+			out[i] = r->in[pos];
+	} else {
+		for (i=0; i<num_samples; i++, pos+=step) {
+			if (pos >= r->in_size) pos -= r->in_size;
+			out[i] = r->in[pos];
 		}
+	}
 
-		outpos = 0;
+	advance(r, num_samples);
+	return 1;
+}
 
-		while (outpos < out_samples)
-		{	
+//
+// Windowed sinc
+//
 
-			// optimize for X many spheres (currently 8)
-			//Optimize for resample rates >= 4
-			if (fractional_pos >= 4.0)
-			{
-				fractional_pos = fractional_pos - 4.0;
+// Fills taps[] (2*half_taps, starting half_taps-1 before pos) for an output at frac past pos.
+// Returns 1/sum of the taps, to normalize the output
+static inline float sinc_taps(const o_resampler *r, float frac, float *taps)
+{
+	const int32_t half = r->half_taps;
+	const float dt = r->cutoff * RESAMPLE_SINC_PHASES;
+	const float t_left = frac * dt;
+	const float t_right = (1.0f - frac) * dt;
+	float sum = 0.0f;
+	int32_t k;
 
-				//shift samples back one
-				//and read a new sample
-				xm1		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+	// The taps are independent of each other, so t is calculated from k rather than stepped
 
-				x0		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+	// pos and to the left
+	for (k=0; k<half; k++)
+		taps[half-1-k] = sinc_lookup(t_left + (float)k * dt);
 
-				x1		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+	// right of pos
+	for (k=0; k<half; k++)
+		taps[half+k] = sinc_lookup(t_right + (float)k * dt);
 
-				x2		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
-			}
-			//Optimize for resample rates >= 3
-			if (fractional_pos >= 3.0)
-			{
-				fractional_pos = fractional_pos - 3.0;
+	for (k=0; k<2*half; k++)
+		sum += taps[k];
 
-				//shift samples back one
-				//and read a new sample
-				xm1 	= x2;
+	return 1.0f / sum;
+}
 
-				x0		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+static inline float sinc_dot(const o_resampler *r, const float *taps, int32_t first, const uint8_t wrap)
+{
+	const int32_t num_taps = 2 * r->half_taps;
+	const int16_t *in = r->in + first;
+	float acc0 = 0.0f, acc1 = 0.0f;
+	int32_t k;
 
-				x1		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+	// num_taps is even. Two accumulators halve the add latency chain
+	if (wrap) {
+		for (k=0; k<num_taps; k+=2) {
+			acc0 += taps[k] * read_wrapped(r, first + k);
+			acc1 += taps[k+1] * read_wrapped(r, first + k + 1);
+		}
+	} else {
+		for (k=0; k<num_taps; k+=2) {
+			acc0 += taps[k] * in[k];
+			acc1 += taps[k+1] * in[k+1];
+		}
+	}
+	return acc0 + acc1;
+}
 
-				x2		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
-			}
-			//Optimize for resample rates >= 2
-			if (fractional_pos >= 2.0)
-			{
-				fractional_pos = fractional_pos - 2.0;
+static inline void sinc_block(o_resampler *r, int16_t *out, uint32_t num_samples, const uint8_t wrap)
+{
+	float taps[RESAMPLE_SINC_MAX_TAPS];
+	const int32_t left = r->half_taps - 1;
+	const float rate = r->rate;
+	int32_t pos = r->pos;
+	float frac = r->frac;
+	float norm;
+	uint32_t whole;
+	uint32_t i;
 
-				//shift samples back one
-				//and read a new sample
-				xm1 	= x1;
-				x0 		= x2;
+	for (i=0; i<num_samples; i++)
+	{
+		norm = sinc_taps(r, frac, taps);
+		out[i] = clamp_s16(sinc_dot(r, taps, pos - left, wrap) * norm);
 
-				x1		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
+		frac += rate;
+		if (frac >= 1.0f) {
+			whole = (uint32_t)frac;
+			frac -= (float)whole;
+			pos += whole;
+			if (wrap && pos >= (int32_t)r->in_size) pos -= r->in_size;
+		}
+	}
 
-				x2		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
-			}
-			//Optimize for resample rates >= 1
-			if (fractional_pos >= 1.0)
-			{
-				fractional_pos = fractional_pos - 1.0;
-
-				//shift samples back one
-				//and read a new sample
-				xm1 = x0;
-				x0 	= x1;
-				x1 	= x2;
-
-				x2		= in[inpos];
-				inpos 	= _WRAP_U32(inpos+1, 0, in_buf_size);
-			}
+	r->pos 	= pos;
+	r->frac = frac;
+}
 
-			//calculate coefficients
-			a = (3 * (x0-x1) - xm1 + x2) / 2;
-			b = 2*x1 + xm1 - (5*x0 + x2) / 2;
-			c = (x1 - xm1) / 2;
+// At a whole number rate, frac stays the same, so the taps are only calculated once
+static uint8_t sinc_whole_numbers(o_resampler *r, int16_t *out, uint32_t num_samples, uint8_t wrap)
+{
+	float taps[RESAMPLE_SINC_MAX_TAPS];
+	const int32_t left = r->half_taps - 1;
+	uint32_t step = whole_number_step(r, num_samples);
+	int32_t pos = r->pos;
+	float norm;
+	uint32_t i;
 
-			//calculate as many fractionally placed output points as we need
-			while ( fractional_pos<1.0 && outpos<out_samples )
-			{
-				out[outpos++] = _CLAMP_I32((((a * fractional_pos) + b) * fractional_pos + c) * fractional_pos + x0, INT16_MIN, INT16_MAX);
-				fractional_pos += resample_rate;
-			}
+	if (!step) return 0;
+
+	norm = sinc_taps(r, r->frac, taps);
+	for (i=0; i<num_samples; i++, pos+=step) {
+		if (wrap && pos >= (int32_t)r->in_size) pos -= r->in_size;
+		out[i] = clamp_s16(sinc_dot(r, taps, pos - left, wrap) * norm);
+	}
+
+	advance(r, num_samples);
+	return 1;
+}
+
+float resampler_process(o_resampler *r, int16_t *out, uint32_t num_samples)
+{
+	uint8_t fits;
+
+	if (!num_samples)
+		return r->pos + r->frac;
+
+	if (r->mode == RESAMPLE_SINC)
+	{
+		fits = block_fits(r, num_samples, r->half_taps - 1, r->half_taps);
+
+		if (!sinc_whole_numbers(r, out, num_samples, !fits)) {
+			if (fits) 	sinc_block(r, out, num_samples, 0);
+			else 		sinc_block(r, out, num_samples, 1);
 		}
 	}
-	return (inpos + fractional_pos);
+	else
+	{
+		if (!hermite_whole_numbers(r, out, num_samples)) {
+			if (block_fits(r, num_samples, 1, 2)) 	hermite_block(r, out, num_samples, 0);
+			else 									hermite_block(r, out, num_samples, 1);
+		}
+	}
+
+	return r->pos + r->frac;
 }
@@ -1,6 +1,7 @@
 #include "sel_bus.h"
 #include "drivers/uart_driver.h"
 #include "preset_manager_selbus.h"
+#include "isr_trace.h"
 
 UART_HandleTypeDef *midiUART;
 
@@ -42,6 +43,8 @@ void UART5_IRQHandler(void)
 	if (midiUART == (UART_HandleTypeDef *)0)
 		return;
 
+	ISR_TRACE_ENTER(ISR_TRACE_MIDI_UART);
+
 	HAL_UART_IRQHandler(midiUART);
 
 
@@ -88,6 +91,8 @@ void UART5_IRQHandler(void)
 	}
 
 	selBus_Start();
+
+	ISR_TRACE_EXIT(ISR_TRACE_MIDI_UART);
 }
 
 //Tests:
@@ -0,0 +1,93 @@
+/*
+ * spectrum_cache.c
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include "spectrum_cache.h"
+#include "wavetable_editing.h"
+
+extern SRAM1DATA o_spherebuf spherebuf;
+
+SRAM1DATA o_spectrum_cache spectrum_cache;
+
+
+// Returns the cell's spectrum if it's cached for the same resampling, or NULL
+o_spectrum_cache_slot* spectrum_cache_find(uint8_t cell, float start_sample, float smoothing)
+{
+	uint8_t i;
+	o_spectrum_cache_slot *s;
+
+	for (i=0; i<SPECTRUM_CACHE_SIZE; i++) {
+		s = &spectrum_cache.slot[i];
+		if (s->valid && s->cell==cell && s->start_sample==start_sample
+				&& s->stretch_ratio==spherebuf.stretch_ratio && s->smoothing==smoothing) {
+			s->last_used = ++spectrum_cache.use_ctr;
+			spectrum_cache.hits++;
+			return s;
+		}
+	}
+	return NULL;
+}
+
+// Takes the slot the cell had before, or a free one, or the least-recently-used one.
+// The caller fills in the spectrum and the waveform's sum, min and max
+o_spectrum_cache_slot* spectrum_cache_new(uint8_t cell, float start_sample, float smoothing)
+{
+	uint8_t i, slot = SPECTRUM_CACHE_SIZE;
+	o_spectrum_cache_slot *s;
+
+	for (i=0; i<SPECTRUM_CACHE_SIZE; i++) {
+		if (spectrum_cache.slot[i].valid && spectrum_cache.slot[i].cell==cell)
+			slot = i;
+	}
+	if (slot == SPECTRUM_CACHE_SIZE) {
+		for (i=0, slot=0; i<SPECTRUM_CACHE_SIZE; i++) {
+			if (!spectrum_cache.slot[i].valid) { slot = i; break; }
+			if (spectrum_cache.slot[i].last_used < spectrum_cache.slot[slot].last_used)
+				slot = i;
+		}
+	}
+
+	s = &spectrum_cache.slot[slot];
+	s->cell 			= cell;
+	s->start_sample 	= start_sample;
+	s->stretch_ratio 	= spherebuf.stretch_ratio;
+	s->smoothing 		= smoothing;
+	s->valid 			= 1;
+	s->last_used 		= ++spectrum_cache.use_ctr;
+	spectrum_cache.misses++;
+
+	return s;
+}
+
+// spectrum_cache is in SRAM1, which isn't cleared at startup, so this must run before it's used
+void flush_spectrum_cache(void)
+{
+	uint8_t i;
+
+	for (i=0; i<SPECTRUM_CACHE_SIZE; i++)
+		spectrum_cache.slot[i].valid = 0;
+	spectrum_cache.use_ctr = 0;
+}
@@ -0,0 +1,195 @@
+/*
+ * sphere_cache.c - Shared cache of waveforms loaded from external flash
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include "sphere_cache.h"
+#include "sphere_flash_io.h"
+#include "drivers/flashram_queue.h"
+
+o_sphere_cache sphere_cache;
+
+
+void init_sphere_cache(void)
+{
+	uint8_t i, chan;
+
+	for (i=0; i<SPHERE_CACHE_SIZE; i++) {
+		sphere_cache.slot[i].valid = 0;
+		sphere_cache.slot[i].refs = 0;
+		sphere_cache.slot[i].loading = 0;
+		sphere_cache.slot[i].last_used = 0;
+	}
+	for (chan=0; chan<NUM_CHANNELS; chan++) {
+		for (i=0; i<8; i++)
+			sphere_cache.chan_slot[chan][i] = SPHERE_CACHE_NONE;
+	}
+	sphere_cache.use_ctr = 0;
+	sphere_cache.hits = 0;
+	sphere_cache.misses = 0;
+	sphere_cache.prefetches = 0;
+}
+
+// If the waveform is cached, uses it for the channel's corner and returns 1
+uint8_t sphere_cache_acquire(uint8_t chan, uint8_t corner, uint8_t wt_num, uint8_t x, uint8_t y, uint8_t z)
+{
+	uint8_t i;
+	o_sphere_cache_slot *s;
+
+	for (i=0; i<SPHERE_CACHE_SIZE; i++) {
+		s = &sphere_cache.slot[i];
+		if (s->valid && s->wt_num==wt_num && s->x==x && s->y==y && s->z==z) {
+			s->refs++;
+			s->last_used = ++sphere_cache.use_ctr;
+			sphere_cache.chan_slot[chan][corner] = i;
+			sphere_cache.hits++;
+
+			// A prefetch that hasn't been read yet is needed now
+			if (s->loading)
+				flash_queue_raise_prio(s->req, FLASHQ_PRIO_AUDIO);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void slot_loaded(uint32_t slot)
+{
+	o_sphere_cache_slot *s = &sphere_cache.slot[slot];
+
+	unpack_extflash_wave(s->wt_num, s->wave);
+	s->loading = 0;
+}
+
+// Queues a flash read into the least-recently-used slot that no channel is using
+static uint8_t load_lru_slot(uint8_t wt_num, uint8_t x, uint8_t y, uint8_t z, enum FlashQueuePriorities prio)
+{
+	uint8_t i, lru = SPHERE_CACHE_NONE;
+	o_sphere_cache_slot *s;
+
+	for (i=0; i<SPHERE_CACHE_SIZE; i++) {
+		s = &sphere_cache.slot[i];
+		if (s->refs || s->loading) continue;
+		if (!s->valid) { lru = i; break; }
+		if (lru == SPHERE_CACHE_NONE || s->last_used < sphere_cache.slot[lru].last_used)
+			lru = i;
+	}
+	if (lru == SPHERE_CACHE_NONE)
+		return SPHERE_CACHE_NONE;
+
+	s = &sphere_cache.slot[lru];
+	s->loading = 1;
+	s->req = flash_queue_read(get_extflash_wave_buf(wt_num, s->wave), get_extflash_wave_addr(wt_num, x, y, z), get_extflash_wave_bytes(wt_num), prio, slot_loaded, lru);
+	if (s->req == FLASHQ_NONE) {
+		s->loading = 0;
+		return SPHERE_CACHE_NONE;
+	}
+
+	s->wt_num = wt_num;
+	s->x = x;
+	s->y = y;
+	s->z = z;
+	s->valid = 1;
+	s->refs = 0;
+	s->last_used = ++sphere_cache.use_ctr;
+
+	return lru;
+}
+
+// Loads the waveform into a free slot and uses it for the channel's corner.
+// Returns 0 if the flash queue is full. The data is ready when sphere_cache_chan_loading() returns 0
+uint8_t sphere_cache_load(uint8_t chan, uint8_t corner, uint8_t wt_num, uint8_t x, uint8_t y, uint8_t z)
+{
+	uint8_t slot = load_lru_slot(wt_num, x, y, z, FLASHQ_PRIO_AUDIO);
+
+	if (slot == SPHERE_CACHE_NONE)
+		return 0;
+
+	sphere_cache.slot[slot].refs = 1;
+	sphere_cache.chan_slot[chan][corner] = slot;
+	sphere_cache.misses++;
+	return 1;
+}
+
+// Loads the waveform into a free slot if it's not already cached, without using it.
+// Returns 1 if a flash read was queued
+uint8_t sphere_cache_prefetch(uint8_t wt_num, uint8_t x, uint8_t y, uint8_t z)
+{
+	uint8_t i;
+	o_sphere_cache_slot *s;
+
+	for (i=0; i<SPHERE_CACHE_SIZE; i++) {
+		s = &sphere_cache.slot[i];
+		if (s->valid && s->wt_num==wt_num && s->x==x && s->y==y && s->z==z)
+			return 0;
+	}
+
+	if (load_lru_slot(wt_num, x, y, z, FLASHQ_PRIO_BACKGROUND) == SPHERE_CACHE_NONE)
+		return 0;
+
+	sphere_cache.prefetches++;
+	return 1;
+}
+
+// Gives up all the channel's corners. The slots keep their data for other channels, or until they're reused
+void sphere_cache_release_chan(uint8_t chan)
+{
+	uint8_t i, slot;
+
+	for (i=0; i<8; i++) {
+		slot = sphere_cache.chan_slot[chan][i];
+		if (slot != SPHERE_CACHE_NONE && sphere_cache.slot[slot].refs)
+			sphere_cache.slot[slot].refs--;
+		sphere_cache.chan_slot[chan][i] = SPHERE_CACHE_NONE;
+	}
+}
+
+uint8_t sphere_cache_chan_loading(uint8_t chan)
+{
+	uint8_t i, slot;
+
+	for (i=0; i<8; i++) {
+		slot = sphere_cache.chan_slot[chan][i];
+		if (slot != SPHERE_CACHE_NONE && sphere_cache.slot[slot].loading)
+			return 1;
+	}
+	return 0;
+}
+
+int16_t* sphere_cache_corner(uint8_t chan, uint8_t corner)
+{
+	return sphere_cache.slot[sphere_cache.chan_slot[chan][corner]].wave;
+}
+
+// Call when sphere data in flash changes. Slots in use stay with their channels
+// until they're released, but won't be found again
+void flush_sphere_cache(void)
+{
+	uint8_t i;
+
+	for (i=0; i<SPHERE_CACHE_SIZE; i++)
+		sphere_cache.slot[i].valid = 0;
+}
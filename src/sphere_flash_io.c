@@ -26,6 +26,7 @@
  * -----------------------------------------------------------------------------
  */
 
+#include <string.h>
 #include "globals.h"
 #include "sphere_flash_io.h"
 #include "sphere.h"
@@ -33,20 +34,30 @@
 
 #include "drivers/flash_S25FL127.h"
 #include "drivers/flashram_spidma.h"
+#include "drivers/flashram_queue.h"
 #include "math_util.h"
 #include "timekeeper.h"
 
 #include "external_flash_layout.h"
+#include "sphere_cache.h"
+#include "sphere_pack.h"
+#include "flash_directory.h"
+#include "sphere_log.h"
 
 const uint32_t 	WT_SIZE = sizeof(o_waveform)*WT_DIM_SIZE*WT_DIM_SIZE*WT_DIM_SIZE;
 
-
 char	user_sphere_signature[4];
 char	factory_sphere_signature[4];
 char	cleared_user_sphere_signature[4];
 
 enum SphereTypes sphere_types[MAX_TOTAL_SPHERES];
 
+// Bytes each waveform of a packed sphere takes in flash, or 0 if the sphere is unpacked
+SRAM1DATA uint16_t sphere_pack_bytes[MAX_TOTAL_SPHERES];
+
+static uint8_t 	save_bits = SPHERE_SAVE_LOSSLESS;
+static SRAM1DATA uint8_t pack_buf[PACK_MAX_BYTES];
+
 void init_sphere_flash(void)
 {
 	user_sphere_signature[0]='U';
@@ -65,6 +76,37 @@ void init_sphere_flash(void)
 	cleared_user_sphere_signature[3]='\0';
 }
 
+static void set_spheretype(uint8_t wt_num, enum SphereTypes sphere_type)
+{
+	sphere_types[wt_num] = sphere_type;
+	flash_directory_set_sphere(wt_num, sphere_type, sphere_pack_bytes[wt_num]);
+}
+
+// Spheres are saved packed with this many bits per sample (SPHERE_SAVE_LOSSLESS for all 16),
+// or unpacked with SPHERE_SAVE_UNPACKED
+void set_sphere_save_bits(uint8_t bits)
+{
+	if (bits > SPHERE_SAVE_LOSSLESS) bits = SPHERE_SAVE_LOSSLESS;
+	if (bits && bits < (SPHERE_SAVE_LOSSLESS - PACK_MAX_SHIFT)) bits = SPHERE_SAVE_LOSSLESS - PACK_MAX_SHIFT;
+	save_bits = bits;
+}
+
+// Signatures match with either version
+static uint8_t is_signature(const char *data, const char *signature)
+{
+	return (   data[0] == signature[0]
+			&& data[1] == signature[1]
+			&& (data[2] == SPHERE_VERSION_UNPACKED || data[2] == SPHERE_VERSION_PACKED)
+			&& data[3] == signature[3] );
+}
+
+uint8_t is_sphere_signature(const char *data)
+{
+	return (   is_signature(data, user_sphere_signature)
+			|| is_signature(data, factory_sphere_signature)
+			|| is_signature(data, cleared_user_sphere_signature) );
+}
+
 void write_factory_spheres_to_extflash(void)
 {
 #ifndef SKIP_FACTORY_SPHERES_IN_HEXFILE
@@ -94,7 +136,7 @@ void restore_factory_spheres_to_extflash(void)
 	uint32_t wt_num;
 
 	for (wt_num=0;wt_num<NUM_FACTORY_SPHERES;wt_num++) {
-		if (read_spheretype(wt_num) != SPHERE_TYPE_FACTORY) {
+		if (get_spheretype(wt_num) != SPHERE_TYPE_FACTORY) {
 			if (is_wav_name((char *)(wavetable_list[wt_num])))
 				save_sphere_to_flash(wt_num, SPHERE_TYPE_FACTORY, (int16_t *)wavetable_list[wt_num]);
 		}
@@ -107,113 +149,235 @@ uint32_t get_wt_addr(uint16_t wt_num)
 	if (wt_num >= MAX_TOTAL_SPHERES)
 		wt_num = (MAX_TOTAL_SPHERES-1);
 
-	return (sFLASH_get_sector_addr(WT_SECTOR_START + wt_num));
-}	
+	return sphere_log_addr(wt_num);
+}
 
-// You must check if SPI DMA is busy before calling this or using *waveform.
-// *waveform must point to a global or static memory space (not to the stack)
-void load_extflash_wavetable(uint8_t wt_num, o_waveform *waveform, uint8_t x, uint8_t y, uint8_t z)
+// Address of a waveform's data in flash (after its name, if the sphere is unpacked)
+uint32_t get_extflash_wave_addr(uint8_t wt_num, uint8_t x, uint8_t y, uint8_t z)
 {
 	uint32_t base_addr = get_wt_addr(wt_num);
-	uint32_t addr;
+	uint32_t i;
 
 	x = _CLAMP_U8(x,0,2);
 	y = _CLAMP_U8(y,0,2);
 	z = _CLAMP_U8(z,0,2);
 
 	//calculate where the waveform is within the sphere
-	addr = base_addr + sizeof(user_sphere_signature) + ((x + (y*WT_DIM_SIZE) + (z*WT_DIM_SIZE*WT_DIM_SIZE)) * SPHERE_WAVEFORM_SIZE);
+	i = x + (y*WT_DIM_SIZE) + (z*WT_DIM_SIZE*WT_DIM_SIZE);
 
-	//sFLASH_read_buffer((uint8_t *)(waveform->name), addr, WT_NAME_MONITOR_CHARSIZE);
+	if (get_extflash_wave_packed(wt_num))
+		return base_addr + PACKED_SPHERE_HEADER_SIZE + i * sphere_pack_bytes[wt_num];
+	else
+		return base_addr + sizeof(user_sphere_signature) + (i * SPHERE_WAVEFORM_SIZE) + WT_NAME_MONITOR_CHARSIZE;
+}
 
-	addr += WT_NAME_MONITOR_CHARSIZE;
+uint8_t get_extflash_wave_packed(uint8_t wt_num)
+{
+	return (wt_num < MAX_TOTAL_SPHERES) && sphere_pack_bytes[wt_num];
+}
 
-	sFLASH_read_buffer_DMA((uint8_t *)(waveform->wave), addr, WT_TABLELEN*BYTEDEPTH);
+// Bytes to read for each of the sphere's waveforms
+uint16_t get_extflash_wave_bytes(uint8_t wt_num)
+{
+	return get_extflash_wave_packed(wt_num) ? sphere_pack_bytes[wt_num] : (WT_TABLELEN*BYTEDEPTH);
 }
 
-void load_extflash_wave_raw(uint8_t wt_num, int16_t *waveform, uint8_t x, uint8_t y, uint8_t z)
+// Where in wave[] to read a waveform, so it can be unpacked in place: the last get_extflash_wave_bytes() of it
+uint8_t *get_extflash_wave_buf(uint8_t wt_num, int16_t *wave)
 {
-	uint32_t base_addr = get_wt_addr(wt_num);
-	uint32_t addr;
+	return (uint8_t *)wave + (WT_TABLELEN*BYTEDEPTH) - get_extflash_wave_bytes(wt_num);
+}
 
-	x = _CLAMP_U8(x,0,2);
-	y = _CLAMP_U8(y,0,2);
-	z = _CLAMP_U8(z,0,2);
+// Call after reading a waveform into get_extflash_wave_buf(wave). Does nothing if the sphere is unpacked.
+// A slot starts with the packed size, and the packed bytes are at the end of it
+void unpack_extflash_wave(uint8_t wt_num, int16_t *wave)
+{
+	uint8_t 	*slot;
+	uint16_t 	slot_bytes, num_bytes;
 
-	//calculate where the waveform is within the sphere
-	addr = base_addr + sizeof(user_sphere_signature) + ((x + (y*WT_DIM_SIZE) + (z*WT_DIM_SIZE*WT_DIM_SIZE)) * SPHERE_WAVEFORM_SIZE);
-	addr += WT_NAME_MONITOR_CHARSIZE;
+	if (!get_extflash_wave_packed(wt_num))
+		return;
+
+	slot 		= get_extflash_wave_buf(wt_num, wave);
+	slot_bytes 	= sphere_pack_bytes[wt_num];
+	num_bytes 	= slot[0] | (slot[1] << 8);
+	if (num_bytes > slot_bytes - 2)
+		num_bytes = slot_bytes - 2;
 
-	sFLASH_read_buffer_DMA((uint8_t *)waveform, addr, WT_TABLELEN*BYTEDEPTH);
+	unpack_waveform(wave, slot + slot_bytes - num_bytes, num_bytes);
 }
 
+// Reads the waveform, and waits until it's read
+// *waveform must point to a global or static memory space (not to the stack)
+void load_extflash_wavetable(uint8_t wt_num, o_waveform *waveform, uint8_t x, uint8_t y, uint8_t z)
+{
+	flash_queue_read_wait(get_extflash_wave_buf(wt_num, waveform->wave), get_extflash_wave_addr(wt_num, x, y, z), get_extflash_wave_bytes(wt_num));
+	unpack_extflash_wave(wt_num, waveform->wave);
+}
 
-void save_sphere_to_flash(uint8_t wt_num, enum SphereTypes sphere_type, int16_t *sphere_data){
+// Reads all the waveforms in a sphere with a single flash read, and waits until it's read.
+// The names between the waveforms of an unpacked sphere are read into a scratch buffer.
+// waves[i] is where waveform i goes, in flash order (i = x + y*3 + z*9).
+// The buffers must be global or static memory (not the stack)
+void load_sphere_bulk(uint8_t wt_num, int16_t * const waves[NUM_WAVEFORMS_IN_SPHERE])
+{
+	static sFlashSegment 	segs[NUM_WAVEFORMS_IN_SPHERE * 2 - 1];
+	static uint8_t 			name_buf[WT_NAME_MONITOR_CHARSIZE];
+	uint8_t 				i, num_segs = 0;
+	uint8_t 				packed = get_extflash_wave_packed(wt_num);
+
+	for (i=0; i<NUM_WAVEFORMS_IN_SPHERE; i++) {
+		if (i && !packed) {
+			segs[num_segs].buf 			= name_buf;
+			segs[num_segs].num_bytes 	= WT_NAME_MONITOR_CHARSIZE;
+			num_segs++;
+		}
+		segs[num_segs].buf 			= get_extflash_wave_buf(wt_num, waves[i]);
+		segs[num_segs].num_bytes 	= get_extflash_wave_bytes(wt_num);
+		num_segs++;
+	}
 
-	uint32_t sz;
-	uint32_t base_addr = get_wt_addr(wt_num);
+	flash_queue_read_segments_wait(segs, num_segs, get_extflash_wave_addr(wt_num, 0, 0, 0));
 
-	pause_timer_IRQ(WT_INTERP_TIM_number);
+	for (i=0; i<NUM_WAVEFORMS_IN_SPHERE; i++)
+		unpack_extflash_wave(wt_num, waves[i]);
+}
 
-	sFLASH_erase_sector(base_addr);
+// Bytes per waveform that all of waves[] can be packed into.
+// Returns 0 if one can't be packed (or it wouldn't save any space)
+static uint16_t get_sphere_pack_bytes(const o_waveform * const waves[NUM_WAVEFORMS_IN_SPHERE], uint8_t shift)
+{
+	uint16_t i, sz;
+	uint16_t slot_bytes = 0;
+
+	for (i=0; i<NUM_WAVEFORMS_IN_SPHERE; i++) {
+		sz = pack_waveform(waves[i]->wave, shift, pack_buf);
+		if (!sz) return 0;
+		if (sz > slot_bytes) slot_bytes = sz;
+	}
+
+	slot_bytes = (slot_bytes + 2 + 3) & ~3;
+	if (slot_bytes >= PACK_MAX_BYTES)
+		return 0;
+
+	return slot_bytes;
+}
+
+// Packs a waveform into pack_buf as a slot of slot_bytes: the packed size, padding, then the packed bytes
+static void pack_slot(const int16_t *wave, uint8_t shift, uint16_t slot_bytes)
+{
+	uint16_t num_bytes = pack_waveform(wave, shift, pack_buf);
+
+	memmove(&pack_buf[slot_bytes - num_bytes], pack_buf, num_bytes);
+	memset(&pack_buf[2], 0xFF, slot_bytes - num_bytes - 2);
+	pack_buf[0] = num_bytes & 0xFF;
+	pack_buf[1] = num_bytes >> 8;
+}
+
+// Writes waves[] (in flash order) into the sphere log, packed if save_bits is set and they can be.
+// The signature is written last, then the old copy is zeroed
+static void write_sphere(uint8_t wt_num, enum SphereTypes sphere_type, const o_waveform * const waves[NUM_WAVEFORMS_IN_SPHERE])
+{
+	static uint8_t 	header[PACKED_SPHERE_HEADER_SIZE];
+	uint32_t 		sphere_addr, base_addr;
+	uint32_t 		num_bytes, crc;
+	uint16_t 		slot_bytes = 0;
+	uint8_t 		shift = 0;
+	uint8_t 		i;
 
-	//Write signature
-	sz = 4;
 	if (sphere_type == SPHERE_TYPE_USER)
-		sFLASH_write_buffer((uint8_t *)user_sphere_signature, base_addr, sz);
+		memcpy(header, user_sphere_signature, 4);
 	else
 	if (sphere_type == SPHERE_TYPE_FACTORY)
-		sFLASH_write_buffer((uint8_t *)factory_sphere_signature, base_addr, sz);
+		memcpy(header, factory_sphere_signature, 4);
 	else 
 		return; //error, bad sphere_type
 
-	base_addr += sz;
+	if (save_bits) {
+		shift = SPHERE_SAVE_LOSSLESS - save_bits;
+		slot_bytes = get_sphere_pack_bytes(waves, shift);
+	}
+
+	if (slot_bytes)
+		num_bytes = PACKED_SPHERE_HEADER_SIZE + NUM_WAVEFORMS_IN_SPHERE * slot_bytes;
+	else
+		num_bytes = 4 + NUM_WAVEFORMS_IN_SPHERE * sizeof(o_waveform);
+
+	flash_directory_changing();
+
+	pause_timer_IRQ(WT_INTERP_TIM_number);
+	flush_sphere_cache();
 
-	sFLASH_write_buffer((uint8_t *)sphere_data, base_addr, WT_SIZE);
+	sphere_addr = sphere_log_start(wt_num, num_bytes);
+	if (!sphere_addr) {
+		resume_timer_IRQ(WT_INTERP_TIM_number);
+		return;
+	}
+
+	if (slot_bytes) {
+		header[2] = SPHERE_VERSION_PACKED;
+		header[4] = slot_bytes & 0xFF;
+		header[5] = slot_bytes >> 8;
+		header[6] = 0xFF;
+		header[7] = 0xFF;
+		base_addr = sphere_addr + PACKED_SPHERE_HEADER_SIZE;
+		crc = _CRC32(0, &header[4], PACKED_SPHERE_HEADER_SIZE - 4);
+
+		for (i=0; i<NUM_WAVEFORMS_IN_SPHERE; i++) {
+			pack_slot(waves[i]->wave, shift, slot_bytes);
+			flash_queue_write_wait(pack_buf, base_addr, slot_bytes);
+			crc = _CRC32(crc, pack_buf, slot_bytes);
+			base_addr += slot_bytes;
+		}
+		sphere_log_commit(wt_num, sphere_addr, crc, header, PACKED_SPHERE_HEADER_SIZE);
+	} else {
+		base_addr = sphere_addr + 4;
+		crc = 0;
+
+		for (i=0; i<NUM_WAVEFORMS_IN_SPHERE; i++) {
+			flash_queue_write_wait((uint8_t *)waves[i], base_addr, sizeof(o_waveform));
+			crc = _CRC32(crc, (const uint8_t *)waves[i], sizeof(o_waveform));
+			base_addr += sizeof(o_waveform);
+		}
+		sphere_log_commit(wt_num, sphere_addr, crc, header, 4);
+	}
 
 	resume_timer_IRQ(WT_INTERP_TIM_number);
 
-	sphere_types[wt_num] = sphere_type;
+	sphere_pack_bytes[wt_num] = slot_bytes;
+	set_spheretype(wt_num, sphere_type);
 }
 
-void save_unformatted_sphere_to_flash(uint8_t wt_num, enum SphereTypes sphere_type, o_waveform sphere_data[WT_DIM_SIZE][WT_DIM_SIZE][WT_DIM_SIZE]){
 
-	uint32_t sz;
-	uint32_t base_addr = get_wt_addr(wt_num);
-	uint8_t dim1 = 0;
-	uint8_t dim2 = 0;
-	uint8_t dim3 = 0;
+// sphere_data is an unpacked sphere as it's stored in flash (without the signature)
+void save_sphere_to_flash(uint8_t wt_num, enum SphereTypes sphere_type, int16_t *sphere_data){
 
+	const o_waveform *waves[NUM_WAVEFORMS_IN_SPHERE];
+	uint8_t i;
 
-	pause_timer_IRQ(WT_INTERP_TIM_number);
+	for (i=0; i<NUM_WAVEFORMS_IN_SPHERE; i++)
+		waves[i] = (const o_waveform *)sphere_data + i;
 
-	sFLASH_erase_sector(base_addr);
+	write_sphere(wt_num, sphere_type, waves);
+}
 
-	//Write signature
-	sz = 4;
-	if (sphere_type == SPHERE_TYPE_USER)
-		sFLASH_write_buffer((uint8_t *)user_sphere_signature, base_addr, sz);
-	else
-	if (sphere_type == SPHERE_TYPE_FACTORY)
-		sFLASH_write_buffer((uint8_t *)factory_sphere_signature, base_addr, sz);
-	else 
-		return; //error, bad sphere_type
+void save_unformatted_sphere_to_flash(uint8_t wt_num, enum SphereTypes sphere_type, o_waveform sphere_data[WT_DIM_SIZE][WT_DIM_SIZE][WT_DIM_SIZE]){
 
-	base_addr += sz;
+	const o_waveform *waves[NUM_WAVEFORMS_IN_SPHERE];
+	uint8_t dim1 = 0;
+	uint8_t dim2 = 0;
+	uint8_t dim3 = 0;
+	uint8_t i = 0;
 
-	sz = sizeof(o_waveform);
 	for (dim1=0; dim1<WT_DIM_SIZE; dim1++) {
 		for (dim2=0; dim2<WT_DIM_SIZE; dim2++) {
 			for (dim3=0; dim3<WT_DIM_SIZE; dim3++) {
-				sFLASH_write_buffer((uint8_t *)(&sphere_data[dim3][dim2][dim1]), base_addr, sz);
-				base_addr+=sz;
+				waves[i++] = &sphere_data[dim3][dim2][dim1];
 			}
 		}
 	}
 
-	resume_timer_IRQ(WT_INTERP_TIM_number);
-
-	sphere_types[wt_num] = sphere_type;
+	write_sphere(wt_num, sphere_type, waves);
 }
 
 enum SphereTypes get_spheretype(uint32_t wt_num)
@@ -225,31 +389,37 @@ enum SphereTypes read_spheretype(uint32_t wt_num)
 {
 	uint32_t addr = get_wt_addr(wt_num);
 	uint32_t sz;
-	static char	read_sphere_type_data[4];
+	uint16_t slot_bytes = 0;
+	static char	read_sphere_type_data[PACKED_SPHERE_HEADER_SIZE];
+
+	if (wt_num < MAX_TOTAL_SPHERES)
+		sphere_pack_bytes[wt_num] = 0;
+	if (!addr)
+		return SPHERE_TYPE_EMPTY;
 
 	pause_timer_IRQ(WT_INTERP_TIM_number);
 
-	sz = 4;
-	sFLASH_read_buffer((uint8_t *)read_sphere_type_data, addr, sz);
+	sz = PACKED_SPHERE_HEADER_SIZE;
+	flash_queue_read_wait((uint8_t *)read_sphere_type_data, addr, sz);
 
 	resume_timer_IRQ(WT_INTERP_TIM_number);
 
-	if (   read_sphere_type_data[0] == user_sphere_signature[0] 
-		&& read_sphere_type_data[1] == user_sphere_signature[1] 
-		&& read_sphere_type_data[2] == user_sphere_signature[2] 
-		&& read_sphere_type_data[3] == user_sphere_signature[3] )
+	//A packed sphere's header has the size of each waveform after its signature
+	if (read_sphere_type_data[2] == SPHERE_VERSION_PACKED) {
+		slot_bytes = (uint8_t)read_sphere_type_data[4] | ((uint8_t)read_sphere_type_data[5] << 8);
+		if (slot_bytes < PACK_HEADER_BYTES + 2 || slot_bytes >= PACK_MAX_BYTES)
+			return SPHERE_TYPE_EMPTY;
+	}
+	if (wt_num < MAX_TOTAL_SPHERES)
+		sphere_pack_bytes[wt_num] = slot_bytes;
+
+	if (is_signature(read_sphere_type_data, user_sphere_signature))
 		return SPHERE_TYPE_USER;
 	else
-	if (   read_sphere_type_data[0] == factory_sphere_signature[0] 
-		&& read_sphere_type_data[1] == factory_sphere_signature[1] 
-		&& read_sphere_type_data[2] == factory_sphere_signature[2] 
-		&& read_sphere_type_data[3] == factory_sphere_signature[3] )
+	if (is_signature(read_sphere_type_data, factory_sphere_signature))
 		return SPHERE_TYPE_FACTORY;
 	else
-	if (   read_sphere_type_data[0] == cleared_user_sphere_signature[0] 
-		&& read_sphere_type_data[1] == cleared_user_sphere_signature[1] 
-		&& read_sphere_type_data[2] == cleared_user_sphere_signature[2] 
-		&& read_sphere_type_data[3] == cleared_user_sphere_signature[3] )
+	if (is_signature(read_sphere_type_data, cleared_user_sphere_signature))
 		return SPHERE_TYPE_CLEARED;
 	else
 		return SPHERE_TYPE_EMPTY;
@@ -261,18 +431,23 @@ enum SphereTypes clear_user_sphere(uint8_t wt_num)
 	uint32_t addr;
 	uint32_t sz;
 	static char	read_data[4];
+	static char	sig[4];
 
 	pause_timer_IRQ(WT_INTERP_TIM_number);
 
 	sz = 4;
 	addr = get_wt_addr(wt_num);
-	sFLASH_read_buffer((uint8_t *)read_data, addr, sz);
+	if (addr)
+		flash_queue_read_wait((uint8_t *)read_data, addr, sz);
 
-	if ((sphere_types[wt_num]==SPHERE_TYPE_USER) ||
-		(read_data[0] == user_sphere_signature[0] && read_data[1] == user_sphere_signature[1] && read_data[2] == user_sphere_signature[2] && read_data[3] == user_sphere_signature[3]))
+	if (addr && ((sphere_types[wt_num]==SPHERE_TYPE_USER) || is_signature(read_data, user_sphere_signature)))
 	{
-		sFLASH_write_buffer((uint8_t *)cleared_user_sphere_signature, addr, sz);
-		sphere_types[wt_num] = SPHERE_TYPE_CLEARED;
+		//keep the version, so a packed sphere stays readable
+		memcpy(sig, cleared_user_sphere_signature, sz);
+		if (get_extflash_wave_packed(wt_num)) sig[2] = SPHERE_VERSION_PACKED;
+		flash_directory_changing();
+		flash_queue_write_wait((uint8_t *)sig, addr, sz);
+		set_spheretype(wt_num, SPHERE_TYPE_CLEARED);
 	}
 	resume_timer_IRQ(WT_INTERP_TIM_number);
 
@@ -284,18 +459,22 @@ enum SphereTypes unclear_user_sphere(uint8_t wt_num)
 	uint32_t addr;
 	uint32_t sz;
 	static char	read_data[4];
+	static char	sig[4];
 
 	pause_timer_IRQ(WT_INTERP_TIM_number);
 
 	sz = 4;
 	addr = get_wt_addr(wt_num);
-	sFLASH_read_buffer((uint8_t *)read_data, addr, sz);
+	if (addr)
+		flash_queue_read_wait((uint8_t *)read_data, addr, sz);
 
-	if ((sphere_types[wt_num]==SPHERE_TYPE_CLEARED) ||
-		(read_data[0] == cleared_user_sphere_signature[0] && read_data[1] == cleared_user_sphere_signature[1] && read_data[2] == cleared_user_sphere_signature[2] && read_data[3] == cleared_user_sphere_signature[3]))
+	if (addr && ((sphere_types[wt_num]==SPHERE_TYPE_CLEARED) || is_signature(read_data, cleared_user_sphere_signature)))
 	{
-		sFLASH_write_buffer((uint8_t *)user_sphere_signature, addr, sz);
-		sphere_types[wt_num] = SPHERE_TYPE_USER;
+		memcpy(sig, user_sphere_signature, sz);
+		if (get_extflash_wave_packed(wt_num)) sig[2] = SPHERE_VERSION_PACKED;
+		flash_directory_changing();
+		flash_queue_write_wait((uint8_t *)sig, addr, sz);
+		set_spheretype(wt_num, SPHERE_TYPE_USER);
 	}
 	resume_timer_IRQ(WT_INTERP_TIM_number);
 
@@ -317,30 +496,49 @@ void empty_all_user_spheres(void)
 	{
 		sz = 4;
  		addr = get_wt_addr(wt_num);
- 		sFLASH_read_buffer((uint8_t *)read_data, addr, sz);
+		if (!addr)
+			continue;
+ 		flash_queue_read_wait((uint8_t *)read_data, addr, sz);
 
-		if ((sphere_types[wt_num]==SPHERE_TYPE_USER) ||
-			(read_data[0] == user_sphere_signature[0] && read_data[1] == user_sphere_signature[1] && read_data[2] == user_sphere_signature[2] && read_data[3] == user_sphere_signature[3]))
+		if ((sphere_types[wt_num]==SPHERE_TYPE_USER) || is_signature(read_data, user_sphere_signature))
 		{
-			read_data[0] = 0x00;
-			read_data[1] = 0x00;
-			read_data[2] = 0x00;
-			read_data[3] = 0x00;
-			sFLASH_write_buffer((uint8_t *)read_data, addr, sz);
-			
-			sphere_types[wt_num] = SPHERE_TYPE_EMPTY;
+			flash_directory_changing();
+			sphere_log_clear(wt_num);
+
+			set_spheretype(wt_num, SPHERE_TYPE_EMPTY);
 		}
 	}
 	resume_timer_IRQ(WT_INTERP_TIM_number);
 }
 
+// From the flash directory, or by reading each sphere if the directory is stale
 void read_all_spheretypes(void)
 {
 	uint8_t i;
 
+	if (flash_directory_has_spheres()) {
+		for (i=0; i< MAX_TOTAL_SPHERES; i++)
+			sphere_types[i] = flash_directory_spheretype(i, &sphere_pack_bytes[i]);
+		return;
+	}
+
 	for (i=0; i< MAX_TOTAL_SPHERES; i++){
 		sphere_types[i] = read_spheretype(i);
+		flash_directory_set_sphere(i, sphere_types[i], sphere_pack_bytes[i]);
 	}	
+	flash_directory_spheres_scanned();
+}
+
+void forget_sphere(uint8_t wt_num)
+{
+	if (wt_num >= MAX_TOTAL_SPHERES)
+		return;
+
+	pause_timer_IRQ(WT_INTERP_TIM_number);
+	sphere_pack_bytes[wt_num] = 0;
+	set_spheretype(wt_num, SPHERE_TYPE_EMPTY);
+	flush_sphere_cache();
+	resume_timer_IRQ(WT_INTERP_TIM_number);
 }
 
 uint8_t is_sphere_filled(uint8_t wt_num){
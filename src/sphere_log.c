@@ -0,0 +1,419 @@
+/*
+ * sphere_log.c - Spheres saved as an append-only log in the sphere sectors
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "sphere_log.h"
+#include "sphere_flash_io.h"
+#include "flash_directory.h"
+#include "drivers/flashram_queue.h"
+#include "math_util.h"
+#include "globals.h"
+
+#define UNITS 		SPHERE_LOG_UNITS_PER_SECTOR
+#define SECTORS 	SPHERE_LOG_NUM_SECTORS
+
+static SRAM1DATA o_sphere_log slog;
+
+static SRAM1DATA uint8_t verify_buf[SPHERE_LOG_VERIFY_CHUNK];
+
+static o_sphere_log_header header;
+static uint32_t commit_crc;
+static uint32_t zero_sig = 0;
+
+
+static uint32_t sector_addr(uint8_t s)
+{
+	return sFLASH_get_sector_addr(WT_SECTOR_START + s);
+}
+
+static uint8_t sector_of(uint32_t addr)
+{
+	return (addr - sector_addr(0)) / SPHERE_LOG_SECTOR_SIZE;
+}
+
+// Spheres in the old layout are at the start of a sector, with no header
+static uint8_t is_legacy_sphere(uint32_t addr)
+{
+	return addr == sector_addr(sector_of(addr));
+}
+
+static uint8_t units_used(uint8_t s)
+{
+	return slog.sector[s] & ~SPHERE_LOG_LEGACY;
+}
+
+static uint8_t units_free(uint8_t s)
+{
+	if (slog.sector[s] & SPHERE_LOG_LEGACY)
+		return 0;
+
+	return UNITS - units_used(s);
+}
+
+static void set_sector(uint8_t s, uint8_t state)
+{
+	slog.sector[s] = state;
+	flash_directory_set_sphere_log_sector(s, state);
+}
+
+static void set_sphere(uint8_t wt_num, uint32_t addr)
+{
+	if (slog.addr[wt_num])
+		slog.live[sector_of(slog.addr[wt_num])]--;
+	if (addr)
+		slog.live[sector_of(addr)]++;
+
+	slog.addr[wt_num] = addr;
+	flash_directory_set_sphere_addr(wt_num, addr);
+}
+
+// A sector that's been written to, with no spheres left.
+// Starts after the head, so the erases go round all the sectors
+static uint8_t find_dead_sector(void)
+{
+	uint8_t s, i;
+	uint8_t start = (slog.head == SPHERE_LOG_NONE) ? (SECTORS - 1) : slog.head;
+
+	for (i = 1; i <= SECTORS; i++) {
+		s = (start + i) % SECTORS;
+		if (slog.sector[s] && !slog.live[s])
+			return s;
+	}
+	return SPHERE_LOG_NONE;
+}
+
+// num_units free units in one sector: the rest of the head sector, or else the next erased sector,
+// or else the rest of any sector with room. If there's none, a sector with no spheres left is erased.
+// Returns 0 if there's no room
+static uint32_t alloc_units(uint8_t num_units)
+{
+	uint8_t s, i, unit;
+	uint8_t start = (slog.head == SPHERE_LOG_NONE) ? (SECTORS - 1) : slog.head;
+
+	if (slog.head == SPHERE_LOG_NONE || units_free(slog.head) < num_units) {
+		slog.head = SPHERE_LOG_NONE;
+
+		for (i = 1; i <= SECTORS; i++) {
+			s = (start + i) % SECTORS;
+			if (!slog.sector[s]) {
+				slog.head = s;
+				break;
+			}
+		}
+		for (s = 0; s < SECTORS && slog.head == SPHERE_LOG_NONE; s++) {
+			if (units_free(s) >= num_units)
+				slog.head = s;
+		}
+		if (slog.head == SPHERE_LOG_NONE) {
+			s = find_dead_sector();
+			if (s == SPHERE_LOG_NONE)
+				return 0;
+
+			flash_queue_erase_sector_wait(sector_addr(s));
+			set_sector(s, 0);
+			slog.head = s;
+		}
+	}
+
+	s = slog.head;
+	unit = units_used(s);
+	set_sector(s, unit + num_units);
+
+	return sector_addr(s) + unit * SPHERE_LOG_UNIT_SIZE;
+}
+
+
+//
+// Saving and clearing
+//
+
+uint32_t sphere_log_start(uint8_t wt_num, uint32_t num_bytes)
+{
+	uint8_t num_units = (SPHERE_LOG_HEADER_SIZE + num_bytes + SPHERE_LOG_UNIT_SIZE - 1) / SPHERE_LOG_UNIT_SIZE;
+	uint32_t addr;
+
+	if (wt_num >= MAX_TOTAL_SPHERES || num_units > UNITS)
+		return 0;
+
+	addr = alloc_units(num_units);
+	if (!addr)
+		return 0;
+
+	header.sig[0] = 'S';
+	header.sig[1] = 'L';
+	header.wt_num = wt_num;
+	header.num_units = num_units;
+	header.seq = slog.next_seq++;
+	header.num_bytes = num_bytes;
+	header.crc = 0xFFFFFFFF;
+	flash_directory_set_sphere_log_seq(slog.next_seq);
+
+	flash_queue_write_wait((uint8_t *)&header, addr, SPHERE_LOG_HEADER_SIZE);
+	return addr + SPHERE_LOG_HEADER_SIZE;
+}
+
+void sphere_log_commit(uint8_t wt_num, uint32_t addr, uint32_t crc, uint8_t *sig, uint8_t sig_bytes)
+{
+	commit_crc = crc;
+	flash_queue_write_wait((uint8_t *)&commit_crc, addr - 4, 4);
+	flash_queue_write_wait(sig, addr, sig_bytes);
+
+	if (slog.addr[wt_num])
+		flash_queue_write_wait((uint8_t *)&zero_sig, slog.addr[wt_num], 4);
+
+	set_sphere(wt_num, addr);
+}
+
+void sphere_log_clear(uint8_t wt_num)
+{
+	if (wt_num >= MAX_TOTAL_SPHERES || !slog.addr[wt_num])
+		return;
+
+	flash_queue_write_wait((uint8_t *)&zero_sig, slog.addr[wt_num], 4);
+	set_sphere(wt_num, 0);
+}
+
+uint32_t sphere_log_addr(uint8_t wt_num)
+{
+	if (wt_num >= MAX_TOTAL_SPHERES) return 0;
+	return slog.addr[wt_num];
+}
+
+
+//
+// Checking the crcs, after boot
+//
+
+static void drop_sphere(uint8_t wt_num)
+{
+	flash_directory_changing();
+	sphere_log_clear(wt_num);
+	forget_sphere(wt_num);
+}
+
+static void verify_read(uint32_t ctx)
+{
+	slog.verify_reading = 0;
+}
+
+static void read_verify_chunk(void)
+{
+	uint32_t num_bytes = slog.verify_bytes - slog.verify_pos;
+
+	if (num_bytes > SPHERE_LOG_VERIFY_CHUNK)
+		num_bytes = SPHERE_LOG_VERIFY_CHUNK;
+
+	slog.verify_reading = 1;
+	while (flash_queue_read(verify_buf, slog.verify_addr + slog.verify_pos, num_bytes, FLASHQ_PRIO_BACKGROUND, verify_read, 0) == FLASHQ_NONE)
+		flash_queue_service();
+}
+
+// Starts reading the next sphere. Spheres in the old layout have no crc
+static void start_verify(void)
+{
+	o_sphere_log_header h;
+	uint8_t wt_num;
+
+	while (slog.verify_next < MAX_TOTAL_SPHERES) {
+		wt_num = slog.verify_next++;
+		if (!slog.addr[wt_num] || is_legacy_sphere(slog.addr[wt_num]))
+			continue;
+
+		flash_queue_read_wait((uint8_t *)&h, slog.addr[wt_num] - SPHERE_LOG_HEADER_SIZE, SPHERE_LOG_HEADER_SIZE);
+
+		slog.verify_wt 		= wt_num;
+		slog.verify_addr 	= slog.addr[wt_num];
+		slog.verify_pos 	= 4;
+		slog.verify_bytes 	= h.num_bytes;
+		slog.verify_crc 	= 0;
+		slog.verify_expect 	= h.crc;
+
+		if (h.num_bytes > 4 && h.num_bytes <= h.num_units * SPHERE_LOG_UNIT_SIZE - SPHERE_LOG_HEADER_SIZE) {
+			read_verify_chunk();
+			return;
+		}
+		slog.verify_bytes = 0;
+		drop_sphere(wt_num);
+	}
+}
+
+// Reads only when nothing else is queued, so the channels' reads don't wait for it
+void update_sphere_log(void)
+{
+	uint32_t num_bytes;
+
+	if (slog.verify_reading || !flash_queue_is_idle())
+		return;
+
+	if (slog.verify_pos >= slog.verify_bytes) {
+		start_verify();
+		return;
+	}
+
+	//Saved or cleared since it was read
+	if (slog.addr[slog.verify_wt] != slog.verify_addr) {
+		slog.verify_bytes = 0;
+		return;
+	}
+
+	num_bytes = slog.verify_bytes - slog.verify_pos;
+	if (num_bytes > SPHERE_LOG_VERIFY_CHUNK)
+		num_bytes = SPHERE_LOG_VERIFY_CHUNK;
+
+	slog.verify_crc = _CRC32(slog.verify_crc, verify_buf, num_bytes);
+	slog.verify_pos += num_bytes;
+
+	if (slog.verify_pos < slog.verify_bytes) {
+		read_verify_chunk();
+		return;
+	}
+
+	if (slog.verify_crc != slog.verify_expect)
+		drop_sphere(slog.verify_wt);
+}
+
+
+//
+// Finding the spheres at boot
+//
+
+static uint32_t record_seq(uint32_t addr)
+{
+	o_sphere_log_header h;
+
+	//Spheres in the old layout have no header, and are older than any in the log
+	if (is_legacy_sphere(addr))
+		return 0;
+
+	flash_queue_read_wait((uint8_t *)&h, addr - SPHERE_LOG_HEADER_SIZE, SPHERE_LOG_HEADER_SIZE);
+	return h.seq;
+}
+
+static void scan_found(uint8_t wt_num, uint32_t addr, uint32_t seq)
+{
+	uint32_t old_addr = slog.addr[wt_num];
+
+	//The power went off before the old copy was zeroed
+	if (old_addr) {
+		if (record_seq(old_addr) > seq) {
+			flash_queue_write_wait((uint8_t *)&zero_sig, addr, 4);
+			return;
+		}
+		flash_queue_write_wait((uint8_t *)&zero_sig, old_addr, 4);
+	}
+
+	slog.addr[wt_num] = addr;
+}
+
+static void scan_sector(uint8_t s)
+{
+	uint32_t base = sector_addr(s);
+	uint8_t rd[SPHERE_LOG_HEADER_SIZE + 4];
+	o_sphere_log_header h;
+	uint8_t unit;
+
+	slog.sector[s] = 0;
+
+	flash_queue_read_wait(rd, base, sizeof(rd));
+	if (rd[0] != 'S' || rd[1] != 'L') {
+		if (rd[0] == 0xFF && rd[1] == 0xFF && rd[2] == 0xFF && rd[3] == 0xFF)
+			return;
+
+		slog.sector[s] = SPHERE_LOG_LEGACY | UNITS;
+		if (s < MAX_TOTAL_SPHERES && is_sphere_signature((char *)rd))
+			scan_found(s, base, 0);
+		return;
+	}
+
+	for (unit = 0; unit < UNITS; unit += h.num_units) {
+		flash_queue_read_wait(rd, base + unit * SPHERE_LOG_UNIT_SIZE, sizeof(rd));
+		if (rd[0] == 0xFF && rd[1] == 0xFF)
+			break;
+
+		//Can't tell where the next record starts, so don't use the rest of the sector
+		memcpy(&h, rd, SPHERE_LOG_HEADER_SIZE);
+		if (h.sig[0] != 'S' || h.sig[1] != 'L' || !h.num_units || h.num_units > UNITS - unit) {
+			unit = UNITS;
+			break;
+		}
+
+		if (h.seq >= slog.next_seq)
+			slog.next_seq = h.seq + 1;
+
+		if (h.wt_num < MAX_TOTAL_SPHERES && is_sphere_signature((char *)rd + SPHERE_LOG_HEADER_SIZE))
+			scan_found(h.wt_num, base + unit * SPHERE_LOG_UNIT_SIZE + SPHERE_LOG_HEADER_SIZE, h.seq);
+	}
+	slog.sector[s] = unit;
+}
+
+void init_sphere_log(void)
+{
+	uint8_t s, i;
+
+	slog.head = SPHERE_LOG_NONE;
+	slog.verify_next = 0;
+	slog.verify_pos = 0;
+	slog.verify_bytes = 0;
+	slog.verify_reading = 0;
+
+	for (i = 0; i < MAX_TOTAL_SPHERES; i++)
+		slog.addr[i] = 0;
+
+	//From the flash directory, or by reading the sphere sectors if the directory is stale
+	if (flash_directory_has_spheres()) {
+		slog.next_seq = flash_directory_sphere_log_seq();
+		for (s = 0; s < SECTORS; s++)
+			slog.sector[s] = flash_directory_sphere_log_sector(s);
+		for (i = 0; i < MAX_TOTAL_SPHERES; i++)
+			slog.addr[i] = flash_directory_sphere_addr(i);
+	}
+	else {
+		slog.next_seq = 1;
+		for (s = 0; s < SECTORS; s++)
+			scan_sector(s);
+
+		for (s = 0; s < SECTORS; s++)
+			flash_directory_set_sphere_log_sector(s, slog.sector[s]);
+		for (i = 0; i < MAX_TOTAL_SPHERES; i++)
+			flash_directory_set_sphere_addr(i, slog.addr[i]);
+		flash_directory_set_sphere_log_seq(slog.next_seq);
+	}
+
+	for (s = 0; s < SECTORS; s++)
+		slog.live[s] = 0;
+	for (i = 0; i < MAX_TOTAL_SPHERES; i++) {
+		if (slog.addr[i])
+			slog.live[sector_of(slog.addr[i])]++;
+	}
+
+	//Keep writing into a sector that's partly used
+	for (s = 0; s < SECTORS && slog.head == SPHERE_LOG_NONE; s++) {
+		if (units_used(s) && units_free(s))
+			slog.head = s;
+	}
+}
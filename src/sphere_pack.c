@@ -0,0 +1,271 @@
+/*
+ * sphere_pack.c - Compression of waveforms stored in external flash
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include "sphere_pack.h"
+
+typedef struct o_bit_writer {
+	uint8_t 	*out;
+	uint32_t 	pos;		// bits written
+	uint32_t 	max_bits;
+} o_bit_writer;
+
+typedef struct o_bit_reader {
+	const uint8_t 	*in;
+	const uint8_t 	*end;
+	uint32_t 		acc;		// next bits, msb first
+	uint8_t 		num_bits;	// bits in acc
+} o_bit_reader;
+
+static inline uint32_t zigzag(int32_t r)
+{
+	return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u)
+{
+	return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+static inline int32_t predict(uint8_t order, int32_t q1, int32_t q2)
+{
+	if (order == 2) return 2*q1 - q2;
+	if (order == 1) return q1;
+	return 0;
+}
+
+static inline uint32_t rice_bits(uint32_t u, uint8_t k)
+{
+	uint32_t q = u >> k;
+	return (q < PACK_RICE_ESCAPE) ? (q + 1 + k) : (PACK_RICE_ESCAPE + PACK_ESCAPE_BITS);
+}
+
+static void put_bits(o_bit_writer *w, uint32_t val, uint8_t n)
+{
+	while (n--) {
+		if (w->pos < w->max_bits) {
+			uint8_t mask = 0x80 >> (w->pos & 7);
+			if ((val >> n) & 1) w->out[w->pos >> 3] |= mask;
+			else 				w->out[w->pos >> 3] &= ~mask;
+		}
+		w->pos++;
+	}
+}
+
+// Loads bytes one at a time, only while acc has room for all 8 bits of them.
+// So bytes are read at most 4 ahead of the bits used, never past end.
+static inline void refill(o_bit_reader *r)
+{
+	while (r->num_bits <= 24 && r->in < r->end) {
+		r->acc |= (uint32_t)(*r->in++) << (24 - r->num_bits);
+		r->num_bits += 8;
+	}
+}
+
+static inline uint32_t get_bits(o_bit_reader *r, uint8_t n)
+{
+	uint32_t v;
+
+	if (!n) return 0;
+	refill(r);
+	v = r->acc >> (32 - n);
+	r->acc <<= n;
+	r->num_bits = (r->num_bits > n) ? (r->num_bits - n) : 0;
+	return v;
+}
+
+static inline uint32_t get_rice(o_bit_reader *r, uint8_t k)
+{
+	uint32_t q;
+
+	refill(r);
+	q = ~r->acc ? __builtin_clz(~r->acc) : 32;
+	if (q >= PACK_RICE_ESCAPE) {
+		get_bits(r, PACK_RICE_ESCAPE);
+		return get_bits(r, PACK_ESCAPE_BITS);
+	}
+	get_bits(r, q + 1);
+	return (q << k) | get_bits(r, k);
+}
+
+// Sample values with the low bits dropped (rounded, not truncated)
+static inline int32_t quantize(int16_t x, uint8_t shift)
+{
+	int32_t q;
+
+	if (!shift) return x;
+	q = ((int32_t)x + (1 << (shift-1))) >> shift;
+	if (q > (32767 >> shift)) q = 32767 >> shift;
+	return q;
+}
+
+// Writes the packed waveform, and the bytes needed to unpack up to each sample to pos[]. Returns the number of bytes
+static uint16_t pack_with(const int16_t *wave, uint8_t shift, uint8_t order, const uint8_t *k, uint8_t *out, uint16_t *pos)
+{
+	o_bit_writer 	w;
+	uint16_t 		i;
+	uint8_t 		b, kk;
+	int32_t 		q, q1, q2;
+	uint32_t 		u;
+
+	w.out = out;
+	w.pos = 0;
+	w.max_bits = PACK_MAX_BYTES * 8;
+
+	put_bits(&w, (order << 4) | shift, 8);
+	for (b=0; b<PACK_NUM_BLOCKS; b++)
+		put_bits(&w, k[b], 4);
+
+	q1 = q2 = 0;
+	for (i=0; i<WT_TABLELEN; i++) {
+		q = quantize(wave[i], shift);
+		u = zigzag(q - predict(order, q1, q2));
+		kk = k[i / PACK_BLOCK_SIZE];
+
+		if (kk == PACK_RAW_BLOCK)
+			put_bits(&w, (uint32_t)q, 16 - shift);
+		else
+		if ((u >> kk) < PACK_RICE_ESCAPE) {
+			put_bits(&w, ((1 << (u >> kk)) - 1) << 1, (u >> kk) + 1);
+			put_bits(&w, u & ((1 << kk) - 1), kk);
+		} else {
+			put_bits(&w, (1 << PACK_RICE_ESCAPE) - 1, PACK_RICE_ESCAPE);
+			put_bits(&w, u, PACK_ESCAPE_BITS);
+		}
+
+		pos[i] = (w.pos + 7) >> 3;
+		q2 = q1;
+		q1 = q;
+	}
+	return (w.pos + 7) >> 3;
+}
+
+uint16_t pack_waveform(const int16_t *wave, uint8_t shift, uint8_t *out)
+{
+	uint32_t 		block_bits[PACK_RAW_BLOCK+1], bits, best_bits = 0xFFFFFFFF;
+	uint8_t 		k[PACK_NUM_BLOCKS], best_k[PACK_NUM_BLOCKS];
+	uint8_t 		order, best_order = 0, b, kk;
+	uint16_t 		i, num_bytes;
+	uint16_t 		pos[WT_TABLELEN];
+	int32_t 		q1, q2;
+	uint32_t 		u;
+
+	if (shift > PACK_MAX_SHIFT) shift = PACK_MAX_SHIFT;
+
+	// Pick the predictor, and the Rice parameter of each block, that make it smallest
+	for (order=0; order<=PACK_MAX_ORDER; order++) {
+		bits = PACK_HEADER_BYTES * 8;
+		for (b=0; b<PACK_NUM_BLOCKS; b++) {
+			for (kk=0; kk<PACK_RAW_BLOCK; kk++) {
+				block_bits[kk] = 0;
+			}
+			block_bits[PACK_RAW_BLOCK] = PACK_BLOCK_SIZE * (16 - shift);
+
+			for (i=b*PACK_BLOCK_SIZE; i<(b+1)*PACK_BLOCK_SIZE; i++) {
+				q1 = i>0 ? quantize(wave[i-1], shift) : 0;
+				q2 = i>1 ? quantize(wave[i-2], shift) : 0;
+				u = zigzag(quantize(wave[i], shift) - predict(order, q1, q2));
+				for (kk=0; kk<PACK_RAW_BLOCK; kk++)
+					block_bits[kk] += rice_bits(u, kk);
+			}
+			k[b] = 0;
+			for (kk=1; kk<=PACK_RAW_BLOCK; kk++) {
+				if (block_bits[kk] < block_bits[k[b]]) k[b] = kk;
+			}
+			bits += block_bits[k[b]];
+		}
+		if (bits < best_bits) {
+			best_bits = bits;
+			best_order = order;
+			for (b=0; b<PACK_NUM_BLOCKS; b++) best_k[b] = k[b];
+		}
+	}
+
+	if (best_bits > PACK_MAX_BYTES*8)
+		return 0;
+
+	// Unpacking in place writes sample i over bytes up to 2(i+1) of the buffer. That's only safe
+	// if the packed bytes there (at the end of the buffer) are already read, which at least
+	// the bytes holding bits up to the end of sample i are. Where that's not so, the rest of
+	// the waveform costs more than 16 bits a sample: store the next coded block as it is, and try again
+	while (1) {
+		num_bytes = pack_with(wave, shift, best_order, best_k, out, pos);
+
+		for (i=0; i<WT_TABLELEN && pos[i] < num_bytes; i++) {
+			if (2*(i+1) > PACK_MAX_BYTES - num_bytes + pos[i])
+				break;
+		}
+		if (i==WT_TABLELEN || pos[i] >= num_bytes)
+			break;
+
+		for (b=i/PACK_BLOCK_SIZE; b<PACK_NUM_BLOCKS && best_k[b]==PACK_RAW_BLOCK; b++)
+			;
+		if (b==PACK_NUM_BLOCKS)
+			return 0;
+		best_k[b] = PACK_RAW_BLOCK;
+	}
+
+	if (num_bytes > PACK_MAX_BYTES)
+		return 0;
+
+	return num_bytes;
+}
+
+void unpack_waveform(int16_t *wave, const uint8_t *in, uint16_t in_bytes)
+{
+	o_bit_reader 	r;
+	uint8_t 		order, shift, b, kk;
+	uint8_t 		k[PACK_NUM_BLOCKS];
+	uint16_t 		i;
+	int32_t 		q, q1, q2;
+
+	r.in = in;
+	r.end = in + in_bytes;
+	r.acc = 0;
+	r.num_bits = 0;
+
+	b = get_bits(&r, 8);
+	order = b >> 4;
+	shift = b & 0x0F;
+	if (order > PACK_MAX_ORDER) order = PACK_MAX_ORDER;
+	if (shift > PACK_MAX_SHIFT) shift = PACK_MAX_SHIFT;
+
+	for (b=0; b<PACK_NUM_BLOCKS; b++)
+		k[b] = get_bits(&r, 4);
+
+	q1 = q2 = 0;
+	for (i=0; i<WT_TABLELEN; i++) {
+		kk = k[i / PACK_BLOCK_SIZE];
+		if (kk == PACK_RAW_BLOCK)
+			q = (int32_t)(get_bits(&r, 16 - shift) << (16 + shift)) >> (16 + shift);
+		else
+			q = predict(order, q1, q2) + unzigzag(get_rice(&r, kk));
+		wave[i] = (int16_t)(q * (1 << shift));
+		q2 = q1;
+		q1 = q;
+	}
+}
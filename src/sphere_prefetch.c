@@ -0,0 +1,196 @@
+/*
+ * sphere_prefetch.c - Loads sphere cells ahead of navigation
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include "sphere_prefetch.h"
+#include "sphere_cache.h"
+#include "params_update.h"
+#include "params_wt_browse.h"
+#include "math_util.h"
+#include "ui_modes.h"
+#include "drivers/flashram_queue.h"
+
+extern o_params 		params;
+extern o_calc_params 	calc_params;
+extern enum UI_Modes 	ui_mode;
+
+o_sphere_prefetch sphere_prefetch;
+
+#define PREFETCH_NO_KEY 0xFFFFFFFF
+
+
+void init_sphere_prefetch(void)
+{
+	uint8_t chan, dim;
+
+	for (chan=0; chan<NUM_CHANNELS; chan++) {
+		for (dim=0; dim<NUM_WT_DIMENSIONS; dim++) {
+			sphere_prefetch.last_pos[dim][chan] = calc_params.wt_pos[dim][chan];
+			sphere_prefetch.vel[dim][chan] = 0;
+		}
+		sphere_prefetch.last_browse[chan] = get_wt_browse_pos(chan);
+		sphere_prefetch.browse_vel[chan] = 0;
+		sphere_prefetch.done_key[chan] = PREFETCH_NO_KEY;
+	}
+	sphere_prefetch.next_chan = 0;
+}
+
+static float wrapped_delta(float now, float last, float size)
+{
+	float d = now - last;
+	if (d > size/2.f) 		d -= size;
+	else if (d < -size/2.f) d += size;
+	return d;
+}
+
+static void track_velocity(uint8_t chan)
+{
+	uint8_t dim;
+	float 	d, browse;
+
+	for (dim=0; dim<NUM_WT_DIMENSIONS; dim++) {
+		d = wrapped_delta(calc_params.wt_pos[dim][chan], sphere_prefetch.last_pos[dim][chan], WT_DIM_SIZE);
+		sphere_prefetch.vel[dim][chan] += (d - sphere_prefetch.vel[dim][chan]) * PREFETCH_VEL_LPF;
+		sphere_prefetch.last_pos[dim][chan] = calc_params.wt_pos[dim][chan];
+	}
+
+	browse = get_wt_browse_pos(chan);
+	d = wrapped_delta(browse, sphere_prefetch.last_browse[chan], NUM_WAVEFORMS_IN_SPHERE);
+	sphere_prefetch.browse_vel[chan] += (d - sphere_prefetch.browse_vel[chan]) * PREFETCH_VEL_LPF;
+	sphere_prefetch.last_browse[chan] = browse;
+}
+
+// Loads the first missing corner of the cell starting at base[]. Returns 1 if a flash read was queued
+static uint8_t prefetch_cell(uint8_t bank, const uint8_t base[NUM_WT_DIMENSIONS])
+{
+	uint8_t c;
+
+	for (c=0; c<8; c++) {
+		if (sphere_cache_prefetch(bank,
+				(base[0] + (c&1)) 		% WT_DIM_SIZE,
+				(base[1] + ((c>>1)&1)) 	% WT_DIM_SIZE,
+				(base[2] + ((c>>2)&1)) 	% WT_DIM_SIZE))
+			return 1;
+	}
+	return 0;
+}
+
+// Works out the cells the channel is headed for, and loads one missing corner.
+// Returns 1 if a flash read was queued
+static uint8_t prefetch_chan(uint8_t chan)
+{
+	uint8_t 	dim, cell, num_cells;
+	uint8_t 	m0[NUM_WT_DIMENSIONS], base[NUM_WT_DIMENSIONS];
+	int8_t 		dir[NUM_WT_DIMENSIONS];
+	float 		browse, now[NUM_WT_DIMENSIONS], next[NUM_WT_DIMENSIONS], pos;
+	uint8_t 	idx, next_idx;
+	uint32_t 	key;
+	uint8_t 	bank = params.wt_bank[chan];
+
+	for (dim=0; dim<NUM_WT_DIMENSIONS; dim++)
+		m0[dim] = ((uint8_t)calc_params.wt_pos[dim][chan]) % WT_DIM_SIZE;
+
+	// Browsing: the next cell is wt_pos moved by the step to the next BROWSE_TABLE entry
+	if ((sphere_prefetch.browse_vel[chan] > PREFETCH_MIN_BROWSE_VEL) || (sphere_prefetch.browse_vel[chan] < -PREFETCH_MIN_BROWSE_VEL))
+	{
+		browse = _WRAP_F(get_wt_browse_pos(chan), 0, NUM_WAVEFORMS_IN_SPHERE);
+		idx = (uint8_t)browse;
+		if (sphere_prefetch.browse_vel[chan] > 0) 	next_idx = (idx + 2) % NUM_WAVEFORMS_IN_SPHERE;
+		else 										next_idx = (idx + NUM_WAVEFORMS_IN_SPHERE - 1) % NUM_WAVEFORMS_IN_SPHERE;
+
+		get_browse_nav(browse, &now[0], &now[1], &now[2]);
+		get_browse_nav(next_idx, &next[0], &next[1], &next[2]);
+
+		for (dim=0; dim<NUM_WT_DIMENSIONS; dim++) {
+			pos = _WRAP_F(calc_params.wt_pos[dim][chan] + next[dim] - now[dim], 0, WT_DIM_SIZE);
+			base[dim] = ((uint8_t)pos) % WT_DIM_SIZE;
+		}
+
+		key = (1UL<<31) | (bank<<16) | (next_idx<<8) | (m0[0]*9 + m0[1]*3 + m0[2]);
+		if (key == sphere_prefetch.done_key[chan])
+			return 0;
+
+		if (prefetch_cell(bank, base))
+			return 1;
+	}
+
+	// Navigating: the neighboring cells in the direction(s) of motion
+	else
+	{
+		num_cells = 0;
+		for (dim=0; dim<NUM_WT_DIMENSIONS; dim++) {
+			if (sphere_prefetch.vel[dim][chan] > PREFETCH_MIN_NAV_VEL) 			dir[dim] = 1;
+			else if (sphere_prefetch.vel[dim][chan] < -PREFETCH_MIN_NAV_VEL) 	dir[dim] = -1;
+			else 																dir[dim] = 0;
+			if (dir[dim]) num_cells++;
+		}
+		if (!num_cells)
+			return 0;
+
+		key = (bank<<16) | ((dir[0]+1)<<12) | ((dir[1]+1)<<10) | ((dir[2]+1)<<8) | (m0[0]*9 + m0[1]*3 + m0[2]);
+		if (key == sphere_prefetch.done_key[chan])
+			return 0;
+
+		// Each combination of the moving dimensions: one step in x, in y, in x and y, etc.
+		// Bit 0 of cell is x, bit 1 is y, bit 2 is z
+		for (cell=1; cell<8; cell++) {
+			if (((cell&1) && !dir[0]) || ((cell&2) && !dir[1]) || ((cell&4) && !dir[2]))
+				continue;
+
+			for (dim=0; dim<NUM_WT_DIMENSIONS; dim++)
+				base[dim] = (cell & (1<<dim)) ? (m0[dim] + WT_DIM_SIZE + dir[dim]) % WT_DIM_SIZE : m0[dim];
+
+			if (prefetch_cell(bank, base))
+				return 1;
+		}
+	}
+
+	// Everything predicted is already cached
+	sphere_prefetch.done_key[chan] = key;
+	return 0;
+}
+
+// Runs every WT_INTERP tick, after update_wt_interp().
+// allow_load is 0 when a channel is waiting on its own flash reads, which always come first
+void update_sphere_prefetch(uint8_t allow_load)
+{
+	uint8_t i, chan;
+
+	for (chan=0; chan<NUM_CHANNELS; chan++)
+		track_velocity(chan);
+
+	if (!allow_load || (ui_mode != PLAY) || !flash_queue_is_idle())
+		return;
+
+	for (i=0; i<NUM_CHANNELS; i++) {
+		chan = (sphere_prefetch.next_chan + i) % NUM_CHANNELS;
+		if (prefetch_chan(chan)) {
+			sphere_prefetch.next_chan = (chan + 1) % NUM_CHANNELS;
+			return;
+		}
+	}
+}
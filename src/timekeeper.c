@@ -33,6 +33,7 @@
 #include "led_cont.h"
 #include "analog_conditioning.h"
 #include "drivers/ads8634_driver.h"
+#include "isr_trace.h"
 
 
 #define USE_HAL_TIM_REGISTER_CALLBACKS 0
@@ -253,33 +254,39 @@ void init_interrupt_timer(uint8_t TIM_periph_number, TimerITInitStruct *timinit)
 void TIM1_UP_TIM10_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM10, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(10);
 		if (TIM_IT_IS_SOURCE(TIM10, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[10] != NULL) tim_callbacks[10]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM10, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(10);
 	}
 
 	if (TIM_IT_IS_SET(TIM1, TIM_IT_UPDATE))	{
+		ISR_TRACE_ENTER(1);
 		if (TIM_IT_IS_SOURCE(TIM1, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[1] != NULL) tim_callbacks[1]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM1, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(1);
 	}
 }
 
 void TIM2_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM2, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(2);
 		if (TIM_IT_IS_SOURCE(TIM2, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[2] != NULL) tim_callbacks[2]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM2, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(2);
 	}
 }
 
@@ -287,12 +294,14 @@ void TIM2_IRQHandler(void)
 void TIM3_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM3, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(3);
 		if (TIM_IT_IS_SOURCE(TIM3, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[3] != NULL) tim_callbacks[3]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM3, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(3);
 	}
 }
 
@@ -300,12 +309,14 @@ void TIM3_IRQHandler(void)
 void TIM4_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM4, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(4);
 		if (TIM_IT_IS_SOURCE(TIM4, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[4] != NULL) tim_callbacks[4]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM4, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(4);
 	}
 }
 
@@ -313,12 +324,14 @@ void TIM4_IRQHandler(void)
 void TIM5_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM5, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(5);
 		if (TIM_IT_IS_SOURCE(TIM5, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[5] != NULL) tim_callbacks[5]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM5, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(5);
 	}
 }
 
@@ -326,12 +339,14 @@ void TIM5_IRQHandler(void)
 void TIM6_DAC_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM6, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(6);
 		if (TIM_IT_IS_SOURCE(TIM6, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[6] != NULL) tim_callbacks[6]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM6, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(6);
 	}
 }
 
@@ -339,12 +354,14 @@ void TIM6_DAC_IRQHandler(void)
 void TIM7_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM7, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(7);
 		if (TIM_IT_IS_SOURCE(TIM7, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[7] != NULL) tim_callbacks[7]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM7, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(7);
 	}
 }
 
@@ -352,21 +369,25 @@ void TIM7_IRQHandler(void)
 void TIM8_UP_TIM13_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM8, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(8);
 		if (TIM_IT_IS_SOURCE(TIM8, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[8] != NULL) tim_callbacks[8]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM8, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(8);
 	}
 
 	if (TIM_IT_IS_SET(TIM13, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(13);
 		if (TIM_IT_IS_SOURCE(TIM13, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[13] != NULL) tim_callbacks[13]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM13, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(13);
 	}
 
 }
@@ -374,12 +395,14 @@ void TIM8_UP_TIM13_IRQHandler(void)
 void TIM1_BRK_TIM9_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM9, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(9);
 		if (TIM_IT_IS_SOURCE(TIM9, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[9] != NULL) tim_callbacks[9]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM9, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(9);
 	}
 }
 
@@ -387,12 +410,14 @@ void TIM1_BRK_TIM9_IRQHandler(void)
 void TIM1_TRG_COM_TIM11_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM11, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(11);
 		if (TIM_IT_IS_SOURCE(TIM11, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[11] != NULL) tim_callbacks[11]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM11, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(11);
 	}
 }
 
@@ -400,24 +425,28 @@ void TIM1_TRG_COM_TIM11_IRQHandler(void)
 void TIM8_BRK_TIM12_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM12, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(12);
 		if (TIM_IT_IS_SOURCE(TIM12, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[12] != NULL) tim_callbacks[12]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM12, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(12);
 	}
 }
 
 void TIM8_TRG_COM_TIM14_IRQHandler(void)
 {
 	if (TIM_IT_IS_SET(TIM14, TIM_IT_UPDATE)){
+		ISR_TRACE_ENTER(14);
 		if (TIM_IT_IS_SOURCE(TIM14, TIM_IT_UPDATE))
 		{
 			if (tim_callbacks[14] != NULL) tim_callbacks[14]();
 		}
 		// Clear TIM update interrupt
 		TIM_IT_CLEAR(TIM14, TIM_IT_UPDATE);
+		ISR_TRACE_EXIT(14);
 	}
 }
 
@@ -0,0 +1,74 @@
+/*
+ * waveshaper.c
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ *
+ */
+
+#include "waveshaper.h"
+#include "math_util.h"
+
+SRAM1DATA o_waveshaper waveshaper;
+
+
+// waveshaper is in SRAM1, which isn't cleared at startup
+void init_waveshaper(o_waveshaper *ws)
+{
+	ws->curve = NULL;
+	ws->param = 0;
+	ws->evals = 0;
+}
+
+// Starts a new table if the curve or its parameter changed
+void waveshaper_set_curve(o_waveshaper *ws, WaveshaperCurve curve, float param)
+{
+	uint32_t i;
+
+	if (ws->curve == curve && ws->param == param)
+		return;
+
+	for (i=0; i<((WAVESHAPER_LUT_SIZE + 32) / 32); i++)
+		ws->filled[i] = 0;
+
+	ws->curve = curve;
+	ws->param = param;
+}
+
+static void fill_point(o_waveshaper *ws, uint32_t i)
+{
+	float x = ((float)i / (float)(WAVESHAPER_LUT_SIZE / 2)) - 1.0f;
+	float y = ws->curve(x, ws->param);
+
+	y = _CLAMP_F(y, -1.0f, 1.0f);
+	ws->lut[i] = (int16_t)(y * (float)INT16_MAX + ((y < 0) ? -0.5f : 0.5f));
+	ws->filled[i >> 5] |= 1UL << (i & 31);
+	ws->evals++;
+}
+
+// Works out the points on either side of interval i
+void waveshaper_fill(o_waveshaper *ws, uint32_t i)
+{
+	if (!WAVESHAPER_FILLED(ws, i)) 		fill_point(ws, i);
+	if (!WAVESHAPER_FILLED(ws, i+1)) 	fill_point(ws, i+1);
+}
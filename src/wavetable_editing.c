@@ -28,6 +28,7 @@
 
 #include <stm32f7xx.h>
 #include <math.h>
+#include <string.h>
 #include "wavetable_editing.h"
 #include "wavetable_effects.h"
 #include "wavetable_saveload.h"
@@ -41,11 +42,14 @@
 #include "params_lfo.h"
 #include "led_map.h"
 #include "math_util.h"
+#include "math_approx.h"
 #include "resample.h"
 #include "ui_modes.h"
 #include "led_cont.h"
 #include "led_colors.h"
 #include "sphere_flash_io.h"
+#include "spectrum_cache.h"
+#include "waveshaper.h"
 #include "params_wt_browse.h"
 #include "flashram_spidma.h"
 #include "codec_sai.h"
@@ -58,7 +62,6 @@ extern uint32_t colorPalette[NUM_LED_COLORS][NUM_PALETTE_COLORS];
 extern o_wt_osc	wt_osc;
 extern o_params params;
 extern o_calc_params calc_params;
-extern const float 	exp_1voct_10_41V[4096];
 
 // sphere data
 SRAM1DATA o_spherebuf spherebuf;
@@ -72,6 +75,10 @@ extern const uint32_t 				WT_SIZE;
 
 uint8_t	stage_enter_wtediting_flag = 0;
 
+// Set while finish_sphere_render() runs in the main loop. The renders share waveshaper and the
+// spectrum cache, so update_sphere_render() doesn't render (or touch spherebuf) until it's done
+static volatile uint8_t	finishing_render = 0;
+
 
 
 void init_wt_edit_settings(void)
@@ -91,6 +98,9 @@ void init_wt_edit_settings(void)
 				spherebuf.fx[FX_METALIZE][i][j][k] 		= 0;
 				spherebuf.fx[FX_NORMALIZE][i][j][k]		= (spherebuf.data_source==SPHERESRC_RECBUFF)? 1 : 0.5;
 				spherebuf.fx[FX_SMOOTHING][i][j][k]		= (spherebuf.data_source==SPHERESRC_RECBUFF)? 1 : 0;
+				spherebuf.fx[FX_TILT][i][j][k] 			= 0.5;
+				spherebuf.fx[FX_FORMANT][i][j][k] 		= 0.5;
+				spherebuf.fx[FX_HARMONICS][i][j][k] 	= 0.5;
 			}
 		}
 	}
@@ -120,7 +130,17 @@ void set_params_for_editing(void)
 	force_all_wt_interp_update();
 }
 
+// Re-renders all the waveforms (position, stretch, spread, or recbuf changed)
 void enter_wtrendering(void){
+	spherebuf.dirty = ALL_SPHERE_CELLS_DIRTY;
+	flush_spectrum_cache();
+	ui_mode = WTRENDERING;
+	set_audio_callback(&process_audio_block_codec);
+}
+
+// Re-renders just one waveform: its fx settings don't change the others, or where they start in recbuf
+void enter_wtrendering_cell(uint8_t dim1, uint8_t dim2, uint8_t dim3){
+	spherebuf.dirty |= (1UL << SPHERE_CELL(dim1, dim2, dim3));
 	ui_mode = WTRENDERING;
 	set_audio_callback(&process_audio_block_codec);
 }
@@ -189,79 +209,87 @@ void exit_wtediting(void){
 
 
 // Copies sphere to recbuf for wt editing w/o recording
-// Todo: Fix and re-enable copying the spheres from waveform[], giving a speed boost since they are already loaded from flash 
+// The whole sphere is read from flash in one go, straight into the first copy of each waveform in recbuf
 void copy_current_sphere_to_recbuf(uint8_t sphere_index){
 
-	uint32_t i;
 	uint32_t j;
-	uint32_t pos;
 	uint8_t	wt_browse;
+	uint8_t x, y, z;
 	int16_t *ptr;
-	static o_waveform tmp_waveform;
-
-	// uint8_t already_loaded_from_flash;
-	// uint8_t dim1=0;
-	// uint8_t dim2=0;
-	// uint8_t dim3=0;
-	// uint8_t x0=0, y0=0, z0=0, x1=0, y1=0, z1=0, x,y,z;
-	// extern o_waveform waveform[NUM_CHANNELS][2][2][2];
-
-
-	// dim1 = 0;
-	// dim2 = 0;
-	// dim3 = 0;
-
-	wt_browse=0;
-	pos=0;
-
-	// x0 = (uint8_t)(wt_osc.m0[0][0]);
-	// y0 = (uint8_t)(wt_osc.m0[1][0]);
-	// z0 = (uint8_t)(wt_osc.m0[2][0]);
-	// x1 = (uint8_t)(wt_osc.m1[0][0]);
-	// y1 = (uint8_t)(wt_osc.m1[1][0]);
-	// z1 = (uint8_t)(wt_osc.m1[2][0]);
-
-	while(wt_browse < (WT_DIM_SIZE * WT_DIM_SIZE * WT_DIM_SIZE)) {
-
-		// already_loaded_from_flash = ((dim1 == x0) || (dim1 == x1)) &&
-		// 							((dim2 == y0) || (dim2 == y1)) &&
-		// 							((dim3 == z0) || (dim3 == z1));
-
-		// if (already_loaded_from_flash) {
-		// 	x = (dim1!=x0);
-		// 	y = (dim2!=y0);
-		// 	z = (dim3!=z0);
-		// 	ptr = waveform[0][x][y][z].wave;
-		// }
-		
-		// else {
-			load_extflash_wavetable(sphere_index, &tmp_waveform, BROWSE_TABLE[wt_browse][0],BROWSE_TABLE[wt_browse][1],BROWSE_TABLE[wt_browse][2]);
-			while (get_flash_state() != sFLASH_NOTBUSY) 
-				{;}
-			ptr = tmp_waveform.wave;
-		// }
-
-		for (j=0; j<NUM_SPHERES_IN_RECBUF; j++){
-			for (i=0; i<WT_TABLELEN; i++){
-				recbuf.data[pos++] = ptr[i];
-			}
-		}
+	int16_t *waves[NUM_WAVEFORMS_IN_SPHERE];
+
+	for (wt_browse=0; wt_browse<NUM_WAVEFORMS_IN_SPHERE; wt_browse++) {
+		x = BROWSE_TABLE[wt_browse][0];
+		y = BROWSE_TABLE[wt_browse][1];
+		z = BROWSE_TABLE[wt_browse][2];
+		waves[x + (y*WT_DIM_SIZE) + (z*WT_DIM_SIZE*WT_DIM_SIZE)] = &recbuf.data[wt_browse * NUM_SPHERES_IN_RECBUF * WT_TABLELEN];
+	}
 
-		wt_browse++;
+	load_sphere_bulk(sphere_index, waves);
 
-		// if (++dim1>=WT_DIM_SIZE){
-		// 	dim1 = 0;
-		// 	if (++dim2>=WT_DIM_SIZE){
-		// 		dim2 = 0;
-		// 		dim3++; 
-		// 	}
-		// }
+	for (wt_browse=0; wt_browse<NUM_WAVEFORMS_IN_SPHERE; wt_browse++) {
+		ptr = &recbuf.data[wt_browse * NUM_SPHERES_IN_RECBUF * WT_TABLELEN];
+		for (j=1; j<NUM_SPHERES_IN_RECBUF; j++)
+			memcpy(&ptr[j*WT_TABLELEN], ptr, WT_TABLELEN * sizeof(int16_t));
 	}
 }
 
-void render_full_sphere(void){
-	float 		start_sample;
-	uint8_t		wt_browse=0;
+// Cells that the channels are reading from, one bit per cell
+static uint32_t get_cells_in_use(void){
+	uint8_t 	chan, c;
+	uint32_t 	used = 0;
+
+	for (chan=0; chan<NUM_CHANNELS; chan++) {
+		for (c=0; c<8; c++)
+			used |= 1UL << SPHERE_CELL(	(c&1) 		? wt_osc.m1[0][chan] : wt_osc.m0[0][chan],
+										((c>>1)&1) 	? wt_osc.m1[1][chan] : wt_osc.m0[1][chan],
+										((c>>2)&1) 	? wt_osc.m1[2][chan] : wt_osc.m0[2][chan]);
+	}
+	return used;
+}
+
+// Where each waveform starts in recbuf, from the position and spread
+void update_start_positions(void){
+	float 		start_sample = spherebuf.position;
+	uint8_t		wt_browse;
+
+	for (wt_browse=0; wt_browse<NUM_WAVEFORMS_IN_SPHERE; wt_browse++) {
+		spherebuf.start_pos[wt_browse] = start_sample;
+		start_sample = get_next_waveform_start(start_sample);
+	}
+}
+
+// Renders the next dirty cell, picking one the channels are reading if there is one
+static void render_next_dirty_cell(void){
+	uint32_t 	dirty = spherebuf.dirty;
+	uint32_t 	used = dirty & get_cells_in_use();
+	uint32_t 	primask;
+	uint8_t 	cell, x, y, z;
+
+	if (used) dirty = used;
+	for (cell=0; !(dirty & (1UL << cell)); cell++) {;}
+
+	//The UI timer can set a bit (enter_wtrendering_cell) while this runs in the main loop
+	primask = __get_PRIMASK();
+	__disable_irq();
+	spherebuf.dirty &= ~(1UL << cell);
+	__set_PRIMASK(primask);
+
+	x = cell % WT_DIM_SIZE;
+	y = (cell / WT_DIM_SIZE) % WT_DIM_SIZE;
+	z = cell / (WT_DIM_SIZE * WT_DIM_SIZE);
+	render_recbuf_to_spherebuf(x, y, z, spherebuf.start_pos[get_browse_index(x, y, z)]);
+}
+
+// Called every WT_INTERP tick.
+// Renders at most SPHERE_RENDER_CELLS_PER_TICK dirty cells, so update_wt_interp() keeps running
+// while a sphere renders. The channels hear each cell as soon as it's done.
+// Rendering stops while recording, since recbuf is being filled.
+void update_sphere_render(void){
+	uint8_t 	i;
+
+	if (finishing_render)
+		return;
 
 	if (stage_enter_wtediting_flag) {
 		if (ui_mode==PLAY)
@@ -276,42 +304,90 @@ void render_full_sphere(void){
 	}
 
 	if (ui_mode == WTRENDERING) {
-		start_sample = spherebuf.position;
+		update_start_positions();
+		ui_mode = WTEDITING;
+	}
+
+	if (!spherebuf.dirty || !UIMODE_IS_WT_RECORDING_EDITING(ui_mode) || ui_mode == WTRECORDING || ui_mode == WTREC_WAIT)
+		return;
+
+	for (i=0; i<SPHERE_RENDER_CELLS_PER_TICK && spherebuf.dirty; i++)
+		render_next_dirty_cell();
+
+	force_all_wt_interp_update();
+}
+
+// Renders all the remaining dirty cells now (before saving or exporting the sphere)
+void finish_sphere_render(void){
+	finishing_render = 1;
+
+	if (ui_mode == WTRENDERING) {
+		update_start_positions();
+		ui_mode = WTEDITING;
+	}
 
-		while(wt_browse<NUM_WAVEFORMS_IN_SPHERE){
-			spherebuf.start_pos[wt_browse] = start_sample;
-			start_sample = render_recbuf_to_spherebuf(BROWSE_TABLE[wt_browse][0],BROWSE_TABLE[wt_browse][1],BROWSE_TABLE[wt_browse][2], start_sample);
- 			wt_browse++;
- 		}
+	if (spherebuf.dirty) {
+		while (spherebuf.dirty)
+			render_next_dirty_cell();
 
-		ui_mode = WTEDITING;	
 		force_all_wt_interp_update();
 	}
+
+	finishing_render = 0;
+}
+
+// The fx levels of one waveform, as an array for apply_wt_fx()
+void get_cell_fx(uint8_t dim1, uint8_t dim2, uint8_t dim3, float *fx){
+	uint8_t i;
+
+	for (i=0; i<NUM_FX; i++)
+		fx[i] = spherebuf.fx[i][dim1][dim2][dim3];
 }
 
 //Render waveform from recbuf.data[] starting at [start_sample], to spherebuf.data[dim1][dim2][dim3]
+//Waveforms that only use spectral FX are rendered from spectrum_cache if they can be.
 float render_recbuf_to_spherebuf(uint8_t dim1, uint8_t dim2, uint8_t dim3, float start_sample){
-	start_sample = put_waveform_in_sphere		(dim1,dim2,dim3, start_sample);
+	o_wt_render_ctx 		ctx = {recbuf.data, NUM_SAMPLES_IN_RECBUF_SMOOTHED, spherebuf.stretch_ratio, &waveshaper};
+	int16_t 				*wave = spherebuf.data[dim1][dim2][dim3].wave;
+	o_spectrum_cache_slot 	*cached = NULL;
+	float 					fx[NUM_FX];
+
+	get_cell_fx(dim1, dim2, dim3, fx);
+
+	if (wt_fx_cacheable(fx)) {
+		cached = spectrum_cache_find(SPHERE_CELL(dim1, dim2, dim3), start_sample, fx[FX_SMOOTHING]);
+		if (cached) {
+			apply_wt_fx_from_spectrum(wave, fx, cached);
+			return get_next_waveform_start(start_sample);
+		}
+		cached = spectrum_cache_new(SPHERE_CELL(dim1, dim2, dim3), start_sample, fx[FX_SMOOTHING]);
+	}
 
-	normalize_waveform   						(dim1,dim2,dim3);
-	chebyshev_wavefold							(dim1,dim2,dim3);
-	decimate_waveform 							(dim1,dim2,dim3);
-	metalizer 									(dim1,dim2,dim3);
-	lowpass_fft									(dim1,dim2,dim3);
-	normalize_waveform   						(dim1,dim2,dim3);
+	render_waveform(&ctx, start_sample, fx, wave, cached);
 
-	return start_sample;
+	return get_next_waveform_start(start_sample);
 }
 
-float put_waveform_in_sphere(uint8_t dim1, uint8_t dim2, uint8_t dim3, float start_sample){
-	int16_t unsmoothed_buf[WT_TABLELEN + (SPHERE_REC_MAX_OVERLAP_SIZE*MAX_STRETCH)];
-	uint32_t next_wave_offset;
+// Resamples a waveform from ctx->rec starting at start_sample, smooths it, and runs the FX chain.
+// Doesn't touch recbuf or spherebuf, so the host can render many cells (of many spheres) at once
+void render_waveform(const o_wt_render_ctx *ctx, float start_sample, const float *fx, int16_t *wave, o_spectrum_cache_slot *save_spectrum){
+	int16_t unsmoothed_buf[WT_TABLELEN + SPHERE_REC_MAX_OVERLAP_SIZE];	// smoothing is 0 to 1
+	o_resampler rs;
+
+	uint32_t unsmoothed_size = WT_TABLELEN + (fx[FX_SMOOTHING] * (float)SPHERE_REC_MAX_OVERLAP_SIZE);
 
-	uint32_t unsmoothed_size = WT_TABLELEN + (spherebuf.fx[FX_SMOOTHING][dim1][dim2][dim3] * (float)SPHERE_REC_MAX_OVERLAP_SIZE);
+	// Stretch ratios above 1 read the recording faster than it was recorded, so use the anti-aliased sinc
+	resampler_init(&rs, (ctx->stretch_ratio > 1.0f) ? RESAMPLE_SINC : RESAMPLE_HERMITE, ctx->stretch_ratio, ctx->rec, ctx->rec_size, start_sample);
+	resampler_process(&rs, unsmoothed_buf, unsmoothed_size);
 
-	resample_hermitian(spherebuf.stretch_ratio, start_sample, NUM_SAMPLES_IN_RECBUF_SMOOTHED, recbuf.data, unsmoothed_size, unsmoothed_buf, 1);
+	overlap_smooth_wave(unsmoothed_buf, wave, unsmoothed_size, WT_TABLELEN);
 
-	overlap_smooth_wave(unsmoothed_buf, spherebuf.data[dim1][dim2][dim3].wave, unsmoothed_size, WT_TABLELEN);
+	apply_wt_fx(ctx->ws, wave, fx, save_spectrum);
+}
+
+// Where the next waveform starts in recbuf. Only depends on spread_amount
+float get_next_waveform_start(float start_sample){
+	uint32_t next_wave_offset;
 
 	next_wave_offset = ((float)spherebuf.spread_amount);// * spherebuf.stretch_ratio);
 
@@ -389,7 +465,7 @@ void display_wt_recbuf_sel_outring(void){
 			led_pos_i = _WRAP_U8(led_pos_i + 1, 0, NUM_LED_OUTRING);
 
 			brightness_unscaled = _CLAMP_F(spherebuf.stretch_ratio - led_pos_end_ctr, 0.0, 1.0);
-			brightness_scaled = exp_1voct_10_41V[ _SCALE_F2U16(brightness_unscaled, 0, 1.0, 128, 4095)] / 1370.0;
+			brightness_scaled = exp_1voct_led(_SCALE_F2U16(brightness_unscaled, 0, 1.0, 128, 4095)) / 1370.0;
 			add_rgb_color_brightness(&led_cont.outring[led_pos_i], waveform_colors[i], brightness_scaled);
 
 			led_pos_end_ctr++;
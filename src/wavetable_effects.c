@@ -28,6 +28,7 @@
 
 #include <stm32f7xx.h>
 #include <math.h>
+#include <string.h>
 #include "globals.h"
 #include "wavetable_effects.h"
 #include "wavetable_editing.h"
@@ -37,6 +38,8 @@
 #include "params_update.h"
 #include "led_cont.h"
 #include "fft_filter.h"
+#include "spectrum_cache.h"
+#include "waveshaper.h"
 
 
 // Displays
@@ -46,7 +49,10 @@ const enum colorCodes fx_colors[NUM_FX] = {
 	ledc_PURPLE,	//METALIZE
 	ledc_FUSHIA,	//DISTORT	
 	ledc_YELLOW,	//NORMALIZE
-	ledc_GOLD		//SMOOTH
+	ledc_GOLD,		//SMOOTH
+	ledc_AQUA,		//TILT
+	ledc_LIGHT_BLUE,//FORMANT
+	ledc_GREEN		//HARMONICS
 };
 
 const float FX_SCALING[NUM_FX] = {
@@ -55,7 +61,10 @@ const float FX_SCALING[NUM_FX] = {
 	0.015, 			//METALIZE
 	0.015, 			//DISTORT	
 	0.025, 			//NORMALIZE
-	0.1 			//SMOOTH
+	0.1, 			//SMOOTH
+	0.015, 			//TILT
+	0.015, 			//FORMANT
+	0.015 			//HARMONICS
 };
 const float FX_FINE_SCALING[NUM_FX] = {
 	0.0015, 		//WAVEFOLD
@@ -63,7 +72,10 @@ const float FX_FINE_SCALING[NUM_FX] = {
 	0.0015, 		//METALIZE
 	0.0015, 		//DISTORT	
 	0.0025, 		//NORMALIZE
-	0.01 			//SMOOTH
+	0.01, 			//SMOOTH
+	0.0015, 		//TILT
+	0.0015, 		//FORMANT
+	0.0015 			//HARMONICS
 };
 
 extern SRAM1DATA 	o_spherebuf 			spherebuf;
@@ -178,6 +190,17 @@ void normalize_waveform(uint8_t dim1,uint8_t dim2,uint8_t dim3){
 // 			FXs
 // -------------------------
 
+// Buttons A-F pick the first six FX. Holding D (LPF) with A, B or C picks a spectral FX instead
+static uint8_t fx_button_pressed(uint8_t fx){
+	uint8_t spectral_page = button_pressed(butm_A_BUTTON + FX_LPF)
+		&& (button_pressed(butm_A_BUTTON) || button_pressed(butm_B_BUTTON) || button_pressed(butm_C_BUTTON));
+
+	if (fx < NUM_FX_BUTTONS)
+		return !spectral_page && button_pressed(butm_A_BUTTON + fx);
+	else
+		return spectral_page && button_pressed(butm_A_BUTTON + fx - FX_TILT);
+}
+
 void update_wt_fx_params(uint8_t dim1, uint8_t dim2, uint8_t dim3, int16_t increment){
 	
 	uint8_t i;
@@ -186,98 +209,367 @@ void update_wt_fx_params(uint8_t dim1, uint8_t dim2, uint8_t dim3, int16_t incre
 	if(increment){
 		
 		for(i=0; i<NUM_FX; i++){ 
-			if(button_pressed(butm_A_BUTTON + i)){
+			if(fx_button_pressed(i)){
 				amt = switch_pressed(FINE_BUTTON) ? FX_FINE_SCALING[i] : FX_SCALING[i];
 				amt *= (float)(increment);
 				spherebuf.fx[i][dim1][dim2][dim3] = _CLAMP_F(spherebuf.fx[i][dim1][dim2][dim3] + amt, 0.0, 1.0);
-				calc_params.already_handled_button[i] = 1;
+				if (i < NUM_FX_BUTTONS)
+					calc_params.already_handled_button[i] = 1;
+				else {
+					calc_params.already_handled_button[i - FX_TILT] = 1;
+					calc_params.already_handled_button[FX_LPF] = 1;
+				}
 			}
 		}
 		start_ongoing_display_fx();
-		enter_wtrendering();
+		enter_wtrendering_cell(dim1, dim2, dim3);
 	}
 }
 
 
-void lowpass_fft(uint8_t dim1,uint8_t dim2,uint8_t dim3){
-	float tmp_buf[WT_TABLELEN*2];
+// -------------------------
+// 		FX chain
+// -------------------------
+//
+// The waveform stays in one float buffer (in the int16 range) for the whole chain, and is
+// converted back to int16 once at the end.
+// Normalizing doesn't need its own passes: each FX keeps the sum, min and max of what it
+// writes, so the DC shift and gain can be worked out from those, and they're applied
+// by the next FX as it reads the buffer.
+
+typedef struct o_fx_buf{
+	float 	x[WT_TABLELEN];
+	float 	shift, gain;		// normalizing that hasn't been applied yet: each sample is (x + shift) * gain
+	float 	sum, min, max;		// of x[]
+} o_fx_buf;
+
+static inline float fx_read(o_fx_buf *b, uint16_t i, float shift, float gain) {
+	return (b->x[i] + shift) * gain;
+}
 
-	if (spherebuf.fx[FX_LPF][dim1][dim2][dim3] < 0.00001)
-		return;
-	
-	// float freq = (float)(15040 - _SCALE_F2U16(spherebuf.fx[FX_LPF][dim1][dim2][dim3], 0.0, 1.0, 40, 15000)) / (F_SAMPLERATE/2.0);
+static inline void fx_write(o_fx_buf *b, uint16_t i, float val) {
+	b->x[i] = val;
+	b->sum += val;
+	if (val < b->min) b->min = val;
+	if (val > b->max) b->max = val;
+}
 
-	float freq = powf(21000.0, 1.0-spherebuf.fx[FX_LPF][dim1][dim2][dim3]) + 200.0;
-	float freq_ratio = freq / (F_SAMPLERATE/2.0);
-	
-	do_cfft_lpf_512_f32(spherebuf.data[dim1][dim2][dim3].wave, spherebuf.data[dim1][dim2][dim3].wave, tmp_buf, freq_ratio);
+static inline void fx_begin_pass(o_fx_buf *b) {
+	b->sum = 0;
+	b->min = (float)INT32_MAX;
+	b->max = (float)INT32_MIN;
 }
 
+static inline void fx_end_pass(o_fx_buf *b) {
+	b->shift = 0;
+	b->gain = 1;
+}
 
-void decimate_waveform(uint8_t dim1, uint8_t dim2, uint8_t dim3){
-	
-	uint16_t i;
-	int8_t   dec_idx = 0;
+// Same as normalize_waveform(), but only updates shift and gain
+static void fx_normalize(o_fx_buf *b, float amount){
+	float avg, min_val, max_val, dc, peak, normgain, gain;
+
+	avg 	= (b->sum / (float)WT_TABLELEN + b->shift) * b->gain;
+	min_val = (b->min + b->shift) * b->gain;
+	max_val = (b->max + b->shift) * b->gain;
 
-	if (spherebuf.fx[FX_DECIMATING][dim1][dim2][dim3] < FX_FINE_SCALING[FX_DECIMATING]) 
+	// Remove DC offset, as far as it can be without clipping.
+	// Like remove_DC_offset(), the limits are worked out as if the waveform touched 0
+	dc = _CLAMP_F(-avg, (float)INT16_MIN - (min_val < 0 ? min_val : 0), (float)INT16_MAX - (max_val > 0 ? max_val : 0));
+	b->shift += dc / b->gain;
+
+	if (amount == 0.5)
 		return;
 
-	for (i=1; i<WT_TABLELEN; i++){
+	peak = ((max_val + dc) > -(min_val + dc)) ? (max_val + dc) : -(min_val + dc);
+	if (peak <= 0)
+		return;
+
+	normgain = (float)(INT16_MAX) / peak;
+
+	if (amount >= 0.5)
+		gain = _CROSSFADE(1.0, normgain, (amount - 0.5) * 2.0);
+	else
+		gain = 0.3 + (amount * 1.4);
+
+	b->gain *= gain;
+}
+
+// Chebyshev waveshaping (sine shape)
+static float chebyshev_curve(float x, float n){
+	return sinf(n * asinf(x));
+}
 
-		if (dec_idx >= ((F_TABLE_DECIMATEMAX / FX_SCALING[FX_DECIMATING]) * spherebuf.fx[FX_DECIMATING][dim1][dim2][dim3])){	
+static void fx_wavefold(o_fx_buf *b, o_waveshaper *ws, float amount){
+	float 		shift = b->shift, gain = b->gain, smpl;
+	uint16_t 	i;
+
+	waveshaper_set_curve(ws, chebyshev_curve, powf(50.0, amount));
+
+	fx_begin_pass(b);
+	for (i=0; i<WT_TABLELEN; i++){
+		smpl = _CLAMP_F(fx_read(b, i, shift, gain) / (float)(INT16_MAX+1), -1.0, 1.0);
+		fx_write(b, i, waveshape(ws, smpl) * INT16_MAX);
+	}
+	fx_end_pass(b);
+}
+
+// Holds samples. dec_idx is an int8_t like it's always been: above about 0.64 it wraps,
+// and part of the waveform is copied from further ahead
+static void fx_decimate(o_fx_buf *b, float amount){
+	float 		hold_len = (F_TABLE_DECIMATEMAX / FX_SCALING[FX_DECIMATING]) * amount;
+	float 		shift = b->shift, gain = b->gain;
+	int8_t 		dec_idx = 0;
+	uint16_t 	i;
+
+	for (i=0; i<WT_TABLELEN; i++)
+		b->x[i] = fx_read(b, i, shift, gain);
+
+	fx_begin_pass(b);
+	fx_write(b, 0, b->x[0]);
+	for (i=1; i<WT_TABLELEN; i++){
+		if (dec_idx >= hold_len)
 			dec_idx = 0;
-		}
-		else{
-			spherebuf.data[dim1][dim2][dim3].wave[i] = spherebuf.data[dim1][dim2][dim3].wave[i-dec_idx-1];
+		else {
+			b->x[i] = b->x[i-dec_idx-1];
 			dec_idx++;
 		}
+		fx_write(b, i, b->x[i]);
 	}
-	
-	normalize_waveform (dim1,dim2,dim3);
+	fx_end_pass(b);
 }
 
+// Adds highs to waveform
+// easter egg from LPF development. The sound comes from the one-pole filter's state
+// being read back as unsigned and wrapping around, so this keeps the int16 steps
+static void fx_metalize(o_fx_buf *b, float amount){
+	float 		lpf_val = amount * 0.95;
+	float 		shift = b->shift, gain = b->gain;
+	uint16_t 	i, index;
+	uint16_t 	prev_val = 0;
+	int16_t 	val;
 
-// add highs to waveform
-// easter egg from LPF development
-void metalizer(uint8_t dim1,uint8_t dim2,uint8_t dim3){
-	
-	uint16_t 		i;
-	int16_t 		index;
-	float 			lpf_val;
-	uint16_t 		prev_val;
+	for (i=0; i < (WT_TABLELEN * 2 - 1); i++){
+		if (i >= WT_TABLELEN) {
+			index = i - WT_TABLELEN;
+			val = (int16_t)(int32_t)((1-lpf_val) * b->x[index] + lpf_val * prev_val);
+		} else {
+			index = i;
+			val = (int16_t)(int32_t)((1-lpf_val) * (int16_t)_CLAMP_F(fx_read(b, index, shift, gain), INT16_MIN, INT16_MAX) + lpf_val * prev_val);
+		}
+		b->x[index] = val;
+		prev_val = val;
+	}
 
-	if (spherebuf.fx[FX_METALIZE][dim1][dim2][dim3] < FX_FINE_SCALING[FX_METALIZE]) 
-		return;
+	fx_begin_pass(b);
+	for (i=0; i<WT_TABLELEN; i++)
+		fx_write(b, i, b->x[i]);
+	fx_end_pass(b);
+}
+
+// -------------------------
+// 		Spectral FX
+// -------------------------
+//
+// LPF, tilt, formant and harmonics are all done on the bins of one real FFT, followed by one inverse.
+// When they're the only FX a waveform uses, the FFT of the resampled waveform is kept in
+// spectrum_cache, so changing their levels doesn't resample or run a forward FFT again.
+
+static uint8_t uses_time_fx(const float *fx){
+	return (fx[FX_WAVEFOLDING] >= FX_FINE_SCALING[FX_WAVEFOLDING])
+		|| (fx[FX_DECIMATING] >= FX_FINE_SCALING[FX_DECIMATING])
+		|| (fx[FX_METALIZE] >= FX_FINE_SCALING[FX_METALIZE]);
+}
+
+// Tilt, formant and harmonics do nothing in the center
+static uint8_t bipolar_fx_on(const float *fx, uint8_t which){
+	return fabsf(fx[which] - 0.5) >= (FX_FINE_SCALING[which] / 2.0);
+}
 
-	prev_val = 0;
-	lpf_val = spherebuf.fx[FX_METALIZE][dim1][dim2][dim3] * 0.95;
+static uint8_t uses_spectral_fx(const float *fx){
+	return (fx[FX_LPF] >= 0.00001)
+		|| bipolar_fx_on(fx, FX_TILT)
+		|| bipolar_fx_on(fx, FX_FORMANT)
+		|| bipolar_fx_on(fx, FX_HARMONICS);
+}
 
-	for (i=0; i < (WT_TABLELEN * 2 - 1); i++){
-		if 		(i 	 >= WT_TABLELEN) 	{index 		= i   - WT_TABLELEN  ;}
-		else 							{index 		= i 				 ;}
-		spherebuf.data[dim1][dim2][dim3].wave[index] = (1-lpf_val) * spherebuf.data[dim1][dim2][dim3].wave[index] + lpf_val * prev_val; 
-		prev_val = spherebuf.data[dim1][dim2][dim3].wave[index];
+// True if the waveform only uses spectral FX, so its spectrum can go in spectrum_cache
+uint8_t wt_fx_cacheable(const float *fx){
+	return uses_spectral_fx(fx) && !uses_time_fx(fx);
+}
+
+static inline float bin_mag(float *spectrum, uint16_t k){
+	return sqrtf(spectrum[k*2] * spectrum[k*2] + spectrum[k*2+1] * spectrum[k*2+1]);
+}
+
+// Moves the spectral envelope up or down by up to an octave, keeping the harmonics where they are.
+// Works in place: shifting up, the bins are done from the top down, so each one only reads
+// bins below it that haven't been changed yet (and the other way around shifting down)
+static void fx_formant(float *spectrum, float amount){
+	const uint16_t 	num_bins = WT_TABLELEN/2;
+	float 			ratio = exp2f((amount - 0.5) * 2.0);
+	float 			src, frac, mag, new_mag, m0, m1;
+	uint16_t 		i, k, src_k;
+
+	for (i=1; i<num_bins; i++)
+	{
+		k = (ratio > 1.0) ? (num_bins - i) : i;
+
+		src = (float)k / ratio;
+		src_k = (uint16_t)src;
+		frac = src - (float)src_k;
+
+		// DC isn't part of the envelope
+		m0 = (src_k && src_k < num_bins) 		? bin_mag(spectrum, src_k) 		: 0;
+		m1 = ((src_k + 1) < num_bins) 			? bin_mag(spectrum, src_k + 1) 	: 0;
+		new_mag = m0 + (m1 - m0) * frac;
+
+		mag = bin_mag(spectrum, k);
+		if (mag > 0.001) {
+			spectrum[k*2] 	*= new_mag / mag;
+			spectrum[k*2+1] *= new_mag / mag;
+		} else {
+			spectrum[k*2] 	= new_mag;
+			spectrum[k*2+1] = 0;
+		}
 	}
-	normalize_waveform (dim1,dim2,dim3);
 }
 
-// Chebyshev waveshaping (sine shape)
-void chebyshev_wavefold(uint8_t dim1, uint8_t dim2, uint8_t dim3){
+// spectrum is the FFT of b->x, without b's pending normalizing. Puts the result in b->x
+static void fx_spectral(o_fx_buf *b, float *spectrum, const float *fx){
+	const uint16_t 	num_bins = WT_TABLELEN/2;
+	float 			lpf = fx[FX_LPF];
+	float 			harmonics = fx[FX_HARMONICS];
+	float 			tilt = (fx[FX_TILT] - 0.5) * 2.0;
+	uint8_t 		tilt_on = bipolar_fx_on(fx, FX_TILT);
+	uint8_t 		harmonics_on = bipolar_fx_on(fx, FX_HARMONICS);
+	float 			cutoff = num_bins;
+	uint16_t 		i, k;
+	float 			freq, g;
+
+	// The shift only changes DC. Nyquist is dropped.
+	spectrum[0] = (spectrum[0] + b->shift * (float)WT_TABLELEN) * b->gain;
+	spectrum[1] = 0;
+
+	if (bipolar_fx_on(fx, FX_FORMANT))
+		fx_formant(spectrum, fx[FX_FORMANT]);
+
+	if (lpf >= 0.00001) {
+		freq = powf(21000.0, 1.0-lpf) + 200.0;
+		cutoff = (freq / (F_SAMPLERATE/2.0)) * (float)num_bins;
+	}
 
-	if (spherebuf.fx[FX_WAVEFOLDING][dim1][dim2][dim3] < FX_FINE_SCALING[FX_WAVEFOLDING]) 
-		return;
+	// Bin k is harmonic k
+	for (k=1; k<num_bins; k++)
+	{
+		// The LPF fades out the bin at the cutoff, so it sweeps smoothly
+		if (k >= cutoff)
+			g = 0;
+		else {
+			g = b->gain;
+			if ((float)(k+1) > cutoff)
+				g *= cutoff - (float)k;
+
+			// +/-6dB per octave, from the fundamental
+			if (tilt_on)
+				g *= powf((float)k, tilt);
+
+			// Fades out the even harmonics below the center, the odd ones (except the fundamental) above
+			if (harmonics_on) {
+				if (harmonics < 0.5 && !(k & 1)) 			g *= harmonics * 2.0;
+				else if (harmonics > 0.5 && (k & 1) && k>1) g *= (1.0 - harmonics) * 2.0;
+			}
+		}
+		spectrum[k*2] 	*= g;
+		spectrum[k*2+1] *= g;
+	}
+
+	do_irfft_512_f32(spectrum, b->x);
+
+	fx_begin_pass(b);
+	for (i=0; i<WT_TABLELEN; i++)
+		fx_write(b, i, b->x[i]);
+	fx_end_pass(b);
+}
+
+static void fx_finish(o_fx_buf *b, int16_t *wave, float normalize){
+	float 		val;
+	uint16_t 	i;
 
-	float n = powf(50.0, spherebuf.fx[FX_WAVEFOLDING][dim1][dim2][dim3]);
+	fx_normalize(b, normalize);
 
-	for (uint32_t i=0; i < WT_TABLELEN; i++){
-		float smpl = (float)spherebuf.data[dim1][dim2][dim3].wave[i] / (float)(INT16_MAX+1);
-		smpl = sinf(n * asinf(smpl));
-		spherebuf.data[dim1][dim2][dim3].wave[i] = _CLAMP_F(smpl * INT16_MAX, INT16_MIN, INT16_MAX);
+	for (i=0; i<WT_TABLELEN; i++) {
+		val = fx_read(b, i, b->shift, b->gain);
+		wave[i] = (int16_t)_CLAMP_F(val, INT16_MIN, INT16_MAX);
 	}
-	normalize_waveform (dim1,dim2,dim3);
 }
 
+// Runs the FX chain on wave[], which was just resampled, with the fx levels fx[NUM_FX]:
+// normalize, wavefold, decimate, metalize, spectral FX, normalize (each FX is followed by normalizing)
+// If save_spectrum isn't NULL (only for wt_fx_cacheable() waveforms), the spectrum of the resampled
+// waveform is stored there.
+// Only uses what's passed to it, so waveforms can be rendered on several threads at once, each with its own ws
+void apply_wt_fx(o_waveshaper *ws, int16_t *wave, const float *fx, o_spectrum_cache_slot *save_spectrum){
+	o_fx_buf 	b;
+	float 		spectrum[WT_TABLELEN];
+	float 		normalize = fx[FX_NORMALIZE];
+	uint16_t 	i;
+
+	fx_end_pass(&b);
+	fx_begin_pass(&b);
+	for (i=0; i<WT_TABLELEN; i++)
+		fx_write(&b, i, wave[i]);
+
+	fx_normalize(&b, normalize);
+
+	if (fx[FX_WAVEFOLDING] >= FX_FINE_SCALING[FX_WAVEFOLDING]) {
+		fx_wavefold(&b, ws, fx[FX_WAVEFOLDING]);
+		fx_normalize(&b, normalize);
+	}
+
+	if (fx[FX_DECIMATING] >= FX_FINE_SCALING[FX_DECIMATING]) {
+		fx_decimate(&b, fx[FX_DECIMATING]);
+		fx_normalize(&b, normalize);
+	}
+
+	if (fx[FX_METALIZE] >= FX_FINE_SCALING[FX_METALIZE]) {
+		fx_metalize(&b, fx[FX_METALIZE]);
+		fx_normalize(&b, normalize);
+	}
+
+	if (uses_spectral_fx(fx)) {
+		do_rfft_512_f32(b.x, spectrum);
+
+		if (save_spectrum) {
+			memcpy(save_spectrum->spectrum, spectrum, sizeof(spectrum));
+			save_spectrum->sum = b.sum;
+			save_spectrum->min = b.min;
+			save_spectrum->max = b.max;
+		}
 
+		fx_spectral(&b, spectrum, fx);
+	}
+
+	fx_finish(&b, wave, normalize);
+}
+
+// Renders a wt_fx_cacheable() waveform from its cached spectrum, without resampling it or
+// running a forward FFT
+void apply_wt_fx_from_spectrum(int16_t *wave, const float *fx, const o_spectrum_cache_slot *cached){
+	o_fx_buf 	b;
+	float 		spectrum[WT_TABLELEN];
+	float 		normalize = fx[FX_NORMALIZE];
+
+	memcpy(spectrum, cached->spectrum, sizeof(spectrum));
+	fx_end_pass(&b);
+	b.sum = cached->sum;
+	b.min = cached->min;
+	b.max = cached->max;
+
+	fx_normalize(&b, normalize);
+	fx_spectral(&b, spectrum, fx);
+	fx_finish(&b, wave, normalize);
+}
 
 void slew_limit(uint8_t dim1,uint8_t dim2,uint8_t dim3){
 	uint16_t i;
@@ -307,59 +599,48 @@ void slew_limit(uint8_t dim1,uint8_t dim2,uint8_t dim3){
 	}
 }
 
-void distort_waveform(uint8_t dim1, uint8_t dim2, uint8_t dim3){
+static float distortion_curve(float x, float a){
+	return x * (fabsf(x) + a) / (x*x + (a-1.0f)*fabsf(x) + 1.0f);
+}
+
+void distort_waveform(o_waveshaper *ws, uint8_t dim1, uint8_t dim2, uint8_t dim3){
 	
 	uint16_t i;
-	float smpl_in, smpl_out;
+	int16_t *wave = spherebuf.data[dim1][dim2][dim3].wave;
 
 	if (spherebuf.fx[FX_DISTORTION][dim1][dim2][dim3] < FX_FINE_SCALING[FX_DISTORTION]) 
 		return;
 
-	float a = (spherebuf.fx[FX_DISTORTION][dim1][dim2][dim3] * 10.0) + 1.0;
+	waveshaper_set_curve(ws, distortion_curve, (spherebuf.fx[FX_DISTORTION][dim1][dim2][dim3] * 10.0) + 1.0);
 
-	for (i=0; i<WT_TABLELEN; i++){
-		smpl_in = (float)spherebuf.data[dim1][dim2][dim3].wave[i]/(float)INT16_MAX;
+	for (i=0; i<WT_TABLELEN; i++)
+		wave[i] = waveshape(ws, (float)wave[i] / (float)INT16_MAX) * INT16_MAX;
+}
 
-		smpl_out = smpl_in*(fabs(smpl_in) + a)/(smpl_in*smpl_in + (a-1.0)*fabs(smpl_in) + 1.0);
 
-		spherebuf.data[dim1][dim2][dim3].wave[i] = smpl_out * INT16_MAX;
-	}
-}
+// Folds back at +/-0.95 as many times as it takes: a triangle wave of gain * x
+static float linear_fold_curve(float x, float gain){
+	const float maxval = 0.95f;
+	float 		t;
+
+	t = fmodf(gain * x + maxval, 4.0f * maxval);
+	if (t < 0) t += 4.0f * maxval;
 
+	return (t < 2.0f * maxval) ? (t - maxval) : (3.0f * maxval - t);
+}
 
-void linear_wavefold(uint8_t dim1, uint8_t dim2, uint8_t dim3){
+void linear_wavefold(o_waveshaper *ws, uint8_t dim1, uint8_t dim2, uint8_t dim3){
 	
 	uint16_t i;
-	float sample_val;
-	float gain;
-	float fold_amt;
-	float maxval;
+	int16_t *wave = spherebuf.data[dim1][dim2][dim3].wave;
 
 	if (spherebuf.fx[FX_WAVEFOLDING][dim1][dim2][dim3] < FX_FINE_SCALING[FX_WAVEFOLDING]) 
 		return;
 
-	gain = 0.95 + F_TABLE_FOLDMAX * spherebuf.fx[FX_WAVEFOLDING][dim1][dim2][dim3];
-	maxval = INT16_MAX * 0.95;
-
-	for (i=0; i<WT_TABLELEN; i++){
-		
-		sample_val = gain * (float)(spherebuf.data[dim1][dim2][dim3].wave[i]);
-		
-		while (fabsf(sample_val)> maxval){
-		
-			if (sample_val > 0){
-				fold_amt = sample_val - maxval;
-				sample_val = (float)(maxval) - fold_amt;
-			}
-			
-			else if (sample_val < 0){
-				fold_amt = maxval + sample_val;
-				sample_val = -(float)(maxval) - fold_amt;
-			}
-		}
+	waveshaper_set_curve(ws, linear_fold_curve, 0.95 + F_TABLE_FOLDMAX * spherebuf.fx[FX_WAVEFOLDING][dim1][dim2][dim3]);
 
-		spherebuf.data[dim1][dim2][dim3].wave[i] = sample_val;
-	}
+	for (i=0; i<WT_TABLELEN; i++)
+		wave[i] = waveshape(ws, (float)wave[i] / (float)INT16_MAX) * INT16_MAX;
 }
 
 
@@ -410,7 +691,7 @@ void lowpass_fft_q15(uint8_t dim1,uint8_t dim2,uint8_t dim3){
 
 enum colorCodes animate_fx_level(uint8_t slot_i){
 
-	static uint8_t fx_num_active = NUM_CHANNELS;
+	static uint8_t fx_num_active = NUM_FX;
 	enum colorCodes led_color;
 	uint8_t i;
 	uint8_t dim1, dim2, dim3;
@@ -419,12 +700,12 @@ enum colorCodes animate_fx_level(uint8_t slot_i){
 	dim2 = calc_params.wt_pos[1][0];
 	dim3 = calc_params.wt_pos[2][0];
 
-	for (i=0; i<NUM_CHANNELS; i++) {
-		if (button_pressed(butm_A_BUTTON + i))
+	for (i=0; i<NUM_FX; i++) {
+		if (fx_button_pressed(i))
 			fx_num_active = i;
 	}
 
-	if (fx_num_active < NUM_CHANNELS)
+	if (fx_num_active < NUM_FX)
 	{
 		if (spherebuf.fx[fx_num_active][dim1][dim2][dim3] > ((float)slot_i/(float)NUM_LED_OUTRING))
 			led_color = fx_colors[fx_num_active];
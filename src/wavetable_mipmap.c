@@ -0,0 +1,157 @@
+/*
+ * wavetable_mipmap.c - Band-limited wavetables for high pitches
+ *
+ * Author: Dan Green (danngreen1@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * See http://creativecommons.org/licenses/MIT/ for more information.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#include "wavetable_mipmap.h"
+#include "oscillator.h"
+#include "fft_filter.h"
+
+extern o_wt_osc	wt_osc;
+
+SRAM1DATA o_wt_mipmap wt_mipmap;
+
+#define WT_MIP_NO_CHAN 0xFF
+#define WT_MIP_NO_SET 0xFF
+
+//Level 0 is wt_osc.mc
+const uint16_t WT_MIP_LEN[WT_MIP_LEVELS] 	= {512, 512, 256, 128, 64, 32, 16, 16, 16};
+const uint16_t WT_MIP_OFFSET[WT_MIP_LEVELS] = {0, 0, 512, 768, 896, 960, 992, 1008, 1024};
+
+
+void init_wt_mipmap(void)
+{
+	uint8_t chan;
+
+	for (chan=0; chan<NUM_CHANNELS; chan++) {
+		wt_mipmap.set[chan] = chan;
+		wt_mipmap.prev_set[chan] = chan;
+		wt_mipmap.xfade[chan] = 0.f;
+		wt_mipmap.top_level[chan] = 0;
+		wt_mipmap.pending[chan] = 1;
+	}
+	wt_mipmap.build_chan = WT_MIP_NO_CHAN;
+	wt_mipmap.build_level = 0;
+	wt_mipmap.last_chan = NUM_CHANNELS-1;
+}
+
+// Called when wt_osc.mc for a channel changes (and buffer_sel flips).
+// The channel keeps playing its current set, and a build in progress carries on:
+// it's from a recent wavetable, and restarting it would starve a channel that changes every tick.
+void invalidate_wt_mipmap(uint8_t chan)
+{
+	wt_mipmap.pending[chan] = 1;
+}
+
+const float* get_wt_mipmap_table(uint8_t chan, uint8_t level)
+{
+	if (level == 0)
+		return wt_osc.mc[wt_osc.buffer_sel[chan]][chan];
+	else
+		return &(wt_mipmap.table[wt_mipmap.set[chan]][WT_MIP_OFFSET[level]]);
+}
+
+// What the channel is crossfading from: the other mc buffer for level 0, and the previous set for the others
+const float* get_wt_mipmap_prev_table(uint8_t chan, uint8_t level)
+{
+	if (level == 0)
+		return wt_osc.mc[1-wt_osc.buffer_sel[chan]][chan];
+	else
+		return &(wt_mipmap.table[wt_mipmap.prev_set[chan]][WT_MIP_OFFSET[level]]);
+}
+
+// A set is free when no channel is playing it or crossfading from it
+static uint8_t find_free_wt_mipmap_set(void)
+{
+	uint8_t set, chan;
+
+	for (set=0; set<WT_MIP_SETS; set++) {
+		for (chan=0; chan<NUM_CHANNELS; chan++) {
+			if (wt_mipmap.top_level[chan] && (wt_mipmap.set[chan] == set))
+				break;
+			if ((wt_mipmap.xfade[chan] > 0.f) && (wt_mipmap.prev_set[chan] == set))
+				break;
+		}
+		if (chan == NUM_CHANNELS)
+			return set;
+	}
+	return WT_MIP_NO_SET;
+}
+
+// Runs in the WT_INTERP timer. Does at most one FFT per call:
+// the first call for a channel takes the forward FFT of its wavetable,
+// then each following call builds one level from that spectrum into a free set.
+// When all the levels are built, the channel switches to the new set.
+void update_wt_mipmaps(void)
+{
+	uint8_t 	i, chan, level, set;
+	uint32_t 	primask;
+
+	if (wt_mipmap.build_chan == WT_MIP_NO_CHAN)
+	{
+		//Round-robin, starting after the last channel built
+		for (i=1; i<=NUM_CHANNELS; i++) {
+			chan = (wt_mipmap.last_chan + i) % NUM_CHANNELS;
+			if (wt_mipmap.pending[chan])
+				break;
+		}
+		if (i > NUM_CHANNELS)
+			return;
+
+		set = find_free_wt_mipmap_set();
+		if (set == WT_MIP_NO_SET)
+			return;
+
+		do_cfft_512_f32(wt_osc.mc[wt_osc.buffer_sel[chan]][chan], wt_mipmap.spectrum);
+		wt_mipmap.pending[chan] = 0;
+		wt_mipmap.build_chan = chan;
+		wt_mipmap.build_set = set;
+		wt_mipmap.build_level = 1;
+		return;
+	}
+
+	chan = wt_mipmap.build_chan;
+	level = wt_mipmap.build_level;
+
+	do_icfft_bandlimit_f32(wt_mipmap.spectrum, (WT_TABLELEN/2) >> level, &(wt_mipmap.table[wt_mipmap.build_set][WT_MIP_OFFSET[level]]), WT_MIP_LEN[level], wt_mipmap.cbuf);
+
+	if (++wt_mipmap.build_level < WT_MIP_LEVELS)
+		return;
+
+	// The audio IRQ reads these, so it mustn't see a half-switched channel
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (wt_mipmap.top_level[chan]) {
+		wt_mipmap.prev_set[chan] = wt_mipmap.set[chan];
+		wt_mipmap.xfade[chan] = 1.f;
+	}
+	wt_mipmap.set[chan] = wt_mipmap.build_set;
+	wt_mipmap.top_level[chan] = WT_MIP_LEVELS-1;
+	__set_PRIMASK(primask);
+
+	wt_mipmap.build_chan = WT_MIP_NO_CHAN;
+	wt_mipmap.last_chan = chan;
+}
@@ -63,6 +63,7 @@ void increment_play_export(uint16_t samples);
 
 void start_play_export_sphere(void)
 {
+	finish_sphere_render();
 	calc_sphere_dc_offsets(dc_offsets);
 
 	ui_mode = WTPLAYEXPORT;
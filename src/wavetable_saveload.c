@@ -103,6 +103,7 @@ void update_number_of_user_spheres_filled(void)
 
 void save_user_sphere(uint8_t sphere_num)
 {
+	finish_sphere_render();
 	ui_mode = WTSAVING;
 	if (sphere_num>=NUM_FACTORY_SPHERES)
 		save_unformatted_sphere_to_flash(sphere_num, SPHERE_TYPE_USER, spherebuf.data);
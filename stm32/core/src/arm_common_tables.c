@@ -203,7 +203,7 @@
 * Cos and Sin values are in interleaved fashion    
 *     
 */
-/*const float32_t twiddleCoef_16[32] = {
+const float32_t twiddleCoef_16[32] = {
     1.000000000f,  0.000000000f,
     0.923879533f,  0.382683432f,
     0.707106781f,  0.707106781f,
@@ -221,7 +221,6 @@
     0.707106781f, -0.707106781f,
     0.923879533f, -0.382683432f
 };
-*/
 /**    
 * \par    
 * Example code for Floating-point Twiddle factors Generation:    
@@ -237,7 +236,7 @@
 * Cos and Sin values are in interleaved fashion    
 *     
 */
-/*const float32_t twiddleCoef_32[64] = {
+const float32_t twiddleCoef_32[64] = {
     1.000000000f,  0.000000000f,
     0.980785280f,  0.195090322f,
     0.923879533f,  0.382683432f,
@@ -270,7 +269,7 @@
     0.831469612f, -0.555570233f,
     0.923879533f, -0.382683432f,
     0.980785280f, -0.195090322f
-};*/
+};
 
 /**    
 * \par    
@@ -287,7 +286,7 @@
 * Cos and Sin values are in interleaved fashion    
 *     
 */
-/*const float32_t twiddleCoef_64[128] = {
+const float32_t twiddleCoef_64[128] = {
     1.000000000f,  0.000000000f,
     0.995184727f,  0.098017140f,
     0.980785280f,  0.195090322f,
@@ -352,7 +351,7 @@
     0.956940336f, -0.290284677f,
     0.980785280f, -0.195090322f,
     0.995184727f, -0.098017140f
-};*/
+};
 
 /**    
 * \par    
@@ -370,7 +369,7 @@
 *     
 */
 
-/*const float32_t twiddleCoef_128[256] = {
+const float32_t twiddleCoef_128[256] = {
     1.000000000f	,	0.000000000f	,
     0.998795456f	,	0.049067674f	,
     0.995184727f	,	0.098017140f	,
@@ -499,7 +498,7 @@
     0.989176510f	,	-0.146730474f	,
     0.995184727f	,	-0.098017140f	,
     0.998795456f	,	-0.049067674f
-};*/
+};
 
 /**    
 * \par    
@@ -516,7 +515,7 @@
 * Cos and Sin values are in interleaved fashion    
 *     
 */
-/*const float32_t twiddleCoef_256[512] = {
+const float32_t twiddleCoef_256[512] = {
     1.000000000f,  0.000000000f,
     0.999698819f,  0.024541229f,
     0.998795456f,  0.049067674f,
@@ -773,7 +772,7 @@
     0.997290457f, -0.073564564f,
     0.998795456f, -0.049067674f,
     0.999698819f, -0.024541229f
-};*/
+};
 
 /**    
 * \par    
@@ -21220,7 +21219,6 @@ const float32_t twiddleCoef_512[1024] = {
   0x4521CCE1, 0x448DB244, 0x43FC0CFA, 0x436CCD78, 0x42DFE4B4, 0x42554426,
   0x41CCDDB6, 0x4146A3C6, 0x40C28923, 0x40408102
 };*/
-/*
 const uint16_t armBitRevIndexTable16[ARMBITREVINDEXTABLE__16_TABLE_LENGTH] = 
 {
    //8x2, size 20
@@ -21299,7 +21297,6 @@ const uint16_t armBitRevIndexTable256[ARMBITREVINDEXTABLE_256_TABLE_LENGTH] =
    1880,1904, 1888,1984, 1896,2000, 1912,2032, 1904,2016, 1976,2032,
    1960,1968, 2008,2032, 1992,2016, 2024,2032
 };
-*/
 const uint16_t armBitRevIndexTable512[ARMBITREVINDEXTABLE_512_TABLE_LENGTH] = 
 {
    //radix 8, size 448